@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../src/Bounds.hpp"
+#include "../src/Bvh.hpp"
+#include "../src/Random.hpp"
+#include "../src/Ray.hpp"
+#include "../src/Tuple.hpp"
+
+/*
+  Builds hierarchies over a million small boxes with the binned surface
+  area heuristic and as an LBVH, each on one thread and on every hardware
+  thread, and reports the build time, the cost of the tree and how fast
+  rays find their nearest box through it.
+*/
+
+namespace {
+
+constexpr int box_count = 1'000'000;
+constexpr int ray_count = 100'000;
+
+template <typename Build>
+void measure(std::string_view name, const std::vector<Bounds>& boxes,
+             const std::vector<Ray>& rays, const Build& build) {
+  using clock = std::chrono::steady_clock;
+  const auto start = clock::now();
+  const auto bvh = build();
+  const std::chrono::duration<double> building = clock::now() - start;
+
+  // Boxes are hit where rays enter them
+  std::size_t hits = 0;
+  const auto traced = clock::now();
+  for (const auto& ray : rays) {
+    const auto slab = BoundsUtil::slab_ray(ray);
+    RayUtil::NearestHit nearest;
+    BvhUtil::traverse(bvh, ray, nearest,
+                      [&](std::uint32_t item, RayUtil::NearestHit& xs) {
+                        const auto t = BoundsUtil::entry(
+                            boxes[item], slab,
+                            std::numeric_limits<float>::infinity());
+                        if (t == std::numeric_limits<float>::infinity())
+                          return;
+                        xs.index = item;
+                        xs.push_back(Intersection(t, ShapeType::Cube, item));
+                      });
+    if (nearest.hit) ++hits;
+  }
+  const std::chrono::duration<double> tracing = clock::now() - traced;
+
+  std::cout << name << ": " << building.count() << " s to build, cost "
+            << static_cast<double>(bvh.build_cost) << ", "
+            << static_cast<double>(rays.size()) / tracing.count() / 1e6
+            << " M rays/s (" << hits << " hits)\n";
+}
+
+}  // namespace
+
+int main() {
+  using namespace TupleUtil;
+
+  RandomUtil::RandomStream random(0, 0, 0);
+  const auto between = [&random](float low, float high) {
+    return low + (high - low) * random.next();
+  };
+
+  // Clusters of boxes of various sizes, as in scenes of many objects
+  std::vector<Bounds> boxes;
+  while (boxes.size() < box_count) {
+    const auto center =
+        point(between(-500, 500), between(-500, 500), between(-500, 500));
+    const auto spread = between(1, 50);
+    for (int i = 0; i < 1000; ++i) {
+      const auto size = between(0.05f, 0.5f);
+      const auto corner = center + vector(between(-spread, spread),
+                                          between(-spread, spread),
+                                          between(-spread, spread));
+      boxes.push_back(Bounds{{corner.x, corner.y, corner.z},
+                             {corner.x + size, corner.y + size,
+                              corner.z + size}});
+    }
+  }
+
+  std::vector<Ray> rays;
+  for (int i = 0; i < ray_count; ++i) {
+    rays.push_back(Ray{point(0, 0, -1000),
+                       normalize(vector(between(-0.5f, 0.5f),
+                                        between(-0.5f, 0.5f), 1))});
+  }
+
+  const auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::cout << threads << " hardware threads\n";
+  measure("binned SAH", boxes, rays, [&] { return BvhUtil::build(boxes); });
+  measure("binned SAH, parallel", boxes, rays,
+          [&] { return BvhUtil::parallel_build(boxes, threads); });
+  measure("LBVH", boxes, rays, [&] { return BvhUtil::build_lbvh(boxes); });
+  measure("LBVH, parallel", boxes, rays,
+          [&] { return BvhUtil::parallel_build_lbvh(boxes, threads); });
+  return 0;
+}
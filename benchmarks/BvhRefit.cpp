@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <numbers>
+#include <string_view>
+#include <vector>
+
+#include "../src/Instance.hpp"
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Random.hpp"
+#include "../src/Ray.hpp"
+#include "../src/World.hpp"
+
+/*
+  Animates instances turning around the y axis like the hands of a clock,
+  each at its own speed, and keeps the hierarchy over them up to date
+  every frame either by building it again or by refitting it, which only
+  builds it again once it has degraded. Both report the time spent on the
+  hierarchy and on tracing the same rays through each frame.
+*/
+
+namespace {
+
+constexpr int instance_count = 20000;
+constexpr int frame_count = 60;
+constexpr int rays_per_frame = 2000;
+
+struct Placement {
+  float radius;
+  float height;
+  float speed;
+};
+
+template <typename Update>
+void animate(std::string_view name, World world,
+             const std::vector<Placement>& placements,
+             const std::vector<Ray>& rays, const Update& update) {
+  using clock = std::chrono::steady_clock;
+  std::chrono::duration<double> updating{0};
+  std::chrono::duration<double> tracing{0};
+  std::size_t rebuilds = 0;
+  std::size_t hits = 0;
+
+  for (int frame = 0; frame < frame_count; ++frame) {
+    const auto time = static_cast<float>(frame) / frame_count;
+    for (std::size_t i = 0; i < placements.size(); ++i) {
+      const auto& [radius, height, speed] = placements[i];
+      world.set_transform(
+          i, MatrixUtil::rotation_y(2 * std::numbers::pi_v<float> * speed *
+                                    time) *
+                 MatrixUtil::translation(0, height, radius));
+    }
+
+    const auto start = clock::now();
+    if (update(world)) ++rebuilds;
+    const auto traced = clock::now();
+    for (const auto& ray : rays) {
+      if (WorldUtil::hit(world, ray)) ++hits;
+    }
+    updating += traced - start;
+    tracing += clock::now() - traced;
+  }
+
+  std::cout << name << ": " << updating.count() << " s updating ("
+            << rebuilds << " builds), " << tracing.count()
+            << " s tracing (" << hits << " hits)\n";
+}
+
+}  // namespace
+
+int main() {
+  using namespace MatrixUtil;
+  using namespace TupleUtil;
+
+  RandomUtil::RandomStream random(0, 0, 0);
+  const auto between = [&random](float low, float high) {
+    return low + (high - low) * random.next();
+  };
+
+  World world;
+  const std::vector<Shape> hand{
+      Cube{translation(0, 0, 0.5f) * scaling(0.05f, 0.05f, 0.5f)},
+      Sphere{translation(0, 0, 1) * scaling(0.1f, 0.1f, 0.1f)}};
+  const auto prototype = world.add(Prototype(hand));
+
+  std::vector<Placement> placements;
+  for (int i = 0; i < instance_count; ++i) {
+    placements.push_back(
+        Placement{between(1, 40), between(-20, 20), between(0.5f, 1.5f)});
+    world.add(Instance{prototype});
+  }
+  world.build_instance_bvh();
+
+  std::vector<Ray> rays;
+  for (int i = 0; i < rays_per_frame; ++i) {
+    rays.push_back(Ray{point(0, 0, -80),
+                       normalize(vector(between(-0.5f, 0.5f),
+                                        between(-0.3f, 0.3f), 1))});
+  }
+
+  animate("build every frame", world, placements, rays, [](World& w) {
+    w.build_instance_bvh();
+    return true;
+  });
+  animate("refit", world, placements, rays,
+          [](World& w) { return w.update_instance_bvh(); });
+  return 0;
+}
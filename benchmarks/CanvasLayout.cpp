@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../src/Canvas.hpp"
+
+/*
+  Measures canvas write throughput of a tile renderer for every layout:
+  workers claim square tiles from a shared counter and write all of their
+  pixels, the way RenderUtil::render does. Reading the canvas back in
+  row-major order, as the image exporters do, is timed as well. Usage:
+
+    canvas-layout [threads]
+*/
+
+namespace {
+
+constexpr int side = 4096;
+constexpr int repetitions = 8;
+
+double write_tiles(Canvas& canvas, int tile_size, unsigned threads) {
+  const int tiles_x = (canvas.width() + tile_size - 1) / tile_size;
+  const int tiles_y = (canvas.height() + tile_size - 1) / tile_size;
+  const int tile_count = tiles_x * tiles_y;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int repetition = 0; repetition < repetitions; ++repetition) {
+    std::atomic<int> next_tile{0};
+    const auto worker = [&] {
+      for (int tile = next_tile++; tile < tile_count; tile = next_tile++) {
+        const int x0 = (tile % tiles_x) * tile_size;
+        const int y0 = (tile / tiles_x) * tile_size;
+        const int x1 = std::min(x0 + tile_size, canvas.width());
+        const int y1 = std::min(y0 + tile_size, canvas.height());
+        for (int y = y0; y < y1; ++y) {
+          for (int x = x0; x < x1; ++x) {
+            const auto value = static_cast<float>(x ^ y ^ repetition);
+            canvas.write_pixel(x, y, Color(value, value, value));
+          }
+        }
+      }
+    };
+
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(worker);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+double read_rows(const Canvas& canvas) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int repetition = 0; repetition < repetitions; ++repetition) {
+    float sum = 0;
+    for (const auto& pixel : canvas) sum += pixel.red;
+    // Keeps the loop from being optimized away
+    volatile float sink = sum;
+    static_cast<void>(sink);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void measure(std::string_view name, CanvasLayout layout, unsigned threads) {
+  Canvas canvas(side, side, layout);
+  const auto megapixels =
+      static_cast<double>(side) * side * repetitions / 1e6;
+
+  std::cout << name << ':';
+  for (const int tile_size : {8, 16, 64}) {
+    const auto seconds = write_tiles(canvas, tile_size, threads);
+    std::cout << "  " << tile_size << "px tiles " << megapixels / seconds
+              << " Mpixel/s";
+  }
+  std::cout << "  row-major read " << megapixels / read_rows(canvas)
+            << " Mpixel/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+  if (argc > 1)
+    threads = static_cast<unsigned>(std::max(std::stoi(argv[1]), 1));
+
+  std::cout << threads << " thread(s), " << side << 'x' << side
+            << " canvas\n";
+  measure("row-major", CanvasLayout::RowMajor, threads);
+  measure("blocked", CanvasLayout::Blocked, threads);
+  measure("morton", CanvasLayout::Morton, threads);
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../src/Canvas.hpp"
+#include "../src/Png.hpp"
+#include "../src/Ppm.hpp"
+#include "../src/Qoi.hpp"
+
+/*
+  Measures the encoding speed and the size of the image formats on a
+  synthetic render-like image: smooth shading, flat background and hard
+  edges. Speeds are in megabytes of raw RGB input per second and sizes are
+  compared to the P3 PPM of the same image.
+*/
+
+namespace {
+
+constexpr int width = 1920;
+constexpr int height = 1080;
+
+Canvas make_image() {
+  Canvas canvas(width, height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const auto dx = static_cast<float>(x - width / 2) / (height / 3.f);
+      const auto dy = static_cast<float>(y - height / 2) / (height / 3.f);
+      const auto d2 = dx * dx + dy * dy;
+      if (d2 < 1.f) {
+        const auto shade = std::sqrt(1.f - d2) * 0.9f + 0.1f;
+        canvas.write_pixel(x, y, Color(shade, 0.2f * shade, 0.1f * shade));
+      } else {
+        const auto floor = ((x / 64 + y / 64) % 2 == 0) ? 0.8f : 0.3f;
+        canvas.write_pixel(x, y, Color(floor, floor, floor * 0.9f));
+      }
+    }
+  }
+  return canvas;
+}
+
+template <typename Encode>
+void measure(std::string_view name, const Encode& encode,
+             std::size_t ppm_size) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto encoded = encode();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const auto megabytes = 3. * width * height / (1024 * 1024);
+  std::cout << name << ": " << encoded.size() << " bytes ("
+            << static_cast<double>(encoded.size()) * 100. /
+                   static_cast<double>(ppm_size)
+            << "% of P3), " << megabytes / elapsed.count() << " MB/s\n";
+}
+
+}  // namespace
+
+int main() {
+  const auto image = make_image();
+  const auto ppm_size = CanvasUtil::to_ppm(image).size();
+
+  measure("P3 PPM", [&] { return CanvasUtil::to_ppm(image); }, ppm_size);
+  measure("QOI", [&] { return CanvasUtil::to_qoi(image); }, ppm_size);
+  measure("PNG", [&] { return CanvasUtil::to_png(image); }, ppm_size);
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../src/Instance.hpp"
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Random.hpp"
+#include "../src/Ray.hpp"
+#include "../src/World.hpp"
+
+/*
+  Places many copies of a cluster of rotated cubes, once as instances of a
+  single prototype and once as that many copies of every shape, and
+  measures the hits of the same rays in both worlds along with the number
+  of shapes each one stores.
+*/
+
+namespace {
+
+constexpr int cluster_size = 64;
+constexpr int grid = 16;
+constexpr int ray_count = 20000;
+
+struct Checksum {
+  double distances{0};
+  std::size_t hits{0};
+
+  void add(const std::optional<Intersection>& hit) {
+    if (!hit) return;
+    distances += static_cast<double>(hit->t());
+    ++hits;
+  }
+};
+
+void measure(std::string_view name, const World& world,
+             std::size_t stored_shapes, const std::vector<Ray>& rays) {
+  Checksum checksum;
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& ray : rays) checksum.add(WorldUtil::hit(world, ray));
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << name << ": " << stored_shapes << " shapes stored, "
+            << elapsed.count() << " s, "
+            << static_cast<double>(rays.size()) / elapsed.count() / 1e6
+            << " M rays/s (" << checksum.hits << " hits, distance sum "
+            << checksum.distances << ")\n";
+}
+
+}  // namespace
+
+int main() {
+  using namespace MatrixUtil;
+  using namespace TupleUtil;
+
+  RandomUtil::RandomStream random(0, 0, 0);
+  const auto between = [&random](float low, float high) {
+    return low + (high - low) * random.next();
+  };
+
+  std::vector<Shape> cluster;
+  for (int i = 0; i < cluster_size; ++i) {
+    cluster.push_back(Cube{translation(between(-4, 4), between(-4, 4),
+                                       between(-4, 4)) *
+                           rotation_y(between(0, 3)) *
+                           scaling(0.3f, 0.3f, 0.3f)});
+  }
+
+  World instanced;
+  World expanded;
+  const auto prototype = instanced.add(Prototype(cluster));
+  for (int x = 0; x < grid; ++x) {
+    for (int y = 0; y < grid; ++y) {
+      const auto place = translation(static_cast<float>(12 * x - 90),
+                                     static_cast<float>(12 * y - 90), 60) *
+                         rotation_z(static_cast<float>(x + y));
+      instanced.add(Instance{prototype, place});
+      for (auto shape : cluster) {
+        std::visit([&place](auto& s) { s.transform = place * s.transform; },
+                   shape);
+        expanded.add(std::move(shape));
+      }
+    }
+  }
+  instanced.build_instance_bvh();
+
+  std::vector<Ray> rays;
+  for (int i = 0; i < ray_count; ++i) {
+    rays.push_back(Ray{point(0, 0, 0), normalize(vector(between(-1.5f, 1.5f),
+                                                        between(-1.5f, 1.5f),
+                                                        1))});
+  }
+
+  measure("instances", instanced, instanced.prototypes()[0].primitive_count(),
+          rays);
+  measure("copies", expanded, expanded.size(), rays);
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../src/Obj.hpp"
+
+/*
+  Measures OBJ loading throughput. Usage:
+
+    obj-loading [file.obj]
+
+  Without a file, a synthetic grid mesh of roughly 300 MB is written to the
+  temporary directory and loaded instead.
+*/
+
+namespace {
+
+std::filesystem::path write_grid(int side) {
+  const auto path = std::filesystem::temp_directory_path() / "obj_bench.obj";
+  std::ofstream file(path);
+  for (int y = 0; y < side; ++y) {
+    for (int x = 0; x < side; ++x) {
+      file << "v " << static_cast<float>(x) * 0.001f << ' '
+           << static_cast<float>(y) * 0.001f << ' '
+           << static_cast<float>((x * y) % 17) * 0.0137f << '\n';
+    }
+  }
+  for (int y = 1; y < side; ++y) {
+    for (int x = 1; x < side; ++x) {
+      const auto v = y * side + x + 1;
+      file << "f " << v - side - 1 << ' ' << v - side << ' ' << v << ' '
+           << v - 1 << '\n';
+    }
+  }
+  return path;
+}
+
+void measure(const std::filesystem::path& path, unsigned threads) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto mesh = ObjUtil::load(path, threads);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (!mesh) {
+    std::cerr << "Could not load " << path << '\n';
+    return;
+  }
+
+  const auto megabytes =
+      static_cast<double>(std::filesystem::file_size(path)) / (1024 * 1024);
+  std::cout << threads << " thread(s): " << mesh->triangle_count()
+            << " triangles, " << megabytes << " MB in " << elapsed.count()
+            << " s (" << megabytes / elapsed.count() << " MB/s)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const bool synthetic = argc < 2;
+  const auto path =
+      synthetic ? write_grid(2500) : std::filesystem::path(argv[1]);
+
+  measure(path, 1);
+  measure(path, std::max(1u, std::thread::hardware_concurrency()));
+
+  if (synthetic) std::filesystem::remove(path);
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "../src/Canvas.hpp"
+#include "../src/MappedCanvas.hpp"
+#include "../src/Ppm.hpp"
+
+/*
+  Measures PPM reading throughput. A 4096x4096 gradient is written to the
+  temporary directory as P3 and as P6, then both files are loaded back.
+*/
+
+namespace {
+
+constexpr int side = 4096;
+
+Color gradient(int x, int y) {
+  return Color(static_cast<float>(x) / side, static_cast<float>(y) / side,
+               static_cast<float>((x * y) % 251) / 250.f);
+}
+
+void measure(std::string_view name, const std::filesystem::path& path) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto image = CanvasUtil::load_ppm(path);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (!image) {
+    std::cerr << "Could not load " << path << '\n';
+    return;
+  }
+
+  const auto megabytes =
+      static_cast<double>(std::filesystem::file_size(path)) / (1024 * 1024);
+  const auto megapixels = static_cast<double>(side) * side / 1e6;
+  std::cout << name << ": " << megabytes << " MB in " << elapsed.count()
+            << " s (" << megabytes / elapsed.count() << " MB/s, "
+            << megapixels / elapsed.count() << " Mpixel/s)\n";
+}
+
+}  // namespace
+
+int main() {
+  const auto directory = std::filesystem::temp_directory_path();
+  const auto p3_path = directory / "ppm_bench_p3.ppm";
+  const auto p6_path = directory / "ppm_bench_p6.ppm";
+
+  {
+    Canvas canvas(side, side);
+    auto binary = MappedCanvas::create(p6_path, side, side);
+    if (!binary) {
+      std::cerr << "Could not create " << p6_path << '\n';
+      return 1;
+    }
+    for (int y = 0; y < side; ++y) {
+      for (int x = 0; x < side; ++x) {
+        canvas.write_pixel(x, y, gradient(x, y));
+        binary->write_pixel(x, y, gradient(x, y));
+      }
+    }
+    std::ofstream(p3_path) << CanvasUtil::to_ppm(canvas);
+  }
+
+  measure("P3", p3_path);
+  measure("P6", p6_path);
+
+  std::filesystem::remove(p3_path);
+  std::filesystem::remove(p6_path);
+  return 0;
+}
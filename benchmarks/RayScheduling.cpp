@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numbers>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Render.hpp"
+#include "../src/Scene.hpp"
+
+/*
+  Measures rays/s of depth-first and wavefront scheduling on scenes where
+  most camera rays bounce: a mirror floor and wall around glass and
+  reflective spheres, then the same scene with a reflective triangle mesh
+  added. Both schedulings cast the same rays, so the rates compare
+  directly. Usage:
+
+    ray-scheduling [threads]
+*/
+
+namespace {
+
+constexpr std::string_view scene_source =
+    "camera 160 120 1.0472 from 0 1.5 -5 to 0 1 0 up 0 1 0\n"
+    "light -10 10 -10 1 1 1\n"
+    "light 6 8 -4 0.4 0.4 0.5\n"
+    "material mirror color 0.2 0.2 0.2 reflective 0.7\n"
+    "material glass reflective 0.1 transparency 0.9 refractive-index 1.5\n"
+    "material chrome color 0.8 0.6 0.3 reflective 0.5\n"
+    "plane material mirror\n"
+    "plane material mirror rotate-x 1.5708 translate 0 0 6\n"
+    "sphere material glass translate -0.6 1 0\n"
+    "sphere material chrome scale 0.5 0.5 0.5 translate 1.2 0.5 -0.8\n"
+    "sphere material chrome scale 0.4 0.4 0.4 translate -1.8 0.4 1.2\n";
+
+constexpr int samples = 2;
+
+/*
+  Sphere of radius 1 made of rings x 2 * rings quads, split in triangles
+*/
+TriangleMesh tessellated_sphere(int rings) {
+  TriangleMesh mesh;
+  const int segments = 2 * rings;
+  for (int ring = 0; ring <= rings; ++ring) {
+    const auto theta = std::numbers::pi_v<float> * static_cast<float>(ring) /
+                       static_cast<float>(rings);
+    for (int segment = 0; segment < segments; ++segment) {
+      const auto phi = 2 * std::numbers::pi_v<float> *
+                       static_cast<float>(segment) /
+                       static_cast<float>(segments);
+      mesh.vertices.insert(mesh.vertices.end(),
+                           {std::sin(theta) * std::cos(phi), std::cos(theta),
+                            std::sin(theta) * std::sin(phi)});
+    }
+  }
+  const auto vertex = [segments](int ring, int segment) {
+    return static_cast<std::uint32_t>(ring * segments + segment % segments);
+  };
+  for (int ring = 0; ring < rings; ++ring) {
+    for (int segment = 0; segment < segments; ++segment) {
+      const auto a = vertex(ring, segment);
+      const auto b = vertex(ring, segment + 1);
+      const auto c = vertex(ring + 1, segment + 1);
+      const auto d = vertex(ring + 1, segment);
+      mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+    }
+  }
+  mesh.packets = MeshUtil::pack(mesh);
+  return mesh;
+}
+
+void measure(std::string_view name, const Scene& scene,
+             RenderSettings settings, RayScheduling scheduling) {
+  settings.scheduling = scheduling;
+  RayCounters counters;
+  const auto start = std::chrono::steady_clock::now();
+  static_cast<void>(
+      RenderUtil::render(scene.camera, scene.world, settings, &counters));
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const auto rays = static_cast<double>(counters.primary +
+                                        counters.secondary() +
+                                        counters.shadow);
+  std::cout << name << ": " << elapsed.count() << " s  "
+            << rays / elapsed.count() / 1e6 << " Mrays/s  ("
+            << counters.secondary() << " secondary rays)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+  if (argc > 1)
+    threads = static_cast<unsigned>(std::max(std::stoi(argv[1]), 1));
+
+  const auto scene = SceneUtil::parse(scene_source);
+  if (!scene) {
+    std::cerr << "invalid benchmark scene\n";
+    return 1;
+  }
+
+  auto with_mesh = *scene;
+  Material blue_mirror;
+  blue_mirror.color = Color(0.3f, 0.4f, 0.8f);
+  blue_mirror.reflective = 0.6f;
+  auto mesh = tessellated_sphere(12);
+  mesh.material = with_mesh.world.add(blue_mirror);
+  mesh.transform = MatrixUtil::translation(0.9f, 1.4f, 1.5f) *
+                   MatrixUtil::scaling(0.7f, 0.7f, 0.7f);
+  with_mesh.world.add(std::move(mesh));
+
+  std::cout << threads << " thread(s), " << samples << " samples\n";
+  const std::pair<std::string_view, const Scene*> scenes[] = {
+      {"spheres", &*scene}, {"mesh", &with_mesh}};
+  for (const auto& [name, tested] : scenes) {
+    for (const int tile_size : {8, 16, 32}) {
+      const RenderSettings settings{threads, tile_size, samples};
+      std::cout << name << ", " << tile_size << "px tiles\n";
+      measure("  depth first", *tested, settings, RayScheduling::DepthFirst);
+      measure("  wavefront", *tested, settings, RayScheduling::Wavefront);
+    }
+  }
+  return 0;
+}
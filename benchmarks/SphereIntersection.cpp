@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Random.hpp"
+#include "../src/Ray.hpp"
+#include "../src/World.hpp"
+
+/*
+  Measures the nearest hit of rays among spheres that are only translated
+  and scaled, the most common spheres of our scenes. The same rays go
+  through the object space test with the cached inverse transformation,
+  the scalar center/radius test and the sphere packets of WorldUtil::hit.
+*/
+
+namespace {
+
+constexpr int sphere_count = 1024;
+constexpr int ray_count = 20000;
+
+struct Checksum {
+  double distances{0};
+  std::size_t hits{0};
+
+  void add(const std::optional<Intersection>& hit) {
+    if (!hit) return;
+    distances += static_cast<double>(hit->t());
+    ++hits;
+  }
+};
+
+template <typename Hit>
+void measure(std::string_view name, const std::vector<Ray>& rays,
+             const Hit& hit) {
+  Checksum checksum;
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& ray : rays) checksum.add(hit(ray));
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const auto tests = static_cast<double>(rays.size()) * sphere_count;
+  std::cout << name << ": " << elapsed.count() << " s, "
+            << tests / elapsed.count() / 1e6 << " M ray/sphere tests/s ("
+            << checksum.hits << " hits, distance sum " << checksum.distances
+            << ")\n";
+}
+
+}  // namespace
+
+int main() {
+  using namespace MatrixUtil;
+  using namespace TupleUtil;
+
+  RandomUtil::RandomStream random(0, 0, 0);
+  const auto between = [&random](float low, float high) {
+    return low + (high - low) * random.next();
+  };
+
+  World world;
+  std::vector<SphereGeometry> spheres;
+  for (int i = 0; i < sphere_count; ++i) {
+    const auto center =
+        point(between(-20, 20), between(-20, 20), between(10, 50));
+    const auto radius = between(0.2f, 1.f);
+    world.add(Sphere{translation(center.x, center.y, center.z) *
+                     scaling(radius, radius, radius)});
+    spheres.push_back(SphereGeometry{center, radius});
+  }
+
+  std::vector<Ray> rays;
+  for (int i = 0; i < ray_count; ++i) {
+    rays.push_back(Ray{point(0, 0, 0), normalize(vector(between(-0.4f, 0.4f),
+                                                        between(-0.4f, 0.4f),
+                                                        1))});
+  }
+
+  measure("object space", rays, [&](const Ray& ray) {
+    RayUtil::NearestHit nearest;
+    for (std::size_t i = 0; i < world.size(); ++i) {
+      nearest.index = i;
+      RayUtil::local_intersect(
+          RayUtil::transform(ray, world.inverse_transform(i)), Sphere{},
+          nearest);
+    }
+    return nearest.hit;
+  });
+
+  measure("center and radius", rays, [&](const Ray& ray) {
+    RayUtil::NearestHit nearest;
+    for (std::size_t i = 0; i < spheres.size(); ++i) {
+      nearest.index = i;
+      for (const auto& intersection : RayUtil::intersect(ray, spheres[i]))
+        nearest.push_back(intersection);
+    }
+    return nearest.hit;
+  });
+
+  measure("sphere packets", rays,
+          [&](const Ray& ray) { return WorldUtil::hit(world, ray); });
+  return 0;
+}
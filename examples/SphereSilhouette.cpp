@@ -6,6 +6,7 @@
 #include "../src/MatrixTransformations.hpp"
 #include "../src/Ppm.hpp"
 #include "../src/Ray.hpp"
+#include "../src/Sampling.hpp"
 #include "../src/Tuple.hpp"
 
 void paint_point(Canvas& canvas, float x, float z) {
@@ -26,6 +27,8 @@ int main() {
   constexpr float pixel_size = wall_size / canvas_pixels;
   constexpr float half = wall_size / 2;
 
+  constexpr int samples = 16;
+
   Canvas canvas(canvas_pixels, canvas_pixels);
   constexpr Color color(1, 0, 0);
   Sphere shape;
@@ -33,17 +36,25 @@ int main() {
   shape.transform = scaling(0.5, 1, 1).shearing(1, 0, 0, 0, 0, 0);
 
   for (int row = 0; row < canvas_pixels; ++row) {
-    const auto world_y = half - pixel_size * static_cast<float>(row);
     for (int col = 0; col < canvas_pixels; ++col) {
-      const auto world_x = half - pixel_size * static_cast<float>(col);
+      // The silhouette edge is antialiased by the fraction of stratified
+      // samples inside the pixel that hit the sphere
+      int hits = 0;
+      for (int sample = 0; sample < samples; ++sample) {
+        const auto [dx, dy] =
+            SamplingUtil::stratified_sample(col, row, sample, samples);
+        const auto world_x = half - pixel_size * (static_cast<float>(col) + dx);
+        const auto world_y = half - pixel_size * (static_cast<float>(row) + dy);
 
-      const auto position = point(world_x, world_y, wall_z);
+        const auto position = point(world_x, world_y, wall_z);
 
-      const Ray ray(ray_origin, normalize(position - ray_origin));
-      const auto xs = intersect(ray, shape);
+        const Ray ray(ray_origin, normalize(position - ray_origin));
+        if (!intersect(ray, shape).empty()) ++hits;
+      }
 
-      if (xs.has_value()) {
-        canvas.write_pixel(row, col, color);
+      if (hits > 0) {
+        canvas.write_pixel(col, row,
+                           color * (static_cast<float>(hits) / samples));
       }
     }
   }
@@ -0,0 +1,207 @@
+#ifndef CONSTEXPR_RAYTRACER_ACCUMULATION_BUFFER_HPP
+#define CONSTEXPR_RAYTRACER_ACCUMULATION_BUFFER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "MappedFile.hpp"
+
+/*
+  AccumulationBuffer:
+
+  Running sum of the samples of every pixel together with how many samples
+  were added, so renders can keep adding samples and resolve the average at
+  any time. Sums are kept in double precision: the 53-bit mantissa keeps
+  millions of float samples exact to float precision without compensated
+  summation.
+
+  Channels and counts live in separate arrays so resolving and merging are
+  plain loops over contiguous memory that compilers vectorize. Adding to
+  distinct pixels from several threads needs no synchronization, which is
+  the case for tile renderers since every tile owns its pixels.
+*/
+
+class AccumulationBuffer {
+ public:
+  AccumulationBuffer(int width, int height)
+      : width_{width},
+        height_{height},
+        counts_(pixel_count()),
+        red_(pixel_count()),
+        green_(pixel_count()),
+        blue_(pixel_count()) {
+    assert(width > 0 && height > 0);
+  }
+
+  [[nodiscard]] int width() const noexcept { return width_; }
+
+  [[nodiscard]] int height() const noexcept { return height_; }
+
+  /*
+    Adds `count` samples whose colors sum to `sum`
+  */
+  void add(int x, int y, const Color& sum, std::uint32_t count = 1) noexcept {
+    const auto i = index(x, y);
+    red_[i] += static_cast<double>(sum.red);
+    green_[i] += static_cast<double>(sum.green);
+    blue_[i] += static_cast<double>(sum.blue);
+    counts_[i] += count;
+  }
+
+  [[nodiscard]] std::uint32_t count(int x, int y) const noexcept {
+    return counts_[index(x, y)];
+  }
+
+  /*
+    Average of the samples of the pixel, black before any sample is added
+  */
+  [[nodiscard]] Color average(int x, int y) const noexcept {
+    const auto i = index(x, y);
+    if (counts_[i] == 0) return ColorUtil::black();
+    const auto count = static_cast<double>(counts_[i]);
+    return Color(static_cast<float>(red_[i] / count),
+                 static_cast<float>(green_[i] / count),
+                 static_cast<float>(blue_[i] / count));
+  }
+
+  /*
+    Writes the average of every pixel to the canvas, one row at a time
+  */
+  void resolve(Canvas& canvas) const noexcept {
+    assert(canvas.width() == width_ && canvas.height() == height_);
+
+    const auto width = static_cast<std::size_t>(width_);
+    std::vector<Color> colors(width);
+
+    for (int y = 0; y < height_; ++y) {
+      const auto row = static_cast<std::size_t>(y) * width;
+      for (std::size_t x = 0; x < width; ++x) {
+        const auto count = static_cast<double>(counts_[row + x]);
+        const auto scale = count > 0 ? 1 / count : 0.;
+        colors[x] = Color(static_cast<float>(red_[row + x] * scale),
+                          static_cast<float>(green_[row + x] * scale),
+                          static_cast<float>(blue_[row + x] * scale));
+      }
+      canvas.write_row(y, colors.data());
+    }
+  }
+
+  [[nodiscard]] Canvas resolve() const {
+    Canvas canvas(width_, height_);
+    resolve(canvas);
+    return canvas;
+  }
+
+  /*
+    Adds the samples of another buffer of the same size, e.g. one rendered
+    by another process with a different seed
+  */
+  [[nodiscard]] bool merge(const AccumulationBuffer& other) noexcept {
+    if (other.width_ != width_ || other.height_ != height_) return false;
+
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      counts_[i] += other.counts_[i];
+      red_[i] += other.red_[i];
+      green_[i] += other.green_[i];
+      blue_[i] += other.blue_[i];
+    }
+    return true;
+  }
+
+  /*
+    Binary file of the buffer: a header followed by the counts and the three
+    channel sums, in native byte order
+  */
+  [[nodiscard]] bool save(const std::filesystem::path& path) const {
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) return false;
+
+    const Header header{magic, version, static_cast<std::uint32_t>(width_),
+                        static_cast<std::uint32_t>(height_)};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(stream, counts_);
+    write_array(stream, red_);
+    write_array(stream, green_);
+    write_array(stream, blue_);
+    return static_cast<bool>(stream);
+  }
+
+  [[nodiscard]] static std::optional<AccumulationBuffer> load(
+      const std::filesystem::path& path) {
+    const auto file = MappedFile::open(path);
+    if (!file || file->size() < sizeof(Header)) return std::nullopt;
+
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != magic || header.version != version ||
+        header.width == 0 || header.height == 0)
+      return std::nullopt;
+
+    const auto pixels = std::size_t{header.width} * header.height;
+    const auto expected =
+        sizeof(Header) + pixels * (sizeof(std::uint32_t) + 3 * sizeof(double));
+    if (file->size() != expected) return std::nullopt;
+
+    AccumulationBuffer buffer(static_cast<int>(header.width),
+                              static_cast<int>(header.height));
+    const char* it = file->data() + sizeof(Header);
+    it = read_array(it, buffer.counts_);
+    it = read_array(it, buffer.red_);
+    it = read_array(it, buffer.green_);
+    read_array(it, buffer.blue_);
+    return buffer;
+  }
+
+ private:
+  struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+  };
+
+  static constexpr std::array<char, 8> magic{'C', 'R', 'T', 'A',
+                                             'C', 'C', 'U', 'M'};
+  static constexpr std::uint32_t version{1};
+
+  [[nodiscard]] std::size_t pixel_count() const noexcept {
+    return static_cast<std::size_t>(width_) * static_cast<std::size_t>(height_);
+  }
+
+  [[nodiscard]] std::size_t index(int x, int y) const noexcept {
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    return static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
+           static_cast<std::size_t>(x);
+  }
+
+  template <typename T>
+  static void write_array(std::ofstream& stream, const std::vector<T>& values) {
+    stream.write(reinterpret_cast<const char*>(values.data()),
+                 static_cast<std::streamsize>(values.size() * sizeof(T)));
+  }
+
+  template <typename T>
+  static const char* read_array(const char* it, std::vector<T>& values) {
+    std::memcpy(values.data(), it, values.size() * sizeof(T));
+    return it + values.size() * sizeof(T);
+  }
+
+  int width_;
+  int height_;
+  std::vector<std::uint32_t> counts_;
+  std::vector<double> red_;
+  std::vector<double> green_;
+  std::vector<double> blue_;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef CONSTEXPR_RAYTRACER_BOUNDS_HPP
+#define CONSTEXPR_RAYTRACER_BOUNDS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <variant>
+
+#include "MatrixTransformations.hpp"
+#include "Ray.hpp"
+#include "Shape.hpp"
+#include "Tuple.hpp"
+
+/*
+  Bounds: axis-aligned box given by its lowest and highest corner. The
+  default box is empty, with every minimum above every maximum, so merging
+  anything into it gives that thing's box.
+*/
+struct Bounds {
+  std::array<float, 3> min{std::numeric_limits<float>::infinity(),
+                           std::numeric_limits<float>::infinity(),
+                           std::numeric_limits<float>::infinity()};
+  std::array<float, 3> max{-std::numeric_limits<float>::infinity(),
+                           -std::numeric_limits<float>::infinity(),
+                           -std::numeric_limits<float>::infinity()};
+
+  [[nodiscard]] friend constexpr bool operator==(const Bounds&,
+                                                 const Bounds&) noexcept =
+      default;
+};
+
+namespace BoundsUtil {
+
+[[nodiscard]] constexpr Bounds merge(const Bounds& lhs,
+                                     const Bounds& rhs) noexcept {
+  Bounds result;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    result.min[axis] = std::min(lhs.min[axis], rhs.min[axis]);
+    result.max[axis] = std::max(lhs.max[axis], rhs.max[axis]);
+  }
+  return result;
+}
+
+[[nodiscard]] constexpr Bounds merge(const Bounds& bounds,
+                                     const Tuple& point) noexcept {
+  return merge(bounds, Bounds{{point.x, point.y, point.z},
+                              {point.x, point.y, point.z}});
+}
+
+[[nodiscard]] constexpr bool empty(const Bounds& bounds) noexcept {
+  return bounds.min[0] > bounds.max[0] || bounds.min[1] > bounds.max[1] ||
+         bounds.min[2] > bounds.max[2];
+}
+
+/*
+  True for boxes with every corner at a finite position, the only ones an
+  acceleration structure can transform and split
+*/
+[[nodiscard]] constexpr bool finite(const Bounds& bounds) noexcept {
+  constexpr auto infinity = std::numeric_limits<float>::infinity();
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    if (!(std::abs(bounds.min[axis]) < infinity) ||
+        !(std::abs(bounds.max[axis]) < infinity))
+      return false;
+  }
+  return true;
+}
+
+[[nodiscard]] constexpr std::array<float, 3> centroid(
+    const Bounds& bounds) noexcept {
+  return {(bounds.min[0] + bounds.max[0]) / 2,
+          (bounds.min[1] + bounds.max[1]) / 2,
+          (bounds.min[2] + bounds.max[2]) / 2};
+}
+
+/*
+  Area of the faces of the box, 0 for an empty box. The chance that a ray
+  through a box also goes through a box inside it is the ratio of their
+  areas.
+*/
+[[nodiscard]] constexpr float surface_area(const Bounds& bounds) noexcept {
+  if (empty(bounds)) return 0;
+  const auto x = bounds.max[0] - bounds.min[0];
+  const auto y = bounds.max[1] - bounds.min[1];
+  const auto z = bounds.max[2] - bounds.min[2];
+  return 2 * (x * y + y * z + z * x);
+}
+
+/*
+  Box of the 8 corners of a finite box moved by the transformation
+*/
+[[nodiscard]] constexpr Bounds transform(
+    const Bounds& bounds, const MatrixUtil::Transformation& matrix) noexcept {
+  Bounds result;
+  for (std::size_t corner = 0; corner < 8; ++corner) {
+    const auto x = (corner & 1) != 0 ? bounds.max[0] : bounds.min[0];
+    const auto y = (corner & 2) != 0 ? bounds.max[1] : bounds.min[1];
+    const auto z = (corner & 4) != 0 ? bounds.max[2] : bounds.min[2];
+    result = merge(result, matrix * TupleUtil::point(x, y, z));
+  }
+  return result;
+}
+
+/*
+  Box of a shape in its object space, before its own transformation.
+  Planes and cylinders or cones without both ends are unbounded
+*/
+[[nodiscard]] constexpr Bounds local_bounds(const Shape& shape) noexcept {
+  constexpr auto infinity = std::numeric_limits<float>::infinity();
+  return std::visit(
+      [](const auto& s) {
+        using T = std::decay_t<decltype(s)>;
+        if constexpr (std::is_same_v<T, Plane>) {
+          return Bounds{{-infinity, 0, -infinity}, {infinity, 0, infinity}};
+        } else if constexpr (std::is_same_v<T, Cylinder>) {
+          return Bounds{{-1, s.minimum, -1}, {1, s.maximum, 1}};
+        } else if constexpr (std::is_same_v<T, Cone>) {
+          const auto radius =
+              std::max(std::abs(s.minimum), std::abs(s.maximum));
+          return Bounds{{-radius, s.minimum, -radius},
+                        {radius, s.maximum, radius}};
+        } else if constexpr (std::is_same_v<T, TriangleMesh>) {
+          Bounds result;
+          for (std::size_t i = 0; i < s.vertex_count(); ++i)
+            result = merge(result, s.vertex(i));
+          return result;
+        } else {
+          return Bounds{{-1, -1, -1}, {1, 1, 1}};
+        }
+      },
+      shape);
+}
+
+/*
+  Box of a shape in the space its transformation leads to
+*/
+[[nodiscard]] constexpr Bounds bounds(const Shape& shape) noexcept {
+  const auto local = local_bounds(shape);
+  if (!finite(local)) return local;
+  return transform(local, ShapeUtil::transform(shape));
+}
+
+/*
+  SlabRay: a ray prepared for box tests, with the inverse of its direction
+  computed once. Axes the ray runs parallel to get an infinite inverse.
+*/
+struct SlabRay {
+  std::array<float, 3> origin;
+  std::array<float, 3> inverse_direction;
+};
+
+[[nodiscard]] constexpr SlabRay slab_ray(const Ray& ray) noexcept {
+  const auto inverse = [](float d) {
+    return d != 0 ? 1 / d : std::numeric_limits<float>::infinity();
+  };
+  return {{ray.origin.x, ray.origin.y, ray.origin.z},
+          {inverse(ray.direction.x), inverse(ray.direction.y),
+           inverse(ray.direction.z)}};
+}
+
+/*
+  Distance at which the ray enters the box, clamped to 0 when it starts
+  inside, or infinity when it misses the box or only reaches it beyond
+  max_t
+*/
+[[nodiscard]] constexpr float entry(const Bounds& bounds, const SlabRay& ray,
+                                    float max_t) noexcept {
+  constexpr auto miss = std::numeric_limits<float>::infinity();
+  float near = 0;
+  float far = max_t;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    if (ray.inverse_direction[axis] == miss) {
+      if (ray.origin[axis] < bounds.min[axis] ||
+          ray.origin[axis] > bounds.max[axis])
+        return miss;
+      continue;
+    }
+    const auto t0 =
+        (bounds.min[axis] - ray.origin[axis]) * ray.inverse_direction[axis];
+    const auto t1 =
+        (bounds.max[axis] - ray.origin[axis]) * ray.inverse_direction[axis];
+    near = std::max(near, std::min(t0, t1));
+    far = std::min(far, std::max(t0, t1));
+  }
+  return near <= far ? near : miss;
+}
+
+}  // namespace BoundsUtil
+
+#endif
@@ -0,0 +1,878 @@
+#ifndef CONSTEXPR_RAYTRACER_BVH_HPP
+#define CONSTEXPR_RAYTRACER_BVH_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "FlatArray.hpp"
+#include "Ray.hpp"
+#include "StaticVector.hpp"
+
+/*
+  BvhNode: box of a subtree. Interior nodes have count 0 and their two
+  children at first and first + 1; leaves hold the count items starting at
+  first in Bvh::items. Children always come after their parent.
+*/
+struct BvhNode {
+  Bounds bounds{};
+  std::uint32_t first{0};
+  std::uint32_t count{0};
+
+  [[nodiscard]] constexpr bool leaf() const noexcept { return count > 0; }
+
+  [[nodiscard]] friend constexpr bool operator==(const BvhNode&,
+                                                 const BvhNode&) noexcept =
+      default;
+};
+
+/*
+  BvhBuilder: how a hierarchy is built. Sah splits nodes with the binned
+  surface area heuristic, Lbvh sorts items along a Morton curve, which
+  builds much faster for previews but gives trees that rays take longer to
+  walk.
+*/
+enum class BvhBuilder { Sah, Lbvh };
+
+/*
+  Bvh: bounding volume hierarchy over items numbered from 0, flattened in
+  one array of nodes with the root first. build_cost is its cost right after
+  it was built, against which refitted trees are measured, and builder the
+  algorithm that built it. The arrays may view those of a scene cache.
+*/
+struct Bvh {
+  FlatArray<BvhNode> nodes{};
+  FlatArray<std::uint32_t> items{};
+  float build_cost{0};
+  BvhBuilder builder{BvhBuilder::Sah};
+};
+
+/*
+  BvhSettings:
+
+  builder: algorithm building the hierarchy
+  threads: threads building it, 0 uses one per hardware thread
+*/
+struct BvhSettings {
+  BvhBuilder builder{BvhBuilder::Sah};
+  unsigned threads{1};
+};
+
+namespace BvhUtil {
+
+inline constexpr std::size_t default_leaf_size = 4;
+
+// Deepest tree traverse can walk, far more than balanced trees need
+inline constexpr std::size_t max_depth = 64;
+
+// Depth from which the builders split nodes at their median instead of
+// their own way. Halving fewer than 2^32 items takes at most 32 more levels,
+// so skewed inputs that would keep peeling single items off a node still
+// give trees no deeper than max_depth
+inline constexpr std::size_t balanced_depth = max_depth / 2 - 1;
+
+// Relative costs of visiting a node and of testing an item in a leaf
+inline constexpr float traversal_cost = 1;
+inline constexpr float intersection_cost = 1;
+
+// How much more than its build cost a refitted tree may cost before update
+// builds it again
+inline constexpr float rebuild_ratio = 1.5f;
+
+/*
+  Surface area heuristic: expected cost of a ray that goes through the root,
+  where each node is visited with the probability that the ray goes through
+  its box, the ratio of its area to the area of the root
+*/
+[[nodiscard]] constexpr float cost(const Bvh& bvh) noexcept {
+  if (bvh.nodes.empty()) return 0;
+  const auto root_area = BoundsUtil::surface_area(bvh.nodes[0].bounds);
+  if (root_area == 0)
+    return intersection_cost * static_cast<float>(bvh.items.size());
+
+  float total = 0;
+  for (const auto& node : bvh.nodes) {
+    const auto area = BoundsUtil::surface_area(node.bounds);
+    total += node.leaf()
+                 ? area * intersection_cost * static_cast<float>(node.count)
+                 : area * traversal_cost;
+  }
+  return total / root_area;
+}
+
+/*
+  Updates the boxes of the nodes in place after the items moved, keeping
+  the tree as it is. Children come after their parent, so going through the
+  nodes backwards sees every child before its parent. A tree viewing the
+  arrays of a scene cache gets its own copy of them first.
+*/
+constexpr void refit(Bvh& bvh, std::span<const Bounds> bounds) {
+  for (auto node = bvh.nodes.rbegin(); node != bvh.nodes.rend(); ++node) {
+    Bounds box;
+    if (node->leaf()) {
+      for (auto i = node->first; i < node->first + node->count; ++i)
+        box = BoundsUtil::merge(box, bounds[bvh.items[i]]);
+    } else {
+      box = BoundsUtil::merge(bvh.nodes[node->first].bounds,
+                              bvh.nodes[node->first + 1].bounds);
+    }
+    node->bounds = box;
+  }
+}
+
+/*
+  Whether the tree can be walked and refitted without leaving its arrays,
+  for trees read from files: children come after their parent and inside
+  the nodes, leaves hold items inside the items, items are below item_count
+  and no path is deeper than traverse can follow
+*/
+[[nodiscard]] constexpr bool valid(const Bvh& bvh, std::size_t item_count) {
+  const auto node_count = bvh.nodes.size();
+  std::vector<std::size_t> depths(node_count, 0);
+  for (std::size_t i = 0; i < node_count; ++i) {
+    const auto& node = bvh.nodes[i];
+    const std::uint64_t first = node.first;
+    if (node.leaf()) {
+      if (first + node.count > bvh.items.size()) return false;
+      continue;
+    }
+    if (first <= i || first + 1 >= node_count || depths[i] + 1 >= max_depth)
+      return false;
+    depths[first] = std::max(depths[first], depths[i] + 1);
+    depths[first + 1] = std::max(depths[first + 1], depths[i] + 1);
+  }
+  return std::all_of(
+      bvh.items.begin(), bvh.items.end(),
+      [item_count](std::uint32_t item) { return item < item_count; });
+}
+
+namespace detail {
+
+// Bins per axis the centroids of a node are sorted into to find its split
+inline constexpr std::size_t bin_count = 16;
+
+// Nodes with fewer items are split without spreading their binning over
+// threads, and are built whole by one thread
+inline constexpr std::size_t parallel_min_items = 4096;
+
+[[nodiscard]] constexpr Bounds centroid_bounds(
+    std::span<const Bounds> bounds,
+    std::span<const std::uint32_t> items) noexcept {
+  Bounds result;
+  for (const auto item : items) {
+    const auto [x, y, z] = BoundsUtil::centroid(bounds[item]);
+    result = BoundsUtil::merge(result, TupleUtil::point(x, y, z));
+  }
+  return result;
+}
+
+/*
+  True when a leaf holds more than leaf_size items, which the builders only
+  do for items at the same place, and they have moved apart since
+*/
+[[nodiscard]] constexpr bool splittable(const Bvh& bvh,
+                                        std::span<const Bounds> bounds,
+                                        std::size_t leaf_size) noexcept {
+  for (const auto& node : bvh.nodes) {
+    if (node.count <= leaf_size) continue;
+    const auto box = centroid_bounds(
+        bounds, std::span(bvh.items).subspan(node.first, node.count));
+    if (box.min != box.max) return true;
+  }
+  return false;
+}
+
+/*
+  Splits of a range at the depth of its node: split(begin, end) reorders the
+  items of the range and returns where its second child starts, or begin to
+  make it a leaf, and split.balanced(begin, end) does the same at the median
+  for nodes from balanced_depth on
+*/
+template <typename Split>
+constexpr std::size_t split_at_depth(const Split& split, std::size_t begin,
+                                     std::size_t end, std::size_t depth) {
+  if (depth < balanced_depth) return split(begin, end);
+  return split.balanced(begin, end);
+}
+
+/*
+  Builds the subtree of the items from begin to end below the node root,
+  which must already be in nodes at the given depth, splitting ranges with
+  split_at_depth. Nodes are appended to nodes without their boxes, which
+  refit fills.
+*/
+template <typename Nodes, typename Split>
+constexpr void build_subtree(Nodes& nodes, std::size_t root, std::size_t begin,
+                             std::size_t end, const Split& split,
+                             std::size_t depth = 0) {
+  struct Range {
+    std::size_t node;
+    std::size_t begin;
+    std::size_t end;
+    std::size_t depth;
+  };
+  std::vector<Range> pending{{root, begin, end, depth}};
+
+  while (!pending.empty()) {
+    const auto range = pending.back();
+    pending.pop_back();
+
+    const auto middle =
+        split_at_depth(split, range.begin, range.end, range.depth);
+    if (middle == range.begin) {
+      nodes[range.node].first = static_cast<std::uint32_t>(range.begin);
+      nodes[range.node].count =
+          static_cast<std::uint32_t>(range.end - range.begin);
+      continue;
+    }
+
+    const auto left = nodes.size();
+    nodes[range.node].first = static_cast<std::uint32_t>(left);
+    nodes.emplace_back();
+    nodes.emplace_back();
+    pending.push_back({left, range.begin, middle, range.depth + 1});
+    pending.push_back({left + 1, middle, range.end, range.depth + 1});
+  }
+}
+
+/*
+  Fills the boxes of a tree whose nodes and items are laid out, and records
+  what it costs
+*/
+constexpr void finish(Bvh& bvh, std::span<const Bounds> bounds) noexcept {
+  refit(bvh, bounds);
+  bvh.build_cost = cost(bvh);
+}
+
+/*
+  Splits a range at the median centroid along the axis where centroids
+  spread the most
+*/
+constexpr std::size_t median_split(std::span<const Bounds> bounds,
+                                   std::span<std::uint32_t> items,
+                                   const Bounds& centroid_box) {
+  std::size_t axis = 0;
+  for (std::size_t a = 1; a < 3; ++a) {
+    if (centroid_box.max[a] - centroid_box.min[a] >
+        centroid_box.max[axis] - centroid_box.min[axis])
+      axis = a;
+  }
+  const auto middle = items.size() / 2;
+  std::nth_element(items.begin(),
+                   items.begin() + static_cast<std::ptrdiff_t>(middle),
+                   items.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+                     return BoundsUtil::centroid(bounds[lhs])[axis] <
+                            BoundsUtil::centroid(bounds[rhs])[axis];
+                   });
+  return middle;
+}
+
+struct Bin {
+  Bounds bounds{};
+  std::size_t count{0};
+};
+
+/*
+  Bins of the three axes, bin_count per axis. They are kept in a vector:
+  GCC 12 miscompiles the default initialization of nested arrays of Bin
+  once it has evaluated one in a constant expression.
+*/
+using Bins = std::vector<Bin>;
+
+[[nodiscard]] constexpr Bins empty_bins() { return Bins(3 * bin_count); }
+
+[[nodiscard]] constexpr std::size_t bin_index(const Bounds& centroid_box,
+                                              std::size_t axis,
+                                              float centroid) noexcept {
+  const auto extent = centroid_box.max[axis] - centroid_box.min[axis];
+  const auto bin = static_cast<std::size_t>(
+      (centroid - centroid_box.min[axis]) / extent *
+      static_cast<float>(bin_count));
+  return std::min(bin, bin_count - 1);
+}
+
+/*
+  Adds the items to the bins their centroid falls in along every axis where
+  the centroids of the node spread
+*/
+constexpr void bin(Bins& bins, const Bounds& centroid_box,
+                   std::span<const Bounds> bounds,
+                   std::span<const std::uint32_t> items) noexcept {
+  for (const auto item : items) {
+    const auto centroid = BoundsUtil::centroid(bounds[item]);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      if (centroid_box.max[axis] == centroid_box.min[axis]) continue;
+      auto& b = bins[axis * bin_count +
+                     bin_index(centroid_box, axis, centroid[axis])];
+      b.bounds = BoundsUtil::merge(b.bounds, bounds[item]);
+      ++b.count;
+    }
+  }
+}
+
+constexpr void merge(Bins& bins, const Bins& other) noexcept {
+  for (std::size_t i = 0; i < bins.size(); ++i) {
+    bins[i].bounds = BoundsUtil::merge(bins[i].bounds, other[i].bounds);
+    bins[i].count += other[i].count;
+  }
+}
+
+/*
+  Splits the items between two bins, at the boundary where the areas of the
+  two sides weighted by their item counts add up to the least, and returns
+  how many items went to the first side
+*/
+constexpr std::size_t sah_partition(const Bins& bins,
+                                    const Bounds& centroid_box,
+                                    std::span<const Bounds> bounds,
+                                    std::span<std::uint32_t> items) {
+  auto best_cost = std::numeric_limits<float>::infinity();
+  std::size_t best_axis = 0;
+  std::size_t best_bin = 0;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    if (centroid_box.max[axis] == centroid_box.min[axis]) continue;
+
+    // Area and item count of the bins from i to the last one
+    std::array<float, bin_count> right_area{};
+    std::array<std::size_t, bin_count> right_count{};
+    Bounds box;
+    std::size_t count = 0;
+    const auto* axis_bins = bins.data() + axis * bin_count;
+    for (auto i = bin_count - 1; i > 0; --i) {
+      box = BoundsUtil::merge(box, axis_bins[i].bounds);
+      count += axis_bins[i].count;
+      right_area[i] = BoundsUtil::surface_area(box);
+      right_count[i] = count;
+    }
+
+    box = Bounds{};
+    count = 0;
+    for (std::size_t i = 1; i < bin_count; ++i) {
+      box = BoundsUtil::merge(box, axis_bins[i - 1].bounds);
+      count += axis_bins[i - 1].count;
+      if (count == 0 || right_count[i] == 0) continue;
+      const auto split_cost =
+          BoundsUtil::surface_area(box) * static_cast<float>(count) +
+          right_area[i] * static_cast<float>(right_count[i]);
+      if (split_cost < best_cost) {
+        best_cost = split_cost;
+        best_axis = axis;
+        best_bin = i;
+      }
+    }
+  }
+
+  // Only boxes too large for their area to be finite leave no split
+  if (best_bin == 0) return median_split(bounds, items, centroid_box);
+  const auto second = std::partition(
+      items.begin(), items.end(), [&](std::uint32_t item) {
+        const auto centroid = BoundsUtil::centroid(bounds[item])[best_axis];
+        return bin_index(centroid_box, best_axis, centroid) < best_bin;
+      });
+  return static_cast<std::size_t>(second - items.begin());
+}
+
+/*
+  Split of the binned surface area heuristic: items whose centroids are
+  spread apart are binned along each axis and split at the bin boundary of
+  least cost
+*/
+struct SahSplit {
+  std::span<const Bounds> bounds;
+  std::span<std::uint32_t> items;
+  std::size_t leaf_size;
+
+  constexpr std::size_t operator()(std::size_t begin, std::size_t end) const {
+    const auto range = items.subspan(begin, end - begin);
+    const auto centroid_box = centroid_bounds(bounds, range);
+    if (range.size() <= leaf_size || centroid_box.min == centroid_box.max)
+      return begin;
+
+    auto bins = empty_bins();
+    bin(bins, centroid_box, bounds, range);
+    return begin + sah_partition(bins, centroid_box, bounds, range);
+  }
+
+  constexpr std::size_t balanced(std::size_t begin, std::size_t end) const {
+    const auto range = items.subspan(begin, end - begin);
+    const auto centroid_box = centroid_bounds(bounds, range);
+    if (range.size() <= leaf_size || centroid_box.min == centroid_box.max)
+      return begin;
+    return begin + median_split(bounds, range, centroid_box);
+  }
+};
+
+/*
+  Spreads each 10 bit coordinate of a Morton code over every third bit
+*/
+[[nodiscard]] constexpr std::uint32_t spread_bits(std::uint32_t x) noexcept {
+  x &= 0x3ffu;
+  x = (x | (x << 16)) & 0x030000ffu;
+  x = (x | (x << 8)) & 0x0300f00fu;
+  x = (x | (x << 4)) & 0x030c30c3u;
+  x = (x | (x << 2)) & 0x09249249u;
+  return x;
+}
+
+/*
+  Position of the centroid of the box along a Z-order curve through the
+  centroid box of every item, so that sorting by it keeps items that are
+  close together next to each other
+*/
+[[nodiscard]] constexpr std::uint32_t morton_code(
+    const Bounds& box, const Bounds& centroid_box) noexcept {
+  const auto centroid = BoundsUtil::centroid(box);
+  std::uint32_t code = 0;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    const auto extent = centroid_box.max[axis] - centroid_box.min[axis];
+    const auto offset = centroid[axis] - centroid_box.min[axis];
+    const auto cell =
+        extent > 0 ? std::min(1023.f, offset / extent * 1024) : 0.f;
+    code |= spread_bits(static_cast<std::uint32_t>(cell)) << (2 - axis);
+  }
+  return code;
+}
+
+/*
+  Split of items sorted by Morton code: a range is split where the highest
+  bit in which its codes differ changes, which halves the space it covers
+  along one axis without looking at the boxes
+*/
+struct MortonSplit {
+  std::span<const Bounds> bounds;
+  std::span<const std::uint32_t> codes;
+  std::span<std::uint32_t> items;
+  std::size_t leaf_size;
+
+  constexpr std::size_t operator()(std::size_t begin, std::size_t end) const {
+    if (end - begin <= leaf_size) return begin;
+    const auto first = codes[begin];
+    const auto last = codes[end - 1];
+    if (first == last) {
+      // Items in the same cell are split in half unless they are all at
+      // the same place
+      const auto box =
+          centroid_bounds(bounds, items.subspan(begin, end - begin));
+      return box.min == box.max ? begin : begin + (end - begin) / 2;
+    }
+
+    const auto bit = std::uint32_t{1} << (std::bit_width(first ^ last) - 1);
+    const auto second = std::partition_point(
+        codes.begin() + static_cast<std::ptrdiff_t>(begin),
+        codes.begin() + static_cast<std::ptrdiff_t>(end),
+        [bit](std::uint32_t code) { return (code & bit) == 0; });
+    return static_cast<std::size_t>(second - codes.begin());
+  }
+
+  // Items are in Morton order, so the middle one splits them in space too
+  constexpr std::size_t balanced(std::size_t begin, std::size_t end) const {
+    if (end - begin <= leaf_size) return begin;
+    const auto box =
+        centroid_bounds(bounds, items.subspan(begin, end - begin));
+    return box.min == box.max ? begin : begin + (end - begin) / 2;
+  }
+};
+
+/*
+  Sorts the items by Morton code, with the code in the high half of each
+  key and the item in the low half so that equal codes keep a fixed order
+*/
+[[nodiscard]] constexpr std::vector<std::uint64_t> morton_keys(
+    std::span<const Bounds> bounds, const Bounds& centroid_box,
+    std::size_t begin, std::size_t end) {
+  std::vector<std::uint64_t> keys;
+  keys.reserve(end - begin);
+  for (auto i = begin; i < end; ++i) {
+    keys.push_back(std::uint64_t{morton_code(bounds[i], centroid_box)} << 32 |
+                   i);
+  }
+  return keys;
+}
+
+}  // namespace detail
+
+/*
+  Builds the hierarchy over the boxes of the items, which must be finite,
+  with the binned surface area heuristic: each node is split where the
+  expected cost of a ray through its two children is the least, until at
+  most leaf_size items remain or the remaining items are all at the same
+  place. Nodes from balanced_depth on are split at their median, which keeps
+  the tree within max_depth.
+*/
+[[nodiscard]] constexpr Bvh build(std::span<const Bounds> bounds,
+                                  std::size_t leaf_size = default_leaf_size) {
+  Bvh bvh;
+  if (bounds.empty()) return bvh;
+
+  for (std::size_t i = 0; i < bounds.size(); ++i)
+    bvh.items.push_back(static_cast<std::uint32_t>(i));
+  bvh.nodes.emplace_back();
+  detail::build_subtree(bvh.nodes, 0, 0, bounds.size(),
+                        detail::SahSplit{bounds, bvh.items, leaf_size});
+  detail::finish(bvh, bounds);
+  return bvh;
+}
+
+/*
+  Builds a linear hierarchy (LBVH) over the boxes of the items, which must
+  be finite: items are sorted along a Morton curve and split by the bits of
+  their codes, and at their median from balanced_depth on. Much faster to
+  build than build(), for previews, but rays visit more nodes of it.
+*/
+[[nodiscard]] constexpr Bvh build_lbvh(
+    std::span<const Bounds> bounds,
+    std::size_t leaf_size = default_leaf_size) {
+  Bvh bvh;
+  bvh.builder = BvhBuilder::Lbvh;
+  if (bounds.empty()) return bvh;
+
+  Bounds centroid_box;
+  for (const auto& box : bounds) {
+    const auto [x, y, z] = BoundsUtil::centroid(box);
+    centroid_box = BoundsUtil::merge(centroid_box, TupleUtil::point(x, y, z));
+  }
+  auto keys = detail::morton_keys(bounds, centroid_box, 0, bounds.size());
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<std::uint32_t> codes;
+  codes.reserve(keys.size());
+  for (const auto key : keys) {
+    codes.push_back(static_cast<std::uint32_t>(key >> 32));
+    bvh.items.push_back(static_cast<std::uint32_t>(key));
+  }
+  bvh.nodes.emplace_back();
+  detail::build_subtree(
+      bvh.nodes, 0, 0, bounds.size(),
+      detail::MortonSplit{bounds, codes, bvh.items, leaf_size});
+  detail::finish(bvh, bounds);
+  return bvh;
+}
+
+namespace detail {
+
+/*
+  Calls work(chunk, begin, end) on its own thread for each of `threads`
+  chunks of about the same size covering 0 to count
+*/
+template <typename Work>
+void for_each_chunk(std::size_t count, unsigned threads, const Work& work) {
+  std::vector<std::jthread> workers;
+  for (std::size_t chunk = 0; chunk < threads; ++chunk) {
+    workers.emplace_back([&work, chunk, count, threads] {
+      work(chunk, chunk * count / threads, (chunk + 1) * count / threads);
+    });
+  }
+}
+
+/*
+  SahSplit with the centroid box and the bins of large ranges computed by
+  every thread over a chunk of the items and merged, which takes the same
+  decisions as binning them all at once
+*/
+inline std::size_t parallel_sah_split(const SahSplit& split,
+                                      std::size_t begin, std::size_t end,
+                                      unsigned threads) {
+  if (end - begin < parallel_min_items) return split(begin, end);
+
+  const auto range = split.items.subspan(begin, end - begin);
+  std::vector<Bounds> boxes(threads);
+  for_each_chunk(range.size(), threads,
+                 [&](std::size_t chunk, std::size_t first, std::size_t last) {
+                   boxes[chunk] = centroid_bounds(
+                       split.bounds, range.subspan(first, last - first));
+                 });
+  Bounds centroid_box;
+  for (const auto& box : boxes)
+    centroid_box = BoundsUtil::merge(centroid_box, box);
+  if (centroid_box.min == centroid_box.max) return begin;
+
+  std::vector<Bins> partial(threads, empty_bins());
+  for_each_chunk(range.size(), threads,
+                 [&](std::size_t chunk, std::size_t first, std::size_t last) {
+                   bin(partial[chunk], centroid_box, split.bounds,
+                       range.subspan(first, last - first));
+                 });
+  auto bins = empty_bins();
+  for (const auto& part : partial) merge(bins, part);
+  return begin + sah_partition(bins, centroid_box, split.bounds, range);
+}
+
+/*
+  Lays out the nodes over count items with `threads` threads. The top of
+  the tree is split with top_split(begin, end), or split.balanced(begin,
+  end) from balanced_depth on, until there are a few ranges per thread;
+  threads then take ranges one at a time and build their subtrees with
+  split into nodes of their own, which are appended after the top in the
+  order of the ranges.
+*/
+template <typename Split, typename TopSplit>
+std::vector<BvhNode> parallel_nodes(std::size_t count, unsigned threads,
+                                    const Split& split,
+                                    const TopSplit& top_split) {
+  struct Range {
+    std::size_t node;
+    std::size_t begin;
+    std::size_t end;
+    std::size_t depth;
+  };
+  std::vector<BvhNode> nodes(1);
+  std::vector<Range> ranges{{0, 0, count, 0}};
+  const auto size = [](const Range& range) { return range.end - range.begin; };
+
+  while (!ranges.empty() && ranges.size() < 4 * std::size_t{threads}) {
+    const auto largest = std::max_element(
+        ranges.begin(), ranges.end(),
+        [&](const Range& lhs, const Range& rhs) {
+          return size(lhs) < size(rhs);
+        });
+    if (size(*largest) < parallel_min_items) break;
+
+    const auto range = *largest;
+    const auto middle =
+        range.depth < balanced_depth
+            ? top_split(range.begin, range.end)
+            : split.balanced(range.begin, range.end);
+    if (middle == range.begin) {
+      nodes[range.node].first = static_cast<std::uint32_t>(range.begin);
+      nodes[range.node].count = static_cast<std::uint32_t>(size(range));
+      ranges.erase(largest);
+      continue;
+    }
+    const auto left = nodes.size();
+    nodes[range.node].first = static_cast<std::uint32_t>(left);
+    nodes.emplace_back();
+    nodes.emplace_back();
+    *largest = {left, range.begin, middle, range.depth + 1};
+    ranges.push_back({left + 1, middle, range.end, range.depth + 1});
+  }
+
+  std::vector<std::vector<BvhNode>> subtrees(ranges.size());
+  std::atomic<std::size_t> next{0};
+  const auto worker = [&] {
+    for (auto i = next++; i < ranges.size(); i = next++) {
+      subtrees[i].emplace_back();
+      build_subtree(subtrees[i], 0, ranges[i].begin, ranges[i].end, split,
+                    ranges[i].depth);
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(worker);
+  }
+
+  // The root of a subtree takes the place of its range in the top and the
+  // other nodes follow the top, so children still come after their parent
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    const auto base = nodes.size();
+    const auto place = [&](std::uint32_t local) {
+      return static_cast<std::uint32_t>(base + local - 1);
+    };
+    auto& subtree = subtrees[i];
+    for (auto& node : subtree) {
+      if (!node.leaf()) node.first = place(node.first);
+    }
+    nodes[ranges[i].node] = subtree[0];
+    nodes.insert(nodes.end(), subtree.begin() + 1, subtree.end());
+  }
+  return nodes;
+}
+
+[[nodiscard]] inline unsigned worker_count(unsigned threads) noexcept {
+  return threads == 0 ? std::max(std::thread::hardware_concurrency(), 1u)
+                      : threads;
+}
+
+}  // namespace detail
+
+/*
+  Parallel version of build, giving the same tree: the boxes of large nodes
+  are binned by every thread and subtrees are built on separate threads.
+  `threads` 0 uses one per hardware thread
+*/
+[[nodiscard]] inline Bvh parallel_build(
+    std::span<const Bounds> bounds, unsigned threads,
+    std::size_t leaf_size = default_leaf_size) {
+  threads = detail::worker_count(threads);
+  if (threads == 1 || bounds.size() < detail::parallel_min_items)
+    return build(bounds, leaf_size);
+
+  Bvh bvh;
+  bvh.items.resize(bounds.size());
+  for (std::size_t i = 0; i < bounds.size(); ++i)
+    bvh.items[i] = static_cast<std::uint32_t>(i);
+
+  const detail::SahSplit split{bounds, bvh.items, leaf_size};
+  bvh.nodes = detail::parallel_nodes(
+      bounds.size(), threads, split,
+      [&](std::size_t begin, std::size_t end) {
+        return detail::parallel_sah_split(split, begin, end, threads);
+      });
+  detail::finish(bvh, bounds);
+  return bvh;
+}
+
+/*
+  Parallel version of build_lbvh, giving the same tree: Morton codes are
+  computed and sorted in chunks on every thread and the sorted chunks
+  merged in pairs, then subtrees are built on separate threads
+*/
+[[nodiscard]] inline Bvh parallel_build_lbvh(
+    std::span<const Bounds> bounds, unsigned threads,
+    std::size_t leaf_size = default_leaf_size) {
+  threads = detail::worker_count(threads);
+  if (threads == 1 || bounds.size() < detail::parallel_min_items)
+    return build_lbvh(bounds, leaf_size);
+
+  std::vector<Bounds> boxes(threads);
+  std::vector<std::vector<std::uint64_t>> chunks(threads);
+  detail::for_each_chunk(
+      bounds.size(), threads,
+      [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+          const auto [x, y, z] = BoundsUtil::centroid(bounds[i]);
+          boxes[chunk] =
+              BoundsUtil::merge(boxes[chunk], TupleUtil::point(x, y, z));
+        }
+      });
+  Bounds centroid_box;
+  for (const auto& box : boxes)
+    centroid_box = BoundsUtil::merge(centroid_box, box);
+
+  detail::for_each_chunk(
+      bounds.size(), threads,
+      [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        chunks[chunk] = detail::morton_keys(bounds, centroid_box, begin, end);
+        std::sort(chunks[chunk].begin(), chunks[chunk].end());
+      });
+  while (chunks.size() > 1) {
+    std::vector<std::vector<std::uint64_t>> merged((chunks.size() + 1) / 2);
+    {
+      std::vector<std::jthread> workers;
+      for (std::size_t i = 0; i < merged.size(); ++i) {
+        workers.emplace_back([&, i] {
+          if (2 * i + 1 == chunks.size()) {
+            merged[i] = std::move(chunks[2 * i]);
+            return;
+          }
+          const auto& lhs = chunks[2 * i];
+          const auto& rhs = chunks[2 * i + 1];
+          merged[i].resize(lhs.size() + rhs.size());
+          std::merge(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                     merged[i].begin());
+        });
+      }
+    }
+    chunks = std::move(merged);
+  }
+
+  Bvh bvh;
+  bvh.builder = BvhBuilder::Lbvh;
+  const auto& keys = chunks[0];
+  std::vector<std::uint32_t> codes(keys.size());
+  bvh.items.resize(keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    codes[i] = static_cast<std::uint32_t>(keys[i] >> 32);
+    bvh.items[i] = static_cast<std::uint32_t>(keys[i]);
+  }
+
+  const detail::MortonSplit split{bounds, codes, bvh.items, leaf_size};
+  bvh.nodes = detail::parallel_nodes(bounds.size(), threads, split, split);
+  detail::finish(bvh, bounds);
+  return bvh;
+}
+
+/*
+  Builds the hierarchy with the builder and number of threads of the
+  settings. A single thread builds it with build() or build_lbvh(), so it
+  can be used in constant expressions
+*/
+[[nodiscard]] constexpr Bvh build(std::span<const Bounds> bounds,
+                                  const BvhSettings& settings) {
+  if (settings.builder == BvhBuilder::Lbvh) {
+    if (settings.threads == 1) return build_lbvh(bounds);
+    return parallel_build_lbvh(bounds, settings.threads);
+  }
+  if (settings.threads == 1) return build(bounds);
+  return parallel_build(bounds, settings.threads);
+}
+
+/*
+  Brings the tree up to date with the boxes of the items: refits it when
+  the same items moved, and builds it again when items were added or
+  removed, when the refitted tree costs more than rebuild_ratio times what
+  it did when built, or when items that shared a leaf for being at the same
+  place moved apart. Returns true when the tree was built again.
+*/
+constexpr bool update(Bvh& bvh, std::span<const Bounds> bounds,
+                      std::size_t leaf_size = default_leaf_size) {
+  if (bvh.items.size() == bounds.size()) {
+    refit(bvh, bounds);
+    if (cost(bvh) <= bvh.build_cost * rebuild_ratio &&
+        !detail::splittable(bvh, bounds, leaf_size))
+      return false;
+  }
+  bvh = build(bounds, leaf_size);
+  return true;
+}
+
+/*
+  Calls test(item, xs) for the items of every leaf whose box the ray enters
+  before xs.limit(), the nearest hit found so far for a NearestHit, visiting
+  the nearer child of every node first so that limit shrinks early
+*/
+template <typename IntersectionList, typename Test>
+constexpr void traverse(const Bvh& bvh, const Ray& ray, IntersectionList& xs,
+                        Test&& test) {
+  if (bvh.nodes.empty()) return;
+
+  const auto slab = BoundsUtil::slab_ray(ray);
+  const auto limit = [&xs] { return xs.limit(); };
+  const auto miss = std::numeric_limits<float>::infinity();
+
+  // Nodes still to visit with the distance at which the ray enters them,
+  // skipped when a hit closer than that is found in the meantime
+  struct Pending {
+    std::uint32_t node;
+    float entry;
+  };
+  StaticVector<Pending, max_depth> stack;
+
+  const auto root_entry = BoundsUtil::entry(bvh.nodes[0].bounds, slab, miss);
+  if (root_entry != miss) stack.push_back({0, root_entry});
+  while (!stack.empty()) {
+    const auto [index, entry] = stack.back();
+    stack.pop_back();
+    if (entry > limit()) continue;
+
+    const auto& node = bvh.nodes[index];
+    if (node.leaf()) {
+      for (auto i = node.first; i < node.first + node.count; ++i)
+        test(bvh.items[i], xs);
+      continue;
+    }
+
+    const auto left =
+        BoundsUtil::entry(bvh.nodes[node.first].bounds, slab, limit());
+    const auto right =
+        BoundsUtil::entry(bvh.nodes[node.first + 1].bounds, slab, limit());
+    const Pending near{left <= right ? node.first : node.first + 1,
+                       std::min(left, right)};
+    const Pending far{left <= right ? node.first + 1 : node.first,
+                      std::max(left, right)};
+    if (far.entry != miss) stack.push_back(far);
+    if (near.entry != miss) stack.push_back(near);
+  }
+}
+
+}  // namespace BvhUtil
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef CONSTEXPR_RAYTRACER_CAMERA_HPP
+#define CONSTEXPR_RAYTRACER_CAMERA_HPP
+
+#include <cmath>
+#include <utility>
+
+#include "MatrixTransformations.hpp"
+#include "Ray.hpp"
+#include "Tuple.hpp"
+
+/*
+  Camera:
+
+  Maps the pixels of a hsize x vsize canvas onto a plane one unit in front of
+  the eye. The camera looks down -z from the origin in its own space, and its
+  transformation (usually a view_transform) orients it in the world. The
+  inverse transformation is cached since every primary ray needs it.
+*/
+
+class Camera {
+ public:
+  [[nodiscard]] constexpr Camera(int hsize, int vsize, float field_of_view,
+                                 MatrixUtil::Transformation transform =
+                                     MatrixUtil::identity<4>()) noexcept
+      : hsize_{hsize},
+        vsize_{vsize},
+        field_of_view_{field_of_view},
+        transform_{std::move(transform)},
+        inverse_transform_{MatrixUtil::inverse(transform_)} {
+    const auto half_view = std::tan(field_of_view_ / 2);
+    const auto aspect =
+        static_cast<float>(hsize_) / static_cast<float>(vsize_);
+    half_width_ = aspect >= 1 ? half_view : half_view * aspect;
+    half_height_ = aspect >= 1 ? half_view / aspect : half_view;
+    pixel_size_ = half_width_ * 2 / static_cast<float>(hsize_);
+  }
+
+  [[nodiscard]] constexpr int hsize() const noexcept { return hsize_; }
+
+  [[nodiscard]] constexpr int vsize() const noexcept { return vsize_; }
+
+  [[nodiscard]] constexpr float field_of_view() const noexcept {
+    return field_of_view_;
+  }
+
+  [[nodiscard]] constexpr float pixel_size() const noexcept {
+    return pixel_size_;
+  }
+
+  [[nodiscard]] constexpr const MatrixUtil::Transformation& transform()
+      const noexcept {
+    return transform_;
+  }
+
+  [[nodiscard]] constexpr const MatrixUtil::Transformation& inverse_transform()
+      const noexcept {
+    return inverse_transform_;
+  }
+
+  [[nodiscard]] constexpr float half_width() const noexcept {
+    return half_width_;
+  }
+
+  [[nodiscard]] constexpr float half_height() const noexcept {
+    return half_height_;
+  }
+
+ private:
+  int hsize_;
+  int vsize_;
+  float field_of_view_;
+  MatrixUtil::Transformation transform_;
+  MatrixUtil::Transformation inverse_transform_;
+  float half_width_{0.f};
+  float half_height_{0.f};
+  float pixel_size_{0.f};
+};
+
+namespace CameraUtil {
+
+/*
+  Ray from the eye through the point (px + dx, py + dy) of the canvas, where
+  (dx, dy) is the position inside the pixel and defaults to its center
+*/
+[[nodiscard]] constexpr Ray ray_for_pixel(const Camera& camera, int px, int py,
+                                          float dx = 0.5f,
+                                          float dy = 0.5f) noexcept {
+  using namespace TupleUtil;
+
+  const auto x_offset = (static_cast<float>(px) + dx) * camera.pixel_size();
+  const auto y_offset = (static_cast<float>(py) + dy) * camera.pixel_size();
+
+  const auto world_x = camera.half_width() - x_offset;
+  const auto world_y = camera.half_height() - y_offset;
+
+  const auto pixel = camera.inverse_transform() * point(world_x, world_y, -1);
+  const auto origin = camera.inverse_transform() * point(0, 0, 0);
+  return Ray{origin, normalize(pixel - origin)};
+}
+
+}  // namespace CameraUtil
+
+#endif
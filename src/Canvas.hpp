@@ -1,56 +1,299 @@
 #ifndef CONSTEXPR_RAYTRACER_CANVAS_HPP
 #define CONSTEXPR_RAYTRACER_CANVAS_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <vector>
 
 #include "Color.hpp"
+#include "PixelFormat.hpp"
 
 // TODO: make a constexpr vector implementation to substitute std::vector
 
+/*
+  CanvasLayout: order in which the pixels are stored in memory
+
+  RowMajor: one row after the other
+  Blocked: 8x8 blocks stored contiguously, rows inside each block. The
+  pixels of a block span 12 cache lines instead of 8 rows of the image
+  Morton: 16x16 blocks whose pixels follow a Z-order curve, so any aligned
+  square of pixels inside a block is contiguous in memory
+
+  Blocked and Morton pad the canvas to whole blocks, so tiles that are a
+  multiple of the block size never share a cache line with another tile.
+  Any layout can be combined with any PixelFormat; pixels are converted to
+  and from Color when written and read.
+*/
+enum class CanvasLayout { RowMajor, Blocked, Morton };
+
 class Canvas {
  public:
   using ColorRow = std::vector<Color>;
   using ColorMatrix = std::vector<ColorRow>;
 
-  Canvas(int width, int height) noexcept
-      : pixels_(static_cast<ColorMatrix::size_type>(height),
-                ColorRow(static_cast<ColorRow::size_type>(width),
-                         Color(0.f, 0.f, 0.f))) {
+  /*
+    Forward iterator over the pixels in row-major order, whatever the
+    layout of the canvas
+  */
+  class ConstIterator {
+   public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Color;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Color;
+
+    ConstIterator() noexcept = default;
+
+    ConstIterator(const Canvas* canvas, int x, int y) noexcept
+        : canvas_{canvas}, x_{x}, y_{y} {}
+
+    [[nodiscard]] reference operator*() const noexcept {
+      return canvas_->pixel_at(x_, y_);
+    }
+
+    ConstIterator& operator++() noexcept {
+      if (++x_ == canvas_->width_) {
+        x_ = 0;
+        ++y_;
+      }
+      return *this;
+    }
+
+    ConstIterator operator++(int) noexcept {
+      auto previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    [[nodiscard]] int x() const noexcept { return x_; }
+
+    [[nodiscard]] int y() const noexcept { return y_; }
+
+    [[nodiscard]] bool operator==(const ConstIterator& other) const noexcept {
+      return x_ == other.x_ && y_ == other.y_;
+    }
+
+   private:
+    const Canvas* canvas_{nullptr};
+    int x_{0};
+    int y_{0};
+  };
+
+  Canvas(int width, int height, CanvasLayout layout = CanvasLayout::RowMajor,
+         PixelFormat format = PixelFormat::Float) noexcept
+      : width_{width},
+        height_{height},
+        layout_{layout},
+        format_{format},
+        blocks_x_{(width + block_side(layout) - 1) / block_side(layout)} {
     assert(width > 0 && height > 0);
+
+    const auto size = padded_size(width, height, layout);
+    switch (format) {
+      case PixelFormat::Float:
+        floats_.resize(size, Color(0.f, 0.f, 0.f));
+        break;
+      case PixelFormat::Half:
+        halves_.resize(3 * size, PixelFormatUtil::float_to_half(0.f));
+        break;
+      case PixelFormat::Srgb8:
+        bytes_.resize(3 * size, 0);
+        break;
+    }
   }
 
-  [[nodiscard]] ColorMatrix pixels() const noexcept { return pixels_; }
+  /*
+    Copy of the pixels as rows, in row-major order
+  */
+  [[nodiscard]] ColorMatrix pixels() const noexcept {
+    ColorMatrix rows(static_cast<std::size_t>(height_));
+    for (int y = 0; y < height_; ++y) {
+      auto& row = rows[static_cast<std::size_t>(y)];
+      row.reserve(static_cast<std::size_t>(width_));
+      for (int x = 0; x < width_; ++x) row.push_back(pixel_at(x, y));
+    }
+    return rows;
+  }
 
-  [[nodiscard]] int width() const noexcept {
-    if (pixels_.empty()) return 0;
+  [[nodiscard]] int width() const noexcept { return width_; }
 
-    return static_cast<int>(pixels_[0].size());
-  }
+  [[nodiscard]] int height() const noexcept { return height_; }
 
-  [[nodiscard]] int height() const noexcept {
-    return static_cast<int>(pixels_.size());
+  [[nodiscard]] bool empty() const noexcept {
+    return width_ == 0 || height_ == 0;
   }
 
-  [[nodiscard]] bool empty() const noexcept { return pixels_.empty(); }
+  [[nodiscard]] CanvasLayout layout() const noexcept { return layout_; }
+
+  [[nodiscard]] PixelFormat format() const noexcept { return format_; }
+
+  /*
+    Bytes taken by the pixels, padding included
+  */
+  [[nodiscard]] std::size_t memory_size() const noexcept {
+    return floats_.size() * sizeof(Color) +
+           halves_.size() * sizeof(std::uint16_t) + bytes_.size();
+  }
 
   void write_pixel(int x, int y, const Color& color) noexcept {
     assert(x < width() && x >= 0 && y < height() && y >= 0);
 
-    pixels_[static_cast<ColorMatrix::size_type>(y)]
-           [static_cast<ColorRow::size_type>(x)] = color;
+    write_run(index(x, y), &color, 1);
   }
 
   [[nodiscard]] Color pixel_at(int x, int y) const noexcept {
-    return pixels_[static_cast<ColorMatrix::size_type>(y)]
-                  [static_cast<ColorRow::size_type>(x)];
+    Color color;
+    read_run(index(x, y), 1, &color);
+    return color;
+  }
+
+  /*
+    Writes the width() colors of row y. Row-major canvases convert the whole
+    row in one pass
+  */
+  void write_row(int y, const Color* colors) noexcept {
+    assert(y < height() && y >= 0);
+
+    if (layout_ == CanvasLayout::RowMajor) {
+      write_run(index(0, y), colors, static_cast<std::size_t>(width_));
+      return;
+    }
+    for (int x = 0; x < width_; ++x)
+      write_run(index(x, y), colors + x, 1);
+  }
+
+  /*
+    Reads the width() colors of row y
+  */
+  void read_row(int y, Color* colors) const noexcept {
+    assert(y < height() && y >= 0);
+
+    if (layout_ == CanvasLayout::RowMajor) {
+      read_run(index(0, y), static_cast<std::size_t>(width_), colors);
+      return;
+    }
+    for (int x = 0; x < width_; ++x) read_run(index(x, y), 1, colors + x);
+  }
+
+  [[nodiscard]] ConstIterator begin() const noexcept { return {this, 0, 0}; }
+
+  [[nodiscard]] ConstIterator end() const noexcept {
+    return {this, 0, height_};
   }
 
  private:
-  ColorMatrix pixels_{};
+  static constexpr int blocked_side{8};
+  static constexpr int morton_side{16};
+
+  [[nodiscard]] static constexpr int block_side(CanvasLayout layout) noexcept {
+    switch (layout) {
+      case CanvasLayout::Blocked:
+        return blocked_side;
+      case CanvasLayout::Morton:
+        return morton_side;
+      case CanvasLayout::RowMajor:
+        break;
+    }
+    return 1;
+  }
+
+  [[nodiscard]] static std::size_t padded_size(int width, int height,
+                                               CanvasLayout layout) noexcept {
+    const auto side = block_side(layout);
+    const auto round_up = [side](int n) {
+      return static_cast<std::size_t>((n + side - 1) / side * side);
+    };
+    return round_up(width) * round_up(height);
+  }
+
+  /*
+    Interleaves the 4 low bits of x and y as yxyxyxyx
+  */
+  [[nodiscard]] static constexpr std::size_t morton_index(unsigned x,
+                                                          unsigned y) noexcept {
+    const auto spread = [](unsigned v) {
+      v = (v | (v << 2)) & 0x33u;
+      return (v | (v << 1)) & 0x55u;
+    };
+    return spread(x) | (spread(y) << 1);
+  }
+
+  void write_run(std::size_t first, const Color* colors,
+                 std::size_t count) noexcept {
+    using namespace PixelFormatUtil;
+
+    switch (format_) {
+      case PixelFormat::Float:
+        std::copy_n(colors, count,
+                    floats_.begin() + static_cast<std::ptrdiff_t>(first));
+        break;
+      case PixelFormat::Half:
+        encode_half(colors, count, halves_.data() + 3 * first);
+        break;
+      case PixelFormat::Srgb8:
+        encode_srgb8(colors, count, bytes_.data() + 3 * first);
+        break;
+    }
+  }
+
+  void read_run(std::size_t first, std::size_t count,
+                Color* colors) const noexcept {
+    using namespace PixelFormatUtil;
+
+    switch (format_) {
+      case PixelFormat::Float:
+        std::copy_n(floats_.begin() + static_cast<std::ptrdiff_t>(first),
+                    count, colors);
+        break;
+      case PixelFormat::Half:
+        decode_half(halves_.data() + 3 * first, count, colors);
+        break;
+      case PixelFormat::Srgb8:
+        decode_srgb8(bytes_.data() + 3 * first, count, colors);
+        break;
+    }
+  }
+
+  [[nodiscard]] std::size_t index(int x, int y) const noexcept {
+    const auto ux = static_cast<std::size_t>(x);
+    const auto uy = static_cast<std::size_t>(y);
+    const auto blocks_x = static_cast<std::size_t>(blocks_x_);
+
+    switch (layout_) {
+      case CanvasLayout::Blocked: {
+        const auto block = (uy / blocked_side) * blocks_x + ux / blocked_side;
+        return block * blocked_side * blocked_side +
+               (uy % blocked_side) * blocked_side + ux % blocked_side;
+      }
+      case CanvasLayout::Morton: {
+        const auto block = (uy / morton_side) * blocks_x + ux / morton_side;
+        return block * morton_side * morton_side +
+               morton_index(static_cast<unsigned>(x % morton_side),
+                            static_cast<unsigned>(y % morton_side));
+      }
+      case CanvasLayout::RowMajor:
+        break;
+    }
+    return uy * static_cast<std::size_t>(width_) + ux;
+  }
+
+  int width_;
+  int height_;
+  CanvasLayout layout_;
+  PixelFormat format_;
+  int blocks_x_;
+  // Only the vector of the pixel format is used
+  std::vector<Color> floats_{};
+  std::vector<std::uint16_t> halves_{};
+  std::vector<std::uint8_t> bytes_{};
 };
 
-[[nodiscard]] bool in_range(const Canvas& c, int x, int y) noexcept {
+[[nodiscard]] inline bool in_range(const Canvas& c, int x, int y) noexcept {
   return x < c.width() && x >= 0 && y < c.height() && y >= 0;
 }
 
@@ -0,0 +1,148 @@
+#ifndef CONSTEXPR_RAYTRACER_FLAT_ARRAY_HPP
+#define CONSTEXPR_RAYTRACER_FLAT_ARRAY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <span>
+#include <utility>
+#include <vector>
+
+/*
+  FlatArray:
+
+  Contiguous array that either owns its elements in a std::vector or views
+  elements owned elsewhere, such as the arrays of a memory-mapped scene
+  cache, without copying them. Reading works the same either way. The first
+  access that may write, through a non-const member, copies viewed elements
+  into a vector of its own, so a view never modifies the memory it points
+  to. Whoever creates a view keeps that memory alive for as long as the
+  FlatArray and its copies use it.
+*/
+
+template <typename T>
+class FlatArray {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = typename std::vector<T>::iterator;
+  using const_iterator = const T*;
+
+  [[nodiscard]] constexpr FlatArray() noexcept = default;
+
+  // Implicit so that vectors built by loaders can be stored as they are
+  [[nodiscard]] constexpr FlatArray(std::vector<T> elements) noexcept
+      : owned_(std::move(elements)) {}
+
+  [[nodiscard]] constexpr FlatArray(std::initializer_list<T> elements)
+      : owned_(elements) {}
+
+  /*
+    Array viewing the elements, which are not copied
+  */
+  [[nodiscard]] static constexpr FlatArray view(
+      std::span<const T> elements) noexcept {
+    FlatArray result;
+    result.view_ = elements;
+    result.viewing_ = true;
+    return result;
+  }
+
+  [[nodiscard]] constexpr bool viewing() const noexcept { return viewing_; }
+
+  [[nodiscard]] constexpr size_type size() const noexcept {
+    return viewing_ ? view_.size() : owned_.size();
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept { return size() == 0; }
+
+  [[nodiscard]] constexpr const T* data() const noexcept {
+    return viewing_ ? view_.data() : owned_.data();
+  }
+
+  [[nodiscard]] constexpr const_iterator begin() const noexcept {
+    return data();
+  }
+
+  [[nodiscard]] constexpr const_iterator end() const noexcept {
+    return data() + size();
+  }
+
+  [[nodiscard]] constexpr const T& operator[](size_type i) const noexcept {
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr const T& back() const noexcept {
+    return data()[size() - 1];
+  }
+
+  // Members that may write, owning the elements first
+
+  [[nodiscard]] constexpr T* data() { return elements().data(); }
+
+  [[nodiscard]] constexpr iterator begin() { return elements().begin(); }
+
+  [[nodiscard]] constexpr iterator end() { return elements().end(); }
+
+  [[nodiscard]] constexpr auto rbegin() { return elements().rbegin(); }
+
+  [[nodiscard]] constexpr auto rend() { return elements().rend(); }
+
+  [[nodiscard]] constexpr T& operator[](size_type i) {
+    return elements()[i];
+  }
+
+  [[nodiscard]] constexpr T& back() { return elements().back(); }
+
+  constexpr void push_back(T element) {
+    elements().push_back(std::move(element));
+  }
+
+  template <typename... Args>
+  constexpr T& emplace_back(Args&&... args) {
+    return elements().emplace_back(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  constexpr iterator insert(Args&&... args) {
+    return elements().insert(std::forward<Args>(args)...);
+  }
+
+  constexpr iterator insert(iterator position,
+                            std::initializer_list<T> elements_to_insert) {
+    return elements().insert(position, elements_to_insert);
+  }
+
+  constexpr void reserve(size_type capacity) {
+    elements().reserve(capacity);
+  }
+
+  constexpr void resize(size_type count) { elements().resize(count); }
+
+  constexpr void clear() noexcept {
+    owned_.clear();
+    view_ = {};
+    viewing_ = false;
+  }
+
+  [[nodiscard]] friend constexpr bool operator==(const FlatArray& lhs,
+                                                 const FlatArray& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+ private:
+  constexpr std::vector<T>& elements() {
+    if (viewing_) {
+      owned_.assign(view_.begin(), view_.end());
+      view_ = {};
+      viewing_ = false;
+    }
+    return owned_;
+  }
+
+  std::vector<T> owned_{};
+  std::span<const T> view_{};
+  bool viewing_{false};
+};
+
+#endif
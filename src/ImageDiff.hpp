@@ -0,0 +1,208 @@
+#ifndef CONSTEXPR_RAYTRACER_IMAGE_DIFF_HPP
+#define CONSTEXPR_RAYTRACER_IMAGE_DIFF_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "Ppm.hpp"
+
+/*
+  Image comparison
+
+  Images are compared as they are displayed: every channel is clamped to
+  [0, 1] first, so differences in overexposed areas do not count. Errors are
+  absolute channel differences and the PSNR uses a peak value of 1.
+*/
+
+/*
+  ImageDifference:
+
+  max_error: largest channel difference
+  mean_error: mean channel difference
+  mse: mean squared channel difference
+  psnr: peak signal-to-noise ratio in dB, infinite for identical images
+  differing_pixels: pixels with any channel differing by more than the
+  tolerance given to the comparison
+*/
+struct ImageDifference {
+  float max_error{0.f};
+  double mean_error{0.};
+  double mse{0.};
+  double psnr{std::numeric_limits<double>::infinity()};
+  std::size_t differing_pixels{0};
+};
+
+namespace ImageDiffUtil {
+
+namespace detail {
+
+struct RowsDifference {
+  float max_error{0.f};
+  double sum{0.};
+  double squared_sum{0.};
+  std::size_t differing_pixels{0};
+};
+
+/*
+  Accumulates the differences of rows [y0, y1). The channel errors of a row
+  are computed first into a flat array, so the reductions run over
+  contiguous floats without branches and vectorize
+*/
+inline RowsDifference compare_rows(const Canvas& a, const Canvas& b, int y0,
+                                   int y1, float tolerance) {
+  const auto width = static_cast<std::size_t>(a.width());
+  std::vector<Color> row_a(width);
+  std::vector<Color> row_b(width);
+  std::vector<float> errors(3 * width);
+
+  const auto channel_error = [](float lhs, float rhs) {
+    return std::abs(std::clamp(lhs, 0.f, 1.f) - std::clamp(rhs, 0.f, 1.f));
+  };
+
+  RowsDifference result;
+  for (int y = y0; y < y1; ++y) {
+    a.read_row(y, row_a.data());
+    b.read_row(y, row_b.data());
+    for (std::size_t x = 0; x < width; ++x) {
+      errors[3 * x] = channel_error(row_a[x].red, row_b[x].red);
+      errors[3 * x + 1] = channel_error(row_a[x].green, row_b[x].green);
+      errors[3 * x + 2] = channel_error(row_a[x].blue, row_b[x].blue);
+    }
+
+    float row_max = 0.f;
+    float row_sum = 0.f;
+    float row_squared_sum = 0.f;
+    for (const float error : errors) {
+      row_max = std::max(row_max, error);
+      row_sum += error;
+      row_squared_sum += error * error;
+    }
+    result.max_error = std::max(result.max_error, row_max);
+    result.sum += static_cast<double>(row_sum);
+    result.squared_sum += static_cast<double>(row_squared_sum);
+
+    for (std::size_t x = 0; x < width; ++x) {
+      const auto pixel_error =
+          std::max({errors[3 * x], errors[3 * x + 1], errors[3 * x + 2]});
+      if (pixel_error > tolerance) ++result.differing_pixels;
+    }
+  }
+  return result;
+}
+
+}  // namespace detail
+
+/*
+  Compares two images of the same size on `threads` threads, 0 using one
+  per hardware thread. Returns nothing when the sizes differ
+*/
+[[nodiscard]] inline std::optional<ImageDifference> compare(
+    const Canvas& a, const Canvas& b, float tolerance = 0.f,
+    unsigned threads = 1) {
+  if (a.width() != b.width() || a.height() != b.height()) return std::nullopt;
+
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  const auto bands = static_cast<int>(
+      std::clamp(threads, 1u, static_cast<unsigned>(std::max(a.height(), 1))));
+
+  // Every thread compares a band of rows and the partial results are
+  // combined afterwards, in a fixed order so the result does not depend on
+  // scheduling
+  std::vector<detail::RowsDifference> parts(static_cast<std::size_t>(bands));
+  {
+    std::vector<std::jthread> workers;
+    for (int band = 0; band < bands; ++band) {
+      const int y0 = band * a.height() / bands;
+      const int y1 = (band + 1) * a.height() / bands;
+      workers.emplace_back([&, band, y0, y1] {
+        parts[static_cast<std::size_t>(band)] =
+            detail::compare_rows(a, b, y0, y1, tolerance);
+      });
+    }
+  }
+
+  ImageDifference difference;
+  double sum = 0.;
+  double squared_sum = 0.;
+  for (const auto& part : parts) {
+    difference.max_error = std::max(difference.max_error, part.max_error);
+    sum += part.sum;
+    squared_sum += part.squared_sum;
+    difference.differing_pixels += part.differing_pixels;
+  }
+
+  const auto channels = 3. * a.width() * a.height();
+  if (channels == 0.) return difference;
+  difference.mean_error = sum / channels;
+  difference.mse = squared_sum / channels;
+  if (difference.mse > 0) difference.psnr = -10. * std::log10(difference.mse);
+  return difference;
+}
+
+/*
+  Compares two PPM files, see compare. Returns nothing when a file cannot
+  be read or the sizes differ
+*/
+[[nodiscard]] inline std::optional<ImageDifference> compare_files(
+    const std::filesystem::path& a, const std::filesystem::path& b,
+    float tolerance = 0.f, unsigned threads = 1) {
+  const auto image_a = CanvasUtil::load_ppm(a);
+  const auto image_b = CanvasUtil::load_ppm(b);
+  if (!image_a || !image_b) return std::nullopt;
+  return compare(*image_a, *image_b, tolerance, threads);
+}
+
+/*
+  Color of an error on the heatmap scale: black for none, then red, yellow
+  and white as the error approaches full_scale
+*/
+[[nodiscard]] constexpr Color heat(float error, float full_scale) noexcept {
+  const auto t = std::clamp(error / full_scale, 0.f, 1.f);
+  return Color(std::clamp(3.f * t, 0.f, 1.f),
+               std::clamp(3.f * t - 1.f, 0.f, 1.f),
+               std::clamp(3.f * t - 2.f, 0.f, 1.f));
+}
+
+/*
+  Image of the largest channel difference of every pixel. full_scale sets
+  the error shown as white, lower it to make small differences visible.
+  Returns nothing when the sizes differ
+*/
+[[nodiscard]] inline std::optional<Canvas> heatmap(const Canvas& a,
+                                                   const Canvas& b,
+                                                   float full_scale = 1.f) {
+  if (a.width() != b.width() || a.height() != b.height()) return std::nullopt;
+
+  Canvas map(a.width(), a.height());
+  const auto width = static_cast<std::size_t>(a.width());
+  std::vector<Color> row_a(width);
+  std::vector<Color> row_b(width);
+  for (int y = 0; y < a.height(); ++y) {
+    a.read_row(y, row_a.data());
+    b.read_row(y, row_b.data());
+    for (std::size_t x = 0; x < width; ++x) {
+      const auto channel = [](float value) {
+        return std::clamp(value, 0.f, 1.f);
+      };
+      const auto error = std::max(
+          {std::abs(channel(row_a[x].red) - channel(row_b[x].red)),
+           std::abs(channel(row_a[x].green) - channel(row_b[x].green)),
+           std::abs(channel(row_a[x].blue) - channel(row_b[x].blue))});
+      row_a[x] = heat(error, full_scale);
+    }
+    map.write_row(y, row_a.data());
+  }
+  return map;
+}
+
+}  // namespace ImageDiffUtil
+
+#endif
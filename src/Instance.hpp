@@ -0,0 +1,210 @@
+#ifndef CONSTEXPR_RAYTRACER_INSTANCE_HPP
+#define CONSTEXPR_RAYTRACER_INSTANCE_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Bvh.hpp"
+#include "MatrixTransformations.hpp"
+#include "Ray.hpp"
+#include "Shading.hpp"
+#include "Shape.hpp"
+#include "Tuple.hpp"
+
+/*
+  Index of a prototype in the table of the world that holds it
+*/
+using PrototypeId = std::uint32_t;
+
+/*
+  Prototype:
+
+  Shapes stored once and drawn any number of times by instances. The shapes
+  are given in the space of the prototype and must be bounded. Meshes are
+  merged into a single list of triangles moved by their transformation, so
+  every primitive of the prototype, a shape or a triangle, is a leaf item of
+  one bounding volume hierarchy built on construction with the given
+  settings.
+
+  Primitives are numbered with the shapes first and the triangles after
+  them; Intersection::primitive() of a hit on a prototype holds that number.
+*/
+class Prototype {
+ public:
+  [[nodiscard]] constexpr Prototype() noexcept = default;
+
+  [[nodiscard]] constexpr explicit Prototype(
+      std::span<const Shape> shapes, const BvhSettings& settings = {}) {
+    for (const auto& shape : shapes) {
+      assert(BoundsUtil::finite(BoundsUtil::bounds(shape)));
+      const auto* mesh = std::get_if<TriangleMesh>(&shape);
+      if (mesh == nullptr) {
+        shapes_.push_back(shape);
+        inverse_transforms_.push_back(
+            MatrixUtil::inverse(ShapeUtil::transform(shape)));
+        continue;
+      }
+
+      const auto first =
+          static_cast<std::uint32_t>(triangles_.vertex_count());
+      for (std::size_t i = 0; i < mesh->vertex_count(); ++i) {
+        const auto vertex = mesh->transform * mesh->vertex(i);
+        triangles_.vertices.insert(triangles_.vertices.end(),
+                                   {vertex.x, vertex.y, vertex.z});
+      }
+      for (const auto index : mesh->indices)
+        triangles_.indices.push_back(first + index);
+    }
+
+    std::vector<Bounds> primitive_bounds;
+    for (const auto& shape : shapes_)
+      primitive_bounds.push_back(BoundsUtil::bounds(shape));
+    for (std::size_t i = 0; i < triangles_.triangle_count(); ++i) {
+      Bounds box;
+      for (const auto& vertex : triangles_.triangle(i))
+        box = BoundsUtil::merge(box, vertex);
+      primitive_bounds.push_back(box);
+    }
+    bvh_ = BvhUtil::build(primitive_bounds, settings);
+  }
+
+  /*
+    Assembles a prototype from parts made earlier, such as those read from a
+    scene cache, which are used as they are: the shapes other than meshes
+    with their inverse transformations, the triangles of the meshes and a
+    hierarchy over all the primitives
+  */
+  [[nodiscard]] constexpr Prototype(
+      std::vector<Shape> shapes,
+      std::vector<MatrixUtil::Transformation> inverse_transforms,
+      TriangleMesh triangles, Bvh bvh) noexcept
+      : shapes_(std::move(shapes)),
+        inverse_transforms_(std::move(inverse_transforms)),
+        triangles_(std::move(triangles)),
+        bvh_(std::move(bvh)) {
+    assert(shapes_.size() == inverse_transforms_.size());
+  }
+
+  /*
+    Shapes of the prototype other than meshes
+  */
+  [[nodiscard]] constexpr const std::vector<Shape>& shapes() const noexcept {
+    return shapes_;
+  }
+
+  /*
+    Triangles of every mesh of the prototype, in the prototype space
+  */
+  [[nodiscard]] constexpr const TriangleMesh& triangles() const noexcept {
+    return triangles_;
+  }
+
+  [[nodiscard]] constexpr const MatrixUtil::Transformation& inverse_transform(
+      std::size_t shape) const noexcept {
+    return inverse_transforms_[shape];
+  }
+
+  [[nodiscard]] constexpr const Bvh& bvh() const noexcept { return bvh_; }
+
+  /*
+    Box of the whole prototype, empty when it has no shapes
+  */
+  [[nodiscard]] constexpr Bounds bounds() const noexcept {
+    return bvh_.nodes.empty() ? Bounds{} : bvh_.nodes[0].bounds;
+  }
+
+  [[nodiscard]] constexpr std::size_t primitive_count() const noexcept {
+    return shapes_.size() + triangles_.triangle_count();
+  }
+
+  /*
+    Normal of the primitive at a point, both in the prototype space
+  */
+  [[nodiscard]] constexpr Tuple normal_at(
+      const Tuple& point, std::size_t primitive) const noexcept {
+    if (primitive < shapes_.size()) {
+      return ShapeUtil::normal_at(shapes_[primitive],
+                                  inverse_transforms_[primitive], point);
+    }
+    return triangles_.local_normal_at(primitive - shapes_.size());
+  }
+
+ private:
+  std::vector<Shape> shapes_{};
+  std::vector<MatrixUtil::Transformation> inverse_transforms_{};
+  TriangleMesh triangles_{};
+  Bvh bvh_{};
+};
+
+/*
+  Instance: a prototype placed in the world by its own transformation and
+  drawn with its own material, whatever the materials of the prototype
+  shapes
+*/
+struct Instance {
+  PrototypeId prototype{0};
+  MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
+  MaterialId material{0};
+};
+
+namespace RayUtil {
+
+namespace detail {
+
+/*
+  Intersection list passing everything on to another one, such as a
+  NearestHit, with the primitive that was tested
+*/
+template <typename IntersectionList>
+struct PrimitiveHits {
+  using value_type = Intersection;
+
+  IntersectionList& xs;
+  std::size_t primitive;
+
+  constexpr void push_back(const Intersection& intersection) {
+    xs.push_back(Intersection(intersection.t(), intersection.object_type(), 0,
+                              primitive));
+  }
+};
+
+}  // namespace detail
+
+/*
+  Adds the intersections of a ray given in the space of the prototype to
+  xs, with Intersection::primitive() set to the primitive that was hit
+*/
+template <typename IntersectionList>
+constexpr void local_intersect(const Ray& local_ray,
+                               const Prototype& prototype,
+                               IntersectionList& xs) {
+  const auto shape_count = prototype.shapes().size();
+  const auto watertight = detail::watertight_ray(local_ray);
+
+  BvhUtil::traverse(
+      prototype.bvh(), local_ray, xs,
+      [&](std::uint32_t primitive, IntersectionList& found) {
+        if (primitive < shape_count) {
+          detail::PrimitiveHits<IntersectionList> hits{found, primitive};
+          local_intersect(
+              transform(local_ray, prototype.inverse_transform(primitive)),
+              prototype.shapes()[primitive], hits);
+          return;
+        }
+        const auto& triangles = prototype.triangles();
+        if (const auto t = intersect_triangle(
+                watertight, triangles.triangle(primitive - shape_count)))
+          found.push_back(
+              Intersection(*t, ShapeType::TriangleMesh, 0, primitive));
+      });
+}
+
+}  // namespace RayUtil
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef CONSTEXPR_RAYTRACER_MAPPED_CANVAS_HPP
+#define CONSTEXPR_RAYTRACER_MAPPED_CANVAS_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "Color.hpp"
+#include "MappedFile.hpp"
+#include "PixelFormat.hpp"
+
+#if !CONSTEXPR_RAYTRACER_HAS_MMAP
+#include <fstream>
+#include <vector>
+#endif
+
+/*
+  MappedCanvas:
+
+  Canvas whose pixels live in a binary PPM (P6) file. The header is written
+  when the canvas is created and the file is mapped in memory, so pixels go
+  straight to the page cache and the image on disk is complete as soon as
+  the last pixel is written: there is no export pass and the image never
+  has to fit in memory. Channels are stored like in Ppm.hpp, clamped to
+  [0, 1] and scaled to 8 bits, so pixel_at returns the quantized color.
+
+  Without mmap the pixels are kept in memory and written on flush().
+*/
+
+class MappedCanvas {
+ public:
+  [[nodiscard]] static std::optional<MappedCanvas> create(
+      const std::filesystem::path& path, int width, int height) noexcept {
+    if (width <= 0 || height <= 0) return std::nullopt;
+
+    MappedCanvas canvas;
+    canvas.width_ = width;
+    canvas.height_ = height;
+    const auto header = "P6\n" + std::to_string(width) + ' ' +
+                        std::to_string(height) + "\n255\n";
+    canvas.header_size_ = header.size();
+    canvas.size_ = header.size() + 3 * static_cast<std::size_t>(width) *
+                                       static_cast<std::size_t>(height);
+
+#if CONSTEXPR_RAYTRACER_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return std::nullopt;
+
+    // The file is grown to its final size first, which leaves the pixels
+    // black until they are written
+    if (::ftruncate(fd, static_cast<off_t>(canvas.size_)) != 0) {
+      ::close(fd);
+      return std::nullopt;
+    }
+    void* data = ::mmap(nullptr, canvas.size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return std::nullopt;
+    canvas.data_ = static_cast<char*>(data);
+#else
+    canvas.path_ = path;
+    canvas.buffer_.resize(canvas.size_);
+    canvas.data_ = canvas.buffer_.data();
+    if (!canvas.flush()) return std::nullopt;
+#endif
+    std::memcpy(canvas.data_, header.data(), header.size());
+    return canvas;
+  }
+
+  MappedCanvas(const MappedCanvas&) = delete;
+  MappedCanvas& operator=(const MappedCanvas&) = delete;
+
+  MappedCanvas(MappedCanvas&& other) noexcept { swap(other); }
+
+  MappedCanvas& operator=(MappedCanvas&& other) noexcept {
+    MappedCanvas moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  ~MappedCanvas() {
+    if (data_ == nullptr) return;
+#if CONSTEXPR_RAYTRACER_HAS_MMAP
+    ::munmap(data_, size_);
+#else
+    static_cast<void>(flush());
+#endif
+  }
+
+  [[nodiscard]] int width() const noexcept { return width_; }
+
+  [[nodiscard]] int height() const noexcept { return height_; }
+
+  void write_pixel(int x, int y, const Color& color) noexcept {
+    char* pixel = data_ + offset(x, y);
+    pixel[0] = to_char(PixelFormatUtil::linear_to_unorm8(color.red));
+    pixel[1] = to_char(PixelFormatUtil::linear_to_unorm8(color.green));
+    pixel[2] = to_char(PixelFormatUtil::linear_to_unorm8(color.blue));
+  }
+
+  [[nodiscard]] Color pixel_at(int x, int y) const noexcept {
+    const char* pixel = data_ + offset(x, y);
+    return Color(to_float(pixel[0]), to_float(pixel[1]), to_float(pixel[2]));
+  }
+
+  void write_row(int y, const Color* colors) noexcept {
+    for (int x = 0; x < width_; ++x) write_pixel(x, y, colors[x]);
+  }
+
+  void read_row(int y, Color* colors) const noexcept {
+    for (int x = 0; x < width_; ++x) colors[x] = pixel_at(x, y);
+  }
+
+  /*
+    Writes the pixels to the file now rather than leaving it to the system
+  */
+  [[nodiscard]] bool flush() noexcept {
+#if CONSTEXPR_RAYTRACER_HAS_MMAP
+    return ::msync(data_, size_, MS_SYNC) == 0;
+#else
+    std::ofstream stream(path_, std::ios::binary | std::ios::trunc);
+    stream.write(data_, static_cast<std::streamsize>(size_));
+    return static_cast<bool>(stream);
+#endif
+  }
+
+ private:
+  MappedCanvas() noexcept = default;
+
+  [[nodiscard]] std::size_t offset(int x, int y) const noexcept {
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    return header_size_ +
+           3 * (static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
+                static_cast<std::size_t>(x));
+  }
+
+  [[nodiscard]] static char to_char(std::uint8_t value) noexcept {
+    return static_cast<char>(value);
+  }
+
+  [[nodiscard]] static float to_float(char value) noexcept {
+    return static_cast<float>(static_cast<unsigned char>(value)) / 255.f;
+  }
+
+  void swap(MappedCanvas& other) noexcept {
+    std::swap(width_, other.width_);
+    std::swap(height_, other.height_);
+    std::swap(header_size_, other.header_size_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+#if !CONSTEXPR_RAYTRACER_HAS_MMAP
+    std::swap(path_, other.path_);
+    std::swap(buffer_, other.buffer_);
+#endif
+  }
+
+  int width_{0};
+  int height_{0};
+  std::size_t header_size_{0};
+  char* data_{nullptr};
+  std::size_t size_{0};
+#if !CONSTEXPR_RAYTRACER_HAS_MMAP
+  std::filesystem::path path_{};
+  std::vector<char> buffer_{};
+#endif
+};
+
+#endif
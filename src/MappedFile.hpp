@@ -0,0 +1,113 @@
+#ifndef CONSTEXPR_RAYTRACER_MAPPED_FILE_HPP
+#define CONSTEXPR_RAYTRACER_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CONSTEXPR_RAYTRACER_HAS_MMAP 1
+#else
+#include <fstream>
+#include <vector>
+#define CONSTEXPR_RAYTRACER_HAS_MMAP 0
+#endif
+
+/*
+  MappedFile:
+
+  Read-only view of a whole file. On POSIX systems the file is memory-mapped
+  so parsers can walk it without copying; elsewhere it is read into memory
+  once.
+*/
+
+class MappedFile {
+ public:
+  [[nodiscard]] static std::optional<MappedFile> open(
+      const std::filesystem::path& path) noexcept {
+#if CONSTEXPR_RAYTRACER_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return std::nullopt;
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      return std::nullopt;
+    }
+
+    MappedFile file;
+    file.size_ = static_cast<std::size_t>(info.st_size);
+    if (file.size_ > 0) {
+      void* data = ::mmap(nullptr, file.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        return std::nullopt;
+      }
+      ::madvise(data, file.size_, MADV_SEQUENTIAL);
+      file.data_ = static_cast<const char*>(data);
+    }
+    ::close(fd);
+    return file;
+#else
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return std::nullopt;
+
+    MappedFile file;
+    file.buffer_.assign(std::istreambuf_iterator<char>(stream),
+                        std::istreambuf_iterator<char>());
+    file.data_ = file.buffer_.data();
+    file.size_ = file.buffer_.size();
+    return file;
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept { swap(other); }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    MappedFile moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  ~MappedFile() {
+#if CONSTEXPR_RAYTRACER_HAS_MMAP
+    if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  [[nodiscard]] const char* data() const noexcept { return data_; }
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return {data_, size_};
+  }
+
+ private:
+  MappedFile() noexcept = default;
+
+  void swap(MappedFile& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+#if !CONSTEXPR_RAYTRACER_HAS_MMAP
+    std::swap(buffer_, other.buffer_);
+#endif
+  }
+
+  const char* data_{nullptr};
+  std::size_t size_{0};
+#if !CONSTEXPR_RAYTRACER_HAS_MMAP
+  std::vector<char> buffer_{};
+#endif
+};
+
+#endif
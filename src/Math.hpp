@@ -10,8 +10,10 @@ namespace MathUtil {
 template <class T>
 concept strict_float = std::is_same_v<T, float>;
 
+constexpr float default_epsilon{0.0001f};
+
 constexpr bool approx_equal(float a, float b,
-                            float epsilon = 0.0001f) noexcept {
+                            float epsilon = default_epsilon) noexcept {
   return std::abs(a - b) < epsilon;
 }
 
@@ -160,6 +160,24 @@ class Transformation : public Matrix<4> {
                         zx,  zy, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f};
 }
 
+/*
+  Orients the world relative to an eye at `from` looking towards `to`, with
+  `up` giving the approximate upwards direction
+*/
+[[nodiscard]] constexpr Transformation view_transform(
+    const Tuple& from, const Tuple& to, const Tuple& up) noexcept {
+  using namespace TupleUtil;
+
+  const auto forward = normalize(to - from);
+  const auto left = cross(forward, normalize(up));
+  const auto true_up = cross(left, forward);
+  const Transformation orientation{left.x,     left.y,     left.z,     0.f,
+                                   true_up.x,  true_up.y,  true_up.z,  0.f,
+                                   -forward.x, -forward.y, -forward.z, 0.f,
+                                   0.f,        0.f,        0.f,        1.f};
+  return orientation * translation(-from.x, -from.y, -from.z);
+}
+
 }  // namespace MatrixUtil
 
 #endif
\ No newline at end of file
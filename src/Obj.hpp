@@ -0,0 +1,300 @@
+#ifndef CONSTEXPR_RAYTRACER_OBJ_HPP
+#define CONSTEXPR_RAYTRACER_OBJ_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Shape.hpp"
+
+/*
+  Wavefront OBJ loading
+
+  Only geometry is read: `v` lines become mesh vertices and `f` lines become
+  triangles (polygons are split as fans). Texture coordinates, normals,
+  groups and materials are skipped. The parser walks the text in place with
+  hand-written number scanners and writes straight into the flat mesh
+  arrays, so no intermediate strings are created.
+*/
+
+namespace ObjUtil {
+
+namespace detail {
+
+[[nodiscard]] constexpr bool is_blank(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+[[nodiscard]] constexpr bool is_digit(char c) noexcept {
+  return c >= '0' && c <= '9';
+}
+
+constexpr void skip_blanks(const char*& it, const char* end) noexcept {
+  while (it != end && is_blank(*it)) ++it;
+}
+
+constexpr void skip_line(const char*& it, const char* end) noexcept {
+  while (it != end && *it != '\n') ++it;
+  if (it != end) ++it;
+}
+
+/*
+  Accumulates up to 19 significant digits in an integer and scales once by a
+  power of ten, which is exact enough for single precision output
+*/
+[[nodiscard]] constexpr std::optional<float> parse_float(
+    const char*& it, const char* end) noexcept {
+  constexpr double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                      1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                      1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const bool negative = it != end && *it == '-';
+  if (it != end && (*it == '-' || *it == '+')) ++it;
+
+  std::uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digit = false;
+
+  for (; it != end && is_digit(*it); ++it, any_digit = true) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + static_cast<std::uint64_t>(*it - '0');
+      if (mantissa != 0) ++digits;
+    } else {
+      ++exponent;
+    }
+  }
+
+  if (it != end && *it == '.') {
+    for (++it; it != end && is_digit(*it); ++it, any_digit = true) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*it - '0');
+        if (mantissa != 0) ++digits;
+        --exponent;
+      }
+    }
+  }
+
+  if (!any_digit) return std::nullopt;
+
+  if (it != end && (*it == 'e' || *it == 'E')) {
+    ++it;
+    const bool negative_exponent = it != end && *it == '-';
+    if (it != end && (*it == '-' || *it == '+')) ++it;
+    if (it == end || !is_digit(*it)) return std::nullopt;
+
+    int value = 0;
+    for (; it != end && is_digit(*it); ++it) {
+      if (value < 10000) value = value * 10 + (*it - '0');
+    }
+    exponent += negative_exponent ? -value : value;
+  }
+
+  auto result = static_cast<double>(mantissa);
+  for (; exponent > 22; exponent -= 22) result *= powers_of_ten[22];
+  for (; exponent < -22; exponent += 22) result /= powers_of_ten[22];
+  result = exponent < 0 ? result / powers_of_ten[-exponent]
+                        : result * powers_of_ten[exponent];
+
+  return static_cast<float>(negative ? -result : result);
+}
+
+/*
+  Parses a decimal integer, saturating at 2^40 so an overlong number is
+  still seen as out of range instead of wrapping around
+*/
+[[nodiscard]] constexpr std::optional<std::int64_t> parse_int(
+    const char*& it, const char* end) noexcept {
+  const bool negative = it != end && *it == '-';
+  if (it != end && (*it == '-' || *it == '+')) ++it;
+  if (it == end || !is_digit(*it)) return std::nullopt;
+
+  std::int64_t value = 0;
+  for (; it != end && is_digit(*it); ++it) {
+    if (value < (std::int64_t{1} << 40)) value = value * 10 + (*it - '0');
+  }
+  return negative ? -value : value;
+}
+
+/*
+  Geometry of a contiguous part of the file. Negative (relative) face indices
+  depend on how many vertices precede the chunk, so they are stored relative
+  to the start of the chunk using unsigned wrap-around and their positions
+  are kept in `relative` to be rebased once the chunk offsets are known.
+*/
+struct Chunk {
+  std::vector<float> vertices{};
+  std::vector<std::uint32_t> indices{};
+  std::vector<std::size_t> relative{};
+};
+
+[[nodiscard]] constexpr std::optional<Chunk> parse_chunk(
+    std::string_view text) {
+  Chunk chunk;
+  const char* it = text.data();
+  const char* const end = text.data() + text.size();
+
+  while (it != end) {
+    skip_blanks(it, end);
+    if (it == end) break;
+
+    if (*it == 'v' && it + 1 != end && is_blank(it[1])) {
+      ++it;
+      for (int axis = 0; axis < 3; ++axis) {
+        skip_blanks(it, end);
+        const auto value = parse_float(it, end);
+        if (!value) return std::nullopt;
+        chunk.vertices.push_back(*value);
+      }
+    } else if (*it == 'f' && it + 1 != end && is_blank(it[1])) {
+      ++it;
+      // Polygons are emitted as a fan around their first corner
+      std::uint32_t first = 0;
+      std::uint32_t previous = 0;
+      bool first_relative = false;
+      bool previous_relative = false;
+      int corner = 0;
+
+      for (skip_blanks(it, end); it != end && *it != '\n';
+           skip_blanks(it, end)) {
+        // Vertex positions run from 1 to 2^32, so every index fits in 32 bits
+        constexpr std::int64_t max_position = std::int64_t{1} << 32;
+        const auto position = parse_int(it, end);
+        if (!position || *position == 0 || *position > max_position ||
+            *position < -max_position)
+          return std::nullopt;
+        // Skip the texture coordinate and normal references
+        while (it != end && !is_blank(*it) && *it != '\n') ++it;
+
+        const bool relative = *position < 0;
+        const auto local_vertices =
+            static_cast<std::int64_t>(chunk.vertices.size() / 3);
+        const auto index = static_cast<std::uint32_t>(
+            relative ? local_vertices + *position : *position - 1);
+
+        if (corner >= 2) {
+          const auto base = chunk.indices.size();
+          chunk.indices.insert(chunk.indices.end(), {first, previous, index});
+          if (first_relative) chunk.relative.push_back(base);
+          if (previous_relative) chunk.relative.push_back(base + 1);
+          if (relative) chunk.relative.push_back(base + 2);
+        }
+        if (corner == 0) {
+          first = index;
+          first_relative = relative;
+        }
+        previous = index;
+        previous_relative = relative;
+        ++corner;
+      }
+    }
+
+    skip_line(it, end);
+  }
+
+  return chunk;
+}
+
+/*
+  Appends a chunk to the mesh, rebasing its relative indices on the vertices
+  that precede it
+*/
+constexpr void append_chunk(TriangleMesh& mesh, const Chunk& chunk) {
+  const auto offset = static_cast<std::uint32_t>(mesh.vertex_count());
+  const auto base = mesh.indices.size();
+
+  mesh.vertices.insert(mesh.vertices.end(), chunk.vertices.begin(),
+                       chunk.vertices.end());
+  mesh.indices.insert(mesh.indices.end(), chunk.indices.begin(),
+                      chunk.indices.end());
+  for (const auto position : chunk.relative)
+    mesh.indices[base + position] += offset;
+}
+
+[[nodiscard]] constexpr bool valid_indices(const TriangleMesh& mesh) noexcept {
+  const auto vertex_count = mesh.vertex_count();
+  return std::all_of(
+      mesh.indices.begin(), mesh.indices.end(),
+      [vertex_count](std::uint32_t index) { return index < vertex_count; });
+}
+
+}  // namespace detail
+
+/*
+  Parses OBJ text into a mesh, or returns nothing if a vertex or face is
+  malformed or a face references a missing vertex
+*/
+[[nodiscard]] constexpr std::optional<TriangleMesh> parse(
+    std::string_view text) {
+  auto chunk = detail::parse_chunk(text);
+  if (!chunk) return std::nullopt;
+
+  TriangleMesh mesh;
+  mesh.vertices = std::move(chunk->vertices);
+  mesh.indices = std::move(chunk->indices);
+  if (!detail::valid_indices(mesh)) return std::nullopt;
+  return mesh;
+}
+
+/*
+  Parallel version of parse: the text is split at line boundaries into one
+  chunk per thread and the chunks are stitched together in order
+*/
+[[nodiscard]] inline std::optional<TriangleMesh> parse(std::string_view text,
+                                                       unsigned threads) {
+  if (threads <= 1 || text.size() < threads) return parse(text);
+
+  std::vector<std::string_view> parts;
+  for (std::size_t begin = 0; begin < text.size();) {
+    auto end = std::min(text.size(), begin + text.size() / threads);
+    end = std::min(text.size(), text.find('\n', end));
+    end = end == text.size() ? end : end + 1;
+    parts.push_back(text.substr(begin, end - begin));
+    begin = end;
+  }
+
+  std::vector<std::optional<detail::Chunk>> chunks(parts.size());
+  {
+    std::vector<std::jthread> workers;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+      workers.emplace_back(
+          [&, i] { chunks[i] = detail::parse_chunk(parts[i]); });
+    }
+  }
+
+  TriangleMesh mesh;
+  std::size_t vertex_floats = 0;
+  std::size_t index_count = 0;
+  for (const auto& chunk : chunks) {
+    if (!chunk) return std::nullopt;
+    vertex_floats += chunk->vertices.size();
+    index_count += chunk->indices.size();
+  }
+  mesh.vertices.reserve(vertex_floats);
+  mesh.indices.reserve(index_count);
+
+  for (const auto& chunk : chunks) detail::append_chunk(mesh, *chunk);
+
+  if (!detail::valid_indices(mesh)) return std::nullopt;
+  return mesh;
+}
+
+/*
+  Memory-maps an OBJ file and parses it with the given number of threads
+*/
+[[nodiscard]] inline std::optional<TriangleMesh> load(
+    const std::filesystem::path& path, unsigned threads = 1) {
+  const auto file = MappedFile::open(path);
+  if (!file) return std::nullopt;
+  return parse(file->view(), threads);
+}
+
+}  // namespace ObjUtil
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef CONSTEXPR_RAYTRACER_PIXEL_FORMAT_HPP
+#define CONSTEXPR_RAYTRACER_PIXEL_FORMAT_HPP
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "Color.hpp"
+
+/*
+  PixelFormat: how the channels of a pixel are stored
+
+  Float: 32-bit floats, 12 bytes per pixel
+  Half: IEEE 754 binary16 floats, 6 bytes per pixel. Keeps values above 1
+  and about 3 significant digits
+  Srgb8: 8-bit sRGB-encoded values, 3 bytes per pixel. Channels are clamped
+  to [0, 1] and the sRGB curve spends the 256 levels where the eye
+  distinguishes them best
+*/
+enum class PixelFormat { Float, Half, Srgb8 };
+
+namespace PixelFormatUtil {
+
+/*
+  Nearest binary16 value, ties to even. Values beyond the half range become
+  infinities and NaNs stay NaNs
+*/
+[[nodiscard]] constexpr std::uint16_t float_to_half(float value) noexcept {
+  const auto bits = std::bit_cast<std::uint32_t>(value);
+  const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+  const auto magnitude = bits & 0x7FFFFFFFu;
+
+  if (magnitude >= 0x7F800000u) {
+    const auto nan = magnitude > 0x7F800000u ? 0x0200u : 0u;
+    return static_cast<std::uint16_t>(sign | 0x7C00u | nan);
+  }
+  // 65520, halfway between the largest half and the next power of two
+  if (magnitude >= 0x477FF000u)
+    return static_cast<std::uint16_t>(sign | 0x7C00u);
+
+  std::uint32_t half = 0;
+  std::uint32_t remainder = 0;
+  std::uint32_t halfway = 0;
+  if (magnitude >= 0x38800000u) {
+    // Normal halves: rebias the exponent from 127 to 15
+    half = (magnitude - 0x38000000u) >> 13;
+    remainder = magnitude & 0x1FFFu;
+    halfway = 0x1000u;
+  } else if (magnitude >= 0x33000000u) {
+    // Subnormal halves count units of 2^-24
+    const auto mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+    const auto shift = 126u - (magnitude >> 23);
+    half = mantissa >> shift;
+    remainder = mantissa & ((1u << shift) - 1u);
+    halfway = 1u << (shift - 1u);
+  }
+  if (remainder > halfway || (remainder == halfway && (half & 1u) != 0))
+    ++half;
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+[[nodiscard]] constexpr float half_to_float(std::uint16_t half) noexcept {
+  const auto sign = (half & 0x8000u) << 16;
+  const auto exponent = (half >> 10) & 0x1Fu;
+  const auto mantissa = half & 0x3FFu;
+
+  if (exponent == 0x1Fu)
+    return std::bit_cast<float>(sign | 0x7F800000u | (mantissa << 13));
+  if (exponent == 0) {
+    const auto value = static_cast<float>(mantissa) * 0x1p-24f;
+    return sign != 0 ? -value : value;
+  }
+  return std::bit_cast<float>(sign | ((exponent + 112u) << 23) |
+                              (mantissa << 13));
+}
+
+namespace detail {
+
+/*
+  Lookup tables of the sRGB transfer function. decode holds the linear value
+  of every code and thresholds[k] the smallest linear value encoded as k or
+  above. guess maps 4096 equal intervals of [0, 1) to the code of their
+  lower end; consecutive thresholds are further apart than an interval, so
+  the code of any value is its guess or the next one
+*/
+struct SrgbTables {
+  std::array<float, 256> decode;
+  std::array<float, 256> thresholds;
+  std::array<std::uint8_t, 4096> guess;
+};
+
+[[nodiscard]] inline double srgb_to_linear(double encoded) noexcept {
+  return encoded <= 0.04045 ? encoded / 12.92
+                            : std::pow((encoded + 0.055) / 1.055, 2.4);
+}
+
+[[nodiscard]] inline const SrgbTables& srgb_tables() noexcept {
+  static const SrgbTables tables = [] {
+    SrgbTables result{};
+    for (std::size_t code = 0; code < 256; ++code) {
+      const auto encoded = static_cast<double>(code) / 255.;
+      result.decode[code] = static_cast<float>(srgb_to_linear(encoded));
+      result.thresholds[code] =
+          code == 0 ? 0.f
+                    : static_cast<float>(
+                          srgb_to_linear((static_cast<double>(code) - 0.5) /
+                                         255.));
+    }
+    std::size_t code = 0;
+    for (std::size_t interval = 0; interval < result.guess.size();
+         ++interval) {
+      const auto start = static_cast<float>(interval) / 4096.f;
+      while (code < 255 && result.thresholds[code + 1] <= start) ++code;
+      result.guess[interval] = static_cast<std::uint8_t>(code);
+    }
+    return result;
+  }();
+  return tables;
+}
+
+}  // namespace detail
+
+/*
+  sRGB code of a linear value, rounded to the nearest code. Values outside
+  [0, 1] are clamped and NaN encodes as 0
+*/
+[[nodiscard]] inline std::uint8_t linear_to_srgb8(float value) noexcept {
+  if (!(value > 0.f)) return 0;
+  if (value >= 1.f) return 255;
+
+  const auto& tables = detail::srgb_tables();
+  auto code = tables.guess[static_cast<std::size_t>(value * 4096.f)];
+  if (code < 255 && value >= tables.thresholds[code + 1u]) ++code;
+  return code;
+}
+
+[[nodiscard]] inline float srgb8_to_linear(std::uint8_t code) noexcept {
+  return detail::srgb_tables().decode[code];
+}
+
+/*
+  Channel value of a PPM file: the value clamped to [0, 1] and scaled to
+  [0, 255] without any transfer curve
+*/
+[[nodiscard]] inline std::uint8_t linear_to_unorm8(float value) noexcept {
+  if (!(value > 0.f)) return 0;
+  if (value > 1.f) return 255;
+  return static_cast<std::uint8_t>(std::lround(value * 255.f));
+}
+
+/*
+  Conversions of runs of pixels between colors and packed channels, three
+  values per pixel. The loops carry no dependency from one pixel to the next
+  so they vectorize
+*/
+inline void encode_half(const Color* colors, std::size_t count,
+                        std::uint16_t* channels) noexcept {
+  for (std::size_t i = 0; i < count; ++i) {
+    channels[3 * i] = float_to_half(colors[i].red);
+    channels[3 * i + 1] = float_to_half(colors[i].green);
+    channels[3 * i + 2] = float_to_half(colors[i].blue);
+  }
+}
+
+inline void decode_half(const std::uint16_t* channels, std::size_t count,
+                        Color* colors) noexcept {
+  for (std::size_t i = 0; i < count; ++i) {
+    colors[i] = Color(half_to_float(channels[3 * i]),
+                      half_to_float(channels[3 * i + 1]),
+                      half_to_float(channels[3 * i + 2]));
+  }
+}
+
+inline void encode_srgb8(const Color* colors, std::size_t count,
+                         std::uint8_t* channels) noexcept {
+  for (std::size_t i = 0; i < count; ++i) {
+    channels[3 * i] = linear_to_srgb8(colors[i].red);
+    channels[3 * i + 1] = linear_to_srgb8(colors[i].green);
+    channels[3 * i + 2] = linear_to_srgb8(colors[i].blue);
+  }
+}
+
+inline void decode_srgb8(const std::uint8_t* channels, std::size_t count,
+                         Color* colors) noexcept {
+  for (std::size_t i = 0; i < count; ++i) {
+    colors[i] = Color(srgb8_to_linear(channels[3 * i]),
+                      srgb8_to_linear(channels[3 * i + 1]),
+                      srgb8_to_linear(channels[3 * i + 2]));
+  }
+}
+
+}  // namespace PixelFormatUtil
+
+#endif
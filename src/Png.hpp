@@ -0,0 +1,449 @@
+#ifndef CONSTEXPR_RAYTRACER_PNG_HPP
+#define CONSTEXPR_RAYTRACER_PNG_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "PixelFormat.hpp"
+
+/*
+  PNG writing without external libraries
+
+  Rows are quantized like in Ppm.hpp, filtered with the PNG filter that
+  gives the smallest sum of absolute residuals and compressed with a
+  single-probe LZ77 matcher coded with the fixed deflate Huffman tables.
+  That trades a few percent of file size against zlib for a much simpler and
+  faster encoder.
+*/
+
+namespace PngUtil {
+
+namespace detail {
+
+[[nodiscard]] constexpr std::array<std::uint32_t, 256> crc_table() noexcept {
+  std::array<std::uint32_t, 256> table{};
+  for (std::uint32_t n = 0; n < 256; ++n) {
+    auto c = n;
+    for (int k = 0; k < 8; ++k)
+      c = (c & 1u) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    table[n] = c;
+  }
+  return table;
+}
+
+constexpr auto crc_lookup = crc_table();
+
+/*
+  Length and distance codes of deflate (RFC 1951, 3.2.5): first value and
+  number of extra bits of every code
+*/
+constexpr std::array<std::uint16_t, 29> length_base{
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<std::uint8_t, 29> length_extra{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<std::uint16_t, 30> distance_base{
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr std::array<std::uint8_t, 30> distance_extra{
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+[[nodiscard]] constexpr std::uint32_t reverse_bits(std::uint32_t code,
+                                                   int length) noexcept {
+  std::uint32_t reversed = 0;
+  for (int i = 0; i < length; ++i) {
+    reversed = (reversed << 1) | (code & 1u);
+    code >>= 1;
+  }
+  return reversed;
+}
+
+struct HuffmanCode {
+  std::uint16_t bits;
+  std::uint8_t length;
+};
+
+/*
+  Fixed literal/length codes (RFC 1951, 3.2.6), bit-reversed since deflate
+  packs Huffman codes starting from their most significant bit
+*/
+[[nodiscard]] constexpr std::array<HuffmanCode, 288> fixed_codes() noexcept {
+  std::array<HuffmanCode, 288> codes{};
+  for (std::uint32_t symbol = 0; symbol < 288; ++symbol) {
+    std::uint32_t code = 0;
+    int length = 0;
+    if (symbol < 144) {
+      code = 0x30u + symbol;
+      length = 8;
+    } else if (symbol < 256) {
+      code = 0x190u + symbol - 144u;
+      length = 9;
+    } else if (symbol < 280) {
+      code = symbol - 256u;
+      length = 7;
+    } else {
+      code = 0xC0u + symbol - 280u;
+      length = 8;
+    }
+    codes[symbol] = {static_cast<std::uint16_t>(reverse_bits(code, length)),
+                     static_cast<std::uint8_t>(length)};
+  }
+  return codes;
+}
+
+constexpr auto fixed_literal_codes = fixed_codes();
+
+/*
+  Code of every match length from 3 to 258
+*/
+[[nodiscard]] constexpr std::array<std::uint8_t, 259> length_codes() noexcept {
+  std::array<std::uint8_t, 259> codes{};
+  for (std::size_t code = 0; code < length_base.size(); ++code) {
+    for (std::size_t length = length_base[code];
+         length < (code + 1 < length_base.size() ? length_base[code + 1]
+                                                 : 259u);
+         ++length)
+      codes[length] = static_cast<std::uint8_t>(code);
+  }
+  codes[258] = 28;
+  return codes;
+}
+
+constexpr auto length_lookup = length_codes();
+
+[[nodiscard]] constexpr std::size_t distance_code(
+    std::size_t distance) noexcept {
+  const auto next = std::upper_bound(distance_base.begin(),
+                                     distance_base.end(), distance);
+  return static_cast<std::size_t>(next - distance_base.begin()) - 1;
+}
+
+}  // namespace detail
+
+[[nodiscard]] constexpr std::uint32_t crc32(std::string_view bytes,
+                                            std::uint32_t crc = 0) noexcept {
+  crc = ~crc;
+  for (const char byte : bytes) {
+    crc = detail::crc_lookup[(crc ^ static_cast<unsigned char>(byte)) & 0xFFu] ^
+          (crc >> 8);
+  }
+  return ~crc;
+}
+
+/*
+  DeflateStream:
+
+  Compresses a byte stream fed in pieces into a zlib stream. Data is
+  buffered and compressed in blocks of block_size bytes, each one matched
+  against the 32 KiB that precede it, and complete bytes of output are
+  handed out as soon as they are produced.
+*/
+class DeflateStream {
+ public:
+  static constexpr std::size_t block_size{1 << 16};
+
+  DeflateStream() : head_(hash_size, -window_size - 1) {
+    // zlib header: deflate with a 32 KiB window, fastest compression
+    out_ += '\x78';
+    out_ += '\x01';
+  }
+
+  void write(std::string_view bytes) {
+    // The sums are reduced every 5552 bytes, the most that cannot overflow
+    for (std::size_t i = 0; i < bytes.size(); i += 5552) {
+      const auto end = std::min(bytes.size(), i + 5552);
+      for (auto j = i; j < end; ++j) {
+        adler_a_ += static_cast<unsigned char>(bytes[j]);
+        adler_b_ += adler_a_;
+      }
+      adler_a_ %= 65521u;
+      adler_b_ %= 65521u;
+    }
+    data_.append(bytes);
+    while (data_.size() - position_ >= block_size) compress(block_size, false);
+  }
+
+  /*
+    Compresses the buffered data and closes the stream
+  */
+  void finish() {
+    compress(data_.size() - position_, true);
+    if (bit_count_ > 0) {
+      out_ += static_cast<char>(bit_buffer_ & 0xFFu);
+      bit_buffer_ = 0;
+      bit_count_ = 0;
+    }
+    const auto adler = (adler_b_ << 16) | adler_a_;
+    for (int shift = 24; shift >= 0; shift -= 8)
+      out_ += static_cast<char>((adler >> shift) & 0xFFu);
+  }
+
+  /*
+    Compressed bytes produced since the last call
+  */
+  [[nodiscard]] std::string take_output() { return std::exchange(out_, {}); }
+
+ private:
+  static constexpr std::ptrdiff_t window_size{1 << 15};
+  static constexpr std::size_t hash_size{1 << 15};
+  static constexpr std::size_t min_match{3};
+  static constexpr std::size_t max_match{258};
+
+  void put_bits(std::uint32_t bits, int count) {
+    bit_buffer_ |= static_cast<std::uint64_t>(bits) << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+      out_ += static_cast<char>(bit_buffer_ & 0xFFu);
+      bit_buffer_ >>= 8;
+      bit_count_ -= 8;
+    }
+  }
+
+  void put_symbol(std::size_t symbol) {
+    const auto code = detail::fixed_literal_codes[symbol];
+    put_bits(code.bits, code.length);
+  }
+
+  void put_match(std::size_t length, std::size_t distance) {
+    using namespace detail;
+
+    const auto length_code = length_lookup[length];
+    put_symbol(257u + length_code);
+    put_bits(static_cast<std::uint32_t>(length - length_base[length_code]),
+             length_extra[length_code]);
+
+    const auto code = distance_code(distance);
+    put_bits(reverse_bits(static_cast<std::uint32_t>(code), 5), 5);
+    put_bits(static_cast<std::uint32_t>(distance - distance_base[code]),
+             distance_extra[code]);
+  }
+
+  [[nodiscard]] std::size_t hash_at(std::size_t i) const noexcept {
+    const auto bytes = static_cast<std::uint32_t>(
+        static_cast<unsigned char>(data_[i]) |
+        static_cast<unsigned char>(data_[i + 1]) << 8 |
+        static_cast<unsigned char>(data_[i + 2]) << 16);
+    return (bytes * 2654435761u) >> 17;
+  }
+
+  /*
+    Codes the next `count` buffered bytes as one fixed-Huffman block
+  */
+  void compress(std::size_t count, bool final) {
+    put_bits(final ? 1u : 0u, 1);
+    put_bits(1u, 2);  // fixed Huffman codes
+
+    const auto end = position_ + count;
+    auto i = position_;
+    while (i < end) {
+      std::size_t length = 0;
+      std::size_t distance = 0;
+      if (end - i >= min_match) {
+        const auto slot = hash_at(i);
+        const auto candidate = head_[slot];
+        const auto absolute = static_cast<std::ptrdiff_t>(i) + offset_;
+        head_[slot] = absolute;
+        if (absolute - candidate <= window_size) {
+          const auto start = static_cast<std::size_t>(candidate - offset_);
+          const auto limit = std::min(max_match, end - i);
+          while (length < limit && data_[start + length] == data_[i + length])
+            ++length;
+          distance = i - start;
+        }
+      }
+
+      if (length >= min_match) {
+        put_match(length, distance);
+        // Only the start of every match is hashed, which keeps long runs of
+        // equal pixels cheap
+        i += length;
+      } else {
+        put_symbol(static_cast<unsigned char>(data_[i]));
+        ++i;
+      }
+    }
+    put_symbol(256);  // end of block
+    position_ = end;
+
+    // Keep the window the next block can refer to
+    if (position_ > static_cast<std::size_t>(window_size)) {
+      const auto drop = position_ - static_cast<std::size_t>(window_size);
+      data_.erase(0, drop);
+      position_ -= drop;
+      offset_ += static_cast<std::ptrdiff_t>(drop);
+    }
+  }
+
+  std::string data_{};
+  std::size_t position_{0};
+  std::ptrdiff_t offset_{0};
+  std::vector<std::ptrdiff_t> head_;
+  std::uint64_t bit_buffer_{0};
+  int bit_count_{0};
+  std::uint32_t adler_a_{1};
+  std::uint32_t adler_b_{0};
+  std::string out_{};
+};
+
+}  // namespace PngUtil
+
+/*
+  PngRowWriter:
+
+  Writes an 8-bit RGB PNG one row at a time, top to bottom. Compressed data
+  is written in an IDAT chunk whenever a deflate block is complete, and the
+  file is closed with the last row.
+*/
+class PngRowWriter {
+ public:
+  PngRowWriter(std::ostream& stream, int width, int height)
+      : stream_{stream},
+        width_{width},
+        height_{height},
+        previous_(3 * static_cast<std::size_t>(width)),
+        current_(previous_.size()),
+        filtered_(previous_.size() + 1, '\0'),
+        candidate_(filtered_.size(), '\0') {
+    assert(width > 0 && height > 0);
+
+    stream_ << std::string_view("\x89PNG\r\n\x1A\n", 8);
+    std::string header;
+    append_u32(header, static_cast<std::uint32_t>(width));
+    append_u32(header, static_cast<std::uint32_t>(height));
+    header += '\x08';  // bit depth
+    header += '\x02';  // RGB
+    header.append(3, '\0');  // deflate, adaptive filters, no interlace
+    write_chunk("IHDR", header);
+  }
+
+  void write_row([[maybe_unused]] int y, const Color* colors) {
+    assert(y == next_row_);
+    ++next_row_;
+
+    for (std::size_t x = 0; x < static_cast<std::size_t>(width_); ++x) {
+      current_[3 * x] = PixelFormatUtil::linear_to_unorm8(colors[x].red);
+      current_[3 * x + 1] = PixelFormatUtil::linear_to_unorm8(colors[x].green);
+      current_[3 * x + 2] = PixelFormatUtil::linear_to_unorm8(colors[x].blue);
+    }
+    filter_row();
+    deflate_.write(filtered_);
+    std::swap(previous_, current_);
+
+    if (next_row_ == height_) deflate_.finish();
+    if (const auto data = deflate_.take_output(); !data.empty())
+      write_chunk("IDAT", data);
+    if (next_row_ == height_) write_chunk("IEND", {});
+  }
+
+ private:
+  static void append_u32(std::string& out, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+      out += static_cast<char>((value >> shift) & 0xFFu);
+  }
+
+  void write_chunk(std::string_view type, std::string_view data) {
+    std::string chunk;
+    append_u32(chunk, static_cast<std::uint32_t>(data.size()));
+    chunk += type;
+    chunk += data;
+    append_u32(chunk, PngUtil::crc32(std::string_view(chunk).substr(4)));
+    stream_ << chunk;
+  }
+
+  [[nodiscard]] static int paeth(int a, int b, int c) noexcept {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+  }
+
+  /*
+    Writes the row filtered with predict(i) as filter type `filter` to out
+    and returns the sum of the residuals taken as signed bytes
+  */
+  template <typename Predict>
+  long filter_with(int filter, const Predict& predict, std::string& out) {
+    out[0] = static_cast<char>(filter);
+    long cost = 0;
+    for (std::size_t i = 0; i < current_.size(); ++i) {
+      const auto residual = static_cast<std::uint8_t>(current_[i] - predict(i));
+      out[i + 1] = static_cast<char>(residual);
+      cost += std::abs(static_cast<std::int8_t>(residual));
+    }
+    return cost;
+  }
+
+  /*
+    Filters the row with the filter type minimizing the sum of the residuals,
+    the heuristic recommended by the PNG specification. The row above the
+    first one is all zeros
+  */
+  void filter_row() {
+    const auto left = [&](std::size_t i) {
+      return i >= 3 ? current_[i - 3] : 0;
+    };
+    const auto up = [&](std::size_t i) { return previous_[i]; };
+    const auto up_left = [&](std::size_t i) {
+      return i >= 3 ? previous_[i - 3] : 0;
+    };
+
+    long best_cost = filter_with(0, [](std::size_t) { return 0; }, filtered_);
+    const auto keep_best = [&](long cost) {
+      if (cost < best_cost) {
+        best_cost = cost;
+        std::swap(filtered_, candidate_);
+      }
+    };
+    keep_best(filter_with(1, left, candidate_));
+    keep_best(filter_with(2, up, candidate_));
+    keep_best(filter_with(
+        3, [&](std::size_t i) { return (left(i) + up(i)) / 2; }, candidate_));
+    keep_best(filter_with(
+        4, [&](std::size_t i) { return paeth(left(i), up(i), up_left(i)); },
+        candidate_));
+  }
+
+  std::ostream& stream_;
+  int width_;
+  int height_;
+  int next_row_{0};
+  std::vector<std::uint8_t> previous_;
+  std::vector<std::uint8_t> current_;
+  std::string filtered_;
+  std::string candidate_;
+  PngUtil::DeflateStream deflate_{};
+};
+
+namespace CanvasUtil {
+
+[[nodiscard]] inline std::string to_png(const Canvas& canvas) {
+  std::ostringstream stream;
+  PngRowWriter writer(stream, canvas.width(), canvas.height());
+  std::vector<Color> row(static_cast<std::size_t>(canvas.width()));
+  for (int y = 0; y < canvas.height(); ++y) {
+    canvas.read_row(y, row.data());
+    writer.write_row(y, row.data());
+  }
+  return std::move(stream).str();
+}
+
+}  // namespace CanvasUtil
+
+#endif
@@ -1,35 +1,43 @@
 #ifndef CONSTEXPR_RAYTRACER_PPM_HPP
 #define CONSTEXPR_RAYTRACER_PPM_HPP
 
+#include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "Canvas.hpp"
+#include "MappedFile.hpp"
+#include "PixelFormat.hpp"
 
 namespace CanvasUtil {
 
 namespace detail {
 
-[[nodiscard]] std::string ppm_pixel_string(const Canvas& canvas) noexcept {
+[[nodiscard]] inline std::string ppm_pixel_string(
+    const Canvas& canvas) noexcept {
   static constexpr auto normalize_float = [](float color_value) {
-    if (color_value < 0.f) return 0l;
-    if (color_value > 1.f) return 255l;
-    return std::lround(color_value * 255.f);
+    return static_cast<int>(PixelFormatUtil::linear_to_unorm8(color_value));
   };
 
   std::string pixel_str;
-  for (const auto& row : canvas.pixels()) {
-    for (const Color& pixel : row) {
-      pixel_str += std::to_string(normalize_float(pixel.red)) + ' ' +
-                   std::to_string(normalize_float(pixel.green)) + ' ' +
-                   std::to_string(normalize_float(pixel.blue)) + ' ';
-    }
-    pixel_str.back() = '\n';
+  for (auto it = canvas.begin(); it != canvas.end(); ++it) {
+    const Color pixel = *it;
+    pixel_str += std::to_string(normalize_float(pixel.red)) + ' ' +
+                 std::to_string(normalize_float(pixel.green)) + ' ' +
+                 std::to_string(normalize_float(pixel.blue)) + ' ';
+    if (it.x() == canvas.width() - 1) pixel_str.back() = '\n';
   }
   return pixel_str;
 }
 
-void ppm_split_lines(std::string& pixel_string) noexcept {
+inline void ppm_split_lines(std::string& pixel_string) noexcept {
   ptrdiff_t line_size = 0;
   auto last_whitespace = pixel_string.begin();
   for (auto it = pixel_string.begin(); it != pixel_string.end(); ++it) {
@@ -46,12 +54,35 @@ void ppm_split_lines(std::string& pixel_string) noexcept {
 
 }  // namespace detail
 
-[[nodiscard]] std::string ppm_header(const Canvas& canvas) noexcept {
-  return "P3\n" + std::to_string(canvas.width()) + ' ' +
-         std::to_string(canvas.height()) + "\n255\n";
+[[nodiscard]] inline std::string ppm_header(int width, int height) noexcept {
+  return "P3\n" + std::to_string(width) + ' ' + std::to_string(height) +
+         "\n255\n";
+}
+
+[[nodiscard]] inline std::string ppm_header(const Canvas& canvas) noexcept {
+  return ppm_header(canvas.width(), canvas.height());
+}
+
+/*
+  PPM lines of one row of width pixels, split the way ppm_payload splits
+  them, so the rows of an image concatenated give its payload
+*/
+[[nodiscard]] inline std::string ppm_row(const Color* colors,
+                                         int width) noexcept {
+  std::string row;
+  for (int x = 0; x < width; ++x) {
+    for (const float channel : {colors[x].red, colors[x].green,
+                                colors[x].blue}) {
+      row += std::to_string(PixelFormatUtil::linear_to_unorm8(channel));
+      row += ' ';
+    }
+  }
+  row.back() = '\n';
+  detail::ppm_split_lines(row);
+  return row;
 }
 
-[[nodiscard]] std::string ppm_payload(const Canvas& canvas) noexcept {
+[[nodiscard]] inline std::string ppm_payload(const Canvas& canvas) noexcept {
   if (canvas.empty()) return "";
 
   auto payload = detail::ppm_pixel_string(canvas);
@@ -59,10 +90,171 @@ void ppm_split_lines(std::string& pixel_string) noexcept {
   return payload;
 }
 
-[[nodiscard]] std::string to_ppm(const Canvas& canvas) noexcept {
+[[nodiscard]] inline std::string to_ppm(const Canvas& canvas) noexcept {
   return ppm_header(canvas) + ppm_payload(canvas);
 }
 
+namespace detail {
+
+[[nodiscard]] constexpr bool is_ppm_space(char c) noexcept {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' ||
+         c == '\f';
+}
+
+/*
+  Skips whitespace and, in the header, comments running from '#' to the end
+  of the line
+*/
+constexpr void skip_ppm_space(const char*& it, const char* end,
+                              bool comments) noexcept {
+  while (it != end) {
+    if (is_ppm_space(*it)) {
+      ++it;
+    } else if (comments && *it == '#') {
+      while (it != end && *it != '\n') ++it;
+    } else {
+      break;
+    }
+  }
+}
+
+/*
+  Unsigned decimal number after optional whitespace, read in place without
+  allocating. Fails on anything but digits and on values above 65535, the
+  largest PPM sample
+*/
+[[nodiscard]] constexpr std::optional<std::uint32_t> scan_ppm_number(
+    const char*& it, const char* end, bool comments = false) noexcept {
+  skip_ppm_space(it, end, comments);
+  if (it == end || *it < '0' || *it > '9') return std::nullopt;
+
+  std::uint32_t value = 0;
+  for (; it != end && *it >= '0' && *it <= '9'; ++it) {
+    value = value * 10 + static_cast<std::uint32_t>(*it - '0');
+    if (value > 65535) return std::nullopt;
+  }
+  return value;
+}
+
+}  // namespace detail
+
+/*
+  Reads a P3 or P6 image. Samples are scaled by the maximum value of the
+  file, so images written by to_ppm or MappedCanvas read back as the colors
+  they were quantized to. Returns nothing for malformed or truncated data
+*/
+[[nodiscard]] inline std::optional<Canvas> parse_ppm(
+    std::string_view data, CanvasLayout layout = CanvasLayout::RowMajor,
+    PixelFormat format = PixelFormat::Float) {
+  using namespace detail;
+
+  if (data.size() < 2 || data[0] != 'P' || (data[1] != '3' && data[1] != '6'))
+    return std::nullopt;
+  const bool binary = data[1] == '6';
+
+  const char* it = data.data() + 2;
+  const char* const end = data.data() + data.size();
+  const auto width = scan_ppm_number(it, end, true);
+  const auto height = scan_ppm_number(it, end, true);
+  const auto max_value = scan_ppm_number(it, end, true);
+  if (!width || !height || !max_value || *width == 0 || *height == 0 ||
+      *max_value == 0)
+    return std::nullopt;
+
+  // Sizes are checked against the data before the canvas is allocated, so
+  // a corrupt header cannot request gigabytes: binary samples take one or
+  // two bytes and text samples at least a digit and a separator
+  const auto samples = 3 * std::size_t{*width} * std::size_t{*height};
+  const std::size_t sample_size = *max_value < 256 ? 1 : 2;
+  if (binary && (it == end || !is_ppm_space(*it))) return std::nullopt;
+  const auto remaining = static_cast<std::size_t>(end - it);
+  if (binary ? remaining < 1 + samples * sample_size
+             : remaining < 2 * samples - 1)
+    return std::nullopt;
+
+  Canvas canvas(static_cast<int>(*width), static_cast<int>(*height), layout,
+                format);
+  const auto scale = 1.f / static_cast<float>(*max_value);
+  std::vector<Color> row(*width);
+
+  if (binary) {
+    // A single whitespace character separates the header from the samples
+    ++it;
+    const auto row_size = 3 * std::size_t{*width} * sample_size;
+
+    std::vector<float> levels;
+    if (sample_size == 1) {
+      levels.resize(256);
+      for (std::size_t i = 0; i < levels.size(); ++i)
+        levels[i] = static_cast<float>(i) * scale;
+    }
+    const auto* bytes = reinterpret_cast<const unsigned char*>(it);
+    const auto sample = [&](std::size_t i) {
+      if (sample_size == 1) return levels[bytes[i]];
+      return static_cast<float>(bytes[2 * i] << 8 | bytes[2 * i + 1]) * scale;
+    };
+
+    for (int y = 0; y < canvas.height(); ++y, bytes += row_size) {
+      for (std::size_t x = 0; x < row.size(); ++x)
+        row[x] = Color(sample(3 * x), sample(3 * x + 1), sample(3 * x + 2));
+      canvas.write_row(y, row.data());
+    }
+    return canvas;
+  }
+
+  for (int y = 0; y < canvas.height(); ++y) {
+    for (auto& color : row) {
+      const auto red = scan_ppm_number(it, end);
+      const auto green = scan_ppm_number(it, end);
+      const auto blue = scan_ppm_number(it, end);
+      if (!red || !green || !blue) return std::nullopt;
+      color = Color(static_cast<float>(*red) * scale,
+                    static_cast<float>(*green) * scale,
+                    static_cast<float>(*blue) * scale);
+    }
+    canvas.write_row(y, row.data());
+  }
+  return canvas;
+}
+
+/*
+  Reads a PPM file through a memory map, see parse_ppm
+*/
+[[nodiscard]] inline std::optional<Canvas> load_ppm(
+    const std::filesystem::path& path,
+    CanvasLayout layout = CanvasLayout::RowMajor,
+    PixelFormat format = PixelFormat::Float) {
+  const auto file = MappedFile::open(path);
+  if (!file) return std::nullopt;
+  return parse_ppm(file->view(), layout, format);
+}
+
 }  // namespace CanvasUtil
 
+/*
+  PpmRowWriter:
+
+  Writes a P3 image to a stream one row at a time, top to bottom, as rows
+  become available, e.g. as the sink of RenderUtil::render_streamed. The
+  stream receives the same bytes as CanvasUtil::to_ppm would produce.
+*/
+class PpmRowWriter {
+ public:
+  PpmRowWriter(std::ostream& stream, int width, int height)
+      : stream_{stream}, width_{width} {
+    stream_ << CanvasUtil::ppm_header(width, height);
+  }
+
+  void write_row([[maybe_unused]] int y, const Color* colors) {
+    assert(y == next_row_);
+    ++next_row_;
+    stream_ << CanvasUtil::ppm_row(colors, width_);
+  }
+
+ private:
+  std::ostream& stream_;
+  int width_;
+  int next_row_{0};
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,157 @@
+#ifndef CONSTEXPR_RAYTRACER_QOI_HPP
+#define CONSTEXPR_RAYTRACER_QOI_HPP
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "PixelFormat.hpp"
+
+/*
+  QoiRowWriter:
+
+  Writes an RGB image in the "Quite OK Image" format (qoiformat.org) one row
+  at a time, top to bottom. Every pixel is coded from the previous one as a
+  run, an index into the 64 most recently hashed colors, a small difference
+  or a literal, which compresses rendered images to a fraction of their PPM
+  size at memory-bandwidth speed. Channels are quantized like in Ppm.hpp.
+  The end marker is written with the last row.
+*/
+class QoiRowWriter {
+ public:
+  QoiRowWriter(std::ostream& stream, int width, int height)
+      : stream_{stream}, width_{width}, height_{height} {
+    assert(width > 0 && height > 0);
+
+    std::string header = "qoif";
+    append_u32(header, static_cast<std::uint32_t>(width));
+    append_u32(header, static_cast<std::uint32_t>(height));
+    header += '\3';  // RGB
+    header += '\0';  // sRGB with linear alpha
+    stream_ << header;
+  }
+
+  void write_row([[maybe_unused]] int y, const Color* colors) {
+    assert(y == next_row_);
+    ++next_row_;
+
+    out_.clear();
+    for (int x = 0; x < width_; ++x) {
+      const Pixel pixel{PixelFormatUtil::linear_to_unorm8(colors[x].red),
+                        PixelFormatUtil::linear_to_unorm8(colors[x].green),
+                        PixelFormatUtil::linear_to_unorm8(colors[x].blue),
+                        255};
+      encode(pixel);
+    }
+    if (next_row_ == height_) {
+      flush_run();
+      out_.append(7, '\0');
+      out_ += '\1';
+    }
+    stream_ << out_;
+  }
+
+ private:
+  // Images are opaque, but the color index of decoders starts out
+  // transparent black
+  struct Pixel {
+    std::uint8_t r{0};
+    std::uint8_t g{0};
+    std::uint8_t b{0};
+    std::uint8_t a{0};
+
+    [[nodiscard]] bool operator==(const Pixel&) const noexcept = default;
+  };
+
+  static constexpr std::uint8_t op_index{0x00};
+  static constexpr std::uint8_t op_diff{0x40};
+  static constexpr std::uint8_t op_luma{0x80};
+  static constexpr std::uint8_t op_run{0xC0};
+  static constexpr std::uint8_t op_rgb{0xFE};
+  static constexpr int max_run{62};
+
+  static void append_u32(std::string& out, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+      out += static_cast<char>((value >> shift) & 0xFFu);
+  }
+
+  [[nodiscard]] static std::size_t hash(const Pixel& p) noexcept {
+    return (p.r * 3u + p.g * 5u + p.b * 7u + p.a * 11u) % 64u;
+  }
+
+  void put(unsigned byte) { out_ += static_cast<char>(byte); }
+
+  void flush_run() {
+    if (run_ > 0) put(op_run | static_cast<unsigned>(run_ - 1));
+    run_ = 0;
+  }
+
+  void encode(const Pixel& pixel) {
+    if (pixel == previous_) {
+      if (++run_ == max_run) flush_run();
+      return;
+    }
+    flush_run();
+
+    const auto slot = hash(pixel);
+    if (seen_[slot] == pixel) {
+      put(op_index | static_cast<unsigned>(slot));
+    } else {
+      seen_[slot] = pixel;
+
+      const auto dr = static_cast<std::int8_t>(pixel.r - previous_.r);
+      const auto dg = static_cast<std::int8_t>(pixel.g - previous_.g);
+      const auto db = static_cast<std::int8_t>(pixel.b - previous_.b);
+      const auto dr_dg = dr - dg;
+      const auto db_dg = db - dg;
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+        put(op_diff | static_cast<unsigned>((dr + 2) << 4 | (dg + 2) << 2 |
+                                            (db + 2)));
+      } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                 db_dg >= -8 && db_dg <= 7) {
+        put(op_luma | static_cast<unsigned>(dg + 32));
+        put(static_cast<unsigned>((dr_dg + 8) << 4 | (db_dg + 8)));
+      } else {
+        put(op_rgb);
+        put(pixel.r);
+        put(pixel.g);
+        put(pixel.b);
+      }
+    }
+    previous_ = pixel;
+  }
+
+  std::ostream& stream_;
+  int width_;
+  int height_;
+  int next_row_{0};
+  Pixel previous_{0, 0, 0, 255};
+  std::array<Pixel, 64> seen_{};
+  int run_{0};
+  std::string out_{};
+};
+
+namespace CanvasUtil {
+
+[[nodiscard]] inline std::string to_qoi(const Canvas& canvas) {
+  std::ostringstream stream;
+  QoiRowWriter writer(stream, canvas.width(), canvas.height());
+  std::vector<Color> row(static_cast<std::size_t>(canvas.width()));
+  for (int y = 0; y < canvas.height(); ++y) {
+    canvas.read_row(y, row.data());
+    writer.write_row(y, row.data());
+  }
+  return std::move(stream).str();
+}
+
+}  // namespace CanvasUtil
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef CONSTEXPR_RAYTRACER_RANDOM_HPP
+#define CONSTEXPR_RAYTRACER_RANDOM_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*
+  Counter-based random numbers
+
+  Philox 4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+  3", 2011) maps a 128-bit counter and a 64-bit key to 128 random bits with
+  no state in between. Keying the counter on what is being sampled (pixel,
+  sample, bounce) and the key on the seed makes every random number a pure
+  function of its purpose, so renders are identical whatever the number of
+  threads or the order of the tiles, and workers never share a generator.
+*/
+
+namespace RandomUtil {
+
+using Counter = std::array<std::uint32_t, 4>;
+using Key = std::array<std::uint32_t, 2>;
+
+namespace detail {
+
+constexpr std::uint32_t philox_m0{0xD2511F53U};
+constexpr std::uint32_t philox_m1{0xCD9E8D57U};
+constexpr std::uint32_t philox_w0{0x9E3779B9U};
+constexpr std::uint32_t philox_w1{0xBB67AE85U};
+constexpr int philox_rounds{10};
+
+[[nodiscard]] constexpr std::uint32_t high_bits(std::uint64_t x) noexcept {
+  return static_cast<std::uint32_t>(x >> 32);
+}
+
+[[nodiscard]] constexpr std::uint32_t low_bits(std::uint64_t x) noexcept {
+  return static_cast<std::uint32_t>(x);
+}
+
+}  // namespace detail
+
+[[nodiscard]] constexpr Counter philox(Counter counter, Key key) noexcept {
+  using namespace detail;
+
+  for (int round = 0; round < philox_rounds; ++round) {
+    const auto product0 = std::uint64_t{philox_m0} * counter[0];
+    const auto product1 = std::uint64_t{philox_m1} * counter[2];
+    counter = {high_bits(product1) ^ counter[1] ^ key[0], low_bits(product1),
+               high_bits(product0) ^ counter[3] ^ key[1], low_bits(product0)};
+    key[0] += philox_w0;
+    key[1] += philox_w1;
+  }
+  return counter;
+}
+
+/*
+  Packet version of philox over Width independent counters sharing a key,
+  laid out as counters[word][lane]. Every lane runs the same instructions, so
+  the loops vectorize with 32x32->64 bit multiplies
+*/
+template <std::size_t Width>
+[[nodiscard]] constexpr std::array<std::array<std::uint32_t, Width>, 4> philox(
+    std::array<std::array<std::uint32_t, Width>, 4> counters,
+    Key key) noexcept {
+  using namespace detail;
+
+  for (int round = 0; round < philox_rounds; ++round) {
+    for (std::size_t lane = 0; lane < Width; ++lane) {
+      const auto product0 = std::uint64_t{philox_m0} * counters[0][lane];
+      const auto product1 = std::uint64_t{philox_m1} * counters[2][lane];
+      const auto c1 = counters[1][lane];
+      const auto c3 = counters[3][lane];
+      counters[0][lane] = high_bits(product1) ^ c1 ^ key[0];
+      counters[1][lane] = low_bits(product1);
+      counters[2][lane] = high_bits(product0) ^ c3 ^ key[1];
+      counters[3][lane] = low_bits(product0);
+    }
+    key[0] += philox_w0;
+    key[1] += philox_w1;
+  }
+  return counters;
+}
+
+/*
+  Uniform float in [0, 1) from the 24 high bits of a random word
+*/
+[[nodiscard]] constexpr float to_unit_float(std::uint32_t bits) noexcept {
+  return static_cast<float>(bits >> 8) * 0x1p-24f;
+}
+
+/*
+  RandomStream:
+
+  Sequence of uniform floats for one (pixel, sample, bounce) under a seed.
+  Each block of four values comes from one philox call, with the block number
+  folded into the key, so streams never overlap and can be recreated at any
+  time from their coordinates.
+*/
+class RandomStream {
+ public:
+  [[nodiscard]] constexpr RandomStream(std::uint32_t x, std::uint32_t y,
+                                       std::uint32_t sample,
+                                       std::uint32_t bounce = 0,
+                                       std::uint32_t seed = 0) noexcept
+      : counter_{x, y, sample, bounce}, seed_{seed} {}
+
+  [[nodiscard]] constexpr float next() noexcept {
+    if (used_ == block_.size()) {
+      block_ = philox(counter_, Key{seed_, blocks_++});
+      used_ = 0;
+    }
+    return to_unit_float(block_[used_++]);
+  }
+
+ private:
+  Counter counter_;
+  std::uint32_t seed_;
+  std::uint32_t blocks_{0};
+  Counter block_{};
+  std::size_t used_{4};
+};
+
+/*
+  First four floats of the streams of Width pixels sharing sample, bounce and
+  seed, as values[k][lane]: the same numbers RandomStream(xs[lane], ys[lane],
+  sample, bounce, seed) starts with
+*/
+template <std::size_t Width>
+[[nodiscard]] constexpr std::array<std::array<float, Width>, 4> uniform_floats(
+    const std::array<std::uint32_t, Width>& xs,
+    const std::array<std::uint32_t, Width>& ys, std::uint32_t sample,
+    std::uint32_t bounce = 0, std::uint32_t seed = 0) noexcept {
+  std::array<std::array<std::uint32_t, Width>, 4> counters{};
+  for (std::size_t lane = 0; lane < Width; ++lane) {
+    counters[0][lane] = xs[lane];
+    counters[1][lane] = ys[lane];
+    counters[2][lane] = sample;
+    counters[3][lane] = bounce;
+  }
+
+  const auto bits = philox(counters, Key{seed, 0});
+
+  std::array<std::array<float, Width>, 4> values{};
+  for (std::size_t k = 0; k < 4; ++k) {
+    for (std::size_t lane = 0; lane < Width; ++lane)
+      values[k][lane] = to_unit_float(bits[k][lane]);
+  }
+  return values;
+}
+
+}  // namespace RandomUtil
+
+#endif
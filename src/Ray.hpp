@@ -1,8 +1,13 @@
 #ifndef CONSTEXPR_RAYTRACER_RAY_HPP
 #define CONSTEXPR_RAYTRACER_RAY_HPP
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <concepts>
+#include <cstddef>
+#include <limits>
 #include <optional>
+#include <vector>
 
 #include "MatrixTransformations.hpp"
 #include "Shape.hpp"
@@ -21,7 +26,13 @@ class Intersection {
   [[nodiscard]] constexpr Intersection(float t, ShapeType object) noexcept
       : t_{t}, object_type_{object} {}
 
-  [[nodiscard]] constexpr Intersection(float t, const Sphere& s) noexcept
+  [[nodiscard]] constexpr Intersection(float t, ShapeType object,
+                                       std::size_t index,
+                                       std::size_t primitive = 0) noexcept
+      : t_{t}, object_type_{object}, index_{index}, primitive_{primitive} {}
+
+  template <primitive T>
+  [[nodiscard]] constexpr Intersection(float t, const T& s) noexcept
       : t_{t}, object_type_{s.object_type} {}
 
   [[nodiscard]] constexpr float t() const noexcept { return t_; }
@@ -30,24 +41,40 @@ class Intersection {
     return object_type_;
   }
 
+  // Position of the intersected shape inside the container it was found in
+  [[nodiscard]] constexpr std::size_t index() const noexcept { return index_; }
+
+  // Triangle of a mesh that was hit, always 0 for the other shapes
+  [[nodiscard]] constexpr std::size_t primitive() const noexcept {
+    return primitive_;
+  }
+
   [[nodiscard]] friend constexpr bool operator==(
       const Intersection& lhs, const Intersection& rhs) noexcept {
-    return lhs.t_ == rhs.t_ && lhs.object_type_ == rhs.object_type_;
+    return lhs.t_ == rhs.t_ && lhs.object_type_ == rhs.object_type_ &&
+           lhs.index_ == rhs.index_ && lhs.primitive_ == rhs.primitive_;
   }
 
  private:
   float t_{0.f};
   ShapeType object_type_{ShapeType::Sphere};
+  std::size_t index_{0};
+  std::size_t primitive_{0};
 };
 
 namespace RayUtil {
 
 namespace detail {
 
+/*
+  Orders nonnegative intersections by distance ahead of all the negative
+  ones, so the hit is the first element of a sorted list. Negative
+  intersections are also ordered by distance to keep this a strict weak
+  ordering, as std::sort requires
+*/
 constexpr bool lower_nonnegative_intersection(
     const Intersection& lhs, const Intersection& rhs) noexcept {
-  // Comparison between negative intersections is undefined
-  if (lhs.t() < 0) return false;
+  if ((lhs.t() < 0) != (rhs.t() < 0)) return rhs.t() < 0;
   return lhs.t() < rhs.t();
 }
 
@@ -81,19 +108,21 @@ requires(std::is_same_v<typename IntersectionList::value_type, Intersection>)
   return ray.origin + ray.direction * t;
 }
 
-[[nodiscard]] constexpr auto intersect(const Ray& ray,
-                                       const Sphere& sphere) noexcept
+/*
+  Intersects a ray that is already expressed in the object space of the sphere,
+  so callers that share one transformation between many shapes only pay for
+  the ray transformation once
+*/
+[[nodiscard]] constexpr auto local_intersect(const Ray& local_ray,
+                                             const Sphere&) noexcept
     -> StaticVector<Intersection, 2> {
   using namespace TupleUtil;
   using namespace MathUtil;
 
-  const auto transformed_ray =
-      transform(ray, MatrixUtil::inverse(sphere.transform));
-
-  const auto sphere_to_ray = transformed_ray.origin - point(0, 0, 0);
+  const auto sphere_to_ray = local_ray.origin - point(0, 0, 0);
 
-  const auto a = dot(transformed_ray.direction, transformed_ray.direction);
-  const auto b = 2 * dot(transformed_ray.direction, sphere_to_ray);
+  const auto a = dot(local_ray.direction, local_ray.direction);
+  const auto b = 2 * dot(local_ray.direction, sphere_to_ray);
   const auto c = dot(sphere_to_ray, sphere_to_ray) - 1;
 
   const auto discriminant = b * b - 4 * a * c;
@@ -104,6 +133,568 @@ requires(std::is_same_v<typename IntersectionList::value_type, Intersection>)
       Intersection((-b + sqrt(discriminant)) / (2 * a), ShapeType::Sphere)};
 }
 
+/*
+  Intersects a world space ray with a sphere given by its center and radius,
+  with no matrix: the distances along the ray are those of the object space
+  test
+*/
+[[nodiscard]] constexpr auto intersect(const Ray& ray,
+                                       const SphereGeometry& sphere) noexcept
+    -> StaticVector<Intersection, 2> {
+  using namespace TupleUtil;
+
+  const auto center_to_ray = ray.origin - sphere.center;
+
+  const auto a = dot(ray.direction, ray.direction);
+  const auto b = 2 * dot(ray.direction, center_to_ray);
+  const auto c =
+      dot(center_to_ray, center_to_ray) - sphere.radius * sphere.radius;
+
+  const auto discriminant = b * b - 4 * a * c;
+  if (discriminant < 0) return StaticVector<Intersection, 2>();
+
+  const auto root = std::sqrt(discriminant);
+  return StaticVector<Intersection, 2>{
+      Intersection((-b - root) / (2 * a), ShapeType::Sphere),
+      Intersection((-b + root) / (2 * a), ShapeType::Sphere)};
+}
+
+/*
+  Packet variant of the test above: returns the nearest non-negative
+  distance to every sphere of the packet, infinity for misses and unused
+  lanes. The discriminants of all lanes are computed by a branch-free loop
+  that compilers turn into vector instructions; most rays miss every
+  sphere of a packet, so only the lanes that hit take a square root.
+*/
+template <std::size_t Width>
+[[nodiscard]] constexpr std::array<float, Width> intersect_spheres(
+    const Ray& ray, const SpherePacket<Width>& packet) noexcept {
+  const auto dx = ray.direction.x;
+  const auto dy = ray.direction.y;
+  const auto dz = ray.direction.z;
+  const auto a = dx * dx + dy * dy + dz * dz;
+
+  std::array<float, Width> b{};
+  std::array<float, Width> discriminant{};
+  for (std::size_t lane = 0; lane < Width; ++lane) {
+    const auto ox = ray.origin.x - packet.center[0][lane];
+    const auto oy = ray.origin.y - packet.center[1][lane];
+    const auto oz = ray.origin.z - packet.center[2][lane];
+    const auto radius = packet.radius[lane];
+
+    b[lane] = 2 * (dx * ox + dy * oy + dz * oz);
+    const auto c = ox * ox + oy * oy + oz * oz - radius * radius;
+    discriminant[lane] = b[lane] * b[lane] - 4 * a * c;
+  }
+
+  std::array<float, Width> result{};
+  result.fill(std::numeric_limits<float>::infinity());
+  for (std::size_t lane = 0; lane < packet.count; ++lane) {
+    if (discriminant[lane] < 0) continue;
+    const auto root = std::sqrt(discriminant[lane]);
+    const auto near = (-b[lane] - root) / (2 * a);
+    const auto far = (-b[lane] + root) / (2 * a);
+    if (near >= 0)
+      result[lane] = near;
+    else if (far >= 0)
+      result[lane] = far;
+  }
+  return result;
+}
+
+[[nodiscard]] constexpr auto local_intersect(const Ray& local_ray,
+                                             const Plane&) noexcept
+    -> StaticVector<Intersection, 1> {
+  if (std::abs(local_ray.direction.y) < MathUtil::default_epsilon)
+    return StaticVector<Intersection, 1>();
+
+  return StaticVector<Intersection, 1>{Intersection(
+      -local_ray.origin.y / local_ray.direction.y, ShapeType::Plane)};
+}
+
+namespace detail {
+
+/*
+  Distances at which a ray crosses the two slabs of a unit cube along one
+  axis. Rays parallel to the slabs get infinite distances instead of a
+  division by zero, which keeps the caller free of branches.
+*/
+[[nodiscard]] constexpr std::pair<float, float> check_axis(
+    float origin, float direction) noexcept {
+  const auto tmin_numerator = -1 - origin;
+  const auto tmax_numerator = 1 - origin;
+
+  const auto parallel = std::abs(direction) < MathUtil::default_epsilon;
+  const auto tmin =
+      parallel ? tmin_numerator * std::numeric_limits<float>::infinity()
+               : tmin_numerator / direction;
+  const auto tmax =
+      parallel ? tmax_numerator * std::numeric_limits<float>::infinity()
+               : tmax_numerator / direction;
+
+  return {std::min(tmin, tmax), std::max(tmin, tmax)};
+}
+
+/*
+  Whether the point of the ray at distance t lies within radius of the y axis
+*/
+[[nodiscard]] constexpr bool check_cap(const Ray& ray, float t,
+                                       float radius) noexcept {
+  const auto x = ray.origin.x + t * ray.direction.x;
+  const auto z = ray.origin.z + t * ray.direction.z;
+  return x * x + z * z <= radius * radius + MathUtil::default_epsilon;
+}
+
+/*
+  Keeps the wall intersections of cylinders and cones that fall within the
+  truncation range of the shape
+*/
+template <typename Truncated>
+constexpr void intersect_walls(const Ray& local_ray, const Truncated& shape,
+                               const StaticVector<float, 2>& ts,
+                               StaticVector<Intersection, 4>& xs) noexcept {
+  for (const auto t : ts) {
+    const auto y = local_ray.origin.y + t * local_ray.direction.y;
+    if (shape.minimum < y && y < shape.maximum)
+      xs.push_back(Intersection(t, shape.object_type));
+  }
+}
+
+/*
+  Adds the cap intersections of closed cylinders and cones. Caps have radius 1
+  for cylinders and |y| for cones, so the radius of each cap is explicit.
+*/
+template <typename Truncated>
+constexpr void intersect_caps(const Ray& local_ray, const Truncated& shape,
+                              float min_cap_radius, float max_cap_radius,
+                              StaticVector<Intersection, 4>& xs) noexcept {
+  if (!shape.closed ||
+      std::abs(local_ray.direction.y) < MathUtil::default_epsilon)
+    return;
+
+  const auto t_min =
+      (shape.minimum - local_ray.origin.y) / local_ray.direction.y;
+  if (check_cap(local_ray, t_min, min_cap_radius))
+    xs.push_back(Intersection(t_min, shape.object_type));
+
+  const auto t_max =
+      (shape.maximum - local_ray.origin.y) / local_ray.direction.y;
+  if (check_cap(local_ray, t_max, max_cap_radius))
+    xs.push_back(Intersection(t_max, shape.object_type));
+}
+
+/*
+  Insertion sort over the at most four hits of a cylinder or cone, which
+  needs no more than six comparisons and, unlike std::sort, never reaches
+  past the hits in use
+*/
+constexpr void sort_by_distance(StaticVector<Intersection, 4>& xs) noexcept {
+  for (std::size_t i = 1; i < xs.size(); ++i) {
+    const auto hit = xs[i];
+    auto j = i;
+    for (; j > 0 && hit.t() < xs[j - 1].t(); --j) xs[j] = xs[j - 1];
+    xs[j] = hit;
+  }
+}
+
+}  // namespace detail
+
+[[nodiscard]] constexpr auto local_intersect(const Ray& local_ray,
+                                             const Cube&) noexcept
+    -> StaticVector<Intersection, 2> {
+  const auto [xtmin, xtmax] =
+      detail::check_axis(local_ray.origin.x, local_ray.direction.x);
+  const auto [ytmin, ytmax] =
+      detail::check_axis(local_ray.origin.y, local_ray.direction.y);
+  const auto [ztmin, ztmax] =
+      detail::check_axis(local_ray.origin.z, local_ray.direction.z);
+
+  const auto tmin = std::max({xtmin, ytmin, ztmin});
+  const auto tmax = std::min({xtmax, ytmax, ztmax});
+
+  if (tmin > tmax) return StaticVector<Intersection, 2>();
+
+  return StaticVector<Intersection, 2>{Intersection(tmin, ShapeType::Cube),
+                                       Intersection(tmax, ShapeType::Cube)};
+}
+
+namespace detail {
+
+[[nodiscard]] constexpr auto intersect_cylinder(
+    const Ray& local_ray, const Truncation& cylinder) noexcept
+    -> StaticVector<Intersection, 4> {
+  const auto& o = local_ray.origin;
+  const auto& d = local_ray.direction;
+
+  const auto a = d.x * d.x + d.z * d.z;
+  const auto b = 2 * o.x * d.x + 2 * o.z * d.z;
+  const auto c = o.x * o.x + o.z * o.z - 1;
+  const auto discriminant = b * b - 4 * a * c;
+
+  StaticVector<Intersection, 4> xs;
+
+  // Rays parallel to the y axis can only hit the caps
+  if (!MathUtil::approx_equal(a, 0.f) &&
+      discriminant > -MathUtil::default_epsilon) {
+    const auto root = MathUtil::sqrt(std::max(discriminant, 0.f));
+    intersect_walls(
+        local_ray, cylinder,
+        StaticVector<float, 2>{(-b - root) / (2 * a), (-b + root) / (2 * a)},
+        xs);
+  }
+  intersect_caps(local_ray, cylinder, 1.f, 1.f, xs);
+
+  sort_by_distance(xs);
+  return xs;
+}
+
+[[nodiscard]] constexpr auto intersect_cone(const Ray& local_ray,
+                                            const Truncation& cone) noexcept
+    -> StaticVector<Intersection, 4> {
+  const auto& o = local_ray.origin;
+  const auto& d = local_ray.direction;
+
+  const auto a = d.x * d.x - d.y * d.y + d.z * d.z;
+  const auto b = 2 * o.x * d.x - 2 * o.y * d.y + 2 * o.z * d.z;
+  const auto c = o.x * o.x - o.y * o.y + o.z * o.z;
+  const auto discriminant = b * b - 4 * a * c;
+
+  const auto wall_ts = [&]() -> StaticVector<float, 2> {
+    if (MathUtil::approx_equal(a, 0.f)) {
+      // Parallel to one of the halves: at most one wall intersection
+      if (MathUtil::approx_equal(b, 0.f)) return {};
+      return StaticVector<float, 2>{-c / (2 * b)};
+    }
+    // Tangent rays can land slightly below zero due to rounding
+    if (discriminant < -MathUtil::default_epsilon) return {};
+    const auto root = MathUtil::sqrt(std::max(discriminant, 0.f));
+    return StaticVector<float, 2>{(-b - root) / (2 * a), (-b + root) / (2 * a)};
+  }();
+
+  StaticVector<Intersection, 4> xs;
+  intersect_walls(local_ray, cone, wall_ts, xs);
+  intersect_caps(local_ray, cone, std::abs(cone.minimum),
+                 std::abs(cone.maximum), xs);
+
+  sort_by_distance(xs);
+  return xs;
+}
+
+}  // namespace detail
+
+[[nodiscard]] constexpr auto local_intersect(const Ray& local_ray,
+                                             const Cylinder& cylinder) noexcept
+    -> StaticVector<Intersection, 4> {
+  return detail::intersect_cylinder(local_ray, cylinder.truncation());
+}
+
+[[nodiscard]] constexpr auto local_intersect(const Ray& local_ray,
+                                             const Cone& cone) noexcept
+    -> StaticVector<Intersection, 4> {
+  return detail::intersect_cone(local_ray, cone.truncation());
+}
+
+/*
+  Cylinder or cone test from its truncation alone, as stored in the
+  intersection arrays of a World
+*/
+[[nodiscard]] constexpr auto local_intersect(
+    const Ray& local_ray, const Truncation& truncation) noexcept
+    -> StaticVector<Intersection, 4> {
+  return truncation.object_type == ShapeType::Cone
+             ? detail::intersect_cone(local_ray, truncation)
+             : detail::intersect_cylinder(local_ray, truncation);
+}
+
+namespace detail {
+
+/*
+  Per-ray setup of the watertight ray/triangle test (Woop, Benthin and Wald,
+  2013). The axes are permuted so the dominant direction component becomes z,
+  and the shear constants map the ray onto the +z axis.
+*/
+struct WatertightRay {
+  std::array<float, 3> origin;
+  std::size_t kx;
+  std::size_t ky;
+  std::size_t kz;
+  float sx;
+  float sy;
+  float sz;
+};
+
+[[nodiscard]] constexpr WatertightRay watertight_ray(const Ray& ray) noexcept {
+  const std::array direction{ray.direction.x, ray.direction.y,
+                             ray.direction.z};
+
+  const std::size_t kz = [&direction] {
+    const auto x = std::abs(direction[0]);
+    const auto y = std::abs(direction[1]);
+    const auto z = std::abs(direction[2]);
+    if (x > y && x > z) return std::size_t{0};
+    return y > z ? std::size_t{1} : std::size_t{2};
+  }();
+  auto kx = (kz + 1) % 3;
+  auto ky = (kx + 1) % 3;
+  // Keep the winding of the triangles after the permutation
+  if (direction[kz] < 0) std::swap(kx, ky);
+
+  return WatertightRay{{ray.origin.x, ray.origin.y, ray.origin.z},
+                       kx,
+                       ky,
+                       kz,
+                       direction[kx] / direction[kz],
+                       direction[ky] / direction[kz],
+                       1.f / direction[kz]};
+}
+
+/*
+  Barycentric edge functions of the sheared triangle. Exact zeros mean the ray
+  goes through an edge or vertex, which is recomputed in double precision so
+  that neighbouring triangles agree on the result.
+*/
+[[nodiscard]] constexpr std::array<float, 3> edge_functions(
+    float ax, float ay, float bx, float by, float cx, float cy) noexcept {
+  auto u = cx * by - cy * bx;
+  auto v = ax * cy - ay * cx;
+  auto w = bx * ay - by * ax;
+
+  if (u == 0.f || v == 0.f || w == 0.f) {
+    const auto difference_of_products = [](double a, double b, double c,
+                                           double d) {
+      return static_cast<float>(a * b - c * d);
+    };
+    u = difference_of_products(cx, by, cy, bx);
+    v = difference_of_products(ax, cy, ay, cx);
+    w = difference_of_products(bx, ay, by, ax);
+  }
+
+  return {u, v, w};
+}
+
+}  // namespace detail
+
+/*
+  Watertight ray/triangle test: returns the distance to the triangle, or
+  nothing when the ray misses it. Rays crossing a shared edge hit exactly one
+  of the triangles, so meshes have no cracks.
+*/
+[[nodiscard]] constexpr std::optional<float> intersect_triangle(
+    const detail::WatertightRay& ray, const std::array<Tuple, 3>& triangle) {
+  const auto relative = [&ray](const Tuple& p) {
+    return std::array{p.x - ray.origin[0], p.y - ray.origin[1],
+                      p.z - ray.origin[2]};
+  };
+  const auto a = relative(triangle[0]);
+  const auto b = relative(triangle[1]);
+  const auto c = relative(triangle[2]);
+
+  const auto [u, v, w] = detail::edge_functions(
+      a[ray.kx] - ray.sx * a[ray.kz], a[ray.ky] - ray.sy * a[ray.kz],
+      b[ray.kx] - ray.sx * b[ray.kz], b[ray.ky] - ray.sy * b[ray.kz],
+      c[ray.kx] - ray.sx * c[ray.kz], c[ray.ky] - ray.sy * c[ray.kz]);
+
+  if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+    return std::nullopt;
+
+  const auto det = u + v + w;
+  if (det == 0.f) return std::nullopt;
+
+  const auto t_scaled = u * ray.sz * a[ray.kz] + v * ray.sz * b[ray.kz] +
+                        w * ray.sz * c[ray.kz];
+  return t_scaled / det;
+}
+
+/*
+  Packet variant of intersect_triangle: tests every lane of the packet and
+  returns the distance per lane, infinity for misses and unused lanes. The
+  main loop is branch-free so compilers turn it into vector instructions;
+  lanes whose edge functions hit an exact zero are redone with the scalar
+  kernel to keep the watertight guarantee.
+*/
+template <std::size_t Width>
+[[nodiscard]] constexpr std::array<float, Width> intersect_triangles(
+    const detail::WatertightRay& ray, const TrianglePacket<Width>& packet) {
+  constexpr auto miss = std::numeric_limits<float>::infinity();
+  const auto [ox, oy, oz] = ray.origin;
+  const std::array origin{ox, oy, oz};
+
+  std::array<float, Width> result{};
+  std::array<bool, Width> degenerate{};
+
+  for (std::size_t lane = 0; lane < Width; ++lane) {
+    const auto sheared = [&](const std::array<std::array<float, Width>, 3>& p) {
+      const auto z = p[ray.kz][lane] - origin[ray.kz];
+      return std::array{p[ray.kx][lane] - origin[ray.kx] - ray.sx * z,
+                        p[ray.ky][lane] - origin[ray.ky] - ray.sy * z,
+                        ray.sz * z};
+    };
+    const auto a = sheared(packet.p0);
+    const auto b = sheared(packet.p1);
+    const auto c = sheared(packet.p2);
+
+    const auto u = c[0] * b[1] - c[1] * b[0];
+    const auto v = a[0] * c[1] - a[1] * c[0];
+    const auto w = b[0] * a[1] - b[1] * a[0];
+    const auto det = u + v + w;
+
+    const bool same_sign =
+        (u >= 0 && v >= 0 && w >= 0) || (u <= 0 && v <= 0 && w <= 0);
+    const bool hit = same_sign && det != 0.f && lane < packet.count;
+    const auto t = (u * a[2] + v * b[2] + w * c[2]) / (det != 0.f ? det : 1.f);
+
+    result[lane] = hit ? t : miss;
+    degenerate[lane] =
+        lane < packet.count && (u == 0.f || v == 0.f || w == 0.f);
+  }
+
+  for (std::size_t lane = 0; lane < packet.count; ++lane) {
+    if (!degenerate[lane]) continue;
+    const std::array triangle{
+        TupleUtil::point(packet.p0[0][lane], packet.p0[1][lane],
+                         packet.p0[2][lane]),
+        TupleUtil::point(packet.p1[0][lane], packet.p1[1][lane],
+                         packet.p1[2][lane]),
+        TupleUtil::point(packet.p2[0][lane], packet.p2[1][lane],
+                         packet.p2[2][lane])};
+    result[lane] = intersect_triangle(ray, triangle).value_or(miss);
+  }
+
+  return result;
+}
+
+/*
+  Appends every intersection of the ray with the triangles of the mesh to xs.
+  Intersection::primitive() holds the triangle that was hit.
+*/
+template <typename IntersectionList>
+constexpr void local_intersect(const Ray& local_ray, const TriangleMesh& mesh,
+                               IntersectionList& xs) {
+  const auto ray = detail::watertight_ray(local_ray);
+
+  if (!mesh.packets.empty()) {
+    for (const auto& packet : mesh.packets) {
+      const auto ts = intersect_triangles(ray, packet);
+      for (std::size_t lane = 0; lane < packet.count; ++lane) {
+        if (ts[lane] == std::numeric_limits<float>::infinity()) continue;
+        xs.push_back(Intersection(ts[lane], ShapeType::TriangleMesh, 0,
+                                  packet.first + lane));
+      }
+    }
+    return;
+  }
+
+  for (std::size_t i = 0; i < mesh.triangle_count(); ++i) {
+    if (const auto t = intersect_triangle(ray, mesh.triangle(i)))
+      xs.push_back(Intersection(*t, ShapeType::TriangleMesh, 0, i));
+  }
+}
+
+template <primitive T>
+[[nodiscard]] constexpr auto intersect(const Ray& ray,
+                                       const T& shape) noexcept {
+  return local_intersect(transform(ray, MatrixUtil::inverse(shape.transform)),
+                         shape);
+}
+
+/*
+  Spheres that are only translated and scaled uniformly are intersected
+  from their center and radius, without inverting their transformation
+*/
+[[nodiscard]] constexpr auto intersect(const Ray& ray,
+                                       const Sphere& sphere) noexcept
+    -> StaticVector<Intersection, 2> {
+  if (const auto geometry = sphere.geometry())
+    return intersect(ray, *geometry);
+  return local_intersect(
+      transform(ray, MatrixUtil::inverse(sphere.transform)), sphere);
+}
+
+/*
+  Appending forms: add the intersections of the shape to xs, so callers can
+  reuse one list for many shapes and rays without allocating
+*/
+template <primitive T, typename IntersectionList>
+constexpr void local_intersect(const Ray& local_ray, const T& shape,
+                               IntersectionList& xs) {
+  for (const auto& intersection : local_intersect(local_ray, shape))
+    xs.push_back(intersection);
+}
+
+template <typename IntersectionList>
+constexpr void local_intersect(const Ray& local_ray,
+                               const Truncation& truncation,
+                               IntersectionList& xs) {
+  for (const auto& intersection : local_intersect(local_ray, truncation))
+    xs.push_back(intersection);
+}
+
+template <typename IntersectionList>
+constexpr void local_intersect(const Ray& local_ray, const Shape& shape,
+                               IntersectionList& xs) {
+  std::visit([&](const auto& s) { local_intersect(local_ray, s, xs); },
+             shape);
+}
+
+template <typename IntersectionList>
+constexpr void intersect(const Ray& ray, const Shape& shape,
+                         IntersectionList& xs) {
+  local_intersect(
+      transform(ray, MatrixUtil::inverse(ShapeUtil::transform(shape))), shape,
+      xs);
+}
+
+/*
+  NearestHit:
+
+  Intersection list for the appending forms that only remembers the closest
+  non-negative intersection, so finding a hit needs neither storage nor a
+  sort. Every intersection pushed is tagged with `index`, which callers set to
+  the position of the shape being tested.
+*/
+struct NearestHit {
+  using value_type = Intersection;
+
+  std::optional<Intersection> hit{};
+  std::size_t index{0};
+
+  constexpr void push_back(const Intersection& intersection) noexcept {
+    if (intersection.t() < 0 || (hit && hit->t() <= intersection.t())) return;
+    hit = Intersection(intersection.t(), intersection.object_type(), index,
+                       intersection.primitive());
+  }
+
+  // Distance past which nothing can change the hit any more
+  [[nodiscard]] constexpr float limit() const noexcept {
+    return hit ? hit->t() : std::numeric_limits<float>::infinity();
+  }
+};
+
+/*
+  AllHits:
+
+  Intersection list for the appending forms that keeps every non-negative
+  intersection, in the order they are found, tagged with `index` like
+  NearestHit. For the queries that need more than the closest hit, such as
+  which objects enclose a point.
+*/
+struct AllHits {
+  using value_type = Intersection;
+
+  std::vector<Intersection> hits{};
+  std::size_t index{0};
+
+  constexpr void push_back(const Intersection& intersection) {
+    if (intersection.t() < 0) return;
+    hits.push_back(Intersection(intersection.t(), intersection.object_type(),
+                                index, intersection.primitive()));
+  }
+
+  [[nodiscard]] constexpr float limit() const noexcept {
+    return std::numeric_limits<float>::infinity();
+  }
+};
+
 }  // namespace RayUtil
 
 #endif
\ No newline at end of file
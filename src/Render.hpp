@@ -0,0 +1,569 @@
+#ifndef CONSTEXPR_RAYTRACER_RENDER_HPP
+#define CONSTEXPR_RAYTRACER_RENDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AccumulationBuffer.hpp"
+#include "Camera.hpp"
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "Sampling.hpp"
+#include "Wavefront.hpp"
+#include "World.hpp"
+
+/*
+  RenderSettings:
+
+  threads: worker threads, 0 uses one per hardware thread
+  tile_size: side in pixels of the square tiles handed to the workers
+  samples: rays per pixel, averaged into the final color
+  adaptive_samples: rays added to the pixels whose color differs from one of
+  their neighbours by more than adaptive_threshold on any channel, 0 disables
+  the refinement
+  seed: selects another set of random sample positions; images only depend
+  on the settings, never on the thread count or tile order
+  layout, format: memory layout and pixel format of the rendered canvas
+  trace: depth and contribution limits of reflected and refracted rays
+  scheduling: traces the rays of every pixel depth first or the rays of a
+  whole tile one bounce at a time, see Wavefront.hpp; both give the same
+  image up to rounding
+*/
+struct RenderSettings {
+  unsigned threads{1};
+  int tile_size{16};
+  int samples{1};
+  int adaptive_samples{0};
+  float adaptive_threshold{0.1f};
+  std::uint32_t seed{0};
+  CanvasLayout layout{CanvasLayout::RowMajor};
+  PixelFormat format{PixelFormat::Float};
+  TraceLimits trace{};
+  RayScheduling scheduling{RayScheduling::DepthFirst};
+};
+
+/*
+  ProgressiveSettings:
+
+  initial_step: side of the blocks filled by the first pass, rounded down to
+  a power of two
+  budget: wall-clock time allowed for the whole render, zero for no limit
+  max_samples: once the image is complete, keep adding render.samples
+  samples per pixel each pass until pixels hold max_samples samples
+*/
+struct ProgressiveSettings {
+  RenderSettings render{};
+  int initial_step{8};
+  std::chrono::milliseconds budget{0};
+  int max_samples{0};
+};
+
+/*
+  PassInfo: what the image handed to a progressive callback contains. step
+  is the side of the blocks sharing one traced color and samples the number
+  of samples averaged in every traced pixel
+*/
+struct PassInfo {
+  int pass;
+  int step;
+  int samples;
+  bool last;
+};
+
+namespace RenderUtil {
+
+/*
+  Average of `samples` stratified rays through the pixel. first_sample
+  numbers the first of them, so samples can be added to a pixel without
+  repeating the ones already traced. The rays cast are added to counters
+  when given
+*/
+[[nodiscard]] constexpr Color render_pixel(
+    const Camera& camera, const World& world, int x, int y, int samples = 1,
+    int first_sample = 0, std::uint32_t seed = 0,
+    const TraceLimits& limits = {}, RayCounters* counters = nullptr) {
+  Color color = ColorUtil::black();
+  for (int sample = 0; sample < samples; ++sample) {
+    const auto [dx, dy] = SamplingUtil::stratified_sample(
+        x, y, sample, samples, first_sample, seed);
+    color += WorldUtil::color_at(
+        world, CameraUtil::ray_for_pixel(camera, x, y, dx, dy), limits, {},
+        counters);
+  }
+  return color / static_cast<float>(samples);
+}
+
+namespace detail {
+
+[[nodiscard]] inline unsigned worker_count(unsigned threads) noexcept {
+  return threads == 0 ? std::max(std::thread::hardware_concurrency(), 1u)
+                      : threads;
+}
+
+/*
+  Traces `samples` samples of every requested pixel with the scheduling of
+  the settings and calls write(pixel, color) with their average
+*/
+template <typename Write>
+void render_pixels(const Camera& camera, const World& world,
+                   const RenderSettings& settings,
+                   std::span<const PixelRequest> pixels, int samples,
+                   RayCounters* counters, const Write& write) {
+  if (settings.scheduling == RayScheduling::Wavefront) {
+    std::vector<Color> colors(pixels.size());
+    WavefrontUtil::render_pixels(camera, world, pixels, samples, settings.seed,
+                                 settings.trace, colors.data(), counters);
+    for (std::size_t i = 0; i < pixels.size(); ++i) write(pixels[i], colors[i]);
+    return;
+  }
+  for (const auto& pixel : pixels) {
+    write(pixel, render_pixel(camera, world, pixel.x, pixel.y, samples,
+                              pixel.first_sample, settings.seed,
+                              settings.trace, counters));
+  }
+}
+
+/*
+  Runs render_tile(x0, y0, x1, y1) over every tile of a width x height image.
+  Workers claim tiles from a shared counter, so threads that finish cheap
+  tiles early keep pulling work instead of idling behind an even split.
+  Returns false when stop() asked to abandon the remaining tiles. An
+  exception thrown by render_tile stops the other workers too and is
+  rethrown once they are all done
+*/
+template <typename RenderTile, typename Stop>
+bool for_each_tile(int width, int height, const RenderSettings& settings,
+                   const RenderTile& render_tile, const Stop& stop) {
+  const int tile_size = std::max(settings.tile_size, 1);
+  const int tiles_x = (width + tile_size - 1) / tile_size;
+  const int tiles_y = (height + tile_size - 1) / tile_size;
+  const int tile_count = tiles_x * tiles_y;
+
+  std::atomic<int> next_tile{0};
+  std::atomic<bool> stopped{false};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  const auto worker = [&] {
+    try {
+      for (int tile = next_tile++; tile < tile_count; tile = next_tile++) {
+        if (stopped || stop()) {
+          stopped = true;
+          return;
+        }
+        const int x0 = (tile % tiles_x) * tile_size;
+        const int y0 = (tile / tiles_x) * tile_size;
+        render_tile(x0, y0, std::min(x0 + tile_size, width),
+                    std::min(y0 + tile_size, height));
+      }
+    } catch (...) {
+      const std::lock_guard lock(error_mutex);
+      if (!error) error = std::current_exception();
+      stopped = true;
+    }
+  };
+
+  const unsigned threads = worker_count(settings.threads);
+  if (threads == 1) {
+    worker();
+  } else {
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(worker);
+  }
+  if (error) std::rethrow_exception(error);
+  return !stopped;
+}
+
+/*
+  Whether the pixel differs from one of its 4 neighbours by more than
+  threshold on any channel, which flags edges and noisy areas while flat
+  regions stay at the base sample count
+*/
+template <typename Image>
+[[nodiscard]] bool needs_refinement(const Image& image, int x, int y,
+                                    float threshold) noexcept {
+  const auto center = image.pixel_at(x, y);
+  const auto differs = [&](int nx, int ny) {
+    if (nx < 0 || nx >= image.width() || ny < 0 || ny >= image.height())
+      return false;
+    const auto other = image.pixel_at(nx, ny);
+    return std::abs(center.red - other.red) > threshold ||
+           std::abs(center.green - other.green) > threshold ||
+           std::abs(center.blue - other.blue) > threshold;
+  };
+  return differs(x - 1, y) || differs(x + 1, y) || differs(x, y - 1) ||
+         differs(x, y + 1);
+}
+
+}  // namespace detail
+
+/*
+  Renders the world through the camera into image, any canvas type of the
+  camera's size such as Canvas or MappedCanvas, splitting it in tiles shared
+  by settings.threads workers. With adaptive sampling enabled, a second pass
+  adds settings.adaptive_samples rays to the pixels flagged by
+  detail::needs_refinement, so the extra cost follows the number of edges in
+  the image rather than its resolution. on_tile(x0, y0, x1, y1) is called
+  from the worker once the pixels of a tile hold their final color. The rays
+  cast are added to counters when given
+*/
+template <typename Image, typename OnTile>
+void render_into(const Camera& camera, const World& world, Image& image,
+                 const RenderSettings& settings, const OnTile& on_tile,
+                 RayCounters* counters = nullptr) {
+  assert(image.width() == camera.hsize() && image.height() == camera.vsize());
+  const int samples = std::max(settings.samples, 1);
+
+  // Tiles count their rays locally and add them up once done
+  std::mutex counters_mutex;
+  const auto add_counters = [&](const RayCounters& tile_counters) {
+    if (counters == nullptr) return;
+    const std::lock_guard lock(counters_mutex);
+    *counters += tile_counters;
+  };
+
+  detail::for_each_tile(
+      camera.hsize(), camera.vsize(), settings,
+      [&](int x0, int y0, int x1, int y1) {
+        std::vector<PixelRequest> pixels;
+        for (int y = y0; y < y1; ++y) {
+          for (int x = x0; x < x1; ++x) pixels.push_back({x, y, 0});
+        }
+        RayCounters tile_counters;
+        detail::render_pixels(camera, world, settings, pixels, samples,
+                              &tile_counters,
+                              [&](const PixelRequest& pixel, Color color) {
+                                image.write_pixel(pixel.x, pixel.y, color);
+                              });
+        add_counters(tile_counters);
+        if (settings.adaptive_samples <= 0) on_tile(x0, y0, x1, y1);
+      },
+      [] { return false; });
+
+  if (settings.adaptive_samples <= 0) return;
+
+  // Flags are computed before any pixel changes so the refinement does not
+  // depend on the order in which tiles are processed
+  const auto width = static_cast<std::size_t>(camera.hsize());
+  std::vector<bool> refine(width * static_cast<std::size_t>(camera.vsize()));
+  for (int y = 0; y < camera.vsize(); ++y) {
+    for (int x = 0; x < camera.hsize(); ++x) {
+      refine[static_cast<std::size_t>(y) * width +
+             static_cast<std::size_t>(x)] =
+          detail::needs_refinement(image, x, y, settings.adaptive_threshold);
+    }
+  }
+
+  const auto base_weight = static_cast<float>(samples);
+  const auto extra_weight = static_cast<float>(settings.adaptive_samples);
+  detail::for_each_tile(
+      camera.hsize(), camera.vsize(), settings,
+      [&](int x0, int y0, int x1, int y1) {
+        std::vector<PixelRequest> pixels;
+        for (int y = y0; y < y1; ++y) {
+          for (int x = x0; x < x1; ++x) {
+            if (refine[static_cast<std::size_t>(y) * width +
+                       static_cast<std::size_t>(x)])
+              pixels.push_back({x, y, samples});
+          }
+        }
+        RayCounters tile_counters;
+        detail::render_pixels(
+            camera, world, settings, pixels, settings.adaptive_samples,
+            &tile_counters, [&](const PixelRequest& pixel, Color extra) {
+              image.write_pixel(
+                  pixel.x, pixel.y,
+                  (image.pixel_at(pixel.x, pixel.y) * base_weight +
+                   extra * extra_weight) /
+                      (base_weight + extra_weight));
+            });
+        add_counters(tile_counters);
+        on_tile(x0, y0, x1, y1);
+      },
+      [] { return false; });
+}
+
+template <typename Image>
+void render_into(const Camera& camera, const World& world, Image& image,
+                 const RenderSettings& settings = {}) {
+  render_into(camera, world, image, settings, [](int, int, int, int) {});
+}
+
+/*
+  Renders the world into a new canvas with the layout and pixel format of
+  the settings
+*/
+[[nodiscard]] inline Canvas render(const Camera& camera, const World& world,
+                                   const RenderSettings& settings = {},
+                                   RayCounters* counters = nullptr) {
+  Canvas image(camera.hsize(), camera.vsize(), settings.layout,
+               settings.format);
+  render_into(
+      camera, world, image, settings, [](int, int, int, int) {}, counters);
+  return image;
+}
+
+namespace detail {
+
+/*
+  RowTracker:
+
+  Counts the finished tiles of every band of tile_size rows and tells how
+  many rows from the top are complete, so a consumer can take rows while
+  the tiles below them are still being rendered. cancel() releases the
+  consumer when the rendering fails and the remaining rows never come
+*/
+class RowTracker {
+ public:
+  RowTracker(int width, int height, int tile_size)
+      : height_{height},
+        tile_size_{tile_size},
+        pending_(static_cast<std::size_t>((height + tile_size - 1) /
+                                          tile_size),
+                 (width + tile_size - 1) / tile_size) {}
+
+  void tile_done(int y0) {
+    {
+      const std::lock_guard lock(mutex_);
+      --pending_[static_cast<std::size_t>(y0 / tile_size_)];
+      while (complete_bands_ < pending_.size() &&
+             pending_[complete_bands_] == 0)
+        ++complete_bands_;
+    }
+    ready_.notify_all();
+  }
+
+  void cancel() {
+    {
+      const std::lock_guard lock(mutex_);
+      cancelled_ = true;
+    }
+    ready_.notify_all();
+  }
+
+  /*
+    Blocks until more than `rows` rows are complete and returns how many are,
+    or returns nothing once cancelled
+  */
+  [[nodiscard]] std::optional<int> wait_for_rows(int rows) {
+    std::unique_lock lock(mutex_);
+    ready_.wait(lock, [&] { return cancelled_ || complete_rows() > rows; });
+    if (cancelled_) return std::nullopt;
+    return complete_rows();
+  }
+
+ private:
+  [[nodiscard]] int complete_rows() const noexcept {
+    return std::min(static_cast<int>(complete_bands_) * tile_size_, height_);
+  }
+
+  int height_;
+  int tile_size_;
+  std::vector<int> pending_;
+  std::size_t complete_bands_{0};
+  bool cancelled_{false};
+  std::mutex mutex_;
+  std::condition_variable ready_;
+};
+
+}  // namespace detail
+
+/*
+  Renders like render() and hands the rows of the image to
+  sink.write_row(y, colors) from a separate thread, top to bottom, as soon
+  as they and all the rows above them are complete. Encoding and writing
+  the image thus overlap the rendering instead of following it. An
+  exception thrown by the sink stops the stream and is rethrown once the
+  rendering is over
+*/
+template <typename Sink>
+Canvas render_streamed(const Camera& camera, const World& world, Sink& sink,
+                       const RenderSettings& settings = {},
+                       RayCounters* counters = nullptr) {
+  const int width = camera.hsize();
+  const int height = camera.vsize();
+  const int tile_size = std::max(settings.tile_size, 1);
+
+  Canvas image(width, height, settings.layout, settings.format);
+  detail::RowTracker tracker(width, height, tile_size);
+
+  std::exception_ptr encoder_error;
+  std::jthread encoder([&] {
+    try {
+      std::vector<Color> row(static_cast<std::size_t>(width));
+      for (int y = 0; y < height;) {
+        const auto ready = tracker.wait_for_rows(y);
+        if (!ready) return;
+        for (; y < *ready; ++y) {
+          image.read_row(y, row.data());
+          sink.write_row(y, row.data());
+        }
+      }
+    } catch (...) {
+      encoder_error = std::current_exception();
+    }
+  });
+
+  try {
+    render_into(
+        camera, world, image, settings,
+        [&](int, int y0, int, int) { tracker.tile_done(y0); }, counters);
+  } catch (...) {
+    tracker.cancel();
+    throw;
+  }
+  encoder.join();
+  if (encoder_error) std::rethrow_exception(encoder_error);
+  return image;
+}
+
+/*
+  Adds settings.samples samples to every pixel of the buffer, numbered after
+  the samples the pixel already holds so none is traced twice. Tiles are
+  abandoned once stop() returns true, in which case false is returned and
+  only part of the pixels received new samples
+*/
+template <typename Stop>
+bool accumulate(const Camera& camera, const World& world,
+                AccumulationBuffer& buffer, const RenderSettings& settings,
+                const Stop& stop) {
+  assert(buffer.width() == camera.hsize() &&
+         buffer.height() == camera.vsize());
+  const int samples = std::max(settings.samples, 1);
+
+  return detail::for_each_tile(
+      camera.hsize(), camera.vsize(), settings,
+      [&](int x0, int y0, int x1, int y1) {
+        std::vector<PixelRequest> pixels;
+        for (int y = y0; y < y1; ++y) {
+          for (int x = x0; x < x1; ++x)
+            pixels.push_back({x, y, static_cast<int>(buffer.count(x, y))});
+        }
+        detail::render_pixels(
+            camera, world, settings, pixels, samples, nullptr,
+            [&](const PixelRequest& pixel, Color color) {
+              buffer.add(pixel.x, pixel.y, color * static_cast<float>(samples),
+                         static_cast<std::uint32_t>(samples));
+            });
+      },
+      stop);
+}
+
+inline void accumulate(const Camera& camera, const World& world,
+                       AccumulationBuffer& buffer,
+                       const RenderSettings& settings = {}) {
+  accumulate(camera, world, buffer, settings, [] { return false; });
+}
+
+/*
+  Progressive rendering
+
+  The first pass traces one pixel out of every initial_step x initial_step
+  block and fills the block with its color. Every following pass halves the
+  step and only traces the pixels the previous passes skipped, so all passes
+  together cost the same as a plain render. Further passes then accumulate
+  more samples per pixel up to settings.max_samples. on_pass(image, info) is
+  called after each completed pass with an image that can be exported as is.
+
+  The first pass always completes. Once the wall-clock budget runs out the
+  pass in flight is abandoned and the image of the last completed pass is
+  returned
+*/
+template <typename OnPass>
+[[nodiscard]] Canvas render_progressive(const Camera& camera,
+                                        const World& world,
+                                        const ProgressiveSettings& settings,
+                                        OnPass&& on_pass) {
+  using clock = std::chrono::steady_clock;
+
+  const auto deadline = clock::now() + settings.budget;
+  const auto out_of_time = [&] {
+    return settings.budget.count() > 0 && clock::now() >= deadline;
+  };
+
+  const int width = camera.hsize();
+  const int height = camera.vsize();
+  const int samples = std::max(settings.render.samples, 1);
+
+  int initial_step = 1;
+  while (initial_step * 2 <= std::max(settings.initial_step, 1))
+    initial_step *= 2;
+
+  Canvas working(width, height, settings.render.layout,
+                 settings.render.format);
+  Canvas completed(width, height, settings.render.layout,
+                   settings.render.format);
+
+  int pass = 0;
+  for (int step = initial_step; step >= 1; step /= 2, ++pass) {
+    const auto traced = [step, first = step == initial_step](int x, int y) {
+      return first || x % (2 * step) != 0 || y % (2 * step) != 0;
+    };
+
+    const bool finished = detail::for_each_tile(
+        width, height, settings.render,
+        [&](int x0, int y0, int x1, int y1) {
+          std::vector<PixelRequest> pixels;
+          for (int y = (y0 + step - 1) / step * step; y < y1; y += step) {
+            for (int x = (x0 + step - 1) / step * step; x < x1; x += step) {
+              if (traced(x, y)) pixels.push_back({x, y, 0});
+            }
+          }
+          detail::render_pixels(
+              camera, world, settings.render, pixels, samples, nullptr,
+              [&](const PixelRequest& pixel, Color color) {
+                for (int by = pixel.y; by < std::min(pixel.y + step, height);
+                     ++by) {
+                  for (int bx = pixel.x; bx < std::min(pixel.x + step, width);
+                       ++bx)
+                    working.write_pixel(bx, by, color);
+                }
+              });
+        },
+        [&] { return pass > 0 && out_of_time(); });
+    if (!finished) return completed;
+
+    completed = working;
+    const bool last = step == 1 && settings.max_samples <= samples;
+    on_pass(std::as_const(completed), PassInfo{pass, step, samples, last});
+    if (last || out_of_time()) return completed;
+  }
+
+  // Every pixel was traced exactly once by the passes above, so the image
+  // holds the average of `samples` samples everywhere
+  AccumulationBuffer buffer(width, height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      buffer.add(x, y, working.pixel_at(x, y) * static_cast<float>(samples),
+                 static_cast<std::uint32_t>(samples));
+    }
+  }
+
+  for (int total = samples; total < settings.max_samples; ++pass) {
+    if (!accumulate(camera, world, buffer, settings.render, out_of_time))
+      break;
+    total += samples;
+    buffer.resolve(completed);
+    on_pass(std::as_const(completed),
+            PassInfo{pass, 1, total, total >= settings.max_samples});
+    if (out_of_time()) break;
+  }
+
+  return completed;
+}
+
+}  // namespace RenderUtil
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CONSTEXPR_RAYTRACER_SAMPLING_HPP
+#define CONSTEXPR_RAYTRACER_SAMPLING_HPP
+
+#include <cstdint>
+#include <utility>
+
+#include "Random.hpp"
+
+/*
+  Pixel sampling patterns
+
+  Positions are offsets inside a pixel, in [0, 1) on both axes. A set of
+  samples is stratified: the pixel is split in a grid with one cell per
+  sample and each sample is jittered inside its own cell, which keeps the
+  noise of random sampling low while avoiding the aliasing of a regular grid.
+*/
+
+namespace SamplingUtil {
+
+/*
+  Grid of columns x rows cells with exactly one cell per sample, as close to
+  square as the number of samples allows. A prime number of samples gets one
+  column per sample, so the cells still cover the whole pixel
+*/
+[[nodiscard]] constexpr std::pair<int, int> strata(int samples) noexcept {
+  int rows = 1;
+  for (int divisor = 2; divisor * divisor <= samples; ++divisor) {
+    if (samples % divisor == 0) rows = divisor;
+  }
+  return {samples / rows, rows};
+}
+
+/*
+  Position of a sample inside the pixel (x, y). sample selects the cell out
+  of `samples` and the jitter inside it is drawn from the random stream of
+  sample number first_sample + sample, so further sets of samples for the
+  same pixel start where the previous ones ended and never repeat them. A
+  lone first sample sits in the center of the pixel
+*/
+[[nodiscard]] constexpr std::pair<float, float> stratified_sample(
+    int x, int y, int sample, int samples, int first_sample = 0,
+    std::uint32_t seed = 0) noexcept {
+  const auto [columns, rows] = strata(samples);
+
+  float jitter_x = 0.5f;
+  float jitter_y = 0.5f;
+  if (samples > 1 || first_sample > 0) {
+    RandomUtil::RandomStream random(static_cast<std::uint32_t>(x),
+                                    static_cast<std::uint32_t>(y),
+                                    static_cast<std::uint32_t>(first_sample +
+                                                               sample),
+                                    0, seed);
+    jitter_x = random.next();
+    jitter_y = random.next();
+  }
+
+  return {(static_cast<float>(sample % columns) + jitter_x) /
+              static_cast<float>(columns),
+          (static_cast<float>(sample / columns) + jitter_y) /
+              static_cast<float>(rows)};
+}
+
+}  // namespace SamplingUtil
+
+#endif
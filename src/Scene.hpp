@@ -0,0 +1,451 @@
+#ifndef CONSTEXPR_RAYTRACER_SCENE_HPP
+#define CONSTEXPR_RAYTRACER_SCENE_HPP
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Camera.hpp"
+#include "Instance.hpp"
+#include "MappedFile.hpp"
+#include "MatrixTransformations.hpp"
+#include "Obj.hpp"
+#include "Shading.hpp"
+#include "Shape.hpp"
+#include "World.hpp"
+
+/*
+  Scene description format
+
+  One statement per line, tokens separated by blanks and `#` starting a
+  comment. Angles are in radians.
+
+    camera <width> <height> <fov> from <x y z> to <x y z> up <x y z>
+    light <x y z> <r g b>
+    material <name> [color <r g b>] [ambient <a>] [diffuse <d>]
+                    [specular <s>] [shininess <s>] [reflective <r>]
+                    [transparency <t>] [refractive-index <n>]
+    sphere | plane | cube | cylinder | cone | mesh <obj path> [options]
+    prototype <name>
+    end
+    instance <name> [options]
+
+  Shape options are `material <name>`, the transformation steps
+  `translate <x y z>`, `scale <x y z>`, `rotate-x <a>`, `rotate-y <a>`,
+  `rotate-z <a>` and `shear <xy xz yx yz zx zy>`, applied in the order they
+  are written, and for cylinders and cones `minimum <y>`, `maximum <y>` and
+  `closed`. Materials must be declared before use, under a name no other
+  material has, and mesh paths are relative to the scene file.
+
+  The shapes between `prototype` and `end` are not added to the scene but
+  stored once as a prototype, which must be bounded and named differently
+  from the other prototypes; every `instance` of it places a copy, with the
+  material and transformation options of shapes.
+*/
+
+/*
+  Scene: what a scene description or cache holds. storage is the file the
+  arrays of the world view when the scene was loaded from a cache, kept
+  mapped for as long as the scene or a copy of it lives
+*/
+struct Scene {
+  Camera camera;
+  World world;
+  std::shared_ptr<const MappedFile> storage{};
+};
+
+namespace SceneUtil {
+
+namespace detail {
+
+[[nodiscard]] constexpr std::vector<std::string_view> tokenize(
+    std::string_view line) {
+  using ObjUtil::detail::is_blank;
+
+  std::vector<std::string_view> tokens;
+  std::size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && is_blank(line[i])) ++i;
+    if (i == line.size() || line[i] == '#') break;
+
+    const auto start = i;
+    while (i < line.size() && !is_blank(line[i]) && line[i] != '#') ++i;
+    tokens.push_back(line.substr(start, i - start));
+  }
+  return tokens;
+}
+
+class TokenStream {
+ public:
+  [[nodiscard]] constexpr explicit TokenStream(
+      std::vector<std::string_view> tokens) noexcept
+      : tokens_(std::move(tokens)) {}
+
+  [[nodiscard]] constexpr bool done() const noexcept {
+    return next_ == tokens_.size();
+  }
+
+  [[nodiscard]] constexpr std::optional<std::string_view> word() noexcept {
+    if (done()) return std::nullopt;
+    return tokens_[next_++];
+  }
+
+  [[nodiscard]] constexpr std::optional<float> number() noexcept {
+    const auto token = word();
+    if (!token) return std::nullopt;
+
+    const char* it = token->data();
+    const char* const end = token->data() + token->size();
+    const auto value = ObjUtil::detail::parse_float(it, end);
+    if (it != end) return std::nullopt;
+    return value;
+  }
+
+  /*
+    Reads a whole number, rejecting fractions and values outside of int
+  */
+  [[nodiscard]] constexpr std::optional<int> integer() noexcept {
+    const auto token = word();
+    if (!token) return std::nullopt;
+
+    const char* it = token->data();
+    const char* const end = token->data() + token->size();
+    const auto value = ObjUtil::detail::parse_int(it, end);
+    if (!value || it != end || *value < std::numeric_limits<int>::min() ||
+        *value > std::numeric_limits<int>::max())
+      return std::nullopt;
+    return static_cast<int>(*value);
+  }
+
+  template <std::size_t N>
+  [[nodiscard]] constexpr std::optional<std::array<float, N>>
+  numbers() noexcept {
+    std::array<float, N> values{};
+    for (auto& value : values) {
+      const auto parsed = number();
+      if (!parsed) return std::nullopt;
+      value = *parsed;
+    }
+    return values;
+  }
+
+  [[nodiscard]] constexpr std::optional<Tuple> point() noexcept {
+    const auto xyz = numbers<3>();
+    if (!xyz) return std::nullopt;
+    return TupleUtil::point((*xyz)[0], (*xyz)[1], (*xyz)[2]);
+  }
+
+  [[nodiscard]] constexpr std::optional<Tuple> vector() noexcept {
+    const auto xyz = numbers<3>();
+    if (!xyz) return std::nullopt;
+    return TupleUtil::vector((*xyz)[0], (*xyz)[1], (*xyz)[2]);
+  }
+
+  [[nodiscard]] constexpr std::optional<Color> color() noexcept {
+    const auto rgb = numbers<3>();
+    if (!rgb) return std::nullopt;
+    return Color((*rgb)[0], (*rgb)[1], (*rgb)[2]);
+  }
+
+ private:
+  std::vector<std::string_view> tokens_;
+  std::size_t next_{0};
+};
+
+// Names of the materials declared so far and their index in the world
+using MaterialTable = std::vector<std::pair<std::string_view, MaterialId>>;
+
+[[nodiscard]] constexpr const MaterialId* find_material(
+    const MaterialTable& materials, std::string_view name) noexcept {
+  for (const auto& [material_name, material] : materials) {
+    if (material_name == name) return &material;
+  }
+  return nullptr;
+}
+
+// Names of the prototypes read so far and their index in the world
+using PrototypeTable = std::vector<std::pair<std::string_view, PrototypeId>>;
+
+[[nodiscard]] constexpr const PrototypeId* find_prototype(
+    const PrototypeTable& prototypes, std::string_view name) noexcept {
+  for (const auto& [prototype_name, prototype] : prototypes) {
+    if (prototype_name == name) return &prototype;
+  }
+  return nullptr;
+}
+
+[[nodiscard]] constexpr bool is_transform_step(std::string_view key) noexcept {
+  return key == "translate" || key == "scale" || key == "rotate-x" ||
+         key == "rotate-y" || key == "rotate-z" || key == "shear";
+}
+
+/*
+  Reads the arguments of a transformation step and returns the matrix of the
+  step alone
+*/
+[[nodiscard]] constexpr std::optional<MatrixUtil::Transformation>
+transform_step(std::string_view key, TokenStream& tokens) noexcept {
+  using namespace MatrixUtil;
+
+  if (key == "translate" || key == "scale") {
+    const auto xyz = tokens.numbers<3>();
+    if (!xyz) return std::nullopt;
+    const auto [x, y, z] = *xyz;
+    return key == "translate" ? translation(x, y, z) : scaling(x, y, z);
+  }
+  if (key == "shear") {
+    const auto factors = tokens.numbers<6>();
+    if (!factors) return std::nullopt;
+    const auto [xy, xz, yx, yz, zx, zy] = *factors;
+    return shearing(xy, xz, yx, yz, zx, zy);
+  }
+
+  const auto angle = tokens.number();
+  if (!angle) return std::nullopt;
+  if (key == "rotate-x") return rotation_x(*angle);
+  if (key == "rotate-y") return rotation_y(*angle);
+  return rotation_z(*angle);
+}
+
+[[nodiscard]] constexpr std::optional<Camera> parse_camera(
+    TokenStream& tokens) noexcept {
+  const auto width = tokens.integer();
+  const auto height = tokens.integer();
+  const auto field_of_view = tokens.number();
+  if (!width || !height || !field_of_view || *width < 1 || *height < 1)
+    return std::nullopt;
+
+  if (tokens.word() != "from") return std::nullopt;
+  const auto from = tokens.point();
+  if (tokens.word() != "to") return std::nullopt;
+  const auto to = tokens.point();
+  if (tokens.word() != "up") return std::nullopt;
+  const auto up = tokens.vector();
+  if (!from || !to || !up || !tokens.done()) return std::nullopt;
+
+  return Camera(*width, *height, *field_of_view,
+                MatrixUtil::view_transform(*from, *to, *up));
+}
+
+[[nodiscard]] constexpr std::optional<std::pair<std::string_view, Material>>
+parse_material(TokenStream& tokens) noexcept {
+  const auto name = tokens.word();
+  if (!name) return std::nullopt;
+
+  Material material;
+  while (!tokens.done()) {
+    const auto key = *tokens.word();
+    if (key == "color") {
+      const auto color = tokens.color();
+      if (!color) return std::nullopt;
+      material.color = *color;
+      continue;
+    }
+
+    const auto value = tokens.number();
+    if (!value) return std::nullopt;
+    if (key == "ambient")
+      material.ambient = *value;
+    else if (key == "diffuse")
+      material.diffuse = *value;
+    else if (key == "specular")
+      material.specular = *value;
+    else if (key == "shininess")
+      material.shininess = *value;
+    else if (key == "reflective")
+      material.reflective = *value;
+    else if (key == "transparency")
+      material.transparency = *value;
+    else if (key == "refractive-index")
+      material.refractive_index = *value;
+    else
+      return std::nullopt;
+  }
+  return std::pair{*name, material};
+}
+
+/*
+  Applies the shape options to an already constructed shape
+*/
+template <typename T>
+[[nodiscard]] constexpr bool parse_shape_options(
+    T& shape, TokenStream& tokens, const MaterialTable& materials) noexcept {
+  constexpr bool truncated =
+      std::is_same_v<T, Cylinder> || std::is_same_v<T, Cone>;
+
+  while (!tokens.done()) {
+    const auto key = *tokens.word();
+    if (key == "material") {
+      const auto name = tokens.word();
+      const auto* material = name ? find_material(materials, *name) : nullptr;
+      if (material == nullptr) return false;
+      shape.material = *material;
+    } else if (is_transform_step(key)) {
+      const auto step = transform_step(key, tokens);
+      if (!step) return false;
+      shape.transform = *step * shape.transform;
+    } else if constexpr (truncated) {
+      if (key == "closed") {
+        shape.closed = true;
+        continue;
+      }
+      const auto value = tokens.number();
+      if (!value) return false;
+      if (key == "minimum")
+        shape.minimum = *value;
+      else if (key == "maximum")
+        shape.maximum = *value;
+      else
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+[[nodiscard]] constexpr std::optional<Shape> parse_shape(
+    T shape, TokenStream& tokens, const MaterialTable& materials) {
+  if (!parse_shape_options(shape, tokens, materials)) return std::nullopt;
+  return Shape{std::move(shape)};
+}
+
+[[nodiscard]] inline std::optional<Shape> parse_mesh(
+    TokenStream& tokens, const MaterialTable& materials,
+    const std::filesystem::path& base_directory, unsigned threads) {
+  const auto path = tokens.word();
+  if (!path) return std::nullopt;
+
+  auto mesh = ObjUtil::load(base_directory / std::filesystem::path(*path),
+                            BvhUtil::detail::worker_count(threads));
+  if (!mesh) return std::nullopt;
+  mesh->packets = MeshUtil::pack(*mesh);
+  return parse_shape(std::move(*mesh), tokens, materials);
+}
+
+}  // namespace detail
+
+/*
+  Parses a scene description. On failure nothing is returned and, when given,
+  error_line receives the 1-based line that could not be read (0 when the
+  scene has no camera). Meshes are loaded relative to base_directory. The
+  hierarchies of prototypes and instances are built with bvh_settings,
+  whose threads also parse the meshes
+*/
+[[nodiscard]] inline std::optional<Scene> parse(
+    std::string_view text, const std::filesystem::path& base_directory = {},
+    std::size_t* error_line = nullptr, const BvhSettings& bvh_settings = {}) {
+  using namespace detail;
+
+  std::optional<Camera> camera;
+  World world;
+  MaterialTable materials;
+  PrototypeTable prototypes;
+  // Name and shapes of the prototype being read, if any
+  std::optional<std::pair<std::string_view, std::vector<Shape>>> prototype;
+
+  const auto fail = [error_line](std::size_t line) -> std::optional<Scene> {
+    if (error_line != nullptr) *error_line = line;
+    return std::nullopt;
+  };
+
+  std::size_t line_number = 0;
+  for (std::size_t begin = 0; begin < text.size();) {
+    const auto end = std::min(text.find('\n', begin), text.size());
+    TokenStream tokens(tokenize(text.substr(begin, end - begin)));
+    begin = end + 1;
+    ++line_number;
+
+    const auto statement = tokens.word();
+    if (!statement) continue;
+
+    if (*statement == "camera") {
+      camera = parse_camera(tokens);
+      if (!camera) return fail(line_number);
+    } else if (*statement == "light") {
+      const auto position = tokens.point();
+      const auto intensity = tokens.color();
+      if (!position || !intensity || !tokens.done()) return fail(line_number);
+      world.add(PointLight(*position, *intensity));
+    } else if (*statement == "material") {
+      const auto material = parse_material(tokens);
+      if (!material || find_material(materials, material->first))
+        return fail(line_number);
+      materials.emplace_back(material->first, world.add(material->second));
+    } else if (*statement == "prototype") {
+      const auto name = tokens.word();
+      if (prototype || !name || find_prototype(prototypes, *name) ||
+          !tokens.done())
+        return fail(line_number);
+      prototype.emplace(*name, std::vector<Shape>{});
+    } else if (*statement == "end") {
+      if (!prototype || prototype->second.empty() || !tokens.done())
+        return fail(line_number);
+      for (const auto& shape : prototype->second) {
+        if (!BoundsUtil::finite(BoundsUtil::bounds(shape)))
+          return fail(line_number);
+      }
+      prototypes.emplace_back(prototype->first,
+                              world.add(Prototype(prototype->second,
+                                                  bvh_settings)));
+      prototype.reset();
+    } else if (*statement == "instance") {
+      const auto name = tokens.word();
+      const auto* id = name ? find_prototype(prototypes, *name) : nullptr;
+      if (id == nullptr) return fail(line_number);
+      Instance instance{*id};
+      if (!parse_shape_options(instance, tokens, materials))
+        return fail(line_number);
+      world.add(std::move(instance));
+    } else {
+      std::optional<Shape> shape;
+      if (*statement == "sphere")
+        shape = parse_shape(Sphere{}, tokens, materials);
+      else if (*statement == "plane")
+        shape = parse_shape(Plane{}, tokens, materials);
+      else if (*statement == "cube")
+        shape = parse_shape(Cube{}, tokens, materials);
+      else if (*statement == "cylinder")
+        shape = parse_shape(Cylinder{}, tokens, materials);
+      else if (*statement == "cone")
+        shape = parse_shape(Cone{}, tokens, materials);
+      else if (*statement == "mesh")
+        shape = parse_mesh(tokens, materials, base_directory,
+                           bvh_settings.threads);
+
+      if (!shape) return fail(line_number);
+      if (prototype)
+        prototype->second.push_back(std::move(*shape));
+      else
+        world.add(std::move(*shape));
+    }
+  }
+
+  if (prototype) return fail(line_number);
+  if (!camera) return fail(0);
+  world.build_instance_bvh(bvh_settings);
+  return Scene{std::move(*camera), std::move(world)};
+}
+
+/*
+  Reads a scene file, resolving mesh paths against its directory
+*/
+[[nodiscard]] inline std::optional<Scene> load(
+    const std::filesystem::path& path, std::size_t* error_line = nullptr,
+    const BvhSettings& bvh_settings = {}) {
+  const auto file = MappedFile::open(path);
+  if (!file) return std::nullopt;
+  return parse(file->view(), path.parent_path(), error_line, bvh_settings);
+}
+
+}  // namespace SceneUtil
+
+#endif
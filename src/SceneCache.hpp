@@ -0,0 +1,808 @@
+#ifndef CONSTEXPR_RAYTRACER_SCENE_CACHE_HPP
+#define CONSTEXPR_RAYTRACER_SCENE_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Bvh.hpp"
+#include "Camera.hpp"
+#include "FlatArray.hpp"
+#include "Instance.hpp"
+#include "MappedFile.hpp"
+#include "MatrixTransformations.hpp"
+#include "Scene.hpp"
+#include "Shading.hpp"
+#include "Shape.hpp"
+#include "World.hpp"
+
+/*
+  Binary scene cache
+
+  A versioned, native-endian file holding a whole Scene so it can be loaded
+  without parsing: the camera, one record per shape with its transformation
+  and the precomputed inverse, the material table the shapes index into, the
+  lights, the flat vertex, index and triangle packet arrays of every mesh,
+  the prototypes and instances and the bounding volume hierarchies over the
+  prototypes and the instances.
+
+  Layout: a FileHeader, a table of SectionHeaders and then the sections, each
+  one a tightly packed array of trivially copyable records aligned to
+  section_alignment. Loading maps the file and checks every index and range
+  in it once; the meshes and hierarchies of the world built from it then
+  view the mapped arrays instead of copying them. Readers skip section types
+  they do not know, which lets later versions add sections without breaking
+  older files.
+*/
+
+namespace SceneCacheUtil {
+
+inline constexpr std::array<char, 8> magic{'C', 'R', 'T', 'S',
+                                           'C', 'E', 'N', 'E'};
+inline constexpr std::uint32_t version{4};
+inline constexpr std::uint32_t byte_order_mark{0x01020304};
+inline constexpr std::uint64_t section_alignment{64};
+
+// Index standing for no record, such as a hierarchy left to the loader
+inline constexpr std::uint32_t no_index{0xffffffff};
+
+enum class SectionType : std::uint32_t {
+  Objects = 1,
+  Materials = 2,
+  Lights = 3,
+  Meshes = 4,
+  Vertices = 5,
+  Indices = 6,
+  Scene = 7,
+  Packets = 8,
+  Prototypes = 9,
+  Instances = 10,
+  Bvhs = 11,
+  BvhNodes = 12,
+  BvhItems = 13
+};
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t byte_order_mark;
+  std::uint32_t section_count;
+  std::uint32_t reserved;
+};
+
+struct SectionHeader {
+  SectionType type;
+  std::uint32_t element_size;
+  std::uint64_t offset;
+  std::uint64_t count;
+};
+
+/*
+  The camera and what the world holds outside prototypes: the first
+  object_count objects, the others being shapes of prototypes
+*/
+struct SceneRecord {
+  std::int32_t hsize;
+  std::int32_t vsize;
+  float field_of_view;
+  std::uint32_t object_count;
+  std::uint32_t instance_bvh;  // Index into the hierarchy section or no_index
+  std::uint32_t reserved;
+  std::array<float, 16> camera_transform;
+};
+
+struct ObjectRecord {
+  ShapeType type;
+  std::uint32_t material;
+  std::uint32_t mesh;  // Index into the mesh section for triangle meshes
+  std::uint32_t closed;
+  float minimum;
+  float maximum;
+  std::array<float, 16> transform;
+  std::array<float, 16> inverse_transform;
+};
+
+struct MaterialRecord {
+  std::array<float, 3> color;
+  float ambient;
+  float diffuse;
+  float specular;
+  float shininess;
+  float reflective;
+  float transparency;
+  float refractive_index;
+};
+
+struct LightRecord {
+  std::array<float, 4> position;
+  std::array<float, 3> intensity;
+};
+
+struct MeshRecord {
+  std::uint64_t first_vertex;  // Offsets in floats into the vertex section
+  std::uint64_t vertex_floats;
+  std::uint64_t first_index;  // Offsets into the index section
+  std::uint64_t index_count;
+  std::uint64_t first_packet;  // Offsets into the packet section
+  std::uint64_t packet_count;
+};
+
+struct PrototypeRecord {
+  std::uint64_t first_shape;  // Offsets into the object section
+  std::uint64_t shape_count;
+  std::uint32_t triangles;  // Index into the mesh section
+  std::uint32_t bvh;        // Index into the hierarchy section
+};
+
+struct InstanceRecord {
+  std::uint32_t prototype;
+  std::uint32_t material;
+  std::array<float, 16> transform;
+  std::array<float, 16> inverse_transform;
+};
+
+struct BvhRecord {
+  std::uint64_t first_node;  // Offsets into the node section
+  std::uint64_t node_count;
+  std::uint64_t first_item;  // Offsets into the item section
+  std::uint64_t item_count;
+  float build_cost;
+  BvhBuilder builder;
+};
+
+using PacketRecord = TrianglePacket<TriangleMesh::packet_width>;
+
+static_assert(std::is_trivially_copyable_v<SceneRecord> &&
+              std::is_trivially_copyable_v<ObjectRecord> &&
+              std::is_trivially_copyable_v<MaterialRecord> &&
+              std::is_trivially_copyable_v<LightRecord> &&
+              std::is_trivially_copyable_v<MeshRecord> &&
+              std::is_trivially_copyable_v<PrototypeRecord> &&
+              std::is_trivially_copyable_v<InstanceRecord> &&
+              std::is_trivially_copyable_v<BvhRecord> &&
+              std::is_trivially_copyable_v<PacketRecord> &&
+              std::is_trivially_copyable_v<BvhNode>);
+
+namespace detail {
+
+[[nodiscard]] inline std::array<float, 16> to_array(
+    const Matrix<4>& matrix) noexcept {
+  std::array<float, 16> result{};
+  std::copy(matrix.begin(), matrix.end(), result.begin());
+  return result;
+}
+
+[[nodiscard]] inline MaterialRecord to_record(const Material& m) noexcept {
+  return {{m.color.red, m.color.green, m.color.blue},
+          m.ambient,
+          m.diffuse,
+          m.specular,
+          m.shininess,
+          m.reflective,
+          m.transparency,
+          m.refractive_index};
+}
+
+[[nodiscard]] inline Material to_material(const MaterialRecord& r) noexcept {
+  return Material{Color(r.color[0], r.color[1], r.color[2]),
+                  r.ambient,
+                  r.diffuse,
+                  r.specular,
+                  r.shininess,
+                  r.reflective,
+                  r.transparency,
+                  r.refractive_index};
+}
+
+/*
+  Whether count elements starting at first fit in size elements, without
+  overflowing on values read from a file
+*/
+[[nodiscard]] constexpr bool in_range(std::uint64_t first, std::uint64_t count,
+                                      std::uint64_t size) noexcept {
+  return first <= size && count <= size - first;
+}
+
+[[nodiscard]] constexpr std::uint64_t align(std::uint64_t offset) noexcept {
+  return (offset + section_alignment - 1) / section_alignment *
+         section_alignment;
+}
+
+/*
+  Records of one section on their way to the file
+*/
+struct SectionData {
+  SectionHeader header;
+  const char* bytes;
+};
+
+template <typename T>
+[[nodiscard]] SectionData section(SectionType type,
+                                  const std::vector<T>& records) noexcept {
+  return {{type, sizeof(T), 0, records.size()},
+          reinterpret_cast<const char*>(records.data())};
+}
+
+/*
+  Records of a scene gathered in the order they are written
+*/
+struct Records {
+  std::vector<ObjectRecord> objects;
+  std::vector<MaterialRecord> materials;
+  std::vector<LightRecord> lights;
+  std::vector<MeshRecord> meshes;
+  std::vector<float> vertices;
+  std::vector<std::uint32_t> indices;
+  std::vector<PacketRecord> packets;
+  std::vector<PrototypeRecord> prototypes;
+  std::vector<InstanceRecord> instances;
+  std::vector<BvhRecord> bvhs;
+  std::vector<BvhNode> bvh_nodes;
+  std::vector<std::uint32_t> bvh_items;
+
+  std::uint32_t add(const TriangleMesh& mesh) {
+    meshes.push_back({vertices.size(), mesh.vertices.size(), indices.size(),
+                      mesh.indices.size(), packets.size(),
+                      mesh.packets.size()});
+    vertices.insert(vertices.end(), mesh.vertices.begin(),
+                    mesh.vertices.end());
+    indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+    packets.insert(packets.end(), mesh.packets.begin(), mesh.packets.end());
+    return static_cast<std::uint32_t>(meshes.size() - 1);
+  }
+
+  std::uint32_t add(const Bvh& bvh) {
+    bvhs.push_back({bvh_nodes.size(), bvh.nodes.size(), bvh_items.size(),
+                    bvh.items.size(), bvh.build_cost, bvh.builder});
+    bvh_nodes.insert(bvh_nodes.end(), bvh.nodes.begin(), bvh.nodes.end());
+    bvh_items.insert(bvh_items.end(), bvh.items.begin(), bvh.items.end());
+    return static_cast<std::uint32_t>(bvhs.size() - 1);
+  }
+
+  void add(const Shape& shape,
+           const MatrixUtil::Transformation& inverse_transform) {
+    ObjectRecord record{ShapeUtil::object_type(shape),
+                        ShapeUtil::material(shape),
+                        0,
+                        0,
+                        0.f,
+                        0.f,
+                        to_array(ShapeUtil::transform(shape)),
+                        to_array(inverse_transform)};
+
+    std::visit(
+        [&](const auto& s) {
+          using T = std::decay_t<decltype(s)>;
+          if constexpr (std::is_same_v<T, Cylinder> ||
+                        std::is_same_v<T, Cone>) {
+            record.minimum = s.minimum;
+            record.maximum = s.maximum;
+            record.closed = s.closed ? 1 : 0;
+          } else if constexpr (std::is_same_v<T, TriangleMesh>) {
+            record.mesh = add(s);
+          }
+        },
+        shape);
+
+    objects.push_back(record);
+  }
+};
+
+}  // namespace detail
+
+/*
+  Writes the scene to path with the inverse transformations and hierarchies
+  it already holds. The hierarchy over the instances is only stored when it
+  is up to date; otherwise it is built again on load. Returns whether the
+  file could be written entirely, false as well when a shape refers to a
+  material outside the table of the world
+*/
+[[nodiscard]] inline bool write(const std::filesystem::path& path,
+                                const Scene& scene) {
+  const auto& world = scene.world;
+  const auto& camera = scene.camera;
+  const auto material_count = world.materials().size();
+  detail::Records records;
+
+  for (World::size_type i = 0; i < world.size(); ++i)
+    records.add(world.objects()[i], world.inverse_transform(i));
+
+  for (const auto& prototype : world.prototypes()) {
+    const auto first_shape = records.objects.size();
+    for (std::size_t i = 0; i < prototype.shapes().size(); ++i)
+      records.add(prototype.shapes()[i], prototype.inverse_transform(i));
+    records.prototypes.push_back({first_shape, prototype.shapes().size(),
+                                  records.add(prototype.triangles()),
+                                  records.add(prototype.bvh())});
+  }
+
+  const auto materials_in_table = [material_count](const auto& record) {
+    return record.material < material_count;
+  };
+  if (!std::all_of(records.objects.begin(), records.objects.end(),
+                   materials_in_table))
+    return false;
+
+  for (std::size_t i = 0; i < world.instances().size(); ++i) {
+    const auto& instance = world.instances()[i];
+    records.instances.push_back(
+        {instance.prototype, instance.material,
+         detail::to_array(instance.transform),
+         detail::to_array(world.instance_inverse_transform(i))});
+  }
+
+  for (const auto& material : world.materials())
+    records.materials.push_back(detail::to_record(material));
+
+  for (const auto& light : world.lights()) {
+    records.lights.push_back(
+        {{light.position.x, light.position.y, light.position.z,
+          light.position.w},
+         {light.intensity.red, light.intensity.green, light.intensity.blue}});
+  }
+
+  const auto* instance_bvh = world.instance_bvh();
+  const std::vector<SceneRecord> scene_records{
+      {camera.hsize(), camera.vsize(), camera.field_of_view(),
+       static_cast<std::uint32_t>(world.size()),
+       instance_bvh ? records.add(*instance_bvh) : no_index, 0,
+       detail::to_array(camera.transform())}};
+
+  std::vector<detail::SectionData> sections{
+      detail::section(SectionType::Scene, scene_records),
+      detail::section(SectionType::Objects, records.objects),
+      detail::section(SectionType::Materials, records.materials),
+      detail::section(SectionType::Lights, records.lights),
+      detail::section(SectionType::Meshes, records.meshes),
+      detail::section(SectionType::Vertices, records.vertices),
+      detail::section(SectionType::Indices, records.indices),
+      detail::section(SectionType::Packets, records.packets),
+      detail::section(SectionType::Prototypes, records.prototypes),
+      detail::section(SectionType::Instances, records.instances),
+      detail::section(SectionType::Bvhs, records.bvhs),
+      detail::section(SectionType::BvhNodes, records.bvh_nodes),
+      detail::section(SectionType::BvhItems, records.bvh_items)};
+
+  auto offset = detail::align(sizeof(FileHeader) +
+                              sections.size() * sizeof(SectionHeader));
+  for (auto& section : sections) {
+    section.header.offset = offset;
+    offset = detail::align(offset + section.header.element_size *
+                                        section.header.count);
+  }
+
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  if (!stream) return false;
+
+  const FileHeader header{magic, version, byte_order_mark,
+                          static_cast<std::uint32_t>(sections.size()), 0};
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& section : sections) {
+    stream.write(reinterpret_cast<const char*>(&section.header),
+                 sizeof(SectionHeader));
+  }
+
+  for (const auto& section : sections) {
+    static constexpr std::array<char, section_alignment> zeros{};
+    const auto current = static_cast<std::uint64_t>(stream.tellp());
+    stream.write(zeros.data(),
+                 static_cast<std::streamsize>(section.header.offset - current));
+    stream.write(section.bytes,
+                 static_cast<std::streamsize>(section.header.element_size *
+                                              section.header.count));
+  }
+
+  return static_cast<bool>(stream);
+}
+
+}  // namespace SceneCacheUtil
+
+/*
+  SceneCache:
+
+  A scene file mapped into memory and checked on opening, so that every
+  index and range in it stays inside the file and the arrays it refers to.
+  Every accessor is a view into the mapping, which lives as long as the
+  SceneCache or any scene built from it.
+*/
+
+class SceneCache {
+ public:
+  using SceneRecord = SceneCacheUtil::SceneRecord;
+  using ObjectRecord = SceneCacheUtil::ObjectRecord;
+  using MaterialRecord = SceneCacheUtil::MaterialRecord;
+  using LightRecord = SceneCacheUtil::LightRecord;
+  using MeshRecord = SceneCacheUtil::MeshRecord;
+  using PacketRecord = SceneCacheUtil::PacketRecord;
+  using PrototypeRecord = SceneCacheUtil::PrototypeRecord;
+  using InstanceRecord = SceneCacheUtil::InstanceRecord;
+  using BvhRecord = SceneCacheUtil::BvhRecord;
+
+  /*
+    Maps the file and validates it. Returns nothing for files of another
+    version or byte order, truncated files and files with sections, indices,
+    shape types, meshes or hierarchies that do not hold together.
+  */
+  [[nodiscard]] static std::optional<SceneCache> open(
+      const std::filesystem::path& path) {
+    using namespace SceneCacheUtil;
+
+    auto file = MappedFile::open(path);
+    if (!file || file->size() < sizeof(FileHeader)) return std::nullopt;
+
+    FileHeader header{};
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != magic || header.version != version ||
+        header.byte_order_mark != byte_order_mark)
+      return std::nullopt;
+
+    const auto table_end =
+        sizeof(FileHeader) +
+        std::uint64_t{header.section_count} * sizeof(SectionHeader);
+    if (file->size() < table_end) return std::nullopt;
+
+    SceneCache cache(std::make_shared<const MappedFile>(std::move(*file)));
+    for (std::uint32_t i = 0; i < header.section_count; ++i) {
+      SectionHeader section{};
+      std::memcpy(&section,
+                  cache.file_->data() + sizeof(FileHeader) +
+                      i * sizeof(SectionHeader),
+                  sizeof(section));
+
+      if (!cache.bind(section)) return std::nullopt;
+    }
+
+    if (!cache.valid()) return std::nullopt;
+    return cache;
+  }
+
+  [[nodiscard]] std::span<const ObjectRecord> objects() const noexcept {
+    return objects_;
+  }
+
+  [[nodiscard]] std::span<const MaterialRecord> materials() const noexcept {
+    return materials_;
+  }
+
+  [[nodiscard]] std::span<const LightRecord> lights() const noexcept {
+    return lights_;
+  }
+
+  [[nodiscard]] std::span<const MeshRecord> meshes() const noexcept {
+    return meshes_;
+  }
+
+  [[nodiscard]] std::span<const PrototypeRecord> prototypes()
+      const noexcept {
+    return prototypes_;
+  }
+
+  [[nodiscard]] std::span<const InstanceRecord> instances() const noexcept {
+    return instances_;
+  }
+
+  [[nodiscard]] std::span<const BvhRecord> bvhs() const noexcept {
+    return bvhs_;
+  }
+
+  /*
+    Whether every hierarchy in the file was built with the builder
+  */
+  [[nodiscard]] bool built_with(BvhBuilder builder) const noexcept {
+    return std::all_of(
+        bvhs_.begin(), bvhs_.end(),
+        [builder](const BvhRecord& bvh) { return bvh.builder == builder; });
+  }
+
+  /*
+    Builds the scene from the records. Shapes and instances take the stored
+    inverse transformations, meshes and hierarchies view the mapped arrays
+    and only the records are turned into objects, whatever builder the
+    settings name. The hierarchy over the instances is built with the
+    settings when the file does not hold it.
+  */
+  [[nodiscard]] Scene scene(const BvhSettings& bvh_settings = {}) const {
+    using SceneCacheUtil::no_index;
+
+    const auto& record = scene_.front();
+    World world;
+
+    std::vector<MaterialId> material_ids;
+    material_ids.reserve(materials_.size());
+    for (const auto& material : materials_)
+      material_ids.push_back(
+          world.add(SceneCacheUtil::detail::to_material(material)));
+
+    for (const auto& light : lights_) {
+      world.add(PointLight(
+          TupleUtil::point(light.position[0], light.position[1],
+                           light.position[2]),
+          Color(light.intensity[0], light.intensity[1], light.intensity[2])));
+    }
+
+    for (std::size_t i = 0; i < record.object_count; ++i) {
+      world.add(shape(objects_[i], material_ids),
+                MatrixUtil::Transformation(objects_[i].inverse_transform));
+    }
+
+    for (const auto& prototype : prototypes_) {
+      std::vector<Shape> shapes;
+      std::vector<MatrixUtil::Transformation> inverse_transforms;
+      for (const auto& object :
+           objects_.subspan(prototype.first_shape, prototype.shape_count)) {
+        shapes.push_back(shape(object, material_ids));
+        inverse_transforms.emplace_back(object.inverse_transform);
+      }
+      world.add(Prototype(std::move(shapes), std::move(inverse_transforms),
+                          mesh(meshes_[prototype.triangles]),
+                          bvh(bvhs_[prototype.bvh])));
+    }
+
+    for (const auto& instance : instances_) {
+      world.add(Instance{instance.prototype,
+                         MatrixUtil::Transformation(instance.transform),
+                         material_ids[instance.material]},
+                MatrixUtil::Transformation(instance.inverse_transform));
+    }
+
+    if (record.instance_bvh == no_index)
+      world.build_instance_bvh(bvh_settings);
+    else
+      world.set_instance_bvh(bvh(bvhs_[record.instance_bvh]));
+
+    return Scene{Camera(record.hsize, record.vsize, record.field_of_view,
+                        MatrixUtil::Transformation(record.camera_transform)),
+                 std::move(world), file_};
+  }
+
+ private:
+  explicit SceneCache(std::shared_ptr<const MappedFile> file) noexcept
+      : file_(std::move(file)) {}
+
+  /*
+    Points the span matching the section at it. Returns false when the
+    section does not lie inside the file or its records do not have the
+    size of the type the span holds; sections of unknown types are skipped.
+  */
+  [[nodiscard]] bool bind(
+      const SceneCacheUtil::SectionHeader& section) noexcept {
+    using SceneCacheUtil::SectionType;
+
+    const auto to = [&]<typename T>(std::span<const T>& target) {
+      if (section.element_size != sizeof(T) ||
+          section.offset % SceneCacheUtil::section_alignment != 0 ||
+          section.offset > file_->size() ||
+          section.count > (file_->size() - section.offset) / sizeof(T))
+        return false;
+      target = std::span<const T>(
+          reinterpret_cast<const T*>(file_->data() + section.offset),
+          section.count);
+      return true;
+    };
+
+    switch (section.type) {
+      case SectionType::Scene:
+        return to(scene_);
+      case SectionType::Objects:
+        return to(objects_);
+      case SectionType::Materials:
+        return to(materials_);
+      case SectionType::Lights:
+        return to(lights_);
+      case SectionType::Meshes:
+        return to(meshes_);
+      case SectionType::Vertices:
+        return to(vertices_);
+      case SectionType::Indices:
+        return to(indices_);
+      case SectionType::Packets:
+        return to(packets_);
+      case SectionType::Prototypes:
+        return to(prototypes_);
+      case SectionType::Instances:
+        return to(instances_);
+      case SectionType::Bvhs:
+        return to(bvhs_);
+      case SectionType::BvhNodes:
+        return to(bvh_nodes_);
+      case SectionType::BvhItems:
+        return to(bvh_items_);
+    }
+    return true;
+  }
+
+  /*
+    Mesh viewing the arrays of the record, with the identity transformation
+    and the default material
+  */
+  [[nodiscard]] TriangleMesh mesh(const MeshRecord& record) const noexcept {
+    TriangleMesh result;
+    result.vertices = FlatArray<float>::view(
+        vertices_.subspan(record.first_vertex, record.vertex_floats));
+    result.indices = FlatArray<std::uint32_t>::view(
+        indices_.subspan(record.first_index, record.index_count));
+    result.packets = FlatArray<PacketRecord>::view(
+        packets_.subspan(record.first_packet, record.packet_count));
+    return result;
+  }
+
+  [[nodiscard]] Bvh bvh(const BvhRecord& record) const noexcept {
+    return Bvh{FlatArray<BvhNode>::view(
+                   bvh_nodes_.subspan(record.first_node, record.node_count)),
+               FlatArray<std::uint32_t>::view(
+                   bvh_items_.subspan(record.first_item, record.item_count)),
+               record.build_cost, record.builder};
+  }
+
+  [[nodiscard]] Shape shape(
+      const ObjectRecord& record,
+      const std::vector<MaterialId>& material_ids) const noexcept {
+    const MatrixUtil::Transformation transform(record.transform);
+    const auto material = material_ids[record.material];
+
+    switch (record.type) {
+      case ShapeType::Sphere:
+        return Sphere{transform, material};
+      case ShapeType::Plane:
+        return Plane{transform, material};
+      case ShapeType::Cube:
+        return Cube{transform, material};
+      case ShapeType::Cylinder:
+        return Cylinder{transform, material, record.minimum, record.maximum,
+                        record.closed != 0};
+      case ShapeType::Cone:
+        return Cone{transform, material, record.minimum, record.maximum,
+                    record.closed != 0};
+      case ShapeType::TriangleMesh:
+        break;
+    }
+    auto result = mesh(meshes_[record.mesh]);
+    result.transform = transform;
+    result.material = material;
+    return result;
+  }
+
+  /*
+    Whether the records refer to each other and to the arrays the way the
+    scene expects, so that scene() and rendering never leave them
+  */
+  [[nodiscard]] bool valid() const {
+    using SceneCacheUtil::detail::in_range;
+
+    if (scene_.size() != 1) return false;
+    const auto& record = scene_.front();
+    if (record.hsize < 1 || record.vsize < 1 ||
+        record.object_count > objects_.size())
+      return false;
+
+    const auto valid_mesh = [this](const MeshRecord& mesh) {
+      return in_range(mesh.first_vertex, mesh.vertex_floats,
+                      vertices_.size()) &&
+             in_range(mesh.first_index, mesh.index_count, indices_.size()) &&
+             in_range(mesh.first_packet, mesh.packet_count,
+                      packets_.size()) &&
+             MeshUtil::valid(this->mesh(mesh));
+    };
+    const auto valid_bvh = [this](const BvhRecord& bvh) {
+      return (bvh.builder == BvhBuilder::Sah ||
+              bvh.builder == BvhBuilder::Lbvh) &&
+             in_range(bvh.first_node, bvh.node_count, bvh_nodes_.size()) &&
+             in_range(bvh.first_item, bvh.item_count, bvh_items_.size());
+    };
+    if (!std::all_of(meshes_.begin(), meshes_.end(), valid_mesh) ||
+        !std::all_of(bvhs_.begin(), bvhs_.end(), valid_bvh))
+      return false;
+
+    const auto valid_object = [this](const ObjectRecord& object) {
+      const auto type = static_cast<int>(object.type);
+      if (type < static_cast<int>(ShapeType::Sphere) ||
+          type > static_cast<int>(ShapeType::TriangleMesh) ||
+          object.material >= materials_.size())
+        return false;
+      return object.type != ShapeType::TriangleMesh ||
+             object.mesh < meshes_.size();
+    };
+    if (!std::all_of(objects_.begin(), objects_.end(), valid_object))
+      return false;
+
+    for (const auto& prototype : prototypes_) {
+      if (!in_range(prototype.first_shape, prototype.shape_count,
+                    objects_.size()) ||
+          prototype.triangles >= meshes_.size() ||
+          prototype.bvh >= bvhs_.size())
+        return false;
+
+      const auto shapes =
+          objects_.subspan(prototype.first_shape, prototype.shape_count);
+      if (std::any_of(shapes.begin(), shapes.end(),
+                      [](const ObjectRecord& object) {
+                        return object.type == ShapeType::TriangleMesh;
+                      }))
+        return false;
+
+      const auto primitive_count =
+          shapes.size() + meshes_[prototype.triangles].index_count / 3;
+      const auto tree = bvh(bvhs_[prototype.bvh]);
+      if (!BvhUtil::valid(tree, primitive_count)) return false;
+      if (!tree.nodes.empty() && !BoundsUtil::finite(tree.nodes[0].bounds))
+        return false;
+    }
+
+    for (const auto& instance : instances_) {
+      if (instance.prototype >= prototypes_.size() ||
+          instance.material >= materials_.size())
+        return false;
+      const auto& tree = bvhs_[prototypes_[instance.prototype].bvh];
+      if (tree.node_count == 0 ||
+          BoundsUtil::empty(bvh_nodes_[tree.first_node].bounds))
+        return false;
+    }
+
+    if (record.instance_bvh == SceneCacheUtil::no_index) return true;
+    if (record.instance_bvh >= bvhs_.size()) return false;
+    const auto tree = bvh(bvhs_[record.instance_bvh]);
+    return tree.items.size() == instances_.size() &&
+           BvhUtil::valid(tree, instances_.size());
+  }
+
+  std::shared_ptr<const MappedFile> file_;
+  std::span<const SceneRecord> scene_{};
+  std::span<const ObjectRecord> objects_{};
+  std::span<const MaterialRecord> materials_{};
+  std::span<const LightRecord> lights_{};
+  std::span<const MeshRecord> meshes_{};
+  std::span<const float> vertices_{};
+  std::span<const std::uint32_t> indices_{};
+  std::span<const PacketRecord> packets_{};
+  std::span<const PrototypeRecord> prototypes_{};
+  std::span<const InstanceRecord> instances_{};
+  std::span<const BvhRecord> bvhs_{};
+  std::span<const BvhNode> bvh_nodes_{};
+  std::span<const std::uint32_t> bvh_items_{};
+};
+
+namespace SceneCacheUtil {
+
+/*
+  Loads the scene file through the cache at cache_path: the cache is used
+  when it is valid, not older than the scene file and its hierarchies were
+  built with the builder of the settings, otherwise the scene file is parsed
+  as SceneUtil::load does and the cache written again for the next run,
+  failing to write it being no error. Meshes the scene refers to
+  are not checked, so a cache must be removed after changing only them.
+*/
+[[nodiscard]] inline std::optional<Scene> load(
+    const std::filesystem::path& scene_path,
+    const std::filesystem::path& cache_path,
+    std::size_t* error_line = nullptr, const BvhSettings& bvh_settings = {}) {
+  std::error_code error;
+  const auto scene_time = std::filesystem::last_write_time(scene_path, error);
+  if (!error) {
+    const auto cache_time =
+        std::filesystem::last_write_time(cache_path, error);
+    if (!error && cache_time >= scene_time) {
+      const auto cache = SceneCache::open(cache_path);
+      if (cache && cache->built_with(bvh_settings.builder))
+        return cache->scene(bvh_settings);
+    }
+  }
+
+  auto scene = SceneUtil::load(scene_path, error_line, bvh_settings);
+  if (scene) static_cast<void>(write(cache_path, *scene));
+  return scene;
+}
+
+}  // namespace SceneCacheUtil
+
+#endif
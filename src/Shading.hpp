@@ -1,4 +1,12 @@
 #ifndef CONSTEXPR_RAYTRACER_SHADING_HPP
+#define CONSTEXPR_RAYTRACER_SHADING_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "Color.hpp"
+#include "Tuple.hpp"
 
 struct PointLight {
   Tuple position;
@@ -8,33 +16,54 @@ struct PointLight {
       : position(std ::move(position_)), intensity(std::move(intensity_)) {}
 };
 
+/*
+  Material: Phong terms plus the weights of the reflected and refracted rays.
+  refractive_index is the index of the inside of the shape, the outside
+  being air
+*/
 struct Material {
   Color color{1.f, 1.f, 1.f};
   float ambient{0.1f};
   float diffuse{0.9f};
   float specular{0.9f};
   float shininess{200.0f};
+  float reflective{0.f};
+  float transparency{0.f};
+  float refractive_index{1.f};
 
   [[nodiscard]] constexpr friend bool operator==(const Material& lhs,
                                                  const Material& rhs) noexcept {
     return lhs.color == rhs.color && lhs.ambient == rhs.ambient &&
            lhs.diffuse == rhs.diffuse && lhs.specular == rhs.specular &&
-           lhs.shininess == rhs.shininess;
+           lhs.shininess == rhs.shininess &&
+           lhs.reflective == rhs.reflective &&
+           lhs.transparency == rhs.transparency &&
+           lhs.refractive_index == rhs.refractive_index;
   }
 };
 
+/*
+  MaterialId: position of a material in the material table of a World.
+  Shapes store this index instead of the material itself, which keeps them
+  small for intersection tests; shading looks the material up once per hit.
+  Index 0 is the default material
+*/
+using MaterialId = std::uint32_t;
+
 namespace ShadingUtil {
 
 /*
   Calculates the lighting at a point of a surface using the Phong Reflection
-  Model
+  Model. Points in shadow only receive the ambient term
 */
-[[nodiscard]] constexpr Color lighting(Material material, PointLight light,
-                                       Tuple point, Tuple eye_vector,
-                                       Tuple normal_vector) noexcept {
+[[nodiscard]] constexpr Color lighting(const Material& material,
+                                       const PointLight& light, Tuple point,
+                                       Tuple eye_vector, Tuple normal_vector,
+                                       bool in_shadow = false) noexcept {
   const Color effective_color = material.color * light.intensity;
   const Tuple light_vector = TupleUtil::normalize(light.position - point);
   const Color ambient = effective_color * material.ambient;
+  if (in_shadow) return ambient;
   const float light_dot_normal = TupleUtil::dot(light_vector, normal_vector);
 
   const auto [diffuse, specular] = [&]() -> std::pair<Color, Color> {
@@ -66,5 +95,4 @@ namespace ShadingUtil {
 
 }  // namespace ShadingUtil
 
-#define CONSTEXPR_RAYTRACER_SHADING_HPP
 #endif
\ No newline at end of file
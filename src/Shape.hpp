@@ -1,30 +1,484 @@
 #ifndef CONSTEXPR_RAYTRACER_SHAPE_HPP
 #define CONSTEXPR_RAYTRACER_SHAPE_HPP
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <tuple>
+#include <variant>
+#include <vector>
 
 #include "Color.hpp"
+#include "FlatArray.hpp"
 #include "MatrixTransformations.hpp"
 #include "Shading.hpp"
 #include "Tuple.hpp"
 
-enum class ShapeType { Sphere };
+enum class ShapeType { Sphere, Plane, Cube, Cylinder, Cone, TriangleMesh };
+
+namespace ShapeUtil::detail {
+
+/*
+  Converts a world space point to object space with the inverse of the shape
+  transformation, evaluates the normal of the shape there and brings it back
+  to world space
+*/
+template <typename LocalNormal>
+[[nodiscard]] constexpr Tuple inverse_normal_at(
+    const MatrixUtil::Transformation& inverse_transform,
+    const Tuple& world_point, LocalNormal local_normal_at) noexcept {
+  const auto object_point = inverse_transform * world_point;
+  const auto object_normal = local_normal_at(object_point);
+  auto world_normal =
+      MatrixUtil::transpose(inverse_transform) * object_normal;
+  world_normal.w = 0;
+  return TupleUtil::normalize(world_normal);
+}
+
+template <typename LocalNormal>
+[[nodiscard]] constexpr Tuple world_normal_at(
+    const MatrixUtil::Transformation& transform, const Tuple& world_point,
+    LocalNormal local_normal_at) noexcept {
+  return inverse_normal_at(MatrixUtil::inverse(transform), world_point,
+                           local_normal_at);
+}
+
+/*
+  Normal shared by the walls and caps of cylinders and cones. radius_squared
+  is the squared radius of the shape at the height of the point.
+*/
+[[nodiscard]] constexpr Tuple truncated_normal_at(
+    const Tuple& object_point, float minimum, float maximum,
+    float radius_squared, float wall_y) noexcept {
+  using namespace TupleUtil;
+
+  const auto dist = object_point.x * object_point.x +
+                    object_point.z * object_point.z;
+  const bool inside_cap = dist < radius_squared;
+
+  if (inside_cap && object_point.y >= maximum - MathUtil::default_epsilon)
+    return vector(0, 1, 0);
+  if (inside_cap && object_point.y <= minimum + MathUtil::default_epsilon)
+    return vector(0, -1, 0);
+  return vector(object_point.x, wall_y, object_point.z);
+}
+
+}  // namespace ShapeUtil::detail
+
+/*
+  SphereGeometry: center and radius of a sphere in world space, all its
+  intersection test and normal need when it is only translated and scaled
+  uniformly
+*/
+struct SphereGeometry {
+  Tuple center;
+  float radius;
+};
 
 struct Sphere {
   static constexpr ShapeType object_type{ShapeType::Sphere};
   MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
-  Material material{};
+  MaterialId material{0};
+
+  /*
+    Center and radius of the sphere when its transformation is a
+    translation and a uniform scaling, nothing otherwise
+  */
+  [[nodiscard]] constexpr std::optional<SphereGeometry> geometry()
+      const noexcept {
+    const auto scale = transform.at(0, 0);
+    if (scale <= 0) return std::nullopt;
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        if (transform.at(row, col) != (row == col ? scale : 0.f))
+          return std::nullopt;
+      }
+    }
+    if (transform.at(3, 0) != 0 || transform.at(3, 1) != 0 ||
+        transform.at(3, 2) != 0 || transform.at(3, 3) != 1)
+      return std::nullopt;
+    return SphereGeometry{TupleUtil::point(transform.at(0, 3),
+                                           transform.at(1, 3),
+                                           transform.at(2, 3)),
+                          scale};
+  }
+
+  [[nodiscard]] constexpr Tuple local_normal_at(
+      const Tuple& object_point) const noexcept {
+    return object_point - TupleUtil::point(0, 0, 0);
+  }
+
+  [[nodiscard]] constexpr Tuple normal_at(
+      const Tuple& world_point) const noexcept {
+    if (const auto sphere = geometry())
+      return TupleUtil::normalize(world_point - sphere->center);
+    return ShapeUtil::detail::world_normal_at(
+        transform, world_point,
+        [this](const Tuple& p) { return local_normal_at(p); });
+  }
+};
+
+/*
+  Plane: the xz plane in object space
+*/
+struct Plane {
+  static constexpr ShapeType object_type{ShapeType::Plane};
+  MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
+  MaterialId material{0};
+
+  [[nodiscard]] constexpr Tuple local_normal_at(const Tuple&) const noexcept {
+    return TupleUtil::vector(0, 1, 0);
+  }
+
+  [[nodiscard]] constexpr Tuple normal_at(
+      const Tuple& world_point) const noexcept {
+    return ShapeUtil::detail::world_normal_at(
+        transform, world_point,
+        [this](const Tuple& p) { return local_normal_at(p); });
+  }
+};
+
+/*
+  Cube: axis-aligned box spanning [-1, 1] on every axis in object space
+*/
+struct Cube {
+  static constexpr ShapeType object_type{ShapeType::Cube};
+  MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
+  MaterialId material{0};
+
+  [[nodiscard]] constexpr Tuple local_normal_at(
+      const Tuple& object_point) const noexcept {
+    const auto abs_x = std::abs(object_point.x);
+    const auto abs_y = std::abs(object_point.y);
+    const auto abs_z = std::abs(object_point.z);
+    const auto max_c = std::max({abs_x, abs_y, abs_z});
+
+    if (max_c == abs_x) return TupleUtil::vector(object_point.x, 0, 0);
+    if (max_c == abs_y) return TupleUtil::vector(0, object_point.y, 0);
+    return TupleUtil::vector(0, 0, object_point.z);
+  }
+
+  [[nodiscard]] constexpr Tuple normal_at(
+      const Tuple& world_point) const noexcept {
+    return ShapeUtil::detail::world_normal_at(
+        transform, world_point,
+        [this](const Tuple& p) { return local_normal_at(p); });
+  }
+};
+
+/*
+  Truncation: all the intersection test of a cylinder or cone reads besides
+  the ray, so it can be stored apart from the transformation and material of
+  the shape
+*/
+struct Truncation {
+  ShapeType object_type{ShapeType::Cylinder};
+  float minimum{-std::numeric_limits<float>::infinity()};
+  float maximum{std::numeric_limits<float>::infinity()};
+  bool closed{false};
+};
+
+/*
+  Cylinder: radius 1 around the y axis, truncated to (minimum, maximum) and
+  optionally capped at both ends
+*/
+struct Cylinder {
+  static constexpr ShapeType object_type{ShapeType::Cylinder};
+  MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
+  MaterialId material{0};
+  float minimum{-std::numeric_limits<float>::infinity()};
+  float maximum{std::numeric_limits<float>::infinity()};
+  bool closed{false};
+
+  [[nodiscard]] constexpr Truncation truncation() const noexcept {
+    return {object_type, minimum, maximum, closed};
+  }
+
+  [[nodiscard]] constexpr Tuple local_normal_at(
+      const Tuple& object_point) const noexcept {
+    return ShapeUtil::detail::truncated_normal_at(object_point, minimum,
+                                                  maximum, 1.f, 0.f);
+  }
 
   [[nodiscard]] constexpr Tuple normal_at(
       const Tuple& world_point) const noexcept {
-    const auto object_point = MatrixUtil::inverse(transform) * world_point;
-    const auto object_normal = object_point - TupleUtil::point(0, 0, 0);
-    auto world_normal =
-        MatrixUtil::transpose(MatrixUtil::inverse(transform)) * object_normal;
-    world_normal.w = 0;
-    return TupleUtil::normalize(world_normal);
+    return ShapeUtil::detail::world_normal_at(
+        transform, world_point,
+        [this](const Tuple& p) { return local_normal_at(p); });
   }
 };
 
-#endif
\ No newline at end of file
+/*
+  Cone: double-napped cone around the y axis with its apex at the origin,
+  truncated to (minimum, maximum) and optionally capped at both ends
+*/
+struct Cone {
+  static constexpr ShapeType object_type{ShapeType::Cone};
+  MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
+  MaterialId material{0};
+  float minimum{-std::numeric_limits<float>::infinity()};
+  float maximum{std::numeric_limits<float>::infinity()};
+  bool closed{false};
+
+  [[nodiscard]] constexpr Truncation truncation() const noexcept {
+    return {object_type, minimum, maximum, closed};
+  }
+
+  [[nodiscard]] constexpr Tuple local_normal_at(
+      const Tuple& object_point) const noexcept {
+    const auto radius_squared = object_point.y * object_point.y;
+    const auto wall_y = std::sqrt(object_point.x * object_point.x +
+                                  object_point.z * object_point.z);
+    return ShapeUtil::detail::truncated_normal_at(
+        object_point, minimum, maximum, radius_squared,
+        object_point.y > 0 ? -wall_y : wall_y);
+  }
+
+  [[nodiscard]] constexpr Tuple normal_at(
+      const Tuple& world_point) const noexcept {
+    return ShapeUtil::detail::world_normal_at(
+        transform, world_point,
+        [this](const Tuple& p) { return local_normal_at(p); });
+  }
+};
+
+/*
+  TrianglePacket:
+
+  Structure-of-arrays copy of up to Width consecutive triangles of a mesh,
+  indexed as vertex[axis][lane], so the packet intersection kernel can test
+  all lanes with the same instruction stream
+*/
+template <std::size_t Width>
+struct TrianglePacket {
+  using lanes_t = std::array<float, Width>;
+
+  static constexpr std::size_t width = Width;
+  std::array<lanes_t, 3> p0{};
+  std::array<lanes_t, 3> p1{};
+  std::array<lanes_t, 3> p2{};
+  std::size_t first{0};  // Index of the triangle in lane 0
+  std::size_t count{0};  // Number of lanes in use
+};
+
+/*
+  SpherePacket:
+
+  Centers and radii of up to Width spheres given by their SphereGeometry,
+  indexed as center[axis][lane], so one ray can be tested against all of
+  them with the same instruction stream. index holds the position of the
+  sphere of every lane in the container it comes from.
+*/
+template <std::size_t Width>
+struct SpherePacket {
+  using lanes_t = std::array<float, Width>;
+
+  static constexpr std::size_t width = Width;
+  std::array<lanes_t, 3> center{};
+  lanes_t radius{};
+  std::array<std::size_t, Width> index{};
+  std::size_t count{0};  // Number of lanes in use
+};
+
+/*
+  TriangleMesh: indexed triangles stored in flat arrays
+
+  vertices holds x, y, z triplets in object space and indices holds three
+  vertex indices per triangle. packets is an optional SIMD-friendly copy of
+  the triangles built by MeshUtil::pack; when present, intersections go
+  through the packet kernel. The arrays may view those of a scene cache.
+*/
+struct TriangleMesh {
+  static constexpr ShapeType object_type{ShapeType::TriangleMesh};
+  static constexpr std::size_t packet_width{8};
+  MatrixUtil::Transformation transform{MatrixUtil::identity<4>()};
+  MaterialId material{0};
+  FlatArray<float> vertices{};
+  FlatArray<std::uint32_t> indices{};
+  FlatArray<TrianglePacket<packet_width>> packets{};
+
+  [[nodiscard]] constexpr std::size_t vertex_count() const noexcept {
+    return vertices.size() / 3;
+  }
+
+  [[nodiscard]] constexpr std::size_t triangle_count() const noexcept {
+    return indices.size() / 3;
+  }
+
+  [[nodiscard]] constexpr Tuple vertex(std::size_t i) const noexcept {
+    assert(i < vertex_count());
+    return TupleUtil::point(vertices[3 * i], vertices[3 * i + 1],
+                            vertices[3 * i + 2]);
+  }
+
+  [[nodiscard]] constexpr std::array<Tuple, 3> triangle(
+      std::size_t i) const noexcept {
+    assert(i < triangle_count());
+    return {vertex(indices[3 * i]), vertex(indices[3 * i + 1]),
+            vertex(indices[3 * i + 2])};
+  }
+
+  [[nodiscard]] constexpr Tuple local_normal_at(
+      std::size_t triangle_index) const noexcept {
+    const auto [p0, p1, p2] = triangle(triangle_index);
+    return TupleUtil::normalize(TupleUtil::cross(p2 - p0, p1 - p0));
+  }
+
+  [[nodiscard]] constexpr Tuple normal_at(
+      const Tuple& world_point, std::size_t triangle_index) const noexcept {
+    return ShapeUtil::detail::world_normal_at(
+        transform, world_point,
+        [&](const Tuple&) { return local_normal_at(triangle_index); });
+  }
+};
+
+template <class T>
+concept primitive = requires(const T& shape, const Tuple& point) {
+  { T::object_type } -> std::convertible_to<ShapeType>;
+  { shape.transform } -> std::convertible_to<MatrixUtil::Transformation>;
+  { shape.material } -> std::convertible_to<MaterialId>;
+  { shape.normal_at(point) } -> std::same_as<Tuple>;
+};
+
+/*
+  Shape:
+
+  Closed set of every primitive. Dispatch happens through std::visit so the
+  intersection loops never go through a virtual call.
+*/
+using Shape = std::variant<Sphere, Plane, Cube, Cylinder, Cone, TriangleMesh>;
+
+namespace ShapeUtil {
+
+template <primitive T>
+[[nodiscard]] constexpr const MatrixUtil::Transformation& transform(
+    const T& shape) noexcept {
+  return shape.transform;
+}
+
+[[nodiscard]] constexpr const MatrixUtil::Transformation& transform(
+    const Shape& shape) noexcept {
+  return std::visit(
+      [](const auto& s) -> const MatrixUtil::Transformation& {
+        return s.transform;
+      },
+      shape);
+}
+
+[[nodiscard]] constexpr MaterialId material(const Shape& shape) noexcept {
+  return std::visit([](const auto& s) { return s.material; }, shape);
+}
+
+[[nodiscard]] constexpr ShapeType object_type(const Shape& shape) noexcept {
+  return std::visit([](const auto& s) { return s.object_type; }, shape);
+}
+
+/*
+  primitive_index selects the triangle of meshes and is ignored by every other
+  shape
+*/
+[[nodiscard]] constexpr Tuple normal_at(
+    const Shape& shape, const Tuple& world_point,
+    std::size_t primitive_index = 0) noexcept {
+  return std::visit(
+      [&](const auto& s) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(s)>, TriangleMesh>)
+          return s.normal_at(world_point, primitive_index);
+        else
+          return s.normal_at(world_point);
+      },
+      shape);
+}
+
+/*
+  Same as above with the inverse of the shape transformation given, such as
+  World::inverse_transform, instead of computed on every call. Spheres with
+  a SphereGeometry need neither
+*/
+[[nodiscard]] constexpr Tuple normal_at(
+    const Shape& shape, const MatrixUtil::Transformation& inverse_transform,
+    const Tuple& world_point, std::size_t primitive_index = 0) noexcept {
+  return std::visit(
+      [&](const auto& s) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(s)>, Sphere>) {
+          if (const auto sphere = s.geometry())
+            return TupleUtil::normalize(world_point - sphere->center);
+        }
+        return detail::inverse_normal_at(
+            inverse_transform, world_point, [&](const Tuple& object_point) {
+              if constexpr (std::is_same_v<std::decay_t<decltype(s)>,
+                                           TriangleMesh>)
+                return s.local_normal_at(primitive_index);
+              else
+                return s.local_normal_at(object_point);
+            });
+      },
+      shape);
+}
+
+}  // namespace ShapeUtil
+
+namespace MeshUtil {
+
+/*
+  Builds the SIMD layout of the mesh triangles. Unused lanes of the last
+  packet are left zeroed and masked out by TrianglePacket::count.
+*/
+[[nodiscard]] constexpr auto pack(const TriangleMesh& mesh)
+    -> std::vector<TrianglePacket<TriangleMesh::packet_width>> {
+  constexpr auto width = TriangleMesh::packet_width;
+
+  std::vector<TrianglePacket<width>> packets;
+  packets.reserve((mesh.triangle_count() + width - 1) / width);
+
+  for (std::size_t first = 0; first < mesh.triangle_count(); first += width) {
+    TrianglePacket<width> packet;
+    packet.first = first;
+    packet.count = std::min(width, mesh.triangle_count() - first);
+
+    for (std::size_t lane = 0; lane < packet.count; ++lane) {
+      const auto [p0, p1, p2] = mesh.triangle(first + lane);
+      packet.p0[0][lane] = p0.x;
+      packet.p0[1][lane] = p0.y;
+      packet.p0[2][lane] = p0.z;
+      packet.p1[0][lane] = p1.x;
+      packet.p1[1][lane] = p1.y;
+      packet.p1[2][lane] = p1.z;
+      packet.p2[0][lane] = p2.x;
+      packet.p2[1][lane] = p2.y;
+      packet.p2[2][lane] = p2.z;
+    }
+
+    packets.push_back(packet);
+  }
+
+  return packets;
+}
+
+/*
+  Whether the arrays of the mesh, read from a file, describe whole triangles
+  whose indices and packets stay inside the mesh
+*/
+[[nodiscard]] constexpr bool valid(const TriangleMesh& mesh) noexcept {
+  const auto vertex_count = mesh.vertex_count();
+  const auto triangle_count = mesh.triangle_count();
+  return mesh.vertices.size() % 3 == 0 && mesh.indices.size() % 3 == 0 &&
+         std::all_of(mesh.indices.begin(), mesh.indices.end(),
+                     [vertex_count](std::uint32_t index) {
+                       return index < vertex_count;
+                     }) &&
+         std::all_of(mesh.packets.begin(), mesh.packets.end(),
+                     [triangle_count](const auto& packet) {
+                       return packet.count <= TriangleMesh::packet_width &&
+                              packet.first <= triangle_count &&
+                              packet.count <= triangle_count - packet.first;
+                     });
+}
+
+}  // namespace MeshUtil
+
+#endif
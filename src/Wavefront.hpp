@@ -0,0 +1,358 @@
+#ifndef CONSTEXPR_RAYTRACER_WAVEFRONT_HPP
+#define CONSTEXPR_RAYTRACER_WAVEFRONT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Camera.hpp"
+#include "Color.hpp"
+#include "Ray.hpp"
+#include "Sampling.hpp"
+#include "Shading.hpp"
+#include "Shape.hpp"
+#include "Tuple.hpp"
+#include "World.hpp"
+
+/*
+  Wavefront ray scheduling
+
+  Depth-first shading follows every camera ray through all of its
+  reflections and refractions before starting the next one, so consecutive
+  intersection tests jump between unrelated rays. The wavefront scheduler
+  advances all the rays of a batch of pixels one bounce at a time:
+
+  1. the rays of the bounce are sorted by the octant of their direction
+  2. they are intersected shape by shape, so the type of a shape is
+     dispatched and its transformation loaded once per bounce rather than
+     once per ray, and meshes run their triangle packets ray after ray
+  3. the hits are sorted by shape and their shadow rays intersected the
+     same way as one more batch, where a ray stops being tested once a
+     shape blocks it
+  4. every hit is lit with ShadingUtil::lighting, its color added to its
+     pixel with the weight of its path, and its reflected and refracted
+     rays are queued for the next bounce
+
+  Colors and ray counts equal those of WorldUtil::color_at up to the order
+  in which floating point terms are summed.
+*/
+
+/*
+  RayScheduling: order in which the rays of an image are traced
+
+  DepthFirst: every camera ray and all the rays it spawns before the next
+  Wavefront: the rays of a tile one bounce at a time, see above
+*/
+enum class RayScheduling { DepthFirst, Wavefront };
+
+/*
+  PixelRequest: samples wanted for a pixel, numbered from first_sample
+*/
+struct PixelRequest {
+  int x;
+  int y;
+  int first_sample;
+};
+
+namespace WavefrontUtil {
+
+namespace detail {
+
+struct QueuedRay {
+  Ray ray;
+  float weight;
+  std::uint32_t pixel;
+};
+
+struct QueuedHit {
+  std::uint32_t ray;
+  Intersection intersection;
+};
+
+[[nodiscard]] constexpr std::size_t octant(const Tuple& direction) noexcept {
+  return (direction.x < 0 ? 1u : 0u) | (direction.y < 0 ? 2u : 0u) |
+         (direction.z < 0 ? 4u : 0u);
+}
+
+/*
+  Stable counting sort of items by key(item), which must be below buckets
+*/
+template <typename T, typename Key>
+void sort_by_key(std::vector<T>& items, std::vector<T>& scratch,
+                 std::size_t buckets, const Key& key) {
+  std::vector<std::size_t> offsets(buckets + 1, 0);
+  for (const auto& item : items) ++offsets[key(item) + 1];
+  for (std::size_t bucket = 1; bucket <= buckets; ++bucket)
+    offsets[bucket] += offsets[bucket - 1];
+
+  // Ray and Intersection are not default constructible, so the scratch
+  // buffer starts as a copy that is then overwritten in order
+  scratch = items;
+  for (const auto& item : items) scratch[offsets[key(item)]++] = item;
+  items.swap(scratch);
+}
+
+// Packets of a mesh tested against every ray of a batch before moving on,
+// 16 KiB of triangles with the default packet width
+inline constexpr std::size_t packets_per_block = 56;
+
+/*
+  Adds the intersections of the shape with every ray r for which skip(r) is
+  false to hits[r]. Meshes go through the packet kernel a block of packets at
+  a time, so the block stays in the L1 cache while the rays stream past it;
+  every ray still meets the triangles in mesh order
+*/
+template <typename T, typename Skip>
+void intersect_batch(const T& shape,
+                     const MatrixUtil::Transformation& inverse,
+                     std::span<const Ray> rays,
+                     std::span<RayUtil::NearestHit> hits, const Skip& skip) {
+  if constexpr (std::is_same_v<T, TriangleMesh>) {
+    if (!shape.packets.empty()) {
+      std::vector<std::pair<std::size_t, RayUtil::detail::WatertightRay>>
+          local_rays;
+      for (std::size_t r = 0; r < rays.size(); ++r) {
+        if (!skip(r))
+          local_rays.emplace_back(r, RayUtil::detail::watertight_ray(
+                                         RayUtil::transform(rays[r], inverse)));
+      }
+
+      const auto& packets = shape.packets;
+      for (std::size_t block = 0; block < packets.size();
+           block += packets_per_block) {
+        const auto end = std::min(block + packets_per_block, packets.size());
+        for (const auto& [r, ray] : local_rays) {
+          for (std::size_t p = block; p < end; ++p) {
+            const auto ts = RayUtil::intersect_triangles(ray, packets[p]);
+            for (std::size_t lane = 0; lane < packets[p].count; ++lane) {
+              if (ts[lane] == std::numeric_limits<float>::infinity())
+                continue;
+              hits[r].push_back(Intersection(ts[lane],
+                                             ShapeType::TriangleMesh, 0,
+                                             packets[p].first + lane));
+            }
+          }
+        }
+      }
+      return;
+    }
+  }
+
+  for (std::size_t r = 0; r < rays.size(); ++r) {
+    if (!skip(r))
+      RayUtil::local_intersect(RayUtil::transform(rays[r], inverse), shape,
+                               hits[r]);
+  }
+}
+
+/*
+  Adds the nearest intersection of every ray r for which skip(r) is false
+  with each sphere of the packet to hits[r]
+*/
+template <std::size_t Width, typename Skip>
+void intersect_batch(const SpherePacket<Width>& packet,
+                     std::span<const Ray> rays,
+                     std::span<RayUtil::NearestHit> hits, const Skip& skip) {
+  for (std::size_t r = 0; r < rays.size(); ++r) {
+    if (skip(r)) continue;
+    const auto ts = RayUtil::intersect_spheres(rays[r], packet);
+    for (std::size_t lane = 0; lane < packet.count; ++lane) {
+      if (ts[lane] == std::numeric_limits<float>::infinity()) continue;
+      hits[r].index = packet.index[lane];
+      hits[r].push_back(Intersection(ts[lane], ShapeType::Sphere));
+    }
+  }
+}
+
+/*
+  Nearest hit of every ray, like WorldUtil::hit, with the loops over shapes
+  and rays swapped
+*/
+inline void nearest_hits(const World& world, std::span<const Ray> rays,
+                         std::vector<RayUtil::NearestHit>& hits) {
+  const auto none = [](std::size_t) { return false; };
+  hits.assign(rays.size(), RayUtil::NearestHit{});
+  for (const auto i : world.transformed_shapes()) {
+    for (auto& hit : hits) hit.index = i;
+    WorldUtil::visit_intersectable(world, i, [&](const auto& shape) {
+      intersect_batch(shape, world.inverse_transform(i), rays, hits, none);
+    });
+  }
+  for (const auto& packet : world.sphere_packets())
+    intersect_batch(packet, rays, hits, none);
+  if (!world.instances().empty()) {
+    for (std::size_t r = 0; r < rays.size(); ++r)
+      WorldUtil::intersect_instances(world, rays[r], hits[r]);
+  }
+}
+
+/*
+  Marks the rays blocked by a shape closer than the distance of their light.
+  Blocked rays skip the remaining shapes
+*/
+inline void blocked_rays(const World& world, std::span<const Ray> rays,
+                         std::span<const float> distances,
+                         std::vector<bool>& blocked) {
+  blocked.assign(rays.size(), false);
+  std::vector<RayUtil::NearestHit> hits;
+  const auto is_blocked = [&](std::size_t r) { return blocked[r]; };
+  const auto mark_blocked = [&] {
+    for (std::size_t r = 0; r < rays.size(); ++r) {
+      if (hits[r].hit && hits[r].hit->t() < distances[r]) blocked[r] = true;
+    }
+  };
+  for (const auto i : world.transformed_shapes()) {
+    hits.assign(rays.size(), RayUtil::NearestHit{});
+    WorldUtil::visit_intersectable(world, i, [&](const auto& shape) {
+      intersect_batch(shape, world.inverse_transform(i), rays, hits,
+                      is_blocked);
+    });
+    mark_blocked();
+  }
+  for (const auto& packet : world.sphere_packets()) {
+    hits.assign(rays.size(), RayUtil::NearestHit{});
+    intersect_batch(packet, rays, hits, is_blocked);
+    mark_blocked();
+  }
+  if (!world.instances().empty()) {
+    hits.assign(rays.size(), RayUtil::NearestHit{});
+    for (std::size_t r = 0; r < rays.size(); ++r) {
+      if (!blocked[r])
+        WorldUtil::intersect_instances(world, rays[r], hits[r]);
+    }
+    mark_blocked();
+  }
+}
+
+/*
+  Buffers of a wave, kept by every thread from one batch to the next
+*/
+struct Workspace {
+  std::vector<QueuedRay> queue;
+  std::vector<QueuedRay> next;
+  std::vector<QueuedRay> queue_scratch;
+  std::vector<Ray> rays;
+  std::vector<RayUtil::NearestHit> hits;
+  std::vector<QueuedHit> hit_queue;
+  std::vector<QueuedHit> hit_scratch;
+  std::vector<Computations> comps;
+  std::vector<Ray> shadow_rays;
+  std::vector<float> light_distances;
+  std::vector<bool> in_shadow;
+  std::vector<Color> sums;
+};
+
+}  // namespace detail
+
+/*
+  Traces `samples` stratified samples through every requested pixel in
+  wavefront order and stores the average color of pixels[i] in colors[i].
+  The rays cast are added to counters when given
+*/
+inline void render_pixels(const Camera& camera, const World& world,
+                          std::span<const PixelRequest> pixels, int samples,
+                          std::uint32_t seed, const TraceLimits& limits,
+                          Color* colors, RayCounters* counters = nullptr) {
+  using namespace detail;
+
+  thread_local Workspace workspace;
+  auto& [queue, next, queue_scratch, rays, hits, hit_queue, hit_scratch,
+         comps, shadow_rays, light_distances, in_shadow, sums] = workspace;
+
+  sums.assign(pixels.size(), ColorUtil::black());
+  queue.clear();
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    const auto& pixel = pixels[i];
+    for (int sample = 0; sample < samples; ++sample) {
+      const auto [dx, dy] = SamplingUtil::stratified_sample(
+          pixel.x, pixel.y, sample, samples, pixel.first_sample, seed);
+      queue.push_back(
+          QueuedRay{CameraUtil::ray_for_pixel(camera, pixel.x, pixel.y, dx, dy),
+                    1.f, static_cast<std::uint32_t>(i)});
+    }
+  }
+  if (counters != nullptr) counters->primary += queue.size();
+
+  const auto& lights = world.lights();
+
+  for (int depth = 0; !queue.empty(); ++depth) {
+    sort_by_key(queue, queue_scratch, 8, [](const QueuedRay& queued) {
+      return octant(queued.ray.direction);
+    });
+    rays.clear();
+    for (const auto& queued : queue) rays.push_back(queued.ray);
+    nearest_hits(world, rays, hits);
+
+    hit_queue.clear();
+    for (std::size_t r = 0; r < hits.size(); ++r) {
+      if (hits[r].hit)
+        hit_queue.push_back(QueuedHit{static_cast<std::uint32_t>(r),
+                                      *hits[r].hit});
+    }
+    sort_by_key(hit_queue, hit_scratch,
+                world.size() + world.instances().size(),
+                [](const QueuedHit& hit) { return hit.intersection.index(); });
+
+    comps.clear();
+    shadow_rays.clear();
+    light_distances.clear();
+    for (const auto& hit : hit_queue) {
+      comps.push_back(WorldUtil::prepare_computations(hit.intersection,
+                                                      rays[hit.ray], world));
+      for (const auto& light : lights) {
+        const auto to_light = light.position - comps.back().over_point;
+        light_distances.push_back(TupleUtil::magnitude(to_light));
+        shadow_rays.push_back(
+            Ray{comps.back().over_point, TupleUtil::normalize(to_light)});
+      }
+    }
+    if (counters != nullptr) counters->shadow += shadow_rays.size();
+    blocked_rays(world, shadow_rays, light_distances, in_shadow);
+
+    next.clear();
+    for (std::size_t h = 0; h < hit_queue.size(); ++h) {
+      const auto& hit_comps = comps[h];
+      const auto& queued = queue[hit_queue[h].ray];
+      const auto& material = world.object_material(hit_comps.object);
+
+      Color surface = ColorUtil::black();
+      for (std::size_t l = 0; l < lights.size(); ++l) {
+        surface += ShadingUtil::lighting(
+            material, lights[l], hit_comps.over_point, hit_comps.eye_vector,
+            hit_comps.normal_vector, in_shadow[h * lights.size() + l]);
+      }
+      sums[queued.pixel] += surface * queued.weight;
+
+      const RayPath path{depth, queued.weight};
+      const auto [reflective, transparency] =
+          WorldUtil::secondary_factors(material, hit_comps);
+      if (WorldUtil::casts_secondary(limits, path, reflective)) {
+        if (counters != nullptr) ++counters->reflection;
+        next.push_back(
+            QueuedRay{Ray{hit_comps.over_point, hit_comps.reflect_vector},
+                      queued.weight * reflective, queued.pixel});
+      }
+      if (WorldUtil::casts_secondary(limits, path, transparency)) {
+        if (const auto direction = WorldUtil::refracted_direction(hit_comps)) {
+          if (counters != nullptr) ++counters->refraction;
+          next.push_back(QueuedRay{Ray{hit_comps.under_point, *direction},
+                                   queued.weight * transparency,
+                                   queued.pixel});
+        }
+      }
+    }
+    queue.swap(next);
+  }
+
+  for (std::size_t i = 0; i < pixels.size(); ++i)
+    colors[i] = sums[i] / static_cast<float>(samples);
+}
+
+}  // namespace WavefrontUtil
+
+#endif
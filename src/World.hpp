@@ -0,0 +1,810 @@
+#ifndef CONSTEXPR_RAYTRACER_WORLD_HPP
+#define CONSTEXPR_RAYTRACER_WORLD_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Bvh.hpp"
+#include "Color.hpp"
+#include "Instance.hpp"
+#include "MatrixTransformations.hpp"
+#include "Ray.hpp"
+#include "Shading.hpp"
+#include "Shape.hpp"
+#include "Tuple.hpp"
+
+/*
+  World:
+
+  Every shape, material and light of a scene. Shapes refer to their material
+  by its index in the material table, which starts with the default material
+  and holds every other material once.
+
+  Intersection tests only read hot arrays holding, for every shape, its type,
+  the inverse of its transformation, computed once when the shape is added,
+  and the truncation of cylinders and cones. The shapes themselves, with the
+  transformation and material that only shading needs, stay in cold arrays
+  the intersection loops never touch, except for the triangles of meshes.
+
+  Spheres that are only translated and scaled uniformly skip the matrix
+  altogether: their centers and radii are packed in sphere_packets(), whose
+  lanes are tested against a ray at once. The other shapes, listed by
+  transformed_shapes(), are tested in object space.
+
+  Geometry repeated many times is added once as a Prototype, each with its
+  own bounding volume hierarchy, and placed by instances holding a
+  transformation and its cached inverse. A second hierarchy over the boxes
+  of the instances, rebuilt by build_instance_bvh(), leads rays to the
+  instances they may hit, so memory grows with the unique geometry and
+  moving instances only touches that top level. Animations move instances
+  with set_transform() and call update_instance_bvh() once per frame,
+  which refits the boxes of the hierarchy in place and builds it again
+  only when it has degraded. Hits refer to shapes by
+  their position in objects() and to instances by size() plus their
+  position in instances().
+*/
+
+class World {
+ public:
+  using size_type = std::vector<Shape>::size_type;
+
+  static constexpr std::size_t sphere_packet_width{8};
+
+  constexpr void add(Shape shape) {
+    auto inverse_transform = MatrixUtil::inverse(ShapeUtil::transform(shape));
+    add(std::move(shape), std::move(inverse_transform));
+  }
+
+  /*
+    Adds a shape whose inverse transformation is already known, such as one
+    read from a scene cache
+  */
+  constexpr void add(Shape shape,
+                     MatrixUtil::Transformation inverse_transform) {
+    assert(ShapeUtil::material(shape) < materials_.size());
+    const auto* sphere = std::get_if<Sphere>(&shape);
+    if (const auto geometry = sphere ? sphere->geometry() : std::nullopt)
+      add_to_packet(*geometry);
+    else
+      transformed_.push_back(objects_.size());
+    types_.push_back(ShapeUtil::object_type(shape));
+    inverse_transforms_.push_back(std::move(inverse_transform));
+    truncations_.push_back(std::visit(
+        [](const auto& s) {
+          if constexpr (requires { s.truncation(); })
+            return s.truncation();
+          else
+            return Truncation{s.object_type};
+        },
+        shape));
+    material_ids_.push_back(ShapeUtil::material(shape));
+    objects_.push_back(std::move(shape));
+  }
+
+  constexpr void add(PointLight light) { lights_.push_back(std::move(light)); }
+
+  constexpr PrototypeId add(Prototype prototype) {
+    prototypes_.push_back(std::move(prototype));
+    return static_cast<PrototypeId>(prototypes_.size() - 1);
+  }
+
+  /*
+    Adds an instance of a prototype already in the world. The hierarchy over
+    the instances must be rebuilt afterwards; until then they are all
+    tested one by one
+  */
+  constexpr void add(Instance instance) {
+    auto inverse_transform = MatrixUtil::inverse(instance.transform);
+    add(std::move(instance), std::move(inverse_transform));
+  }
+
+  /*
+    Adds an instance whose inverse transformation is already known
+  */
+  constexpr void add(Instance instance,
+                     MatrixUtil::Transformation inverse_transform) {
+    assert(instance.prototype < prototypes_.size());
+    assert(!BoundsUtil::empty(prototypes_[instance.prototype].bounds()));
+    assert(instance.material < materials_.size());
+    instance_inverse_transforms_.push_back(std::move(inverse_transform));
+    instance_bounds_.push_back(BoundsUtil::transform(
+        prototypes_[instance.prototype].bounds(), instance.transform));
+    instances_.push_back(std::move(instance));
+    instance_bvh_current_ = false;
+  }
+
+  /*
+    Moves the i-th instance, which leaves the prototypes untouched. The
+    hierarchy over the instances must be updated afterwards
+  */
+  constexpr void set_transform(size_type i,
+                               MatrixUtil::Transformation transform) {
+    instance_inverse_transforms_[i] = MatrixUtil::inverse(transform);
+    instance_bounds_[i] = BoundsUtil::transform(
+        prototypes_[instances_[i].prototype].bounds(), transform);
+    instances_[i].transform = std::move(transform);
+    instance_bvh_current_ = false;
+  }
+
+  /*
+    Builds the hierarchy over the boxes of the instances with the builder
+    and number of threads of the settings
+  */
+  constexpr void build_instance_bvh(const BvhSettings& settings = {}) {
+    instance_bvh_ = BvhUtil::build(instance_bounds_, settings);
+    instance_bvh_current_ = true;
+  }
+
+  /*
+    Uses a hierarchy built earlier over the boxes of the instances, such as
+    one read from a scene cache, instead of building it again
+  */
+  constexpr void set_instance_bvh(Bvh bvh) {
+    assert(bvh.items.size() == instances_.size());
+    instance_bvh_ = std::move(bvh);
+    instance_bvh_current_ = true;
+  }
+
+  /*
+    Brings the hierarchy over the instances up to date after instances were
+    moved or added, refitting it when that keeps it good enough. Returns
+    true when it was built again
+  */
+  constexpr bool update_instance_bvh() {
+    if (instance_bvh_current_) return false;
+    instance_bvh_current_ = true;
+    return BvhUtil::update(instance_bvh_, instance_bounds_);
+  }
+
+  /*
+    Adds the material to the table unless an equal one is already there, and
+    returns its index for the shapes that use it
+  */
+  constexpr MaterialId add(const Material& material) {
+    const auto found =
+        std::find(materials_.begin(), materials_.end(), material);
+    if (found == materials_.end()) {
+      materials_.push_back(material);
+      return static_cast<MaterialId>(materials_.size() - 1);
+    }
+    return static_cast<MaterialId>(std::distance(materials_.begin(), found));
+  }
+
+  [[nodiscard]] constexpr const std::vector<Shape>& objects() const noexcept {
+    return objects_;
+  }
+
+  [[nodiscard]] constexpr const std::vector<PointLight>& lights()
+      const noexcept {
+    return lights_;
+  }
+
+  [[nodiscard]] constexpr const std::vector<Material>& materials()
+      const noexcept {
+    return materials_;
+  }
+
+  [[nodiscard]] constexpr const Material& material(
+      MaterialId id) const noexcept {
+    return materials_[id];
+  }
+
+  /*
+    Material of the i-th shape or, past the shapes, of the instance
+    i - size()
+  */
+  [[nodiscard]] constexpr const Material& object_material(
+      size_type i) const noexcept {
+    if (i >= objects_.size())
+      return materials_[instances_[i - objects_.size()].material];
+    return materials_[material_ids_[i]];
+  }
+
+  [[nodiscard]] constexpr ShapeType type(size_type i) const noexcept {
+    return types_[i];
+  }
+
+  [[nodiscard]] constexpr const MatrixUtil::Transformation& inverse_transform(
+      size_type i) const noexcept {
+    return inverse_transforms_[i];
+  }
+
+  /*
+    Truncation of the i-th shape when it is a cylinder or cone
+  */
+  [[nodiscard]] constexpr const Truncation& truncation(
+      size_type i) const noexcept {
+    return truncations_[i];
+  }
+
+  /*
+    Shapes tested in object space through their inverse transformation
+  */
+  [[nodiscard]] constexpr const std::vector<size_type>& transformed_shapes()
+      const noexcept {
+    return transformed_;
+  }
+
+  [[nodiscard]] constexpr const std::vector<
+      SpherePacket<sphere_packet_width>>&
+  sphere_packets() const noexcept {
+    return sphere_packets_;
+  }
+
+  [[nodiscard]] constexpr const std::vector<Prototype>& prototypes()
+      const noexcept {
+    return prototypes_;
+  }
+
+  [[nodiscard]] constexpr const std::vector<Instance>& instances()
+      const noexcept {
+    return instances_;
+  }
+
+  [[nodiscard]] constexpr const MatrixUtil::Transformation&
+  instance_inverse_transform(size_type i) const noexcept {
+    return instance_inverse_transforms_[i];
+  }
+
+  [[nodiscard]] constexpr const std::vector<Bounds>& instance_bounds()
+      const noexcept {
+    return instance_bounds_;
+  }
+
+  /*
+    Hierarchy over the instances, nothing when instances were added or moved
+    since it was last built or updated
+  */
+  [[nodiscard]] constexpr const Bvh* instance_bvh() const noexcept {
+    return instance_bvh_current_ ? &instance_bvh_ : nullptr;
+  }
+
+  /*
+    Number of shapes, not counting instances
+  */
+  [[nodiscard]] constexpr size_type size() const noexcept {
+    return objects_.size();
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return objects_.empty();
+  }
+
+ private:
+  constexpr void add_to_packet(const SphereGeometry& sphere) {
+    if (sphere_packets_.empty() ||
+        sphere_packets_.back().count == sphere_packet_width)
+      sphere_packets_.emplace_back();
+    auto& packet = sphere_packets_.back();
+    const auto lane = packet.count++;
+    packet.center[0][lane] = sphere.center.x;
+    packet.center[1][lane] = sphere.center.y;
+    packet.center[2][lane] = sphere.center.z;
+    packet.radius[lane] = sphere.radius;
+    packet.index[lane] = objects_.size();
+  }
+
+  // Hot: read by every intersection test
+  std::vector<size_type> transformed_{};
+  std::vector<SpherePacket<sphere_packet_width>> sphere_packets_{};
+  std::vector<ShapeType> types_{};
+  std::vector<MatrixUtil::Transformation> inverse_transforms_{};
+  std::vector<Truncation> truncations_{};
+  std::vector<Prototype> prototypes_{};
+  std::vector<MatrixUtil::Transformation> instance_inverse_transforms_{};
+  std::vector<Bounds> instance_bounds_{};
+  Bvh instance_bvh_{};
+  bool instance_bvh_current_{true};
+
+  // Cold: read to shade hits
+  std::vector<Instance> instances_{};
+  std::vector<Shape> objects_{};
+  std::vector<MaterialId> material_ids_{};
+  std::vector<PointLight> lights_{};
+  std::vector<Material> materials_{Material{}};
+};
+
+/*
+  Computations:
+
+  Everything shading needs to know about a hit. over_point is nudged along the
+  normal so shadow and reflected rays do not intersect the surface they start
+  from, and under_point the other way for refracted rays. n1 and n2 are the
+  refractive indices on the side the ray comes from and on the other side.
+*/
+struct Computations {
+  float t;
+  std::size_t object;
+  std::size_t primitive;
+  Tuple point;
+  Tuple over_point;
+  Tuple under_point;
+  Tuple eye_vector;
+  Tuple normal_vector;
+  Tuple reflect_vector;
+  bool inside;
+  float n1;
+  float n2;
+};
+
+/*
+  TraceLimits: bounds on the rays spawned by reflective and transparent
+  materials, so mirrors facing each other or nested glass cannot multiply
+  the rays of a pixel without end
+
+  max_depth: reflection and refraction bounces after the primary ray
+  min_contribution: rays whose weight in the pixel color, the product of the
+  reflective and transparent factors along their path, would fall below
+  this are not cast
+*/
+struct TraceLimits {
+  int max_depth{5};
+  float min_contribution{0.001f};
+};
+
+/*
+  RayPath: bounces that led to a ray and the weight of its color in the
+  pixel
+*/
+struct RayPath {
+  int depth{0};
+  float weight{1.f};
+};
+
+/*
+  RayCounters: rays cast while computing colors, by kind
+*/
+struct RayCounters {
+  std::uint64_t primary{0};
+  std::uint64_t reflection{0};
+  std::uint64_t refraction{0};
+  std::uint64_t shadow{0};
+
+  [[nodiscard]] constexpr std::uint64_t secondary() const noexcept {
+    return reflection + refraction;
+  }
+
+  constexpr RayCounters& operator+=(const RayCounters& rhs) noexcept {
+    primary += rhs.primary;
+    reflection += rhs.reflection;
+    refraction += rhs.refraction;
+    shadow += rhs.shadow;
+    return *this;
+  }
+
+  [[nodiscard]] friend constexpr bool operator==(
+      const RayCounters&, const RayCounters&) noexcept = default;
+};
+
+namespace WorldUtil {
+
+namespace detail {
+
+inline constexpr Sphere unit_sphere{};
+inline constexpr Plane xz_plane{};
+inline constexpr Cube unit_cube{};
+
+/*
+  Normal at a point of the shape or instance that was hit
+*/
+[[nodiscard]] constexpr Tuple normal_at(const World& world,
+                                        const Intersection& intersection,
+                                        const Tuple& point) noexcept {
+  const auto index = intersection.index();
+  if (index < world.size()) {
+    return ShapeUtil::normal_at(world.objects()[index],
+                                world.inverse_transform(index), point,
+                                intersection.primitive());
+  }
+
+  const auto instance = index - world.size();
+  const auto& prototype =
+      world.prototypes()[world.instances()[instance].prototype];
+  return ShapeUtil::detail::inverse_normal_at(
+      world.instance_inverse_transform(instance), point,
+      [&](const Tuple& prototype_point) {
+        return prototype.normal_at(prototype_point, intersection.primitive());
+      });
+}
+
+}  // namespace detail
+
+/*
+  Calls f with what the intersection test of the i-th shape reads, taken
+  from the hot arrays of the world: a default shape of the right type for
+  spheres, planes and cubes, whose tests depend on nothing else, the
+  truncation of cylinders and cones, and the mesh itself
+*/
+template <typename F>
+constexpr void visit_intersectable(const World& world, std::size_t i,
+                                   F&& f) {
+  switch (world.type(i)) {
+    case ShapeType::Sphere:
+      f(detail::unit_sphere);
+      return;
+    case ShapeType::Plane:
+      f(detail::xz_plane);
+      return;
+    case ShapeType::Cube:
+      f(detail::unit_cube);
+      return;
+    case ShapeType::Cylinder:
+    case ShapeType::Cone:
+      f(world.truncation(i));
+      return;
+    case ShapeType::TriangleMesh:
+      f(std::get<TriangleMesh>(world.objects()[i]));
+      return;
+  }
+}
+
+/*
+  Adds the intersections of the ray with the instances of the world to
+  xs, a NearestHit or AllHits, going through the hierarchy over the
+  instances when it is up to date and through the hierarchy of each
+  prototype reached
+*/
+template <typename IntersectionList>
+constexpr void intersect_instances(const World& world, const Ray& ray,
+                                   IntersectionList& xs) {
+  const auto test = [&](std::uint32_t i, IntersectionList& found) {
+    found.index = world.size() + i;
+    RayUtil::local_intersect(
+        RayUtil::transform(ray, world.instance_inverse_transform(i)),
+        world.prototypes()[world.instances()[i].prototype], found);
+  };
+
+  if (const auto* bvh = world.instance_bvh()) {
+    BvhUtil::traverse(*bvh, ray, xs, test);
+    return;
+  }
+  for (std::size_t i = 0; i < world.instances().size(); ++i)
+    test(static_cast<std::uint32_t>(i), xs);
+}
+
+/*
+  Closest non-negative intersection of the ray with the world, with
+  Intersection::index() referring to World::objects() or, past its size, to
+  World::instances()
+*/
+[[nodiscard]] constexpr std::optional<Intersection> hit(const World& world,
+                                                        const Ray& ray) {
+  RayUtil::NearestHit nearest;
+  for (const auto i : world.transformed_shapes()) {
+    nearest.index = i;
+    const auto local_ray = RayUtil::transform(ray, world.inverse_transform(i));
+    visit_intersectable(world, i, [&](const auto& shape) {
+      RayUtil::local_intersect(local_ray, shape, nearest);
+    });
+  }
+  for (const auto& packet : world.sphere_packets()) {
+    const auto ts = RayUtil::intersect_spheres(ray, packet);
+    for (std::size_t lane = 0; lane < packet.count; ++lane) {
+      if (ts[lane] == std::numeric_limits<float>::infinity()) continue;
+      nearest.index = packet.index[lane];
+      nearest.push_back(Intersection(ts[lane], ShapeType::Sphere));
+    }
+  }
+  intersect_instances(world, ray, nearest);
+  return nearest.hit;
+}
+
+namespace detail {
+
+/*
+  Objects that enclose the point where the ray hits, innermost first: the
+  book's containers list, taken from the crossings behind the hit rather
+  than from a sorted list of every intersection, which hit() never builds.
+  The ray is followed back from the hit through every shape and instance;
+  an object crossed an odd number of times there is one the ray is inside
+  of, and the nearer its last crossing, the later the ray entered it. The
+  crossing of the hit surface itself is left out.
+*/
+[[nodiscard]] constexpr std::vector<std::size_t> containers(
+    const World& world, const Intersection& intersection, const Tuple& point,
+    const Tuple& direction) {
+  const Ray back{point, -direction};
+  RayUtil::AllHits behind;
+  for (std::size_t i = 0; i < world.size(); ++i) {
+    behind.index = i;
+    const auto local_ray = RayUtil::transform(back, world.inverse_transform(i));
+    visit_intersectable(world, i, [&](const auto& shape) {
+      RayUtil::local_intersect(local_ray, shape, behind);
+    });
+  }
+  intersect_instances(world, back, behind);
+  std::sort(behind.hits.begin(), behind.hits.end(),
+            [](const Intersection& lhs, const Intersection& rhs) {
+              return lhs.t() < rhs.t();
+            });
+
+  struct Crossings {
+    std::size_t index;
+    std::size_t count;
+  };
+  std::vector<Crossings> objects;
+  for (const auto& crossing : behind.hits) {
+    if (crossing.index() == intersection.index() &&
+        crossing.t() < MathUtil::default_epsilon)
+      continue;
+    const auto object = std::find_if(
+        objects.begin(), objects.end(),
+        [&](const Crossings& o) { return o.index == crossing.index(); });
+    if (object == objects.end())
+      objects.push_back({crossing.index(), 1});
+    else
+      ++object->count;
+  }
+
+  std::vector<std::size_t> result;
+  for (const auto& object : objects)
+    if (object.count % 2 == 1) result.push_back(object.index);
+  return result;
+}
+
+/*
+  Refractive indices on the side the ray comes from and on the other side
+  of the hit: those of the innermost enclosing object before and after the
+  ray enters or leaves the object hit, the air's outside every object
+*/
+[[nodiscard]] constexpr std::pair<float, float> refractive_indices(
+    const World& world, const Intersection& intersection, const Tuple& point,
+    const Tuple& direction) {
+  const auto index_of = [&](const std::vector<std::size_t>& objects) {
+    return objects.empty() ? 1.f
+                           : world.object_material(objects[0]).refractive_index;
+  };
+
+  auto enclosing = containers(world, intersection, point, direction);
+  const auto n1 = index_of(enclosing);
+  const auto hit = std::find(enclosing.begin(), enclosing.end(),
+                             intersection.index());
+  if (hit == enclosing.end())
+    return {n1, world.object_material(intersection.index()).refractive_index};
+  enclosing.erase(hit);
+  return {n1, index_of(enclosing)};
+}
+
+}  // namespace detail
+
+/*
+  n1 and n2 come from the objects enclosing the hit, so transparent objects
+  may touch or nest, like a bubble in glass or a liquid in a glass. Finding
+  them follows the ray back through the whole world, which is only worth it
+  for transparent materials: for the others n1 and n2 feed nothing, and
+  are taken as if the object hit were in the air.
+*/
+[[nodiscard]] constexpr Computations prepare_computations(
+    const Intersection& intersection, const Ray& ray, const World& world) {
+  using namespace TupleUtil;
+
+  const auto point = RayUtil::position(ray, intersection.t());
+  const auto eye_vector = -ray.direction;
+  auto normal_vector = detail::normal_at(world, intersection, point);
+
+  const bool inside = dot(normal_vector, eye_vector) < 0;
+  if (inside) normal_vector = -normal_vector;
+
+  const auto& material = world.object_material(intersection.index());
+  const auto [n1, n2] =
+      material.transparency > 0.f
+          ? detail::refractive_indices(world, intersection, point,
+                                       ray.direction)
+          : std::pair{inside ? material.refractive_index : 1.f,
+                      inside ? 1.f : material.refractive_index};
+  return Computations{intersection.t(),
+                      intersection.index(),
+                      intersection.primitive(),
+                      point,
+                      point + normal_vector * MathUtil::default_epsilon,
+                      point - normal_vector * MathUtil::default_epsilon,
+                      eye_vector,
+                      normal_vector,
+                      reflect(ray.direction, normal_vector),
+                      inside,
+                      n1,
+                      n2};
+}
+
+[[nodiscard]] constexpr bool is_shadowed(const World& world, const Tuple& point,
+                                         const PointLight& light) {
+  const auto to_light = light.position - point;
+  const auto distance = TupleUtil::magnitude(to_light);
+  const auto shadow_hit =
+      hit(world, Ray{point, TupleUtil::normalize(to_light)});
+  return shadow_hit && shadow_hit->t() < distance;
+}
+
+/*
+  Schlick's approximation of the Fresnel reflectance: the fraction of the
+  light reflected rather than refracted at the hit, 1 under total internal
+  reflection
+*/
+[[nodiscard]] constexpr float schlick(const Computations& comps) {
+  auto cos = TupleUtil::dot(comps.eye_vector, comps.normal_vector);
+  if (comps.n1 > comps.n2) {
+    const auto n = comps.n1 / comps.n2;
+    const auto sin2_t = n * n * (1.f - cos * cos);
+    if (sin2_t > 1.f) return 1.f;
+    cos = MathUtil::sqrt(1.f - sin2_t);
+  }
+  const auto r = (comps.n1 - comps.n2) / (comps.n1 + comps.n2);
+  const auto r0 = r * r;
+  const auto x = 1.f - cos;
+  return r0 + (1.f - r0) * x * x * x * x * x;
+}
+
+/*
+  Direction of the refracted ray by Snell's law, nothing under total
+  internal reflection
+*/
+[[nodiscard]] constexpr std::optional<Tuple> refracted_direction(
+    const Computations& comps) {
+  const auto n_ratio = comps.n1 / comps.n2;
+  const auto cos_i = TupleUtil::dot(comps.eye_vector, comps.normal_vector);
+  const auto sin2_t = n_ratio * n_ratio * (1.f - cos_i * cos_i);
+  if (sin2_t > 1.f) return std::nullopt;
+  const auto cos_t = MathUtil::sqrt(1.f - sin2_t);
+  return comps.normal_vector * (n_ratio * cos_i - cos_t) -
+         comps.eye_vector * n_ratio;
+}
+
+/*
+  Factors of the reflected and refracted colors at the hit. Materials that
+  are both reflective and transparent split the light between the two rays
+  with the Schlick approximation
+*/
+[[nodiscard]] constexpr std::pair<float, float> secondary_factors(
+    const Material& material, const Computations& comps) {
+  auto reflective = material.reflective;
+  auto transparency = material.transparency;
+  if (reflective > 0.f && transparency > 0.f) {
+    const auto reflectance = schlick(comps);
+    reflective *= reflectance;
+    transparency *= 1.f - reflectance;
+  }
+  return {reflective, transparency};
+}
+
+/*
+  Whether a secondary ray whose color is scaled by factor is cast from a
+  ray on the given path: rays past the depth limit or whose weight would
+  fall below the minimum contribution are not
+*/
+[[nodiscard]] constexpr bool casts_secondary(const TraceLimits& limits,
+                                             const RayPath& path,
+                                             float factor) noexcept {
+  return factor > 0.f && path.depth < limits.max_depth &&
+         path.weight * factor >= limits.min_contribution;
+}
+
+[[nodiscard]] constexpr Color color_at(const World& world, const Ray& ray,
+                                       const TraceLimits& limits = {},
+                                       const RayPath& path = {},
+                                       RayCounters* counters = nullptr);
+
+namespace detail {
+
+/*
+  Color seen along a reflected or refracted ray, scaled by its factor and
+  counted as `kind`. Rays that are not cast count as black
+*/
+[[nodiscard]] constexpr Color secondary_color(
+    const World& world, const Ray& ray, float factor,
+    const TraceLimits& limits, const RayPath& path, RayCounters* counters,
+    std::uint64_t RayCounters::*kind) {
+  if (!casts_secondary(limits, path, factor)) return ColorUtil::black();
+  if (counters != nullptr) ++(counters->*kind);
+  return color_at(world, ray, limits,
+                  RayPath{path.depth + 1, path.weight * factor}, counters) *
+         factor;
+}
+
+[[nodiscard]] constexpr Color reflected_color(const World& world,
+                                              const Computations& comps,
+                                              float factor,
+                                              const TraceLimits& limits,
+                                              const RayPath& path,
+                                              RayCounters* counters) {
+  return secondary_color(world, Ray{comps.over_point, comps.reflect_vector},
+                         factor, limits, path, counters,
+                         &RayCounters::reflection);
+}
+
+[[nodiscard]] constexpr Color refracted_color(const World& world,
+                                              const Computations& comps,
+                                              float factor,
+                                              const TraceLimits& limits,
+                                              const RayPath& path,
+                                              RayCounters* counters) {
+  if (factor <= 0.f) return ColorUtil::black();
+  const auto direction = refracted_direction(comps);
+  if (!direction) return ColorUtil::black();
+  return secondary_color(world, Ray{comps.under_point, *direction}, factor,
+                         limits, path, counters, &RayCounters::refraction);
+}
+
+}  // namespace detail
+
+/*
+  Color of the reflection at the hit, scaled by the reflectivity of the
+  material
+*/
+[[nodiscard]] constexpr Color reflected_color(const World& world,
+                                              const Computations& comps,
+                                              const TraceLimits& limits = {},
+                                              const RayPath& path = {},
+                                              RayCounters* counters = nullptr) {
+  const auto& material = world.object_material(comps.object);
+  return detail::reflected_color(world, comps, material.reflective, limits,
+                                 path, counters);
+}
+
+/*
+  Color seen through the hit, scaled by the transparency of the material.
+  Black under total internal reflection
+*/
+[[nodiscard]] constexpr Color refracted_color(const World& world,
+                                              const Computations& comps,
+                                              const TraceLimits& limits = {},
+                                              const RayPath& path = {},
+                                              RayCounters* counters = nullptr) {
+  const auto& material = world.object_material(comps.object);
+  return detail::refracted_color(world, comps, material.transparency, limits,
+                                 path, counters);
+}
+
+/*
+  Lighting of the surface plus its reflection and refraction, see
+  secondary_factors
+*/
+[[nodiscard]] constexpr Color shade_hit(const World& world,
+                                        const Computations& comps,
+                                        const TraceLimits& limits = {},
+                                        const RayPath& path = {},
+                                        RayCounters* counters = nullptr) {
+  const auto& material = world.object_material(comps.object);
+
+  Color result = ColorUtil::black();
+  for (const auto& light : world.lights()) {
+    if (counters != nullptr) ++counters->shadow;
+    result += ShadingUtil::lighting(
+        material, light, comps.over_point, comps.eye_vector,
+        comps.normal_vector, is_shadowed(world, comps.over_point, light));
+  }
+
+  const auto [reflective, transparency] = secondary_factors(material, comps);
+  result += detail::reflected_color(world, comps, reflective, limits, path,
+                                    counters);
+  result += detail::refracted_color(world, comps, transparency, limits, path,
+                                    counters);
+  return result;
+}
+
+/*
+  Color seen along the ray. path places the ray in the tree of rays of its
+  pixel, the default being a primary ray
+*/
+[[nodiscard]] constexpr Color color_at(const World& world, const Ray& ray,
+                                       const TraceLimits& limits,
+                                       const RayPath& path,
+                                       RayCounters* counters) {
+  if (counters != nullptr && path.depth == 0) ++counters->primary;
+  const auto intersection = hit(world, ray);
+  if (!intersection) return ColorUtil::black();
+  return shade_hit(world, prepare_computations(*intersection, ray, world),
+                   limits, path, counters);
+}
+
+}  // namespace WorldUtil
+
+#endif
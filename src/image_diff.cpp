@@ -0,0 +1,146 @@
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+#include "ImageDiff.hpp"
+#include "Ppm.hpp"
+
+namespace {
+
+constexpr std::string_view usage =
+    "usage: image-diff <a.ppm> <b.ppm> [--threads <n>] [--tolerance <x>] "
+    "[--max-error <x>] [--min-psnr <dB>] [--heatmap <out.ppm>] "
+    "[--scale <x>]\n"
+    "  Compares two images with channels in [0, 1] and exits with 1 when\n"
+    "  they differ by more than the given bounds, 2 on errors\n"
+    "  --threads 0 uses one thread per hardware thread\n"
+    "  --tolerance counts the pixels differing by more than x (0 by default)\n"
+    "  --heatmap writes the largest channel difference of every pixel, from\n"
+    "    black through red and yellow to white at --scale (1 by default)\n";
+
+struct Options {
+  std::filesystem::path first{};
+  std::filesystem::path second{};
+  std::filesystem::path heatmap{};
+  unsigned threads{0};
+  float tolerance{0.f};
+  float scale{1.f};
+  std::optional<float> max_error{};
+  std::optional<float> min_psnr{};
+};
+
+std::optional<int> parse_count(std::string_view text) {
+  int value = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size() || value < 0)
+    return std::nullopt;
+  return value;
+}
+
+std::optional<float> parse_real(std::string_view text) {
+  float value = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size() || value < 0)
+    return std::nullopt;
+  return value;
+}
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view argument = argv[i];
+
+    if (argument == "--heatmap" || argument == "--threads" ||
+        argument == "--tolerance" || argument == "--max-error" ||
+        argument == "--min-psnr" || argument == "--scale") {
+      if (i + 1 == argc) return std::nullopt;
+      const std::string_view value = argv[++i];
+      if (argument == "--heatmap") {
+        options.heatmap = value;
+        continue;
+      }
+      if (argument == "--threads") {
+        const auto count = parse_count(value);
+        if (!count) return std::nullopt;
+        options.threads = static_cast<unsigned>(*count);
+        continue;
+      }
+
+      const auto number = parse_real(value);
+      if (!number) return std::nullopt;
+      if (argument == "--tolerance")
+        options.tolerance = *number;
+      else if (argument == "--max-error")
+        options.max_error = *number;
+      else if (argument == "--min-psnr")
+        options.min_psnr = *number;
+      else if (*number > 0)
+        options.scale = *number;
+      else
+        return std::nullopt;
+    } else if (options.first.empty() && !argument.starts_with('-')) {
+      options.first = argument;
+    } else if (options.second.empty() && !argument.starts_with('-')) {
+      options.second = argument;
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  if (options.second.empty()) return std::nullopt;
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const auto options = parse_options(argc, argv);
+  if (!options) {
+    std::cerr << usage;
+    return 2;
+  }
+
+  const auto first = CanvasUtil::load_ppm(options->first);
+  if (!first) {
+    std::cerr << "cannot read " << options->first.string() << '\n';
+    return 2;
+  }
+  const auto second = CanvasUtil::load_ppm(options->second);
+  if (!second) {
+    std::cerr << "cannot read " << options->second.string() << '\n';
+    return 2;
+  }
+
+  const auto difference = ImageDiffUtil::compare(
+      *first, *second, options->tolerance, options->threads);
+  if (!difference) {
+    std::cerr << "the images have different sizes\n";
+    return 2;
+  }
+
+  std::cout << "max error: " << difference->max_error << '\n'
+            << "mean error: " << difference->mean_error << '\n'
+            << "PSNR: " << difference->psnr << " dB\n"
+            << "differing pixels: " << difference->differing_pixels << '\n';
+
+  if (!options->heatmap.empty()) {
+    const auto map = ImageDiffUtil::heatmap(*first, *second, options->scale);
+    std::ofstream output(options->heatmap, std::ios::binary);
+    output << CanvasUtil::to_ppm(*map);
+    if (!output) {
+      std::cerr << "cannot write " << options->heatmap.string() << '\n';
+      return 2;
+    }
+  }
+
+  const bool within_bounds =
+      (!options->max_error || difference->max_error <= *options->max_error) &&
+      (!options->min_psnr ||
+       difference->psnr >= static_cast<double>(*options->min_psnr));
+  return within_bounds ? 0 : 1;
+}
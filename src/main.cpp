@@ -1,2 +1,301 @@
-
-int main() { return 0; }
\ No newline at end of file
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+#include "MappedCanvas.hpp"
+#include "Png.hpp"
+#include "Ppm.hpp"
+#include "Qoi.hpp"
+#include "Render.hpp"
+#include "Scene.hpp"
+#include "SceneCache.hpp"
+
+namespace {
+
+constexpr std::string_view usage =
+    "usage: ray-tracer <scene> [-o <image.ppm|.png|.qoi>] [--threads <n>] "
+    "[--tile <pixels>] [--samples <n>] [--adaptive <n>] "
+    "[--threshold <x>] [--seed <n>] [--progressive] [--budget <ms>] "
+    "[--max-samples <n>] [--layout row|blocked|morton] "
+    "[--format float|half|srgb8] [--mapped] [--max-depth <n>] [--stats] "
+    "[--wavefront] [--lbvh] [--cache <file>]\n"
+    "  -o picks the image format from the extension, PPM by default\n"
+    "  --threads 0 uses one thread per hardware thread, for loading the\n"
+    "    scene as well as rendering it\n"
+    "  --adaptive adds n samples where neighbouring pixels differ by more\n"
+    "    than the threshold (0.1 by default)\n"
+    "  --seed picks another set of sample positions\n"
+    "  --progressive rewrites the image after every refinement pass\n"
+    "  --budget stops refining after the given time\n"
+    "  --max-samples keeps adding samples to the progressive image until\n"
+    "    pixels hold n samples\n"
+    "  --budget and --max-samples imply --progressive\n"
+    "  --layout stores the image in 8x8 blocks or 16x16 Z-order blocks\n"
+    "    instead of rows, which keeps the pixels of a tile together\n"
+    "  --format stores pixels as half floats or 8-bit sRGB values to save\n"
+    "    memory\n"
+    "  --mapped renders straight into a binary PPM file mapped in memory,\n"
+    "    for images too large to keep in memory; only with a .ppm output\n"
+    "    and not with --progressive\n"
+    "  --max-depth limits the bounces of reflected and refracted rays (5 by\n"
+    "    default)\n"
+    "  --stats prints the number of rays cast by kind; not with\n"
+    "    --progressive\n"
+    "  --wavefront traces the rays of a tile one bounce at a time instead of\n"
+    "    following every ray through all its bounces\n"
+    "  --lbvh builds the hierarchies over meshes and instances along a\n"
+    "    Morton curve, much faster for previews but slower to render\n"
+    "  --cache loads the scene from a binary cache file, written from the\n"
+    "    scene when it is missing or older than it; remove it after changing\n"
+    "    only the meshes\n";
+
+struct Options {
+  std::filesystem::path scene{};
+  std::filesystem::path output{};
+  std::filesystem::path cache{};
+  RenderSettings settings{};
+  BvhBuilder builder{BvhBuilder::Sah};
+  bool progressive{false};
+  bool mapped{false};
+  bool stats{false};
+  std::chrono::milliseconds budget{0};
+  int max_samples{0};
+};
+
+std::optional<int> parse_count(std::string_view text) {
+  int value = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size() || value < 0)
+    return std::nullopt;
+  return value;
+}
+
+std::optional<float> parse_real(std::string_view text) {
+  float value = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size() || value < 0)
+    return std::nullopt;
+  return value;
+}
+
+std::optional<CanvasLayout> parse_layout(std::string_view text) {
+  if (text == "row") return CanvasLayout::RowMajor;
+  if (text == "blocked") return CanvasLayout::Blocked;
+  if (text == "morton") return CanvasLayout::Morton;
+  return std::nullopt;
+}
+
+std::optional<PixelFormat> parse_format(std::string_view text) {
+  if (text == "float") return PixelFormat::Float;
+  if (text == "half") return PixelFormat::Half;
+  if (text == "srgb8") return PixelFormat::Srgb8;
+  return std::nullopt;
+}
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view argument = argv[i];
+
+    if (argument == "--progressive") {
+      options.progressive = true;
+    } else if (argument == "--mapped") {
+      options.mapped = true;
+    } else if (argument == "--stats") {
+      options.stats = true;
+    } else if (argument == "--wavefront") {
+      options.settings.scheduling = RayScheduling::Wavefront;
+    } else if (argument == "--lbvh") {
+      options.builder = BvhBuilder::Lbvh;
+    } else if (argument == "-o" || argument == "--threads" ||
+               argument == "--tile" || argument == "--samples" ||
+               argument == "--budget" || argument == "--adaptive" ||
+               argument == "--threshold" || argument == "--seed" ||
+               argument == "--max-samples" || argument == "--layout" ||
+               argument == "--format" || argument == "--max-depth" ||
+               argument == "--cache") {
+      if (i + 1 == argc) return std::nullopt;
+      const std::string_view value = argv[++i];
+      if (argument == "-o") {
+        options.output = value;
+        continue;
+      }
+      if (argument == "--cache") {
+        options.cache = value;
+        continue;
+      }
+      if (argument == "--threshold") {
+        const auto threshold = parse_real(value);
+        if (!threshold) return std::nullopt;
+        options.settings.adaptive_threshold = *threshold;
+        continue;
+      }
+      if (argument == "--layout") {
+        const auto layout = parse_layout(value);
+        if (!layout) return std::nullopt;
+        options.settings.layout = *layout;
+        continue;
+      }
+      if (argument == "--format") {
+        const auto format = parse_format(value);
+        if (!format) return std::nullopt;
+        options.settings.format = *format;
+        continue;
+      }
+
+      const auto count = parse_count(value);
+      if (!count) return std::nullopt;
+      if (argument == "--threads")
+        options.settings.threads = static_cast<unsigned>(*count);
+      else if (argument == "--tile" && *count > 0)
+        options.settings.tile_size = *count;
+      else if (argument == "--samples" && *count > 0)
+        options.settings.samples = *count;
+      else if (argument == "--seed")
+        options.settings.seed = static_cast<std::uint32_t>(*count);
+      else if (argument == "--adaptive")
+        options.settings.adaptive_samples = *count;
+      else if (argument == "--max-samples")
+        options.max_samples = *count;
+      else if (argument == "--max-depth")
+        options.settings.trace.max_depth = *count;
+      else if (argument == "--budget" && *count > 0)
+        options.budget = std::chrono::milliseconds(*count);
+      else
+        return std::nullopt;
+    } else if (options.scene.empty() && !argument.starts_with('-')) {
+      options.scene = argument;
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  if (options.scene.empty()) return std::nullopt;
+  if (options.budget.count() > 0 || options.max_samples > 0)
+    options.progressive = true;
+  if ((options.mapped || options.stats) && options.progressive)
+    return std::nullopt;
+  if (options.output.empty())
+    options.output = options.scene.stem().concat(".ppm");
+  if (options.mapped && options.output.extension() != ".ppm")
+    return std::nullopt;
+  return options;
+}
+
+bool write_image(const std::filesystem::path& path, const Canvas& image) {
+  std::ofstream output(path, std::ios::binary);
+  if (path.extension() == ".png")
+    output << CanvasUtil::to_png(image);
+  else if (path.extension() == ".qoi")
+    output << CanvasUtil::to_qoi(image);
+  else
+    output << CanvasUtil::to_ppm(image);
+  return static_cast<bool>(output);
+}
+
+template <typename Writer>
+void render_rows(std::ostream& output, const Scene& scene,
+                 const RenderSettings& settings, RayCounters* counters) {
+  Writer writer(output, scene.camera.hsize(), scene.camera.vsize());
+  RenderUtil::render_streamed(scene.camera, scene.world, writer, settings,
+                              counters);
+}
+
+/*
+  Renders the scene while its rows are encoded to the output file. Returns
+  false when the file cannot be written, including when the encoder throws
+*/
+bool render_to_file(const std::filesystem::path& path, const Scene& scene,
+                    const RenderSettings& settings, RayCounters* counters) {
+  std::ofstream output(path, std::ios::binary);
+  try {
+    if (path.extension() == ".png")
+      render_rows<PngRowWriter>(output, scene, settings, counters);
+    else if (path.extension() == ".qoi")
+      render_rows<QoiRowWriter>(output, scene, settings, counters);
+    else
+      render_rows<PpmRowWriter>(output, scene, settings, counters);
+  } catch (const std::exception&) {
+    return false;
+  }
+  return static_cast<bool>(output);
+}
+
+void print_counters(const RayCounters& counters, const Camera& camera) {
+  const auto pixels = static_cast<double>(camera.hsize()) *
+                      static_cast<double>(camera.vsize());
+  std::cerr << "primary rays: " << counters.primary << '\n'
+            << "reflection rays: " << counters.reflection << '\n'
+            << "refraction rays: " << counters.refraction << '\n'
+            << "shadow rays: " << counters.shadow << '\n'
+            << "secondary rays per pixel: "
+            << static_cast<double>(counters.secondary()) / pixels << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const auto options = parse_options(argc, argv);
+  if (!options) {
+    std::cerr << usage;
+    return 1;
+  }
+
+  std::size_t error_line = 0;
+  const BvhSettings bvh_settings{options->builder, options->settings.threads};
+  const auto scene =
+      options->cache.empty()
+          ? SceneUtil::load(options->scene, &error_line, bvh_settings)
+          : SceneCacheUtil::load(options->scene, options->cache, &error_line,
+                                 bvh_settings);
+  if (!scene) {
+    std::cerr << options->scene.string() << ": ";
+    if (error_line == 0)
+      std::cerr << "cannot read the scene or it has no camera\n";
+    else
+      std::cerr << "invalid statement on line " << error_line << '\n';
+    return 1;
+  }
+
+  RayCounters counters;
+  bool written = true;
+  if (options->mapped) {
+    auto image = MappedCanvas::create(
+        options->output, scene->camera.hsize(), scene->camera.vsize());
+    written = image.has_value();
+    if (image) {
+      RenderUtil::render_into(
+          scene->camera, scene->world, *image, options->settings,
+          [](int, int, int, int) {}, &counters);
+      written = image->flush();
+    }
+  } else if (options->progressive) {
+    const ProgressiveSettings settings{options->settings, 8, options->budget,
+                                       options->max_samples};
+    static_cast<void>(RenderUtil::render_progressive(
+        scene->camera, scene->world, settings,
+        [&](const Canvas& image, const PassInfo&) {
+          written = write_image(options->output, image) && written;
+        }));
+  } else {
+    written = render_to_file(options->output, *scene, options->settings,
+                             &counters);
+  }
+  if (options->stats) print_counters(counters, scene->camera);
+
+  if (!written) {
+    std::cerr << "cannot write " << options->output.string() << '\n';
+    return 1;
+  }
+  return 0;
+}
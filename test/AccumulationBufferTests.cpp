@@ -0,0 +1,81 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include "../src/AccumulationBuffer.hpp"
+#include "../src/Canvas.hpp"
+#include "../src/Color.hpp"
+
+SCENARIO("Averaging the samples added to a pixel") {
+  GIVEN("buffer <- AccumulationBuffer(3, 2)") {
+    AccumulationBuffer buffer(3, 2);
+
+    WHEN("samples are added to one pixel") {
+      buffer.add(1, 1, Color(1, 0, 0));
+      buffer.add(1, 1, Color(0, 1, 0));
+      buffer.add(1, 1, Color(0.5f, 0.5f, 3), 2);
+      const auto canvas = buffer.resolve();
+
+      THEN("the pixel holds their average and sample count")
+      AND_THEN("pixels without samples resolve to black") {
+        REQUIRE(buffer.count(1, 1) == 4);
+        REQUIRE(buffer.average(1, 1) == Color(0.375f, 0.375f, 0.75f));
+        REQUIRE(canvas.pixel_at(1, 1) == Color(0.375f, 0.375f, 0.75f));
+        REQUIRE(buffer.count(0, 0) == 0);
+        REQUIRE(canvas.pixel_at(0, 0) == Color(0, 0, 0));
+      }
+    }
+  }
+}
+
+SCENARIO("Merging buffers rendered separately") {
+  GIVEN("two buffers of the same size and one of another size") {
+    AccumulationBuffer a(2, 2);
+    AccumulationBuffer b(2, 2);
+    const AccumulationBuffer other_size(3, 2);
+    a.add(0, 1, Color(1, 1, 1), 1);
+    b.add(0, 1, Color(0, 0, 0), 3);
+
+    WHEN("b is merged into a") {
+      REQUIRE(a.merge(b));
+      THEN("the sums and counts add up")
+      AND_THEN("buffers of another size are refused") {
+        REQUIRE(a.count(0, 1) == 4);
+        REQUIRE(a.average(0, 1) == Color(0.25f, 0.25f, 0.25f));
+        REQUIRE_FALSE(a.merge(other_size));
+      }
+    }
+  }
+}
+
+SCENARIO("Saving and loading a buffer to merge it in another process") {
+  GIVEN("a buffer saved to a file") {
+    AccumulationBuffer buffer(4, 3);
+    buffer.add(3, 2, Color(0.1f, 0.2f, 0.3f), 5);
+    buffer.add(0, 0, Color(2, 2, 2), 2);
+    const auto path =
+        std::filesystem::temp_directory_path() / "accumulation_tests.bin";
+    REQUIRE(buffer.save(path));
+
+    WHEN("it is loaded back") {
+      const auto loaded = AccumulationBuffer::load(path);
+      THEN("it holds the same samples") {
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded->width() == 4);
+        REQUIRE(loaded->height() == 3);
+        REQUIRE(loaded->count(3, 2) == 5);
+        REQUIRE(loaded->average(3, 2) == buffer.average(3, 2));
+        REQUIRE(loaded->average(0, 0) == Color(1, 1, 1));
+      }
+    }
+
+    WHEN("the file is truncated") {
+      std::filesystem::resize_file(path,
+                                   std::filesystem::file_size(path) - 8);
+      THEN("it cannot be loaded") {
+        REQUIRE_FALSE(AccumulationBuffer::load(path).has_value());
+      }
+    }
+    std::filesystem::remove(path);
+  }
+}
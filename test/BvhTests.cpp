@@ -0,0 +1,392 @@
+#include <array>
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../src/Bounds.hpp"
+#include "../src/Bvh.hpp"
+#include "../src/Instance.hpp"
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace MatrixUtil;
+
+namespace {
+
+// Unit cubes in a row along x, 3 units apart
+constexpr std::vector<Bounds> row_of_boxes(int count) {
+  std::vector<Bounds> boxes;
+  for (int i = 0; i < count; ++i) {
+    const auto x = static_cast<float>(3 * i);
+    boxes.push_back(Bounds{{x - 1, -1, -1}, {x + 1, 1, 1}});
+  }
+  return boxes;
+}
+
+// Unit cubes spread over a 100 x 100 x 100 block
+std::vector<Bounds> scattered_boxes(int count) {
+  std::vector<Bounds> boxes;
+  for (int i = 0; i < count; ++i) {
+    const auto x = static_cast<float>(i * 37 % 101);
+    const auto y = static_cast<float>(i * 53 % 97);
+    const auto z = static_cast<float>(i * 29 % 89);
+    boxes.push_back(Bounds{{x, y, z}, {x + 1, y + 1, z + 1}});
+  }
+  return boxes;
+}
+
+// Unit squares lying across each axis at 2^-1, 2^-2 and so on down to the
+// smallest float, copies times with the copies side by side. Each split of
+// the surface area heuristic peels a few of them off, which would nest
+// far deeper than max_depth
+std::vector<Bounds> skewed_slabs(int copies) {
+  std::vector<Bounds> boxes;
+  for (int copy = 0; copy < copies; ++copy) {
+    const auto offset = static_cast<float>(2 * copy);
+    for (int exponent = 1; exponent <= 149; ++exponent) {
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        Bounds box{{offset - 0.5f, offset - 0.5f, offset - 0.5f},
+                   {offset + 0.5f, offset + 0.5f, offset + 0.5f}};
+        box.min[axis] = box.max[axis] = std::ldexp(1.f, -exponent);
+        boxes.push_back(box);
+      }
+    }
+  }
+  return boxes;
+}
+
+// Every box is in exactly one leaf of at most leaf_size boxes, and children
+// come after their parent and lie inside its box
+constexpr bool well_formed(const Bvh& bvh, const std::vector<Bounds>& boxes) {
+  std::vector<int> seen(boxes.size(), 0);
+  for (std::size_t i = 0; i < bvh.nodes.size(); ++i) {
+    const auto& node = bvh.nodes[i];
+    if (node.leaf()) {
+      if (node.count > BvhUtil::default_leaf_size) return false;
+      for (auto item = node.first; item < node.first + node.count; ++item) {
+        ++seen[bvh.items[item]];
+        if (BoundsUtil::merge(node.bounds, boxes[bvh.items[item]]) !=
+            node.bounds)
+          return false;
+      }
+      continue;
+    }
+    if (node.first <= i) return false;
+    for (const auto child : {node.first, node.first + 1}) {
+      if (BoundsUtil::merge(node.bounds, bvh.nodes[child].bounds) !=
+          node.bounds)
+        return false;
+    }
+  }
+  for (const auto count : seen) {
+    if (count != 1) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+SCENARIO("The bounds of shapes") {
+  GIVEN("a translated and scaled sphere, a cone and a plane") {
+    constexpr auto sphere = BoundsUtil::bounds(
+        Sphere{translation(1, 2, 3) * scaling(2, 2, 2)});
+    constexpr auto cone = BoundsUtil::bounds(Cone{identity<4>(), 0, -2, 1});
+    constexpr auto plane_is_finite =
+        BoundsUtil::finite(BoundsUtil::bounds(Plane{}));
+    THEN("the sphere box follows its transformation")
+    AND_THEN("the cone box is as wide as its widest end")
+    AND_THEN("a plane is unbounded") {
+      STATIC_REQUIRE(sphere == Bounds{{-1, 0, 1}, {3, 4, 5}});
+      STATIC_REQUIRE(cone == Bounds{{-2, -2, -2}, {2, 1, 2}});
+      STATIC_REQUIRE_FALSE(plane_is_finite);
+    }
+  }
+}
+
+SCENARIO("Entering a box along a ray") {
+  GIVEN("b <- the box from (-1, -1, -1) to (1, 1, 1)") {
+    static constexpr Bounds b{{-1, -1, -1}, {1, 1, 1}};
+    constexpr auto inf = std::numeric_limits<float>::infinity();
+    constexpr auto entry = [](const Ray& r, float max_t) {
+      return BoundsUtil::entry(b, BoundsUtil::slab_ray(r), max_t);
+    };
+    THEN("a ray from outside enters at the first face")
+    AND_THEN("a ray from inside enters at 0")
+    AND_THEN("rays beside the box or reaching it too late miss it") {
+      STATIC_REQUIRE(entry(Ray{point(0, 0, -5), vector(0, 0, 1)}, inf) == 4);
+      STATIC_REQUIRE(entry(Ray{point(0.5f, 0, 0), vector(0, 1, 0)}, inf) ==
+                     0);
+      STATIC_REQUIRE(entry(Ray{point(2, 0, -5), vector(0, 0, 1)}, inf) ==
+                     inf);
+      STATIC_REQUIRE(entry(Ray{point(0, 0, -5), vector(0, 0, 1)}, 3) == inf);
+      STATIC_REQUIRE(entry(Ray{point(0, 0, 5), vector(0, 0, 1)}, inf) == inf);
+    }
+  }
+}
+
+SCENARIO("Building a hierarchy over boxes") {
+  GIVEN("boxes <- 37 boxes in a row") {
+    constexpr auto sah = [] {
+      const auto boxes = row_of_boxes(37);
+      const auto bvh = BvhUtil::build(boxes);
+      return well_formed(bvh, boxes) &&
+             bvh.nodes[0].bounds == Bounds{{-1, -1, -1}, {109, 1, 1}} &&
+             bvh.build_cost == BvhUtil::cost(bvh);
+    }();
+    constexpr auto lbvh = [] {
+      const auto boxes = row_of_boxes(37);
+      const auto bvh = BvhUtil::build_lbvh(boxes);
+      return well_formed(bvh, boxes) &&
+             bvh.nodes[0].bounds == Bounds{{-1, -1, -1}, {109, 1, 1}};
+    }();
+    THEN("build(boxes) puts every box in exactly one leaf of at most 4")
+    AND_THEN("children come after their parent and lie inside its box")
+    AND_THEN("build_lbvh(boxes) lays out its nodes the same way") {
+      STATIC_REQUIRE(sah);
+      STATIC_REQUIRE(lbvh);
+    }
+  }
+  GIVEN("boxes <- 8 boxes around the origin and one far away") {
+    constexpr auto outlier_alone = [] {
+      std::vector<Bounds> boxes;
+      for (int i = 0; i < 8; ++i) {
+        const auto x = static_cast<float>(i % 2);
+        const auto y = static_cast<float>(i / 2 % 2);
+        const auto z = static_cast<float>(i / 4);
+        boxes.push_back(Bounds{{x, y, z}, {x + 1, y + 1, z + 1}});
+      }
+      boxes.push_back(Bounds{{100, 0, 0}, {101, 1, 1}});
+      const auto bvh = BvhUtil::build(boxes);
+      const auto& left = bvh.nodes[bvh.nodes[0].first];
+      const auto& right = bvh.nodes[bvh.nodes[0].first + 1];
+      return (left.leaf() && left.count == 1) ||
+             (right.leaf() && right.count == 1);
+    }();
+    THEN("the surface area heuristic splits the far box off first") {
+      STATIC_REQUIRE(outlier_alone);
+    }
+  }
+}
+
+SCENARIO("Building a hierarchy on several threads gives the same tree") {
+  GIVEN("boxes <- 20000 scattered boxes") {
+    const auto boxes = scattered_boxes(20000);
+    WHEN("serial <- build(boxes)")
+    AND_WHEN("parallel <- parallel_build(boxes, 7 threads)") {
+      const auto serial = BvhUtil::build(boxes);
+      const auto parallel = BvhUtil::parallel_build(boxes, 7);
+      THEN("both trees split the items alike") {
+        REQUIRE(well_formed(parallel, boxes));
+        REQUIRE(parallel.items == serial.items);
+        REQUIRE(parallel.nodes.size() == serial.nodes.size());
+        REQUIRE(parallel.nodes[0].bounds == serial.nodes[0].bounds);
+        REQUIRE(parallel.build_cost == Approx(serial.build_cost));
+      }
+    }
+    WHEN("serial <- build_lbvh(boxes)")
+    AND_WHEN("parallel <- parallel_build_lbvh(boxes, 7 threads)") {
+      const auto serial = BvhUtil::build_lbvh(boxes);
+      const auto parallel = BvhUtil::parallel_build_lbvh(boxes, 7);
+      THEN("both trees split the items alike")
+      AND_THEN("they cost more than the surface area heuristic tree") {
+        REQUIRE(well_formed(parallel, boxes));
+        REQUIRE(parallel.items == serial.items);
+        REQUIRE(parallel.nodes.size() == serial.nodes.size());
+        REQUIRE(parallel.build_cost == Approx(serial.build_cost));
+        REQUIRE(serial.build_cost > BvhUtil::build(boxes).build_cost);
+      }
+    }
+    WHEN("trees are built from settings naming the builder and threads") {
+      const auto lbvh = BvhUtil::build(boxes, {BvhBuilder::Lbvh, 7});
+      const auto sah = BvhUtil::build(boxes, {BvhBuilder::Sah, 1});
+      THEN("they equal the trees of the builder asked for") {
+        REQUIRE(lbvh.items == BvhUtil::parallel_build_lbvh(boxes, 7).items);
+        REQUIRE(sah.items == BvhUtil::build(boxes).items);
+        REQUIRE(lbvh.builder == BvhBuilder::Lbvh);
+        REQUIRE(sah.builder == BvhBuilder::Sah);
+      }
+    }
+  }
+}
+
+SCENARIO("Hierarchies over skewed boxes stay within the traversal depth") {
+  GIVEN("boxes <- 447 slabs at x, y or z = 2^-1 down to 2^-149") {
+    const auto boxes = skewed_slabs(1);
+    WHEN("trees are built with either builder")
+    AND_WHEN("r <- ray(point(0, 0, 0), vector(1, 1, 1))") {
+      const std::array trees{BvhUtil::build(boxes),
+                             BvhUtil::build_lbvh(boxes)};
+      const Ray r{point(0, 0, 0), vector(1, 1, 1)};
+      THEN("no path is deeper than max_depth")
+      AND_THEN("traversing them tests every slab the ray crosses") {
+        for (const auto& bvh : trees) {
+          REQUIRE(well_formed(bvh, boxes));
+          REQUIRE(BvhUtil::valid(bvh, boxes.size()));
+
+          std::size_t tested = 0;
+          RayUtil::NearestHit nearest;
+          BvhUtil::traverse(bvh, r, nearest,
+                            [&](std::uint32_t, RayUtil::NearestHit&) {
+                              ++tested;
+                            });
+          REQUIRE(tested == boxes.size());
+        }
+      }
+    }
+  }
+  GIVEN("boxes <- 10 side by side copies of those slabs") {
+    const auto boxes = skewed_slabs(10);
+    WHEN("trees are built on 7 threads with either builder") {
+      const auto sah = BvhUtil::parallel_build(boxes, 7);
+      const auto lbvh = BvhUtil::parallel_build_lbvh(boxes, 7);
+      THEN("no path is deeper than max_depth")
+      AND_THEN("they equal the trees built on one thread") {
+        REQUIRE(BvhUtil::valid(sah, boxes.size()));
+        REQUIRE(BvhUtil::valid(lbvh, boxes.size()));
+        REQUIRE(sah.items == BvhUtil::build(boxes).items);
+        REQUIRE(lbvh.items == BvhUtil::build_lbvh(boxes).items);
+      }
+    }
+  }
+}
+
+SCENARIO("Refitting a hierarchy after its items moved") {
+  GIVEN("bvh <- build(37 boxes in a row)") {
+    constexpr auto shifted = [] {
+      auto boxes = row_of_boxes(37);
+      auto bvh = BvhUtil::build(boxes);
+      const auto nodes = bvh.nodes.size();
+      for (auto& box : boxes) {
+        box.min[1] += 5;
+        box.max[1] += 5;
+      }
+      const auto rebuilt = BvhUtil::update(bvh, boxes);
+      return !rebuilt && bvh.nodes.size() == nodes &&
+             bvh.nodes[0].bounds == Bounds{{-1, 4, -1}, {109, 6, 1}} &&
+             BvhUtil::cost(bvh) == bvh.build_cost;
+    }();
+    constexpr auto scattered = [] {
+      auto boxes = row_of_boxes(37);
+      auto bvh = BvhUtil::build(boxes);
+      const auto row = row_of_boxes(37);
+      for (std::size_t i = 0; i < boxes.size(); ++i)
+        boxes[i] = row[(i * 17) % row.size()];
+
+      auto refitted = bvh;
+      BvhUtil::refit(refitted, boxes);
+      const auto contained = [&refitted](const BvhNode& node,
+                                         const Bounds& box) {
+        return BoundsUtil::merge(node.bounds, box) == node.bounds;
+      };
+      for (const auto& node : refitted.nodes) {
+        if (node.leaf()) {
+          for (auto i = node.first; i < node.first + node.count; ++i) {
+            if (!contained(node, boxes[refitted.items[i]])) return false;
+          }
+        } else if (!contained(node, refitted.nodes[node.first].bounds) ||
+                   !contained(node, refitted.nodes[node.first + 1].bounds)) {
+          return false;
+        }
+      }
+
+      const auto degraded = BvhUtil::cost(refitted) >
+                            refitted.build_cost * BvhUtil::rebuild_ratio;
+      const auto rebuilt = BvhUtil::update(bvh, boxes);
+      return degraded && rebuilt && bvh.build_cost < BvhUtil::cost(refitted);
+    }();
+    constexpr auto spread = [] {
+      const std::vector<Bounds> stacked(37, Bounds{{-1, -1, -1}, {1, 1, 1}});
+      auto bvh = BvhUtil::build(stacked);
+      const auto one_leaf = bvh.nodes.size() == 1;
+      return one_leaf && BvhUtil::update(bvh, row_of_boxes(37)) &&
+             bvh.nodes.size() > 1;
+    }();
+    THEN("moving every box alike refits the tree without building it again")
+    AND_THEN("refitted nodes still hold their children and items")
+    AND_THEN("scattering the boxes degrades the tree until it is rebuilt")
+    AND_THEN("boxes built at the same place are split once they move apart") {
+      STATIC_REQUIRE(shifted);
+      STATIC_REQUIRE(scattered);
+      STATIC_REQUIRE(spread);
+    }
+  }
+}
+
+SCENARIO("Traversing a hierarchy finds the nearest item") {
+  GIVEN("bvh <- build(37 boxes in a row)")
+  AND_GIVEN("r <- ray(point(200, 0, 0), vector(-1, 0, 0))") {
+    constexpr auto visits = [] {
+      const auto boxes = row_of_boxes(37);
+      const auto bvh = BvhUtil::build(boxes);
+      const Ray r{point(200, 0, 0), vector(-1, 0, 0)};
+
+      // Every item is hit where the ray enters its box
+      std::size_t tested = 0;
+      RayUtil::NearestHit nearest;
+      BvhUtil::traverse(
+          bvh, r, nearest,
+          [&](std::uint32_t item, RayUtil::NearestHit& xs) {
+            ++tested;
+            xs.index = item;
+            xs.push_back(Intersection(
+                BoundsUtil::entry(boxes[item], BoundsUtil::slab_ray(r),
+                                  std::numeric_limits<float>::infinity()),
+                ShapeType::Cube, item));
+          });
+      return std::array{nearest.hit->index(), tested};
+    }();
+    THEN("the last box of the row is hit first")
+    AND_THEN("boxes behind it are skipped") {
+      STATIC_REQUIRE(visits[0] == 36);
+      STATIC_REQUIRE(visits[1] < 37);
+    }
+  }
+}
+
+SCENARIO("Intersecting a prototype") {
+  GIVEN("p <- a prototype of a sphere and a mesh square at z = 2") {
+    constexpr auto hits = [] {
+      TriangleMesh square;
+      square.vertices = {-1, -1, 0, 1, -1, 0, 1, 1, 0, -1, 1, 0};
+      square.indices = {0, 1, 2, 0, 2, 3};
+      square.transform = translation(0, 0, 2);
+      const std::vector<Shape> shapes{Sphere{translation(0, 3, 0)}, square};
+      const Prototype p(shapes);
+
+      const auto nearest = [&p](const Ray& r) {
+        RayUtil::NearestHit xs;
+        RayUtil::local_intersect(r, p, xs);
+        return *xs.hit;
+      };
+      return std::array{nearest(Ray{point(0, 3, -5), vector(0, 0, 1)}),
+                        nearest(Ray{point(0.5f, -0.5f, -5), vector(0, 0, 1)}),
+                        nearest(Ray{point(-0.5f, 0.5f, -5),
+                                    vector(0, 0, 1)})};
+    }();
+    constexpr auto layout = [] {
+      TriangleMesh square;
+      square.vertices = {-1, -1, 0, 1, -1, 0, 1, 1, 0, -1, 1, 0};
+      square.indices = {0, 1, 2, 0, 2, 3};
+      const std::vector<Shape> shapes{square, Sphere{}};
+      const Prototype p(shapes);
+      return std::array{p.shapes().size(), p.triangles().triangle_count(),
+                        p.primitive_count()};
+    }();
+    THEN("the sphere is primitive 0 and the triangles follow it")
+    AND_THEN("hits carry the primitive that was hit") {
+      STATIC_REQUIRE(layout[0] == 1);
+      STATIC_REQUIRE(layout[1] == 2);
+      STATIC_REQUIRE(layout[2] == 3);
+      STATIC_REQUIRE(hits[0] == Intersection(4, ShapeType::Sphere, 0, 0));
+      STATIC_REQUIRE(hits[1].t() == 7);
+      STATIC_REQUIRE(hits[1].primitive() == 1);
+      STATIC_REQUIRE(hits[2].primitive() == 2);
+    }
+  }
+}
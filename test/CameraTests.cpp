@@ -0,0 +1,153 @@
+#include <catch2/catch.hpp>
+#include <numbers>
+
+#include "../src/Camera.hpp"
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Render.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace MatrixUtil;
+using namespace CameraUtil;
+
+SCENARIO("The transformation matrix for the default orientation") {
+  GIVEN("from <- point(0, 0, 0)")
+  AND_GIVEN("to <- point(0, 0, -1)")
+  AND_GIVEN("up <- vector(0, 1, 0)") {
+    constexpr auto t =
+        view_transform(point(0, 0, 0), point(0, 0, -1), vector(0, 1, 0));
+    THEN("t = identity_matrix") { STATIC_REQUIRE(t == identity<4>()); }
+  }
+}
+
+SCENARIO("A view transformation matrix looking in positive z direction") {
+  GIVEN("from <- point(0, 0, 0)")
+  AND_GIVEN("to <- point(0, 0, 1)")
+  AND_GIVEN("up <- vector(0, 1, 0)") {
+    constexpr auto t =
+        view_transform(point(0, 0, 0), point(0, 0, 1), vector(0, 1, 0));
+    THEN("t = scaling(-1, 1, -1)") { STATIC_REQUIRE(t == scaling(-1, 1, -1)); }
+  }
+}
+
+SCENARIO("The view transformation moves the world") {
+  GIVEN("from <- point(0, 0, 8)")
+  AND_GIVEN("to <- point(0, 0, 0)")
+  AND_GIVEN("up <- vector(0, 1, 0)") {
+    constexpr auto t =
+        view_transform(point(0, 0, 8), point(0, 0, 0), vector(0, 1, 0));
+    THEN("t = translation(0, 0, -8)") {
+      STATIC_REQUIRE(t == translation(0, 0, -8));
+    }
+  }
+}
+
+SCENARIO("An arbitrary view transformation") {
+  GIVEN("from <- point(1, 3, 2)")
+  AND_GIVEN("to <- point(4, -2, 8)")
+  AND_GIVEN("up <- vector(1, 1, 0)") {
+    constexpr auto t =
+        view_transform(point(1, 3, 2), point(4, -2, 8), vector(1, 1, 0));
+    THEN("t is the expected 4x4 matrix") {
+      STATIC_REQUIRE(t == Transformation{-0.50709f, 0.50709f, 0.67612f,
+                                         -2.36643f, 0.76772f, 0.60609f,
+                                         0.12122f, -2.82843f, -0.35857f,
+                                         0.59761f, -0.71714f, 0.f, 0.f, 0.f,
+                                         0.f, 1.f});
+    }
+  }
+}
+
+SCENARIO("Constructing a camera") {
+  GIVEN("c <- camera(160, 120, π/2)") {
+    constexpr Camera c(160, 120, std::numbers::pi_v<float> / 2);
+    THEN("c.hsize = 160")
+    AND_THEN("c.vsize = 120")
+    AND_THEN("c.field_of_view = π/2")
+    AND_THEN("c.transform = identity_matrix") {
+      STATIC_REQUIRE(c.hsize() == 160);
+      STATIC_REQUIRE(c.vsize() == 120);
+      STATIC_REQUIRE(c.field_of_view() == std::numbers::pi_v<float> / 2);
+      STATIC_REQUIRE(c.transform() == identity<4>());
+    }
+  }
+}
+
+SCENARIO("The pixel size for horizontal and vertical canvases") {
+  GIVEN("c1 <- camera(200, 125, π/2)")
+  AND_GIVEN("c2 <- camera(125, 200, π/2)") {
+    constexpr Camera c1(200, 125, std::numbers::pi_v<float> / 2);
+    constexpr Camera c2(125, 200, std::numbers::pi_v<float> / 2);
+    THEN("c1.pixel_size = 0.01")
+    AND_THEN("c2.pixel_size = 0.01") {
+      STATIC_REQUIRE(MathUtil::approx_equal(c1.pixel_size(), 0.01f));
+      STATIC_REQUIRE(MathUtil::approx_equal(c2.pixel_size(), 0.01f));
+    }
+  }
+}
+
+SCENARIO("Constructing a ray through the center and a corner of the canvas") {
+  GIVEN("c <- camera(201, 101, π/2)") {
+    constexpr Camera c(201, 101, std::numbers::pi_v<float> / 2);
+    WHEN("r1 <- ray_for_pixel(c, 100, 50)")
+    AND_WHEN("r2 <- ray_for_pixel(c, 0, 0)") {
+      constexpr auto r1 = ray_for_pixel(c, 100, 50);
+      constexpr auto r2 = ray_for_pixel(c, 0, 0);
+      THEN("r1 starts at the origin and points down -z")
+      AND_THEN("r2.direction = vector(0.66519, 0.33259, -0.66851)") {
+        STATIC_REQUIRE(r1.origin == point(0, 0, 0));
+        STATIC_REQUIRE(r1.direction == vector(0, 0, -1));
+        STATIC_REQUIRE(r2.origin == point(0, 0, 0));
+        STATIC_REQUIRE(TupleUtil::magnitude(
+                           r2.direction -
+                           vector(0.66519f, 0.33259f, -0.66851f)) < 0.0001f);
+      }
+    }
+  }
+}
+
+SCENARIO("Constructing a ray when the camera is transformed") {
+  GIVEN("c <- camera(201, 101, π/2)")
+  AND_GIVEN("c.transform <- rotation_y(π/4) * translation(0, -2, 5)") {
+    constexpr Camera c(
+        201, 101, std::numbers::pi_v<float> / 2,
+        rotation_y(std::numbers::pi_v<float> / 4) * translation(0, -2, 5));
+    WHEN("r <- ray_for_pixel(c, 100, 50)") {
+      constexpr auto r = ray_for_pixel(c, 100, 50);
+      constexpr auto half_sqrt2 = std::numbers::sqrt2_v<float> / 2;
+      THEN("r.origin = point(0, 2, -5)")
+      AND_THEN("r.direction = vector(√2/2, 0, -√2/2)") {
+        STATIC_REQUIRE(r.origin == point(0, 2, -5));
+        STATIC_REQUIRE(TupleUtil::magnitude(
+                           r.direction -
+                           vector(half_sqrt2, 0, -half_sqrt2)) < 0.0001f);
+      }
+    }
+  }
+}
+
+SCENARIO("Rendering a pixel of a world with a camera") {
+  GIVEN("w <- a world with the default spheres")
+  AND_GIVEN("c <- camera(11, 11, π/2) looking at the origin from z = -5") {
+    const auto pixel = [] {
+      World w;
+      w.add(PointLight(point(-10, 10, -10), Color(1, 1, 1)));
+      Material m1;
+      m1.color = Color(0.8f, 1.0f, 0.6f);
+      m1.diffuse = 0.7f;
+      m1.specular = 0.2f;
+      Sphere s1;
+      s1.material = w.add(m1);
+      w.add(s1);
+      w.add(Sphere{scaling(0.5f, 0.5f, 0.5f)});
+
+      const Camera c(
+          11, 11, std::numbers::pi_v<float> / 2,
+          view_transform(point(0, 0, -5), point(0, 0, 0), vector(0, 1, 0)));
+      return RenderUtil::render_pixel(c, w, 5, 5);
+    }();
+    THEN("the center pixel = color(0.38066, 0.47583, 0.2855)") {
+      REQUIRE(pixel == Color(0.38066f, 0.47583f, 0.2855f));
+    }
+  }
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <catch2/catch.hpp>
+#include <cmath>
 #include <string>
 #include <vector>
 
@@ -189,4 +190,193 @@ SCENARIO("PPM files are terminated by a newline character") {
       THEN("ppm ends with a newline character") { REQUIRE(ppm.back() == '\n'); }
     }
   }
-}
\ No newline at end of file
+}
+
+SCENARIO("Every canvas layout holds the same pixels") {
+  GIVEN("Canvases of 37x21 pixels in every layout")
+  AND_GIVEN("Every pixel is written with its own coordinates") {
+    std::vector<Canvas> canvases;
+    for (const auto layout : {CanvasLayout::RowMajor, CanvasLayout::Blocked,
+                              CanvasLayout::Morton}) {
+      Canvas c(37, 21, layout);
+      for (int y = 0; y < c.height(); ++y) {
+        for (int x = 0; x < c.width(); ++x) {
+          c.write_pixel(x, y, Color(static_cast<float>(x),
+                                    static_cast<float>(y), 0.f));
+        }
+      }
+      canvases.push_back(c);
+    }
+    THEN("pixel_at reads every pixel back") {
+      REQUIRE(canvases[1].layout() == CanvasLayout::Blocked);
+      REQUIRE(canvases[2].layout() == CanvasLayout::Morton);
+      for (const auto& c : canvases) {
+        REQUIRE(c.width() == 37);
+        REQUIRE(c.height() == 21);
+        for (int y = 0; y < c.height(); ++y) {
+          for (int x = 0; x < c.width(); ++x) {
+            REQUIRE(c.pixel_at(x, y) == Color(static_cast<float>(x),
+                                              static_cast<float>(y), 0.f));
+          }
+        }
+      }
+    }
+    AND_THEN("Iterating over a canvas visits the pixels in row-major order") {
+      for (const auto& c : canvases) {
+        int count = 0;
+        for (auto it = c.begin(); it != c.end(); ++it, ++count) {
+          REQUIRE(it.x() == count % 37);
+          REQUIRE(it.y() == count / 37);
+          REQUIRE(*it == Color(static_cast<float>(it.x()),
+                               static_cast<float>(it.y()), 0.f));
+        }
+        REQUIRE(count == 37 * 21);
+      }
+    }
+  }
+}
+
+SCENARIO("The PPM export does not depend on the canvas layout") {
+  GIVEN("c1 <- Canvas(19, 11)")
+  AND_GIVEN("c2 <- Canvas(19, 11, Blocked)")
+  AND_GIVEN("c3 <- Canvas(19, 11, Morton)") {
+    Canvas c1(19, 11);
+    Canvas c2(19, 11, CanvasLayout::Blocked);
+    Canvas c3(19, 11, CanvasLayout::Morton);
+    WHEN("The same gradient is written to all of them") {
+      for (int y = 0; y < 11; ++y) {
+        for (int x = 0; x < 19; ++x) {
+          const Color color(static_cast<float>(x) / 18.f,
+                            static_cast<float>(y) / 10.f, 0.5f);
+          c1.write_pixel(x, y, color);
+          c2.write_pixel(x, y, color);
+          c3.write_pixel(x, y, color);
+        }
+      }
+      THEN("Their pixels and PPM files are equal") {
+        REQUIRE(c2.pixels() == c1.pixels());
+        REQUIRE(c3.pixels() == c1.pixels());
+        REQUIRE(CanvasUtil::to_ppm(c2) == CanvasUtil::to_ppm(c1));
+        REQUIRE(CanvasUtil::to_ppm(c3) == CanvasUtil::to_ppm(c1));
+      }
+    }
+  }
+}
+
+SCENARIO("Canvases with reduced-precision pixel formats") {
+  GIVEN("c1 <- Canvas(16, 16)")
+  AND_GIVEN("c2 <- Canvas(16, 16, RowMajor, Half)")
+  AND_GIVEN("c3 <- Canvas(16, 16, Morton, Srgb8)") {
+    Canvas c1(16, 16);
+    Canvas c2(16, 16, CanvasLayout::RowMajor, PixelFormat::Half);
+    Canvas c3(16, 16, CanvasLayout::Morton, PixelFormat::Srgb8);
+    THEN("c2 takes half the memory of c1 and c3 a quarter") {
+      REQUIRE(c2.format() == PixelFormat::Half);
+      REQUIRE(c3.format() == PixelFormat::Srgb8);
+      REQUIRE(c2.memory_size() * 2 == c1.memory_size());
+      REQUIRE(c3.memory_size() * 4 == c1.memory_size());
+    }
+    WHEN("The same colors are written to all of them") {
+      std::vector<Color> row(16);
+      for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+          row[static_cast<std::size_t>(x)] =
+              Color(static_cast<float>(x) / 15.f, static_cast<float>(y) / 15.f,
+                    1.5f);
+        }
+        c1.write_row(y, row.data());
+        c2.write_row(y, row.data());
+        c3.write_row(y, row.data());
+      }
+      THEN("The half canvas keeps every color within half precision")
+      AND_THEN("The sRGB canvas clamps colors to [0, 1] within a code") {
+        std::vector<Color> read(16);
+        for (int y = 0; y < 16; ++y) {
+          c2.read_row(y, read.data());
+          for (int x = 0; x < 16; ++x) {
+            const auto expected = c1.pixel_at(x, y);
+            const auto half = read[static_cast<std::size_t>(x)];
+            REQUIRE(half == c2.pixel_at(x, y));
+            REQUIRE(std::abs(half.red - expected.red) <= 0x1p-11f);
+            REQUIRE(std::abs(half.green - expected.green) <= 0x1p-11f);
+            REQUIRE(half.blue == 1.5f);
+
+            const auto srgb = c3.pixel_at(x, y);
+            REQUIRE(std::abs(srgb.red - expected.red) < 0.01f);
+            REQUIRE(std::abs(srgb.green - expected.green) < 0.01f);
+            REQUIRE(srgb.blue == 1.f);
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("Reading PPM images") {
+  using namespace std::string_literals;
+
+  GIVEN("c <- Canvas(23, 7) with a gradient") {
+    Canvas c(23, 7);
+    for (int y = 0; y < 7; ++y) {
+      for (int x = 0; x < 23; ++x) {
+        c.write_pixel(x, y, Color(static_cast<float>(x) / 22.f,
+                                  static_cast<float>(y) / 6.f, 1.2f));
+      }
+    }
+    WHEN("image <- parse_ppm(to_ppm(c))") {
+      const auto ppm = CanvasUtil::to_ppm(c);
+      const auto image = CanvasUtil::parse_ppm(ppm);
+      THEN("image has the size of c and its pixels within quantization")
+      AND_THEN("to_ppm(image) = to_ppm(c)") {
+        REQUIRE(image.has_value());
+        REQUIRE(image->width() == 23);
+        REQUIRE(image->height() == 7);
+        for (int y = 0; y < 7; ++y) {
+          for (int x = 0; x < 23; ++x) {
+            const auto expected = c.pixel_at(x, y);
+            const auto pixel = image->pixel_at(x, y);
+            REQUIRE(std::abs(pixel.red - expected.red) <= 0.501f / 255.f);
+            REQUIRE(std::abs(pixel.green - expected.green) <= 0.501f / 255.f);
+            REQUIRE(pixel.blue == 1.f);
+          }
+        }
+        REQUIRE(CanvasUtil::to_ppm(*image) == ppm);
+      }
+    }
+  }
+  GIVEN("A P6 image with a comment and 8-bit samples") {
+    const auto p6 = "P6 # binary\n2 1\n255\n\x00\x80\xFF\x0A\x20\x0D"s;
+    THEN("parse_ppm reads the samples scaled by the maximum value") {
+      const auto image = CanvasUtil::parse_ppm(p6);
+      REQUIRE(image.has_value());
+      REQUIRE(image->pixel_at(0, 0) == Color(0, 128.f / 255.f, 1));
+      REQUIRE(image->pixel_at(1, 0) ==
+              Color(10.f / 255.f, 32.f / 255.f, 13.f / 255.f));
+    }
+  }
+  GIVEN("A P6 image with 16-bit samples and a P3 image with maximum 15") {
+    const auto p6 = "P6\n1 1\n1000\n\x01\xF4\x00\x00\x03\xE8"s;
+    const std::string p3("P3\n# comment\n2 1 15\n15 0 3\n\n5 15 0\n");
+    THEN("their samples are scaled by their maximum values") {
+      const auto wide = CanvasUtil::parse_ppm(p6);
+      REQUIRE(wide.has_value());
+      REQUIRE(wide->pixel_at(0, 0) == Color(0.5f, 0, 1));
+      const auto narrow = CanvasUtil::parse_ppm(p3);
+      REQUIRE(narrow.has_value());
+      REQUIRE(narrow->pixel_at(0, 0) == Color(1, 0, 0.2f));
+      REQUIRE(narrow->pixel_at(1, 0) == Color(1.f / 3.f, 1, 0));
+    }
+  }
+  GIVEN("Malformed images") {
+    THEN("parse_ppm returns nothing") {
+      REQUIRE_FALSE(CanvasUtil::parse_ppm("P5\n1 1\n255\n0").has_value());
+      REQUIRE_FALSE(
+          CanvasUtil::parse_ppm("P3\n2 1\n255\n0 0 0 1 1").has_value());
+      REQUIRE_FALSE(CanvasUtil::parse_ppm("P3\n1 1\n255\n0 x 0").has_value());
+      REQUIRE_FALSE(CanvasUtil::parse_ppm("P3\n0 1\n255\n").has_value());
+      REQUIRE_FALSE(
+          CanvasUtil::parse_ppm("P6\n60000 60000\n255\n\x01\x02").has_value());
+      REQUIRE_FALSE(CanvasUtil::load_ppm("missing/image.ppm").has_value());
+    }
+  }
+}
@@ -0,0 +1,91 @@
+#include <array>
+#include <catch2/catch.hpp>
+
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace RayUtil;
+
+SCENARIO("Intersecting a cone with a ray") {
+  GIVEN("shape <- Cone()") {
+    constexpr Cone shape;
+    WHEN("xs <- local_intersect(shape, r)") {
+      constexpr auto xs1 =
+          local_intersect(Ray{point(0, 0, -5), vector(0, 0, 1)}, shape);
+      constexpr auto xs2 = local_intersect(
+          Ray{point(0, 0, -5), normalize(vector(1, 1, 1))}, shape);
+      constexpr auto xs3 = local_intersect(
+          Ray{point(1, 1, -5), normalize(vector(-0.5f, -1, 1))}, shape);
+      THEN("xs.count = 2")
+      AND_THEN("xs[0].t = t0")
+      AND_THEN("xs[1].t = t1") {
+        STATIC_REQUIRE(xs1.size() == 2);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs1[0].t(), 5));
+        STATIC_REQUIRE(MathUtil::approx_equal(xs1[1].t(), 5));
+        STATIC_REQUIRE(xs2.size() == 2);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs2[0].t(), 8.66025f, 0.001f));
+        STATIC_REQUIRE(MathUtil::approx_equal(xs2[1].t(), 8.66025f, 0.001f));
+        STATIC_REQUIRE(xs3.size() == 2);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs3[0].t(), 4.55006f, 0.001f));
+        STATIC_REQUIRE(MathUtil::approx_equal(xs3[1].t(), 49.44994f, 0.01f));
+      }
+    }
+  }
+}
+
+SCENARIO("Intersecting a cone with a ray parallel to one of its halves") {
+  GIVEN("shape <- Cone()")
+  AND_GIVEN("direction <- normalize(vector(0, 1, 1))")
+  AND_GIVEN("r <- ray(point(0, 0, -1), direction)") {
+    constexpr Cone shape;
+    constexpr Ray r(point(0, 0, -1), normalize(vector(0, 1, 1)));
+    WHEN("xs <- local_intersect(shape, r)") {
+      constexpr auto xs = local_intersect(r, shape);
+      THEN("xs.count = 1")
+      AND_THEN("xs[0].t = 0.35355") {
+        STATIC_REQUIRE(xs.size() == 1);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs[0].t(), 0.35355f));
+      }
+    }
+  }
+}
+
+SCENARIO("Intersecting a cone's end caps") {
+  GIVEN("shape <- Cone()")
+  AND_GIVEN("shape.minimum <- -0.5")
+  AND_GIVEN("shape.maximum <- 0.5")
+  AND_GIVEN("shape.closed <- true") {
+    constexpr Cone shape{.minimum = -0.5f, .maximum = 0.5f, .closed = true};
+    WHEN("xs <- local_intersect(shape, r)") {
+      constexpr auto xs1 =
+          local_intersect(Ray{point(0, 0, -5), vector(0, 1, 0)}, shape);
+      constexpr auto xs2 = local_intersect(
+          Ray{point(0, 0, -0.25f), normalize(vector(0, 1, 1))}, shape);
+      constexpr auto xs3 =
+          local_intersect(Ray{point(0, 0, -0.25f), vector(0, 1, 0)}, shape);
+      THEN("xs.count = count") {
+        STATIC_REQUIRE(xs1.size() == 0);
+        STATIC_REQUIRE(xs2.size() == 2);
+        STATIC_REQUIRE(xs3.size() == 4);
+      }
+    }
+  }
+}
+
+SCENARIO("Computing the normal vector on a cone") {
+  GIVEN("shape <- Cone()") {
+    constexpr Cone shape;
+    WHEN("n <- local_normal_at(shape, point)") {
+      THEN("n = normal") {
+        STATIC_REQUIRE(shape.local_normal_at(point(0, 0, 0)) ==
+                       vector(0, 0, 0));
+        STATIC_REQUIRE(shape.local_normal_at(point(1, 1, 1)) ==
+                       vector(1, -MathUtil::sqrt(2.f), 1));
+        STATIC_REQUIRE(shape.local_normal_at(point(-1, -1, 0)) ==
+                       vector(-1, 1, 0));
+      }
+    }
+  }
+}
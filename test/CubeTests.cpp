@@ -0,0 +1,93 @@
+#include <array>
+#include <catch2/catch.hpp>
+
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace RayUtil;
+
+namespace {
+
+struct CubeHit {
+  Tuple origin;
+  Tuple direction;
+  float t1;
+  float t2;
+};
+
+struct CubeNormal {
+  Tuple point;
+  Tuple normal;
+};
+
+}  // namespace
+
+SCENARIO("A ray intersects a cube") {
+  GIVEN("c <- Cube()") {
+    constexpr Cube c;
+    constexpr std::array examples{
+        CubeHit{point(5, 0.5f, 0), vector(-1, 0, 0), 4, 6},    // +x
+        CubeHit{point(-5, 0.5f, 0), vector(1, 0, 0), 4, 6},    // -x
+        CubeHit{point(0.5f, 5, 0), vector(0, -1, 0), 4, 6},    // +y
+        CubeHit{point(0.5f, -5, 0), vector(0, 1, 0), 4, 6},    // -y
+        CubeHit{point(0.5f, 0, 5), vector(0, 0, -1), 4, 6},    // +z
+        CubeHit{point(0.5f, 0, -5), vector(0, 0, 1), 4, 6},    // -z
+        CubeHit{point(0, 0.5f, 0), vector(0, 0, 1), -1, 1}};  // inside
+    WHEN("xs <- local_intersect(c, r)") {
+      THEN("xs[0].t = t1")
+      AND_THEN("xs[1].t = t2") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&c](const CubeHit& e) {
+              const auto xs = local_intersect(Ray{e.origin, e.direction}, c);
+              return xs.size() == 2 && xs[0].t() == e.t1 &&
+                     xs[1].t() == e.t2;
+            }));
+      }
+    }
+  }
+}
+
+SCENARIO("A ray misses a cube") {
+  GIVEN("c <- Cube()") {
+    constexpr Cube c;
+    constexpr std::array rays{
+        Ray{point(-2, 0, 0), vector(0.2673f, 0.5345f, 0.8018f)},
+        Ray{point(0, -2, 0), vector(0.8018f, 0.2673f, 0.5345f)},
+        Ray{point(0, 0, -2), vector(0.5345f, 0.8018f, 0.2673f)},
+        Ray{point(2, 0, 2), vector(0, 0, -1)},
+        Ray{point(0, 2, 2), vector(0, -1, 0)},
+        Ray{point(2, 2, 0), vector(-1, 0, 0)}};
+    WHEN("xs <- local_intersect(c, r)") {
+      THEN("xs.count = 0") {
+        STATIC_REQUIRE(std::all_of(rays.begin(), rays.end(), [&c](auto r) {
+          return local_intersect(r, c).empty();
+        }));
+      }
+    }
+  }
+}
+
+SCENARIO("The normal on the surface of a cube") {
+  GIVEN("c <- Cube()") {
+    constexpr Cube c;
+    constexpr std::array examples{
+        CubeNormal{point(1, 0.5f, -0.8f), vector(1, 0, 0)},
+        CubeNormal{point(-1, -0.2f, 0.9f), vector(-1, 0, 0)},
+        CubeNormal{point(-0.4f, 1, -0.1f), vector(0, 1, 0)},
+        CubeNormal{point(0.3f, -1, -0.7f), vector(0, -1, 0)},
+        CubeNormal{point(-0.6f, 0.3f, 1), vector(0, 0, 1)},
+        CubeNormal{point(0.4f, 0.4f, -1), vector(0, 0, -1)},
+        CubeNormal{point(1, 1, 1), vector(1, 0, 0)},
+        CubeNormal{point(-1, -1, -1), vector(-1, 0, 0)}};
+    WHEN("normal <- local_normal_at(c, p)") {
+      THEN("normal = expected") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&c](const CubeNormal& e) {
+              return c.local_normal_at(e.point) == e.normal;
+            }));
+      }
+    }
+  }
+}
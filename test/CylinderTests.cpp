@@ -0,0 +1,175 @@
+#include <array>
+#include <catch2/catch.hpp>
+#include <limits>
+
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace RayUtil;
+
+namespace {
+
+struct RayExample {
+  Tuple origin;
+  Tuple direction;
+  size_t count;
+};
+
+struct NormalExample {
+  Tuple point;
+  Tuple normal;
+};
+
+}  // namespace
+
+SCENARIO("A ray misses a cylinder") {
+  GIVEN("cyl <- Cylinder()") {
+    constexpr Cylinder cyl;
+    constexpr std::array examples{
+        RayExample{point(1, 0, 0), vector(0, 1, 0), 0},
+        RayExample{point(0, 0, 0), vector(0, 1, 0), 0},
+        RayExample{point(0, 0, -5), normalize(vector(1, 1, 1)), 0}};
+    WHEN("xs <- local_intersect(cyl, r)") {
+      THEN("xs.count = 0") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&cyl](const RayExample& e) {
+              return local_intersect(Ray{e.origin, e.direction}, cyl).empty();
+            }));
+      }
+    }
+  }
+}
+
+SCENARIO("A ray strikes a cylinder") {
+  GIVEN("cyl <- Cylinder()") {
+    constexpr Cylinder cyl;
+    WHEN("xs <- local_intersect(cyl, r)") {
+      constexpr auto xs1 =
+          local_intersect(Ray{point(1, 0, -5), vector(0, 0, 1)}, cyl);
+      constexpr auto xs2 =
+          local_intersect(Ray{point(0, 0, -5), vector(0, 0, 1)}, cyl);
+      constexpr auto xs3 = local_intersect(
+          Ray{point(0.5f, 0, -5), normalize(vector(0.1f, 1, 1))}, cyl);
+      THEN("xs.count = 2")
+      AND_THEN("xs[0].t = t0")
+      AND_THEN("xs[1].t = t1") {
+        STATIC_REQUIRE(xs1.size() == 2);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs1[0].t(), 5));
+        STATIC_REQUIRE(MathUtil::approx_equal(xs1[1].t(), 5));
+        STATIC_REQUIRE(xs2.size() == 2);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs2[0].t(), 4));
+        STATIC_REQUIRE(MathUtil::approx_equal(xs2[1].t(), 6));
+        STATIC_REQUIRE(xs3.size() == 2);
+        STATIC_REQUIRE(MathUtil::approx_equal(xs3[0].t(), 6.80798f, 0.001f));
+        STATIC_REQUIRE(MathUtil::approx_equal(xs3[1].t(), 7.08872f, 0.001f));
+      }
+    }
+  }
+}
+
+SCENARIO("Normal vector on a cylinder") {
+  GIVEN("cyl <- Cylinder()") {
+    constexpr Cylinder cyl;
+    constexpr std::array examples{
+        NormalExample{point(1, 0, 0), vector(1, 0, 0)},
+        NormalExample{point(0, 5, -1), vector(0, 0, -1)},
+        NormalExample{point(0, -2, 1), vector(0, 0, 1)},
+        NormalExample{point(-1, 1, 0), vector(-1, 0, 0)}};
+    WHEN("n <- local_normal_at(cyl, point)") {
+      THEN("n = normal") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&cyl](const NormalExample& e) {
+              return cyl.local_normal_at(e.point) == e.normal;
+            }));
+      }
+    }
+  }
+}
+
+SCENARIO("The default minimum and maximum for a cylinder") {
+  GIVEN("cyl <- Cylinder()") {
+    constexpr Cylinder cyl;
+    THEN("cyl.minimum = -infinity")
+    AND_THEN("cyl.maximum = infinity")
+    AND_THEN("cyl.closed = false") {
+      STATIC_REQUIRE(cyl.minimum == -std::numeric_limits<float>::infinity());
+      STATIC_REQUIRE(cyl.maximum == std::numeric_limits<float>::infinity());
+      STATIC_REQUIRE_FALSE(cyl.closed);
+    }
+  }
+}
+
+SCENARIO("Intersecting a constrained cylinder") {
+  GIVEN("cyl <- Cylinder()")
+  AND_GIVEN("cyl.minimum <- 1")
+  AND_GIVEN("cyl.maximum <- 2") {
+    constexpr Cylinder cyl{.minimum = 1, .maximum = 2};
+    constexpr std::array examples{
+        RayExample{point(0, 1.5f, 0), normalize(vector(0.1f, 1, 0)), 0},
+        RayExample{point(0, 3, -5), vector(0, 0, 1), 0},
+        RayExample{point(0, 0, -5), vector(0, 0, 1), 0},
+        RayExample{point(0, 2, -5), vector(0, 0, 1), 0},
+        RayExample{point(0, 1, -5), vector(0, 0, 1), 0},
+        RayExample{point(0, 1.5f, -2), vector(0, 0, 1), 2}};
+    WHEN("xs <- local_intersect(cyl, r)") {
+      THEN("xs.count = count") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&cyl](const RayExample& e) {
+              return local_intersect(Ray{e.origin, e.direction}, cyl).size() ==
+                     e.count;
+            }));
+      }
+    }
+  }
+}
+
+SCENARIO("Intersecting the caps of a closed cylinder") {
+  GIVEN("cyl <- Cylinder()")
+  AND_GIVEN("cyl.minimum <- 1")
+  AND_GIVEN("cyl.maximum <- 2")
+  AND_GIVEN("cyl.closed <- true") {
+    constexpr Cylinder cyl{.minimum = 1, .maximum = 2, .closed = true};
+    constexpr std::array examples{
+        RayExample{point(0, 3, 0), vector(0, -1, 0), 2},
+        RayExample{point(0, 3, -2), normalize(vector(0, -1, 2)), 2},
+        RayExample{point(0, 4, -2), normalize(vector(0, -1, 1)), 2},
+        RayExample{point(0, 0, -2), normalize(vector(0, 1, 2)), 2},
+        RayExample{point(0, -1, -2), normalize(vector(0, 1, 1)), 2}};
+    WHEN("xs <- local_intersect(cyl, r)") {
+      THEN("xs.count = count")
+      AND_THEN("xs is sorted by distance") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&cyl](const RayExample& e) {
+              const auto xs = local_intersect(Ray{e.origin, e.direction}, cyl);
+              return xs.size() == e.count && xs[0].t() <= xs[1].t();
+            }));
+      }
+    }
+  }
+}
+
+SCENARIO("The normal vector on a cylinder's end caps") {
+  GIVEN("cyl <- Cylinder()")
+  AND_GIVEN("cyl.minimum <- 1")
+  AND_GIVEN("cyl.maximum <- 2")
+  AND_GIVEN("cyl.closed <- true") {
+    constexpr Cylinder cyl{.minimum = 1, .maximum = 2, .closed = true};
+    constexpr std::array examples{
+        NormalExample{point(0, 1, 0), vector(0, -1, 0)},
+        NormalExample{point(0.5f, 1, 0), vector(0, -1, 0)},
+        NormalExample{point(0, 1, 0.5f), vector(0, -1, 0)},
+        NormalExample{point(0, 2, 0), vector(0, 1, 0)},
+        NormalExample{point(0.5f, 2, 0), vector(0, 1, 0)},
+        NormalExample{point(0, 2, 0.5f), vector(0, 1, 0)}};
+    WHEN("n <- local_normal_at(cyl, point)") {
+      THEN("n = normal") {
+        STATIC_REQUIRE(std::all_of(
+            examples.begin(), examples.end(), [&cyl](const NormalExample& e) {
+              return cyl.local_normal_at(e.point) == e.normal;
+            }));
+      }
+    }
+  }
+}
@@ -0,0 +1,156 @@
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include "../src/Canvas.hpp"
+#include "../src/ImageDiff.hpp"
+#include "../src/Ppm.hpp"
+#include "../src/Render.hpp"
+#include "../src/Scene.hpp"
+
+namespace {
+
+// Reference scenes and their images, see golden/ThreeSpheres.scene
+const std::filesystem::path golden_directory =
+    std::filesystem::path(__FILE__).parent_path() / "golden";
+
+}  // namespace
+
+SCENARIO("Comparing identical images") {
+  GIVEN("an image and its copy") {
+    Canvas a(5, 3);
+    a.write_pixel(1, 2, Color(0.25f, 0.5f, 2.f));
+    const Canvas b = a;
+
+    WHEN("they are compared") {
+      const auto difference = ImageDiffUtil::compare(a, b);
+      REQUIRE(difference.has_value());
+
+      THEN("there are no errors and the PSNR is infinite") {
+        REQUIRE(difference->max_error == 0.f);
+        REQUIRE(difference->mean_error == 0.);
+        REQUIRE(difference->mse == 0.);
+        REQUIRE(difference->psnr == std::numeric_limits<double>::infinity());
+        REQUIRE(difference->differing_pixels == 0);
+      }
+    }
+  }
+}
+
+SCENARIO("Measuring the difference of two images") {
+  GIVEN("a black image and one with a red pixel, an overexposed pixel and "
+        "a dim pixel") {
+    const Canvas a(4, 6);
+    Canvas b(4, 6, CanvasLayout::Morton);
+    b.write_pixel(1, 1, Color(0.5f, 0, 0));
+    b.write_pixel(2, 4, Color(0, 0, 0.01f));
+    b.write_pixel(3, 5, Color(-1.f, 0, 0));
+    Canvas bright(4, 6);
+    bright.write_pixel(0, 0, Color(1.f, 1.f, 1.f));
+    Canvas brighter(4, 6);
+    brighter.write_pixel(0, 0, Color(4.f, 1.f, 1.f));
+
+    THEN("the errors are the differences of the clamped channels")
+    AND_THEN("they do not depend on the thread count") {
+      const double mse = (0.25 + 0.01 * 0.01) / 72.;
+      for (const unsigned threads : {1u, 4u, 0u}) {
+        const auto difference = ImageDiffUtil::compare(a, b, 0.05f, threads);
+        REQUIRE(difference.has_value());
+        REQUIRE(difference->max_error == 0.5f);
+        REQUIRE(difference->mean_error == Approx(0.51 / 72.));
+        REQUIRE(difference->mse == Approx(mse));
+        REQUIRE(difference->psnr == Approx(-10. * std::log10(mse)));
+        REQUIRE(difference->differing_pixels == 1);
+      }
+      REQUIRE(ImageDiffUtil::compare(a, b)->differing_pixels == 2);
+      REQUIRE(ImageDiffUtil::compare(bright, brighter)->max_error == 0.f);
+    }
+  }
+  GIVEN("images of different sizes") {
+    THEN("they cannot be compared") {
+      REQUIRE_FALSE(ImageDiffUtil::compare(Canvas(4, 6), Canvas(6, 4)));
+      REQUIRE_FALSE(ImageDiffUtil::heatmap(Canvas(4, 6), Canvas(4, 5)));
+    }
+  }
+}
+
+SCENARIO("Comparing PPM files") {
+  const auto directory = std::filesystem::temp_directory_path();
+  const auto a_path = directory / "image_diff_test_a.ppm";
+  const auto b_path = directory / "image_diff_test_b.ppm";
+
+  GIVEN("two PPM files with one differing pixel") {
+    Canvas a(3, 2);
+    Canvas b(3, 2);
+    b.write_pixel(2, 1, Color(0, 1, 0));
+    std::ofstream(a_path) << CanvasUtil::to_ppm(a);
+    std::ofstream(b_path) << CanvasUtil::to_ppm(b);
+
+    THEN("the files compare like the images") {
+      const auto difference = ImageDiffUtil::compare_files(a_path, b_path);
+      REQUIRE(difference.has_value());
+      REQUIRE(difference->max_error == 1.f);
+      REQUIRE(difference->differing_pixels == 1);
+      REQUIRE_FALSE(
+          ImageDiffUtil::compare_files(a_path, directory / "missing.ppm"));
+    }
+  }
+  std::filesystem::remove(a_path);
+  std::filesystem::remove(b_path);
+}
+
+SCENARIO("A heatmap shows the largest channel difference of every pixel") {
+  GIVEN("two images") {
+    const Canvas a(3, 1);
+    Canvas b(3, 1, CanvasLayout::Blocked);
+    b.write_pixel(1, 0, Color(0, 0.05f, 0.02f));
+    b.write_pixel(2, 0, Color(0.5f, 0.5f, 0.5f));
+
+    WHEN("map <- heatmap(a, b, 0.1)") {
+      const auto map = ImageDiffUtil::heatmap(a, b, 0.1f);
+      REQUIRE(map.has_value());
+
+      THEN("equal pixels are black and errors go from red to white") {
+        REQUIRE(map->pixel_at(0, 0) == Color(0, 0, 0));
+        REQUIRE(map->pixel_at(1, 0) == Color(1, 0.5f, 0));
+        REQUIRE(map->pixel_at(2, 0) == Color(1, 1, 1));
+        REQUIRE(ImageDiffUtil::heat(0.01f, 0.1f) == Color(0.3f, 0, 0));
+      }
+    }
+  }
+}
+
+SCENARIO("Rendering the golden scenes within bounded error") {
+  GIVEN("the golden three spheres scene and its reference image") {
+    const auto scene = SceneUtil::load(golden_directory / "ThreeSpheres.scene");
+    REQUIRE(scene.has_value());
+    const auto reference =
+        CanvasUtil::load_ppm(golden_directory / "ThreeSpheres.ppm");
+    REQUIRE(reference.has_value());
+
+    WHEN("it is rendered with several threads, tile sizes, layouts and "
+         "pixel formats") {
+      const RenderSettings settings[] = {
+          {1, 16, 4},
+          {4, 7, 4},
+          {3, 32, 4, 0, 0.1f, 0, CanvasLayout::Morton, PixelFormat::Half},
+          {2, 8, 4, 0, 0.1f, 0, CanvasLayout::Blocked, PixelFormat::Srgb8}};
+
+      THEN("every image matches the reference up to quantization errors") {
+        for (const auto& render_settings : settings) {
+          const auto image = RenderUtil::render(scene->camera, scene->world,
+                                                render_settings);
+          const auto difference =
+              ImageDiffUtil::compare(image, *reference, 0.f, 0);
+          REQUIRE(difference.has_value());
+          // Half a code for the reference and up to one and a half for
+          // sRGB values near white
+          REQUIRE(difference->max_error <= 2.f / 255.f);
+          REQUIRE(difference->psnr >= 50.);
+        }
+      }
+    }
+  }
+}
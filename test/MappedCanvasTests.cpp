@@ -0,0 +1,110 @@
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+#include "../src/MappedCanvas.hpp"
+#include "../src/MappedFile.hpp"
+#include "../src/PixelFormat.hpp"
+#include "../src/Ppm.hpp"
+#include "../src/Render.hpp"
+#include "../src/Scene.hpp"
+
+namespace {
+
+std::string read_file(const std::filesystem::path& path) {
+  const auto file = MappedFile::open(path);
+  return file ? std::string(file->view()) : std::string();
+}
+
+}  // namespace
+
+SCENARIO("A mapped canvas is a binary PPM file") {
+  const auto path =
+      std::filesystem::temp_directory_path() / "mapped_canvas_test.ppm";
+
+  GIVEN("c <- MappedCanvas(path, 4, 3)") {
+    auto c = MappedCanvas::create(path, 4, 3);
+    REQUIRE(c.has_value());
+
+    THEN("the file holds the P6 header and black pixels") {
+      REQUIRE(c->width() == 4);
+      REQUIRE(c->height() == 3);
+      REQUIRE(c->pixel_at(3, 2) == Color(0, 0, 0));
+      const auto contents = read_file(path);
+      REQUIRE(contents == "P6\n4 3\n255\n" + std::string(36, '\0'));
+    }
+    WHEN("pixels are written") {
+      c->write_pixel(0, 0, Color(1.5f, 0, 0));
+      c->write_pixel(2, 1, Color(0, 0.5f, 0));
+      c->write_pixel(3, 2, Color(-0.5f, 0, 1));
+      REQUIRE(c->flush());
+
+      THEN("their quantized values are stored at their offsets") {
+        const auto contents = read_file(path);
+        REQUIRE(contents.size() == 11 + 36);
+        const auto byte = [&](int x, int y, int channel) {
+          return static_cast<unsigned char>(
+              contents[static_cast<std::size_t>(11 + 3 * (y * 4 + x) +
+                                                channel)]);
+        };
+        REQUIRE(byte(0, 0, 0) == 255);
+        REQUIRE(byte(2, 1, 1) == 128);
+        REQUIRE(byte(3, 2, 0) == 0);
+        REQUIRE(byte(3, 2, 2) == 255);
+        REQUIRE(c->pixel_at(2, 1) == Color(0, 128.f / 255.f, 0));
+      }
+    }
+  }
+  std::filesystem::remove(path);
+
+  GIVEN("a path in a directory that does not exist") {
+    THEN("no canvas is created") {
+      REQUIRE_FALSE(MappedCanvas::create(path / "missing" / "image.ppm", 4, 3)
+                        .has_value());
+    }
+  }
+}
+
+SCENARIO("Rendering into a mapped canvas") {
+  const auto path =
+      std::filesystem::temp_directory_path() / "mapped_render_test.ppm";
+
+  GIVEN("a scene") {
+    const auto scene = SceneUtil::parse(
+        "camera 24 16 1.0472 from 0 1.5 -5 to 0 1 0 up 0 1 0\n"
+        "light -10 10 -10 1 1 1\n"
+        "plane\n"
+        "sphere translate 0 1 0\n");
+    REQUIRE(scene.has_value());
+
+    WHEN("it is rendered into a mapped canvas and into a canvas") {
+      const RenderSettings settings{2, 8, 1};
+      {
+        auto mapped = MappedCanvas::create(path, 24, 16);
+        REQUIRE(mapped.has_value());
+        RenderUtil::render_into(scene->camera, scene->world, *mapped,
+                                settings);
+      }
+      const auto image =
+          RenderUtil::render(scene->camera, scene->world, settings);
+
+      THEN("the file holds the quantized pixels of the canvas")
+      AND_THEN("reading the file back gives the exported canvas") {
+        const auto contents = read_file(path);
+        REQUIRE(contents.size() == 13 + 3 * 24 * 16);
+        std::size_t offset = 13;
+        for (const auto pixel : image) {
+          for (const float channel : {pixel.red, pixel.green, pixel.blue}) {
+            REQUIRE(static_cast<unsigned char>(contents[offset++]) ==
+                    PixelFormatUtil::linear_to_unorm8(channel));
+          }
+        }
+        const auto loaded = CanvasUtil::load_ppm(path);
+        REQUIRE(loaded.has_value());
+        REQUIRE(CanvasUtil::to_ppm(*loaded) == CanvasUtil::to_ppm(image));
+      }
+    }
+  }
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,173 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace RayUtil;
+using namespace MatrixUtil;
+
+namespace {
+
+// Triangle with p1 = (0, 1, 0), p2 = (-1, 0, 0), p3 = (1, 0, 0)
+constexpr TriangleMesh single_triangle() {
+  return TriangleMesh{.vertices = {0, 1, 0, -1, 0, 0, 1, 0, 0},
+                      .indices = {0, 1, 2}};
+}
+
+// Unit square on the z = 0 plane split along its diagonal
+constexpr TriangleMesh square() {
+  return TriangleMesh{.vertices = {-1, -1, 0, 1, -1, 0, 1, 1, 0, -1, 1, 0},
+                      .indices = {0, 1, 2, 0, 2, 3}};
+}
+
+constexpr auto hits(const Ray& ray, const TriangleMesh& mesh) {
+  std::vector<Intersection> xs;
+  local_intersect(ray, mesh, xs);
+  return xs;
+}
+
+}  // namespace
+
+SCENARIO("Constructing a triangle mesh") {
+  GIVEN("mesh <- TriangleMesh(p1, p2, p3)") {
+    constexpr auto counts = [] {
+      const auto mesh = single_triangle();
+      return std::pair{mesh.vertex_count(), mesh.triangle_count()};
+    }();
+    constexpr auto vertices_match = [] {
+      const auto [p1, p2, p3] = single_triangle().triangle(0);
+      return p1 == point(0, 1, 0) && p2 == point(-1, 0, 0) &&
+             p3 == point(1, 0, 0);
+    }();
+    constexpr auto normal = [] {
+      return single_triangle().local_normal_at(0);
+    }();
+    THEN("mesh has 3 vertices and 1 triangle")
+    AND_THEN("triangle(0) = (p1, p2, p3)")
+    AND_THEN("local_normal_at(mesh, 0) = vector(0, 0, -1)") {
+      STATIC_REQUIRE(counts.first == 3);
+      STATIC_REQUIRE(counts.second == 1);
+      STATIC_REQUIRE(vertices_match);
+      STATIC_REQUIRE(normal == vector(0, 0, -1));
+    }
+  }
+}
+
+SCENARIO("Intersecting a ray parallel to the triangle") {
+  GIVEN("r <- ray(point(0, -1, -2), vector(0, 1, 0))") {
+    constexpr Ray r(point(0, -1, -2), vector(0, 1, 0));
+    WHEN("xs <- local_intersect(mesh, r)") {
+      constexpr auto xs_empty = [&r] {
+        return hits(r, single_triangle()).empty();
+      }();
+      THEN("xs is empty") { STATIC_REQUIRE(xs_empty); }
+    }
+  }
+}
+
+SCENARIO("A ray misses the edges of a triangle") {
+  GIVEN("r1 misses the p1-p3 edge")
+  AND_GIVEN("r2 misses the p1-p2 edge")
+  AND_GIVEN("r3 misses the p2-p3 edge") {
+    constexpr Ray r1(point(1, 1, -2), vector(0, 0, 1));
+    constexpr Ray r2(point(-1, 1, -2), vector(0, 0, 1));
+    constexpr Ray r3(point(0, -1, -2), vector(0, 0, 1));
+    WHEN("xs <- local_intersect(mesh, r)") {
+      constexpr auto all_miss = [&] {
+        const auto mesh = single_triangle();
+        return hits(r1, mesh).empty() && hits(r2, mesh).empty() &&
+               hits(r3, mesh).empty();
+      }();
+      THEN("xs is empty") { STATIC_REQUIRE(all_miss); }
+    }
+  }
+}
+
+SCENARIO("A ray strikes a triangle") {
+  GIVEN("r <- ray(point(0, 0.5, -2), vector(0, 0, 1))") {
+    constexpr Ray r(point(0, 0.5f, -2), vector(0, 0, 1));
+    WHEN("xs <- local_intersect(mesh, r)") {
+      constexpr auto xs = [&r] {
+        const auto result = hits(r, single_triangle());
+        return std::pair{result.size(), result[0]};
+      }();
+      THEN("xs.count = 1")
+      AND_THEN("xs[0].t = 2")
+      AND_THEN("xs[0].primitive = 0") {
+        STATIC_REQUIRE(xs.first == 1);
+        STATIC_REQUIRE(xs.second.t() == 2);
+        STATIC_REQUIRE(xs.second.object_type() == ShapeType::TriangleMesh);
+        STATIC_REQUIRE(xs.second.primitive() == 0);
+      }
+    }
+  }
+}
+
+SCENARIO("A ray through a shared edge never falls through the mesh") {
+  GIVEN("mesh <- square split along its diagonal")
+  AND_GIVEN("r <- ray(point(0.25, 0.25, -1), vector(0, 0, 1))") {
+    constexpr Ray r(point(0.25f, 0.25f, -1), vector(0, 0, 1));
+    WHEN("xs <- local_intersect(mesh, r)") {
+      constexpr auto xs = [&r] {
+        const auto result = hits(r, square());
+        return std::pair{result.size(), result.empty() ? 0.f : result[0].t()};
+      }();
+      THEN("xs is not empty")
+      AND_THEN("xs[0].t = 1") {
+        STATIC_REQUIRE(xs.first >= 1);
+        STATIC_REQUIRE(xs.second == 1);
+      }
+    }
+  }
+}
+
+SCENARIO("The packet kernel agrees with the scalar kernel") {
+  GIVEN("mesh <- square scaled by 2")
+  AND_GIVEN("packed <- mesh with pack(mesh)") {
+    constexpr std::array rays{Ray{point(0.5f, -0.5f, -3), vector(0, 0, 1)},
+                              Ray{point(-0.5f, 0.5f, 3), vector(0, 0, -1)},
+                              Ray{point(3, 3, -3), vector(0, 0, 1)},
+                              Ray{point(0, 0, -3), normalize(vector(1, 1, 3))}};
+    WHEN("xs1 <- local_intersect(mesh, r)")
+    AND_WHEN("xs2 <- local_intersect(packed, r)") {
+      constexpr auto agree = [&rays] {
+        auto mesh = square();
+        auto packed = square();
+        packed.packets = MeshUtil::pack(packed);
+        return std::all_of(rays.begin(), rays.end(), [&](const Ray& r) {
+          return hits(r, mesh) == hits(r, packed);
+        });
+      }();
+      THEN("xs1 = xs2") { STATIC_REQUIRE(agree); }
+    }
+  }
+}
+
+SCENARIO("Intersecting a transformed mesh through the shape variant") {
+  GIVEN("s <- Shape(TriangleMesh with translation(0, 0, 5))")
+  AND_GIVEN("r <- ray(point(0, 0.5, -2), vector(0, 0, 1))") {
+    constexpr Ray r(point(0, 0.5f, -2), vector(0, 0, 1));
+    WHEN("xs <- intersect(r, s)")
+    AND_WHEN("n <- normal_at(s, position(r, xs[0].t), xs[0].primitive)") {
+      constexpr auto result = [&r] {
+        auto mesh = single_triangle();
+        mesh.transform = translation(0, 0, 5);
+        const Shape s = mesh;
+        std::vector<Intersection> xs;
+        intersect(r, s, xs);
+        const auto n =
+            ShapeUtil::normal_at(s, position(r, xs[0].t()), xs[0].primitive());
+        return std::pair{xs[0].t(), n};
+      }();
+      THEN("xs[0].t = 7")
+      AND_THEN("n = vector(0, 0, -1)") {
+        STATIC_REQUIRE(result.first == 7);
+        STATIC_REQUIRE(result.second == vector(0, 0, -1));
+      }
+    }
+  }
+}
@@ -0,0 +1,202 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "../src/Obj.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+
+SCENARIO("Parsing numbers without allocating") {
+  GIVEN("OBJ number tokens") {
+    constexpr auto parse_float = [](std::string_view text) {
+      const char* it = text.data();
+      return ObjUtil::detail::parse_float(it, text.data() + text.size());
+    };
+    constexpr auto parse_int = [](std::string_view text) {
+      const char* it = text.data();
+      return ObjUtil::detail::parse_int(it, text.data() + text.size());
+    };
+    THEN("floats are parsed with sign, fraction and exponent")
+    AND_THEN("integers keep their sign")
+    AND_THEN("malformed tokens are rejected") {
+      STATIC_REQUIRE(parse_float("1") == 1.f);
+      STATIC_REQUIRE(parse_float("-0.5") == -0.5f);
+      STATIC_REQUIRE(parse_float("+.25") == 0.25f);
+      STATIC_REQUIRE(parse_float("1.5e3") == 1500.f);
+      STATIC_REQUIRE(parse_float("-2.5E-2") == -0.025f);
+      STATIC_REQUIRE(parse_float("0.000001") == 0.000001f);
+      STATIC_REQUIRE_FALSE(parse_float("x").has_value());
+      STATIC_REQUIRE_FALSE(parse_float("1e").has_value());
+      STATIC_REQUIRE(parse_int("42") == 42);
+      STATIC_REQUIRE(parse_int("-3") == -3);
+      STATIC_REQUIRE_FALSE(parse_int("/").has_value());
+    }
+  }
+}
+
+SCENARIO("Ignoring unrecognized lines") {
+  GIVEN(R"(gibberish <- a file containing:
+            """
+            There was a young lady named Bright
+            who traveled much faster than light.
+            She set out one day
+            in a relative way,
+            and came back the previous night.
+            """)") {
+    constexpr std::string_view gibberish =
+        "There was a young lady named Bright\n"
+        "who traveled much faster than light.\n"
+        "She set out one day\n"
+        "in a relative way,\n"
+        "and came back the previous night.\n";
+    WHEN("mesh <- parse(gibberish)") {
+      constexpr auto empty = [&gibberish] {
+        const auto mesh = ObjUtil::parse(gibberish);
+        return mesh && mesh->vertex_count() == 0 && mesh->triangle_count() == 0;
+      }();
+      THEN("mesh is empty") { STATIC_REQUIRE(empty); }
+    }
+  }
+}
+
+SCENARIO("Vertex records") {
+  GIVEN("file <- four vertices, normals and texture coordinates") {
+    constexpr std::string_view file =
+        "v -1 1 0\n"
+        "vn 0 0 1\n"
+        "v -1.0000 0.5000 0.0000\n"
+        "vt 0.5 0.5\n"
+        "v 1 0 0\n"
+        "  v 1 1 0\r\n";
+    WHEN("mesh <- parse(file)") {
+      constexpr auto vertices_match = [&file] {
+        const auto mesh = ObjUtil::parse(file);
+        return mesh->vertex_count() == 4 &&
+               mesh->vertex(0) == point(-1, 1, 0) &&
+               mesh->vertex(1) == point(-1, 0.5f, 0) &&
+               mesh->vertex(2) == point(1, 0, 0) &&
+               mesh->vertex(3) == point(1, 1, 0);
+      }();
+      THEN("mesh.vertices are the v records") {
+        STATIC_REQUIRE(vertices_match);
+      }
+    }
+  }
+}
+
+SCENARIO("Parsing faces and triangulating polygons") {
+  GIVEN("file <- a triangle and a pentagon with texture/normal references") {
+    constexpr std::string_view file =
+        "v -1 1 0\n"
+        "v -1 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 2 0\n"
+        "f 1 2 3\n"
+        "f 1/1 2//2 3/3/3 4 -1\n";
+    WHEN("mesh <- parse(file)") {
+      constexpr auto indices_match = [&file] {
+        const auto mesh = ObjUtil::parse(file);
+        return mesh->indices == std::vector<std::uint32_t>{
+                                    0, 1, 2, 0, 1, 2, 0, 2, 3, 0, 3, 4};
+      }();
+      THEN("the pentagon becomes a fan of three triangles") {
+        STATIC_REQUIRE(indices_match);
+      }
+    }
+  }
+}
+
+SCENARIO("Rejecting faces that reference missing vertices") {
+  GIVEN("file <- a face referencing vertex 4 of 3") {
+    constexpr std::string_view file =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 0 1 0\n"
+        "f 1 2 4\n";
+    WHEN("mesh <- parse(file)") {
+      constexpr auto rejected = [&file] {
+        return !ObjUtil::parse(file).has_value();
+      }();
+      THEN("nothing is returned") { STATIC_REQUIRE(rejected); }
+    }
+  }
+}
+
+SCENARIO("Rejecting face indices that do not fit in 32 bits") {
+  GIVEN("file <- a face whose index wraps to vertex 1 in 32 bits") {
+    constexpr std::string_view file =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 0 1 0\n"
+        "f 4294967297 2 3\n";
+    WHEN("mesh <- parse(file)") {
+      constexpr auto rejected = [&file] {
+        return !ObjUtil::parse(file).has_value();
+      }();
+      THEN("nothing is returned") { STATIC_REQUIRE(rejected); }
+    }
+  }
+  GIVEN("file <- a face with a relative index below -2^32") {
+    constexpr std::string_view file =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 0 1 0\n"
+        "f 1 2 -4294967297\n";
+    WHEN("mesh <- parse(file)") {
+      constexpr auto rejected = [&file] {
+        return !ObjUtil::parse(file).has_value();
+      }();
+      THEN("nothing is returned") { STATIC_REQUIRE(rejected); }
+    }
+  }
+}
+
+SCENARIO("Parsing in parallel gives the same mesh") {
+  GIVEN("text <- a strip of quads using relative indices") {
+    std::string text;
+    for (int i = 0; i < 500; ++i) {
+      text += "v " + std::to_string(i) + " 0 0\n";
+      text += "v " + std::to_string(i) + " 1 0\n";
+      if (i > 0) text += "f -4 -3 -1 -2\n";
+    }
+    WHEN("serial <- parse(text)")
+    AND_WHEN("parallel <- parse(text, 7 threads)") {
+      const auto serial = ObjUtil::parse(text);
+      const auto parallel = ObjUtil::parse(text, 7);
+      THEN("both meshes are identical") {
+        REQUIRE(serial.has_value());
+        REQUIRE(parallel.has_value());
+        REQUIRE(serial->triangle_count() == 998);
+        REQUIRE(parallel->vertices == serial->vertices);
+        REQUIRE(parallel->indices == serial->indices);
+      }
+    }
+  }
+}
+
+SCENARIO("Loading a mesh from a memory-mapped file") {
+  GIVEN("a file containing a triangle") {
+    const auto path =
+        std::filesystem::temp_directory_path() / "obj_tests_triangle.obj";
+    {
+      std::ofstream file(path);
+      file << "v 0 1 0\nv -1 0 0\nv 1 0 0\nf 1 2 3\n";
+    }
+    WHEN("mesh <- load(path)") {
+      const auto mesh = ObjUtil::load(path, 2);
+      const auto missing = ObjUtil::load(path.string() + ".missing");
+      THEN("mesh has one triangle")
+      AND_THEN("loading a missing file returns nothing") {
+        REQUIRE(mesh.has_value());
+        REQUIRE(mesh->triangle_count() == 1);
+        REQUIRE(mesh->vertex(0) == point(0, 1, 0));
+        REQUIRE_FALSE(missing.has_value());
+      }
+    }
+    std::filesystem::remove(path);
+  }
+}
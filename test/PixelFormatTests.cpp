@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "../src/PixelFormat.hpp"
+
+SCENARIO("Converting floats to half floats") {
+  using namespace PixelFormatUtil;
+
+  GIVEN("Values exactly representable as halves") {
+    THEN("They convert to their binary16 encoding") {
+      STATIC_REQUIRE(float_to_half(0.f) == 0x0000);
+      STATIC_REQUIRE(float_to_half(-0.f) == 0x8000);
+      STATIC_REQUIRE(float_to_half(1.f) == 0x3C00);
+      STATIC_REQUIRE(float_to_half(-2.f) == 0xC000);
+      STATIC_REQUIRE(float_to_half(0.5f) == 0x3800);
+      STATIC_REQUIRE(float_to_half(65504.f) == 0x7BFF);
+      STATIC_REQUIRE(float_to_half(0x1p-14f) == 0x0400);
+      STATIC_REQUIRE(float_to_half(0x1p-24f) == 0x0001);
+    }
+  }
+  GIVEN("Values between two halves") {
+    THEN("They round to the nearest half, ties to even") {
+      STATIC_REQUIRE(float_to_half(1.f + 0x1p-11f) == 0x3C00);
+      STATIC_REQUIRE(float_to_half(1.f + 3 * 0x1p-11f) == 0x3C02);
+      STATIC_REQUIRE(float_to_half(1.f + 0x1.2p-11f) == 0x3C01);
+      STATIC_REQUIRE(float_to_half(0x1p-25f) == 0x0000);
+      STATIC_REQUIRE(float_to_half(0x1.8p-24f) == 0x0002);
+      STATIC_REQUIRE(float_to_half(0x1.ffcp-15f) == 0x0400);
+    }
+  }
+  GIVEN("Values beyond the half range") {
+    THEN("They become infinities and NaNs stay NaNs") {
+      STATIC_REQUIRE(float_to_half(65519.f) == 0x7BFF);
+      STATIC_REQUIRE(float_to_half(65520.f) == 0x7C00);
+      STATIC_REQUIRE(float_to_half(-1e10f) == 0xFC00);
+      STATIC_REQUIRE(float_to_half(std::numeric_limits<float>::infinity()) ==
+                     0x7C00);
+      STATIC_REQUIRE(
+          (float_to_half(std::numeric_limits<float>::quiet_NaN()) & 0x7FFF) >
+          0x7C00);
+    }
+  }
+}
+
+SCENARIO("Half floats convert back to the floats they came from") {
+  using namespace PixelFormatUtil;
+
+  GIVEN("Every finite half") {
+    THEN("half_to_float(h) converts back to h") {
+      STATIC_REQUIRE(half_to_float(0x3C00) == 1.f);
+      STATIC_REQUIRE(half_to_float(0x0001) == 0x1p-24f);
+      STATIC_REQUIRE(half_to_float(0x8001) == -0x1p-24f);
+      STATIC_REQUIRE(half_to_float(0x7BFF) == 65504.f);
+      for (std::uint32_t half = 0; half < 0x10000; ++half) {
+        if ((half & 0x7C00u) == 0x7C00u) continue;
+        const auto h = static_cast<std::uint16_t>(half);
+        REQUIRE(float_to_half(half_to_float(h)) == h);
+      }
+    }
+  }
+}
+
+SCENARIO("Encoding linear values as 8-bit sRGB") {
+  using namespace PixelFormatUtil;
+
+  const auto reference = [](float value) {
+    const auto v = std::clamp(static_cast<double>(value), 0., 1.);
+    const auto encoded =
+        v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+    return static_cast<int>(std::lround(encoded * 255));
+  };
+
+  GIVEN("Every sRGB code") {
+    THEN("Decoding and encoding it gives the code back") {
+      for (int code = 0; code < 256; ++code) {
+        const auto byte = static_cast<std::uint8_t>(code);
+        REQUIRE(linear_to_srgb8(srgb8_to_linear(byte)) == byte);
+      }
+      REQUIRE(srgb8_to_linear(0) == 0.f);
+      REQUIRE(srgb8_to_linear(255) == 1.f);
+    }
+  }
+  GIVEN("Values spread over [0, 1] and beyond") {
+    THEN("They encode to the nearest sRGB code") {
+      for (int i = -10; i <= 100010; ++i) {
+        const auto value = static_cast<float>(i) / 100000.f;
+        REQUIRE(linear_to_srgb8(value) == reference(value));
+      }
+      REQUIRE(linear_to_srgb8(std::numeric_limits<float>::quiet_NaN()) == 0);
+      REQUIRE(linear_to_srgb8(7.f) == 255);
+    }
+  }
+}
@@ -0,0 +1,115 @@
+#include <catch2/catch.hpp>
+
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace RayUtil;
+using namespace MatrixUtil;
+
+SCENARIO("The normal of a plane is constant everywhere") {
+  GIVEN("p <- Plane()") {
+    constexpr Plane p;
+    WHEN("n1 <- local_normal_at(p, point(0, 0, 0))")
+    AND_WHEN("n2 <- local_normal_at(p, point(10, 0, -10))")
+    AND_WHEN("n3 <- local_normal_at(p, point(-5, 0, 150))") {
+      constexpr auto n1 = p.local_normal_at(point(0, 0, 0));
+      constexpr auto n2 = p.local_normal_at(point(10, 0, -10));
+      constexpr auto n3 = p.local_normal_at(point(-5, 0, 150));
+      THEN("n1 = vector(0, 1, 0)")
+      AND_THEN("n2 = vector(0, 1, 0)")
+      AND_THEN("n3 = vector(0, 1, 0)") {
+        STATIC_REQUIRE(n1 == vector(0, 1, 0));
+        STATIC_REQUIRE(n2 == vector(0, 1, 0));
+        STATIC_REQUIRE(n3 == vector(0, 1, 0));
+      }
+    }
+  }
+}
+
+SCENARIO("Intersect with a ray parallel to the plane") {
+  GIVEN("p <- Plane()")
+  AND_GIVEN("r <- ray(point(0, 10, 0), vector(0, 0, 1))") {
+    constexpr Plane p;
+    constexpr Ray r(point(0, 10, 0), vector(0, 0, 1));
+    WHEN("xs <- local_intersect(p, r)") {
+      constexpr auto xs = local_intersect(r, p);
+      THEN("xs is empty") { STATIC_REQUIRE(xs.empty()); }
+    }
+  }
+}
+
+SCENARIO("Intersect with a coplanar ray") {
+  GIVEN("p <- Plane()")
+  AND_GIVEN("r <- ray(point(0, 0, 0), vector(0, 0, 1))") {
+    constexpr Plane p;
+    constexpr Ray r(point(0, 0, 0), vector(0, 0, 1));
+    WHEN("xs <- local_intersect(p, r)") {
+      constexpr auto xs = local_intersect(r, p);
+      THEN("xs is empty") { STATIC_REQUIRE(xs.empty()); }
+    }
+  }
+}
+
+SCENARIO("A ray intersecting a plane from above") {
+  GIVEN("p <- Plane()")
+  AND_GIVEN("r <- ray(point(0, 1, 0), vector(0, -1, 0))") {
+    constexpr Plane p;
+    constexpr Ray r(point(0, 1, 0), vector(0, -1, 0));
+    WHEN("xs <- local_intersect(p, r)") {
+      constexpr auto xs = local_intersect(r, p);
+      THEN("xs.count = 1")
+      AND_THEN("xs[0].t = 1")
+      AND_THEN("xs[0].object = p") {
+        STATIC_REQUIRE(xs.size() == 1);
+        STATIC_REQUIRE(xs[0].t() == 1);
+        STATIC_REQUIRE(xs[0].object_type() == ShapeType::Plane);
+      }
+    }
+  }
+}
+
+SCENARIO("A ray intersecting a plane from below") {
+  GIVEN("p <- Plane()")
+  AND_GIVEN("r <- ray(point(0, -1, 0), vector(0, 1, 0))") {
+    constexpr Plane p;
+    constexpr Ray r(point(0, -1, 0), vector(0, 1, 0));
+    WHEN("xs <- local_intersect(p, r)") {
+      constexpr auto xs = local_intersect(r, p);
+      THEN("xs.count = 1")
+      AND_THEN("xs[0].t = 1")
+      AND_THEN("xs[0].object = p") {
+        STATIC_REQUIRE(xs.size() == 1);
+        STATIC_REQUIRE(xs[0].t() == 1);
+        STATIC_REQUIRE(xs[0].object_type() == ShapeType::Plane);
+      }
+    }
+  }
+}
+
+SCENARIO("Intersecting a shape variant dispatches to the primitive") {
+  GIVEN("s <- Shape(Plane(translation(0, 2, 0)))")
+  AND_GIVEN("r <- ray(point(0, 5, 0), vector(0, -1, 0))") {
+    constexpr Shape s = Plane{translation(0, 2, 0)};
+    constexpr Ray r(point(0, 5, 0), vector(0, -1, 0));
+    WHEN("xs <- intersect(r, s)")
+    AND_WHEN("n <- normal_at(s, point(0, 2, 0))") {
+      constexpr auto xs = [&r, &s] {
+        StaticVector<Intersection, 4> result;
+        intersect(r, s, result);
+        return result;
+      }();
+      constexpr auto n = ShapeUtil::normal_at(s, point(0, 2, 0));
+      THEN("xs.count = 1")
+      AND_THEN("xs[0].t = 3")
+      AND_THEN("n = vector(0, 1, 0)") {
+        STATIC_REQUIRE(ShapeUtil::object_type(s) == ShapeType::Plane);
+        STATIC_REQUIRE(xs.size() == 1);
+        STATIC_REQUIRE(xs[0].t() == 3);
+        STATIC_REQUIRE(n == vector(0, 1, 0));
+      }
+    }
+  }
+}
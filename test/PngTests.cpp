@@ -0,0 +1,182 @@
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/Canvas.hpp"
+#include "../src/PixelFormat.hpp"
+#include "../src/Png.hpp"
+
+namespace {
+
+std::uint32_t read_u32(std::string_view data, std::size_t offset) {
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i < 4; ++i)
+    value = value << 8 | static_cast<unsigned char>(data[offset + i]);
+  return value;
+}
+
+/*
+  Inflates a zlib stream made of fixed-Huffman blocks, the only kind the
+  writer produces
+*/
+std::vector<std::uint8_t> inflate_fixed(std::string_view zlib) {
+  using namespace PngUtil::detail;
+
+  std::size_t bit = 16;  // after the zlib header
+  const auto read_bit = [&] {
+    const auto byte = static_cast<unsigned char>(zlib[bit / 8]);
+    return (byte >> (bit++ % 8)) & 1u;
+  };
+  const auto read_bits = [&](int count) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < count; ++i) value |= read_bit() << i;
+    return value;
+  };
+  const auto read_symbol = [&] {
+    std::uint32_t code = 0;
+    for (int length = 1; length <= 9; ++length) {
+      code = code << 1 | read_bit();
+      if (length == 7 && code <= 0x17u) return code + 256u;
+      if (length == 8 && code >= 0x30u && code <= 0xBFu) return code - 0x30u;
+      if (length == 8 && code >= 0xC0u && code <= 0xC7u)
+        return code - 0xC0u + 280u;
+      if (length == 9) return code - 0x190u + 144u;
+    }
+    return 0u;
+  };
+
+  std::vector<std::uint8_t> out;
+  for (bool final = false; !final;) {
+    final = read_bits(1) == 1;
+    REQUIRE(read_bits(2) == 1);
+    for (auto symbol = read_symbol(); symbol != 256; symbol = read_symbol()) {
+      if (symbol < 256) {
+        out.push_back(static_cast<std::uint8_t>(symbol));
+        continue;
+      }
+      const auto code = symbol - 257u;
+      const auto length = length_base[code] + read_bits(length_extra[code]);
+      std::uint32_t distance_symbol = 0;
+      for (int i = 0; i < 5; ++i)
+        distance_symbol = distance_symbol << 1 | read_bit();
+      const auto distance = distance_base[distance_symbol] +
+                            read_bits(distance_extra[distance_symbol]);
+      for (std::uint32_t i = 0; i < length; ++i)
+        out.push_back(out[out.size() - distance]);
+    }
+  }
+
+  std::uint32_t a = 1;
+  std::uint32_t b = 0;
+  for (const auto byte : out) {
+    a = (a + byte) % 65521u;
+    b = (b + a) % 65521u;
+  }
+  REQUIRE(read_u32(zlib, (bit + 7) / 8) == (b << 16 | a));
+  return out;
+}
+
+/*
+  Undoes the PNG filters of every row
+*/
+std::vector<std::uint8_t> unfilter(const std::vector<std::uint8_t>& data,
+                                   std::size_t stride) {
+  std::vector<std::uint8_t> rgb;
+  std::vector<int> previous(stride);
+  for (std::size_t row = 0; row * (stride + 1) < data.size(); ++row) {
+    const auto filter = data[row * (stride + 1)];
+    std::vector<int> current(stride);
+    for (std::size_t i = 0; i < stride; ++i) {
+      const int a = i >= 3 ? current[i - 3] : 0;
+      const int b = previous[i];
+      const int c = i >= 3 ? previous[i - 3] : 0;
+      int predictor = 0;
+      if (filter == 1) predictor = a;
+      if (filter == 2) predictor = b;
+      if (filter == 3) predictor = (a + b) / 2;
+      if (filter == 4) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+      }
+      current[i] = (data[row * (stride + 1) + 1 + i] + predictor) & 0xFF;
+      rgb.push_back(static_cast<std::uint8_t>(current[i]));
+    }
+    previous = current;
+  }
+  return rgb;
+}
+
+std::vector<std::uint8_t> quantized(const Canvas& canvas) {
+  std::vector<std::uint8_t> rgb;
+  for (const auto pixel : canvas) {
+    for (const float channel : {pixel.red, pixel.green, pixel.blue})
+      rgb.push_back(PixelFormatUtil::linear_to_unorm8(channel));
+  }
+  return rgb;
+}
+
+}  // namespace
+
+SCENARIO("Computing PNG chunk checksums") {
+  GIVEN("The standard check input and a chunk type") {
+    THEN("Their CRC-32 match the reference values") {
+      STATIC_REQUIRE(PngUtil::crc32("123456789") == 0xCBF43926u);
+      STATIC_REQUIRE(PngUtil::crc32("IEND") == 0xAE426082u);
+    }
+  }
+}
+
+SCENARIO("Encoding a canvas as PNG") {
+  GIVEN("c <- Canvas(150, 160) larger than one deflate block") {
+    Canvas c(150, 160);
+    for (int y = 0; y < 160; ++y) {
+      for (int x = 0; x < 150; ++x) {
+        c.write_pixel(x, y,
+                      Color(static_cast<float>(x % 9) / 8.f,
+                            static_cast<float>((x * y) % 31) / 30.f,
+                            y < 80 ? 0.5f : static_cast<float>(x) / 149.f));
+      }
+    }
+    WHEN("png <- to_png(c)") {
+      const auto png = CanvasUtil::to_png(c);
+      const std::string_view view(png);
+
+      THEN("png starts with the signature and an RGB IHDR chunk")
+      AND_THEN("every chunk has a valid CRC and the file ends with IEND")
+      AND_THEN("inflating and unfiltering the data gives the pixels of c") {
+        REQUIRE(view.substr(0, 8) == std::string_view("\x89PNG\r\n\x1A\n", 8));
+        REQUIRE(view.substr(12, 4) == "IHDR");
+        REQUIRE(read_u32(view, 16) == 150);
+        REQUIRE(read_u32(view, 20) == 160);
+        REQUIRE(view[24] == 8);
+        REQUIRE(view[25] == 2);
+
+        std::string idat;
+        std::string_view last_type;
+        for (std::size_t offset = 8; offset < view.size();) {
+          const auto length = read_u32(view, offset);
+          const auto type = view.substr(offset + 4, 4);
+          const auto body = view.substr(offset + 8, length);
+          REQUIRE(read_u32(view, offset + 8 + length) ==
+                  PngUtil::crc32(view.substr(offset + 4, 4 + length)));
+          if (type == "IDAT") idat += body;
+          last_type = type;
+          offset += 12 + length;
+        }
+        REQUIRE(last_type == "IEND");
+
+        const auto data = inflate_fixed(idat);
+        REQUIRE(data.size() == 160 * (3 * 150 + 1));
+        REQUIRE(unfilter(data, 3 * 150) == quantized(c));
+        REQUIRE(png.size() < data.size());
+      }
+    }
+  }
+}
@@ -0,0 +1,110 @@
+#include <array>
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../src/Canvas.hpp"
+#include "../src/PixelFormat.hpp"
+#include "../src/Qoi.hpp"
+
+namespace {
+
+std::uint32_t read_u32(const std::string& data, std::size_t offset) {
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i < 4; ++i)
+    value = value << 8 | static_cast<unsigned char>(data[offset + i]);
+  return value;
+}
+
+/*
+  Reference QOI decoder following the specification, RGB output
+*/
+std::vector<std::uint8_t> decode_qoi(const std::string& data) {
+  const auto pixels =
+      std::size_t{read_u32(data, 4)} * std::size_t{read_u32(data, 8)};
+  std::array<std::array<int, 4>, 64> index{};
+  std::array<int, 4> pixel{0, 0, 0, 255};
+  std::vector<std::uint8_t> rgb;
+  std::size_t i = 14;
+  int run = 0;
+  const auto byte = [&] { return static_cast<unsigned char>(data[i++]); };
+
+  for (std::size_t p = 0; p < pixels; ++p) {
+    if (run > 0) {
+      --run;
+    } else {
+      const int op = byte();
+      if (op == 0xFE) {
+        pixel[0] = byte();
+        pixel[1] = byte();
+        pixel[2] = byte();
+      } else if (op >> 6 == 0) {
+        pixel = index[static_cast<std::size_t>(op)];
+      } else if (op >> 6 == 1) {
+        pixel[0] = (pixel[0] + ((op >> 4) & 3) - 2) & 0xFF;
+        pixel[1] = (pixel[1] + ((op >> 2) & 3) - 2) & 0xFF;
+        pixel[2] = (pixel[2] + (op & 3) - 2) & 0xFF;
+      } else if (op >> 6 == 2) {
+        const int second = byte();
+        const int dg = (op & 0x3F) - 32;
+        pixel[0] = (pixel[0] + dg - 8 + (second >> 4)) & 0xFF;
+        pixel[1] = (pixel[1] + dg) & 0xFF;
+        pixel[2] = (pixel[2] + dg - 8 + (second & 0xF)) & 0xFF;
+      } else {
+        run = op & 0x3F;
+      }
+    }
+    index[static_cast<std::size_t>(
+        (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64)] =
+        pixel;
+    for (std::size_t c = 0; c < 3; ++c)
+      rgb.push_back(static_cast<std::uint8_t>(pixel[c]));
+  }
+  REQUIRE(data.substr(i) == std::string(7, '\0') + '\1');
+  return rgb;
+}
+
+std::vector<std::uint8_t> quantized(const Canvas& canvas) {
+  std::vector<std::uint8_t> rgb;
+  for (const auto pixel : canvas) {
+    for (const float channel : {pixel.red, pixel.green, pixel.blue})
+      rgb.push_back(PixelFormatUtil::linear_to_unorm8(channel));
+  }
+  return rgb;
+}
+
+}  // namespace
+
+SCENARIO("Encoding a canvas as QOI") {
+  GIVEN("c <- Canvas(70, 9) with runs, repeated colors and gradients") {
+    Canvas c(70, 9);
+    for (int y = 0; y < 9; ++y) {
+      for (int x = 0; x < 70; ++x) {
+        const auto fx = static_cast<float>(x);
+        const auto fy = static_cast<float>(y);
+        if (y < 3)
+          c.write_pixel(x, y, Color(0.25f, 0.5f, 1.5f));
+        else if (y < 6)
+          c.write_pixel(x, y, Color(fx / 70.f, fx / 69.f, fy / 9.f));
+        else
+          c.write_pixel(x, y, Color(static_cast<float>(x % 5) / 4.f,
+                                    static_cast<float>(x % 3) / 2.f, 0.f));
+      }
+    }
+    WHEN("qoi <- to_qoi(c)") {
+      const auto qoi = CanvasUtil::to_qoi(c);
+
+      THEN("the header holds the magic, the size and 3 channels")
+      AND_THEN("decoding qoi gives the quantized pixels of c") {
+        REQUIRE(qoi.substr(0, 4) == "qoif");
+        REQUIRE(read_u32(qoi, 4) == 70);
+        REQUIRE(read_u32(qoi, 8) == 9);
+        REQUIRE(qoi[12] == 3);
+        REQUIRE(decode_qoi(qoi) == quantized(c));
+        REQUIRE(qoi.size() < 70 * 9 * 3);
+      }
+    }
+  }
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch.hpp>
+
+#include "../src/Random.hpp"
+
+using namespace RandomUtil;
+
+SCENARIO("Philox 4x32-10 matches the Random123 known answers") {
+  GIVEN("the reference counters and keys") {
+    THEN("the outputs are the published ones") {
+      STATIC_REQUIRE(philox(Counter{0, 0, 0, 0}, Key{0, 0}) ==
+                     Counter{0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU,
+                             0x9b00dbd8U});
+      STATIC_REQUIRE(philox(Counter{0xffffffffU, 0xffffffffU, 0xffffffffU,
+                                    0xffffffffU},
+                            Key{0xffffffffU, 0xffffffffU}) ==
+                     Counter{0x408f276dU, 0x41c83b0eU, 0xa20bc7c6U,
+                             0x6d5451fdU});
+      STATIC_REQUIRE(philox(Counter{0x243f6a88U, 0x85a308d3U, 0x13198a2eU,
+                                    0x03707344U},
+                            Key{0xa4093822U, 0x299f31d0U}) ==
+                     Counter{0xd16cfe09U, 0x94fdccebU, 0x5001e420U,
+                             0x24126ea1U});
+    }
+  }
+}
+
+SCENARIO("The packet generator matches the scalar one lane by lane") {
+  GIVEN("8 counters sharing a key") {
+    constexpr auto lanes_match = [] {
+      std::array<std::array<std::uint32_t, 8>, 4> counters{};
+      for (std::uint32_t lane = 0; lane < 8; ++lane) {
+        counters[0][lane] = lane;
+        counters[1][lane] = 100 + lane;
+        counters[2][lane] = 7;
+        counters[3][lane] = lane * lane;
+      }
+      const auto packet = philox(counters, Key{42, 3});
+
+      for (std::size_t lane = 0; lane < 8; ++lane) {
+        const auto scalar =
+            philox(Counter{counters[0][lane], counters[1][lane],
+                           counters[2][lane], counters[3][lane]},
+                   Key{42, 3});
+        for (std::size_t word = 0; word < 4; ++word) {
+          if (packet[word][lane] != scalar[word]) return false;
+        }
+      }
+      return true;
+    }();
+    THEN("every lane holds the scalar result") { STATIC_REQUIRE(lanes_match); }
+  }
+}
+
+SCENARIO("Random streams are pure functions of their coordinates") {
+  GIVEN("streams for pixels, samples, bounces and seeds") {
+    constexpr auto first = [](std::uint32_t x, std::uint32_t y,
+                              std::uint32_t sample, std::uint32_t bounce,
+                              std::uint32_t seed) {
+      RandomStream stream(x, y, sample, bounce, seed);
+      return stream.next();
+    };
+    constexpr auto in_unit_interval = [] {
+      RandomStream stream(3, 4, 5);
+      for (int i = 0; i < 1000; ++i) {
+        const auto value = stream.next();
+        if (value < 0 || value >= 1) return false;
+      }
+      return true;
+    }();
+    constexpr auto packet_matches_streams = [] {
+      const std::array<std::uint32_t, 4> xs{0, 1, 2, 3};
+      const std::array<std::uint32_t, 4> ys{9, 9, 8, 8};
+      const auto values = uniform_floats(xs, ys, 2, 1, 7);
+      for (std::size_t lane = 0; lane < 4; ++lane) {
+        RandomStream stream(xs[lane], ys[lane], 2, 1, 7);
+        for (std::size_t k = 0; k < 4; ++k) {
+          if (values[k][lane] != stream.next()) return false;
+        }
+      }
+      return true;
+    }();
+    THEN("the same coordinates give the same numbers")
+    AND_THEN("changing any coordinate changes the numbers")
+    AND_THEN("the values are in [0, 1)")
+    AND_THEN("the packet variant starts every stream") {
+      STATIC_REQUIRE(first(1, 2, 3, 0, 0) == first(1, 2, 3, 0, 0));
+      STATIC_REQUIRE(first(1, 2, 3, 0, 0) != first(2, 1, 3, 0, 0));
+      STATIC_REQUIRE(first(1, 2, 3, 0, 0) != first(1, 2, 4, 0, 0));
+      STATIC_REQUIRE(first(1, 2, 3, 0, 0) != first(1, 2, 3, 1, 0));
+      STATIC_REQUIRE(first(1, 2, 3, 0, 0) != first(1, 2, 3, 0, 1));
+      STATIC_REQUIRE(in_unit_interval);
+      STATIC_REQUIRE(packet_matches_streams);
+    }
+  }
+}
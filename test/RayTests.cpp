@@ -1,4 +1,5 @@
 #include <catch2/catch.hpp>
+#include <limits>
 
 #include "../src/MatrixTransformations.hpp"
 #include "../src/Ray.hpp"
@@ -268,6 +269,26 @@ SCENARIO("The hit is always the lowest nonnegative intersection") {
   }
 }
 
+SCENARIO("Interleaved negative intersections do not hide the hit") {
+  GIVEN("s <- sphere()")
+  AND_GIVEN("xs <- intersections(-1, 1, -1, 1, -1, 1)") {
+    constexpr Sphere s;
+    constexpr auto xs = intersections(
+        Intersection(-1.f, s), Intersection(1.f, s), Intersection(-1.f, s),
+        Intersection(1.f, s), Intersection(-1.f, s), Intersection(1.f, s));
+    WHEN("i <- hit(xs)") {
+      constexpr auto i = hit(xs);
+      THEN("i.t = 1")
+      AND_THEN("the nonnegative intersections come first") {
+        STATIC_REQUIRE(i.has_value());
+        STATIC_REQUIRE(i->t() == 1);
+        STATIC_REQUIRE(xs[2].t() == 1);
+        STATIC_REQUIRE(xs[3].t() == -1);
+      }
+    }
+  }
+}
+
 SCENARIO("Translating a ray") {
   GIVEN("r <- ray(point(1, 2, 3), vector(0, 1, 0))")
   AND_GIVEN("m <- translation(3, 4, 5)") {
@@ -365,3 +386,89 @@ SCENARIO("Intersecting a translated sphere with a ray") {
     }
   }
 }
+
+SCENARIO("Intersecting a ray already in the object space of a sphere") {
+  GIVEN("r <- ray(point(0, 0, -5), vector(0, 0, 1))")
+  AND_GIVEN("s <- Sphere(translation(5, 0, 0))") {
+    constexpr Ray r(point(0, 0, -5), vector(0, 0, 1));
+    constexpr Sphere s(translation(5, 0, 0));
+    WHEN("xs <- local_intersect(r, s)") {
+      constexpr auto xs = local_intersect(r, s);
+      THEN("s.transform is not applied")
+      AND_THEN("xs[0].t = 4")
+      AND_THEN("xs[1].t = 6") {
+        STATIC_REQUIRE(xs.size() == 2);
+        STATIC_REQUIRE(xs[0].t() == 4);
+        STATIC_REQUIRE(xs[1].t() == 6);
+      }
+    }
+  }
+}
+
+SCENARIO("A translated and uniformly scaled sphere has a center and radius") {
+  GIVEN("s <- Sphere(translation(1, 2, 3) * scaling(2, 2, 2))")
+  AND_GIVEN("rotated <- Sphere(rotation_x(0.5))")
+  AND_GIVEN("squashed <- Sphere(scaling(1, 0.5, 1))") {
+    constexpr Sphere s(translation(1, 2, 3) * scaling(2, 2, 2));
+    constexpr Sphere rotated(rotation_x(0.5f));
+    constexpr Sphere squashed(scaling(1, 0.5f, 1));
+    THEN("s.geometry() = {point(1, 2, 3), 2}")
+    AND_THEN("the other spheres need their transformation") {
+      STATIC_REQUIRE(s.geometry()->center == point(1, 2, 3));
+      STATIC_REQUIRE(s.geometry()->radius == 2);
+      STATIC_REQUIRE(Sphere{}.geometry()->radius == 1);
+      STATIC_REQUIRE_FALSE(rotated.geometry().has_value());
+      STATIC_REQUIRE_FALSE(squashed.geometry().has_value());
+    }
+  }
+}
+
+SCENARIO("Intersecting a sphere from its center and radius") {
+  GIVEN("r <- ray(point(1, 2, -5), vector(0, 0, 1))")
+  AND_GIVEN("s <- Sphere(translation(1, 2, 3) * scaling(2, 2, 2))") {
+    constexpr Ray r(point(1, 2, -5), vector(0, 0, 1));
+    constexpr Sphere s(translation(1, 2, 3) * scaling(2, 2, 2));
+    WHEN("xs <- intersect(r, s.geometry())") {
+      constexpr auto xs = intersect(r, *s.geometry());
+      constexpr auto through_matrix =
+          local_intersect(transform(r, inverse(s.transform)), s);
+      THEN("xs[0].t = 6")
+      AND_THEN("xs[1].t = 10")
+      AND_THEN("the distances are those of the object space test") {
+        STATIC_REQUIRE(xs.size() == 2);
+        STATIC_REQUIRE(xs[0].t() == 6);
+        STATIC_REQUIRE(xs[1].t() == 10);
+        STATIC_REQUIRE(xs[0] == through_matrix[0]);
+        STATIC_REQUIRE(xs[1] == through_matrix[1]);
+      }
+    }
+  }
+}
+
+SCENARIO("Intersecting a ray with a packet of spheres") {
+  GIVEN("r <- ray(point(0, 0, -5), vector(0, 0, 1))")
+  AND_GIVEN("a packet of a sphere ahead of r, one around its origin and "
+            "one it misses") {
+    constexpr Ray r(point(0, 0, -5), vector(0, 0, 1));
+    constexpr auto packet = [] {
+      SpherePacket<4> p;
+      p.center[2] = {0, -5, 0, 0};
+      p.center[0] = {0, 0, 3, 0};
+      p.radius = {1, 2, 1, 0};
+      p.count = 3;
+      return p;
+    }();
+    WHEN("ts <- intersect_spheres(r, packet)") {
+      constexpr auto ts = intersect_spheres(r, packet);
+      constexpr auto miss = std::numeric_limits<float>::infinity();
+      THEN("ts[0] = 4, the nearest distance")
+      AND_THEN("ts[1] = 2, the one in front of the origin")
+      AND_THEN("the missed sphere and the unused lane are at infinity") {
+        STATIC_REQUIRE(ts[0] == 4);
+        STATIC_REQUIRE(ts[1] == 2);
+        STATIC_REQUIRE(ts[2] == miss);
+        STATIC_REQUIRE(ts[3] == miss);
+      }
+    }
+  }
+}
@@ -0,0 +1,101 @@
+#include <array>
+#include <catch2/catch.hpp>
+#include <utility>
+
+#include "../src/Sampling.hpp"
+
+using namespace SamplingUtil;
+
+SCENARIO("A single sample sits in the center of the pixel") {
+  GIVEN("one sample of the first sequence") {
+    constexpr auto offset = stratified_sample(3, 7, 0, 1);
+    THEN("its offset is (0.5, 0.5)") {
+      STATIC_REQUIRE(offset == std::pair{0.5f, 0.5f});
+    }
+  }
+}
+
+SCENARIO("Stratified samples cover one cell each") {
+  GIVEN("9 samples for the pixel (10, 20)") {
+    constexpr auto in_own_cell = [] {
+      for (int sample = 0; sample < 9; ++sample) {
+        const auto [dx, dy] = stratified_sample(10, 20, sample, 9);
+        const auto column = static_cast<int>(dx * 3);
+        const auto row = static_cast<int>(dy * 3);
+        if (column != sample % 3 || row != sample / 3) return false;
+      }
+      return true;
+    }();
+    THEN("sample i falls in column i % 3 and row i / 3") {
+      STATIC_REQUIRE(strata(9) == std::pair{3, 3});
+      STATIC_REQUIRE(strata(6) == std::pair{3, 2});
+      STATIC_REQUIRE(strata(5) == std::pair{5, 1});
+      STATIC_REQUIRE(in_own_cell);
+    }
+  }
+}
+
+SCENARIO("Stratified samples cover the whole pixel") {
+  GIVEN("3 samples for the pixel (4, 5)") {
+    constexpr auto in_own_column = [] {
+      for (int sample = 0; sample < 3; ++sample) {
+        const auto [dx, dy] = stratified_sample(4, 5, sample, 3);
+        if (static_cast<int>(dx * 3) != sample || dy < 0 || dy >= 1)
+          return false;
+      }
+      return true;
+    }();
+    THEN("the pixel is split in 3 columns holding one sample each") {
+      STATIC_REQUIRE(strata(3) == std::pair{3, 1});
+      STATIC_REQUIRE(in_own_column);
+    }
+  }
+  GIVEN("1 to 16 samples") {
+    constexpr auto every_cell_hit_once = [] {
+      for (int samples = 1; samples <= 16; ++samples) {
+        const auto [columns, rows] = strata(samples);
+        if (columns * rows != samples) return false;
+
+        std::array<int, 16> hits{};
+        for (int sample = 0; sample < samples; ++sample) {
+          const auto [dx, dy] = stratified_sample(0, 0, sample, samples, 1);
+          const auto column =
+              static_cast<int>(dx * static_cast<float>(columns));
+          const auto row = static_cast<int>(dy * static_cast<float>(rows));
+          ++hits[static_cast<std::size_t>(row * columns + column)];
+        }
+        for (int cell = 0; cell < samples; ++cell) {
+          if (hits[static_cast<std::size_t>(cell)] != 1) return false;
+        }
+      }
+      return true;
+    }();
+    THEN("there are as many cells as samples and each holds one sample") {
+      STATIC_REQUIRE(every_cell_hit_once);
+    }
+  }
+}
+
+SCENARIO("Jitter is deterministic but differs between pixels and sets") {
+  GIVEN("the first of 4 samples") {
+    constexpr auto a = stratified_sample(1, 2, 0, 4);
+    constexpr auto b = stratified_sample(1, 2, 0, 4);
+    constexpr auto other_pixel = stratified_sample(2, 1, 0, 4);
+    constexpr auto other_set = stratified_sample(1, 2, 0, 4, 4);
+    constexpr auto other_seed = stratified_sample(1, 2, 0, 4, 0, 1);
+    THEN("the same inputs give the same position")
+    AND_THEN("another pixel, set of samples or seed gives another position")
+    AND_THEN("every position stays in the first cell") {
+      STATIC_REQUIRE(a == b);
+      STATIC_REQUIRE(a != other_pixel);
+      STATIC_REQUIRE(a != other_set);
+      STATIC_REQUIRE(a != other_seed);
+      STATIC_REQUIRE(a.first >= 0);
+      STATIC_REQUIRE(a.first < 0.5f);
+      STATIC_REQUIRE(a.second >= 0);
+      STATIC_REQUIRE(a.second < 0.5f);
+      STATIC_REQUIRE(other_set.first < 0.5f);
+      STATIC_REQUIRE(other_set.second < 0.5f);
+    }
+  }
+}
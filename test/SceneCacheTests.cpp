@@ -0,0 +1,310 @@
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Render.hpp"
+#include "../src/SceneCache.hpp"
+#include "../src/Shape.hpp"
+
+using namespace TupleUtil;
+using namespace MatrixUtil;
+
+namespace {
+
+// A sphere, a closed cylinder, a plane and a packed mesh with a material,
+// a light and three instances of a prototype holding a cube and a mesh
+Scene sample_scene() {
+  World world;
+  Material red;
+  red.color = Color(1, 0, 0);
+  red.reflective = 0.25f;
+  red.transparency = 0.5f;
+  red.refractive_index = 1.5f;
+  const auto red_id = world.add(red);
+  world.add(PointLight(point(-10, 10, -10), Color(1, 1, 1)));
+
+  world.add(Sphere{translation(1, 2, 3), red_id});
+  world.add(Cylinder{scaling(2, 1, 2), 0, -1, 1, true});
+  world.add(Plane{translation(0, -1, 0) * rotation_x(0.1f), red_id});
+  TriangleMesh mesh{translation(0, 0, 5), 0,
+                    std::vector<float>{0, 1, 0, -1, 0, 0, 1, 0, 0},
+                    std::vector<std::uint32_t>{0, 1, 2}};
+  mesh.packets = MeshUtil::pack(mesh);
+  world.add(mesh);
+
+  const std::vector<Shape> prototype_shapes{
+      Cube{scaling(0.5f, 0.5f, 0.5f)},
+      TriangleMesh{translation(0, 1, 0), 0,
+                   std::vector<float>{0, 1, 0, -1, 0, 0, 1, 0, 0},
+                   std::vector<std::uint32_t>{0, 1, 2}}};
+  const auto prototype = world.add(Prototype(prototype_shapes));
+  world.add(Instance{prototype, translation(-2, 0, 0), red_id});
+  world.add(Instance{prototype, translation(2, 0, 0)});
+  world.add(Instance{prototype, translation(0, 2, 0) * rotation_y(0.5f)});
+  world.build_instance_bvh();
+
+  return Scene{Camera(40, 20, 1.0472f,
+                      view_transform(point(0, 1.5f, -8), point(0, 1, 0),
+                                     vector(0, 1, 0))),
+               std::move(world)};
+}
+
+// Overwrites the bytes at offset in the file with value
+template <typename T>
+void patch(const std::filesystem::path& path, std::uint64_t offset,
+           const T& value) {
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(static_cast<std::streamoff>(offset));
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Header of the section of the given type in the file
+std::pair<std::uint64_t, SceneCacheUtil::SectionHeader> find_section(
+    const std::filesystem::path& path, SceneCacheUtil::SectionType type) {
+  using namespace SceneCacheUtil;
+  std::ifstream file(path, std::ios::binary);
+  FileHeader header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  for (std::uint32_t i = 0; i < header.section_count; ++i) {
+    const auto position = sizeof(FileHeader) + i * sizeof(SectionHeader);
+    SectionHeader section{};
+    file.seekg(static_cast<std::streamoff>(position));
+    file.read(reinterpret_cast<char*>(&section), sizeof(section));
+    if (section.type == type) return {position, section};
+  }
+  return {};
+}
+
+}  // namespace
+
+SCENARIO("Round-tripping a scene through the binary cache") {
+  GIVEN("scene <- shapes, a mesh, materials, a light and instances")
+  AND_GIVEN("path <- a file in the temporary directory") {
+    const auto scene = sample_scene();
+    const auto path =
+        std::filesystem::temp_directory_path() / "scene_cache_tests.bin";
+
+    WHEN("write(path, scene)")
+    AND_WHEN("cached <- SceneCache::open(path).scene()") {
+      REQUIRE(SceneCacheUtil::write(path, scene));
+      const auto cache = SceneCache::open(path);
+      REQUIRE(cache.has_value());
+      const auto cached = cache->scene();
+
+      THEN("the camera, materials and lights are stored as they are")
+      AND_THEN("shapes and instances take the stored inverses")
+      AND_THEN("meshes and hierarchies view the mapped file")
+      AND_THEN("the cached scene renders the same image") {
+        const auto& world = cached.world;
+        REQUIRE(cached.storage != nullptr);
+        REQUIRE(cached.camera.transform() == scene.camera.transform());
+        REQUIRE(cached.camera.hsize() == 40);
+        REQUIRE(world.materials() == scene.world.materials());
+        REQUIRE(world.lights().size() == 1);
+        REQUIRE(world.lights()[0].position == point(-10, 10, -10));
+
+        REQUIRE(world.size() == 4);
+        for (World::size_type i = 0; i < world.size(); ++i) {
+          REQUIRE(world.type(i) == scene.world.type(i));
+          REQUIRE(world.inverse_transform(i) ==
+                  scene.world.inverse_transform(i));
+          REQUIRE(world.object_material(i) == scene.world.object_material(i));
+        }
+        const auto& cylinder = std::get<Cylinder>(world.objects()[1]);
+        REQUIRE(cylinder.minimum == -1);
+        REQUIRE(cylinder.maximum == 1);
+        REQUIRE(cylinder.closed);
+
+        const auto& mesh = std::get<TriangleMesh>(world.objects()[3]);
+        const auto& original = std::get<TriangleMesh>(scene.world.objects()[3]);
+        REQUIRE(mesh.vertices.viewing());
+        REQUIRE(mesh.indices.viewing());
+        REQUIRE(mesh.packets.viewing());
+        REQUIRE(mesh.vertices == original.vertices);
+        REQUIRE(mesh.indices == original.indices);
+        REQUIRE(mesh.packets.size() == 1);
+
+        REQUIRE(world.prototypes().size() == 1);
+        const auto& prototype = world.prototypes()[0];
+        REQUIRE(prototype.primitive_count() == 2);
+        REQUIRE(prototype.triangles().vertices.viewing());
+        REQUIRE(prototype.bvh().nodes.viewing());
+        REQUIRE(prototype.bvh().nodes ==
+                scene.world.prototypes()[0].bvh().nodes);
+        REQUIRE(prototype.inverse_transform(0) ==
+                scene.world.prototypes()[0].inverse_transform(0));
+
+        REQUIRE(world.instances().size() == 3);
+        REQUIRE(world.instance_inverse_transform(2) ==
+                scene.world.instance_inverse_transform(2));
+        REQUIRE(world.instance_bvh() != nullptr);
+        REQUIRE(world.instance_bvh()->nodes.viewing());
+        REQUIRE(world.instance_bvh()->items ==
+                scene.world.instance_bvh()->items);
+
+        const RenderSettings settings{1, 16, 1};
+        REQUIRE(RenderUtil::render(cached.camera, world, settings).pixels() ==
+                RenderUtil::render(scene.camera, scene.world, settings)
+                    .pixels());
+      }
+    }
+    std::filesystem::remove(path);
+  }
+}
+
+SCENARIO("Rejecting cache files that cannot be trusted") {
+  using namespace SceneCacheUtil;
+
+  GIVEN("a valid cache file") {
+    const auto path =
+        std::filesystem::temp_directory_path() / "scene_cache_reject.bin";
+    REQUIRE(write(path, sample_scene()));
+    REQUIRE(SceneCache::open(path).has_value());
+    const auto size = std::filesystem::file_size(path);
+
+    WHEN("the version is changed") {
+      patch(path, 8, version + 1);
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("the file is truncated") {
+      std::filesystem::resize_file(path, size / 2);
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("a section is so long that its end overflows") {
+      auto [position, section] = find_section(path, SectionType::Vertices);
+      section.count = ~std::uint64_t{0} / sizeof(float);
+      patch(path, position, section);
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("a mesh index points past its vertices") {
+      const auto [position, section] = find_section(path, SectionType::Indices);
+      patch(path, section.offset + sizeof(std::uint32_t), std::uint32_t{3});
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("a mesh range overflows") {
+      const auto [position, section] = find_section(path, SectionType::Meshes);
+      patch(path, section.offset + offsetof(MeshRecord, first_index),
+            ~std::uint64_t{0});
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("an object has an unknown shape type") {
+      const auto [position, section] = find_section(path, SectionType::Objects);
+      patch(path, section.offset, ShapeType{17});
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("an object refers to a material outside the table") {
+      const auto [position, section] = find_section(path, SectionType::Objects);
+      patch(path, section.offset + offsetof(ObjectRecord, material),
+            std::uint32_t{2});
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+
+    WHEN("a hierarchy node points at children before itself") {
+      const auto [position, section] =
+          find_section(path, SectionType::BvhNodes);
+      patch(path, section.offset + offsetof(BvhNode, first), std::uint32_t{0});
+      patch(path, section.offset + offsetof(BvhNode, count), std::uint32_t{0});
+      THEN("open returns nothing") {
+        REQUIRE_FALSE(SceneCache::open(path).has_value());
+      }
+    }
+    std::filesystem::remove(path);
+  }
+  GIVEN("a scene with a shape referring to a material outside the table") {
+    const auto path =
+        std::filesystem::temp_directory_path() / "scene_cache_reject.bin";
+    auto scene = sample_scene();
+    auto prototype_shapes = std::vector<Shape>{Sphere{identity<4>(), 5}};
+    scene.world.add(Prototype(prototype_shapes));
+    THEN("no cache is written for it") {
+      REQUIRE_FALSE(write(path, scene));
+    }
+    std::filesystem::remove(path);
+  }
+}
+
+SCENARIO("Loading a scene file through its cache") {
+  GIVEN("a scene file and a cache path next to it") {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto scene_path = directory / "scene_cache_load.scene";
+    const auto cache_path = directory / "scene_cache_load.bin";
+    std::filesystem::remove(cache_path);
+    std::ofstream(scene_path)
+        << "camera 10 10 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+        << "prototype ball\n  sphere\nend\n"
+        << "instance ball translate 0 1 0\n";
+
+    WHEN("the scene is loaded twice through the cache") {
+      const auto parsed = SceneCacheUtil::load(scene_path, cache_path);
+      const auto cached = SceneCacheUtil::load(scene_path, cache_path);
+
+      THEN("the first load parses the scene and writes the cache")
+      AND_THEN("the second load maps the cache") {
+        REQUIRE(parsed.has_value());
+        REQUIRE(parsed->storage == nullptr);
+        REQUIRE(std::filesystem::exists(cache_path));
+        REQUIRE(cached.has_value());
+        REQUIRE(cached->storage != nullptr);
+        REQUIRE(cached->world.instances().size() == 1);
+        REQUIRE(cached->world.instance_bvh()->nodes ==
+                parsed->world.instance_bvh()->nodes);
+      }
+    }
+
+    WHEN("the scene is loaded through the cache with another builder") {
+      REQUIRE(SceneCacheUtil::load(scene_path, cache_path).has_value());
+      const BvhSettings lbvh{BvhBuilder::Lbvh, 1};
+      const auto parsed = SceneCacheUtil::load(scene_path, cache_path,
+                                               nullptr, lbvh);
+      const auto cached = SceneCacheUtil::load(scene_path, cache_path,
+                                               nullptr, lbvh);
+
+      THEN("the scene is parsed again and the cache rewritten for it") {
+        REQUIRE(parsed.has_value());
+        REQUIRE(parsed->storage == nullptr);
+        REQUIRE(cached.has_value());
+        REQUIRE(cached->storage != nullptr);
+        REQUIRE(cached->world.prototypes()[0].bvh().builder ==
+                BvhBuilder::Lbvh);
+        REQUIRE(cached->world.instance_bvh()->builder == BvhBuilder::Lbvh);
+      }
+    }
+
+    WHEN("the cache is not a valid cache file") {
+      std::ofstream(cache_path) << "not a cache";
+      const auto scene = SceneCacheUtil::load(scene_path, cache_path);
+      THEN("the scene is parsed and the cache written again") {
+        REQUIRE(scene.has_value());
+        REQUIRE(scene->storage == nullptr);
+        REQUIRE(SceneCache::open(cache_path).has_value());
+      }
+    }
+    std::filesystem::remove(scene_path);
+    std::filesystem::remove(cache_path);
+  }
+}
@@ -0,0 +1,570 @@
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <numbers>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Ppm.hpp"
+#include "../src/Render.hpp"
+#include "../src/Scene.hpp"
+#include "../src/Tuple.hpp"
+
+using namespace TupleUtil;
+using namespace MatrixUtil;
+
+namespace {
+
+constexpr std::string_view sample_scene = R"(# two spheres on a floor
+camera 40 20 1.0472 from 0 1.5 -5 to 0 1 0 up 0 1 0
+light -10 10 -10 1 1 1
+
+material floor color 1 0.9 0.9 specular 0
+material glossy color 0.1 1 0.5 diffuse 0.7 specular 0.3 shininess 50
+
+plane material floor
+sphere material glossy translate -0.5 1 0.5
+sphere scale 0.5 0.5 0.5 translate 1.5 0.5 -0.5   # transformed twice
+cylinder minimum 0 maximum 2 closed rotate-y 0.5
+)";
+
+}  // namespace
+
+SCENARIO("Parsing a scene description") {
+  GIVEN("a scene with a camera, a light, two materials and four shapes") {
+    const auto scene = SceneUtil::parse(sample_scene);
+
+    THEN("the camera is set up from its statement")
+    AND_THEN("the lights and shapes are added to the world")
+    AND_THEN("shapes use the named materials")
+    AND_THEN("transformation steps apply in the order they are written") {
+      REQUIRE(scene.has_value());
+      REQUIRE(scene->camera.hsize() == 40);
+      REQUIRE(scene->camera.vsize() == 20);
+      REQUIRE(scene->camera.transform() ==
+              view_transform(point(0, 1.5f, -5), point(0, 1, 0),
+                             vector(0, 1, 0)));
+
+      const auto& world = scene->world;
+      REQUIRE(world.lights().size() == 1);
+      REQUIRE(world.lights()[0].position == point(-10, 10, -10));
+      REQUIRE(world.size() == 4);
+
+      REQUIRE(ShapeUtil::object_type(world.objects()[0]) == ShapeType::Plane);
+      REQUIRE(world.object_material(0).color == Color(1, 0.9f, 0.9f));
+      REQUIRE(world.object_material(0).specular == 0);
+      REQUIRE(world.object_material(1).shininess == 50);
+      REQUIRE(world.object_material(2) == Material{});
+      REQUIRE(world.materials().size() == 3);
+
+      REQUIRE(ShapeUtil::transform(world.objects()[1]) ==
+              translation(-0.5f, 1, 0.5f));
+      REQUIRE(ShapeUtil::transform(world.objects()[2]) ==
+              translation(1.5f, 0.5f, -0.5f) * scaling(0.5f, 0.5f, 0.5f));
+      REQUIRE(world.inverse_transform(2) ==
+              inverse(ShapeUtil::transform(world.objects()[2])));
+
+      const auto& cylinder = std::get<Cylinder>(world.objects()[3]);
+      REQUIRE(cylinder.minimum == 0);
+      REQUIRE(cylinder.maximum == 2);
+      REQUIRE(cylinder.closed);
+      REQUIRE(cylinder.transform == rotation_y(0.5f));
+    }
+  }
+}
+
+SCENARIO("Parsing reflective and transparent materials") {
+  GIVEN("a material with reflective, transparency and refractive-index") {
+    const auto scene = SceneUtil::parse(
+        "camera 4 4 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+        "material glass reflective 0.9 transparency 1 refractive-index 1.5\n"
+        "sphere material glass\n");
+
+    THEN("the shape gets the secondary ray weights and its index") {
+      REQUIRE(scene.has_value());
+      const auto& material = scene->world.object_material(0);
+      REQUIRE(material.reflective == 0.9f);
+      REQUIRE(material.transparency == 1);
+      REQUIRE(material.refractive_index == 1.5f);
+    }
+  }
+}
+
+SCENARIO("Reporting the line of an invalid statement") {
+  GIVEN("scenes with mistakes") {
+    constexpr auto error_line = [](std::string_view text) {
+      std::size_t line = 99;
+      const auto scene = SceneUtil::parse(text, {}, &line);
+      return scene ? std::size_t{99} : line;
+    };
+    THEN("unknown materials, options and statements are rejected")
+    AND_THEN("malformed numbers are rejected")
+    AND_THEN("a scene without camera fails with line 0") {
+      REQUIRE(error_line("camera 10 10 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "sphere material missing\n") == 2);
+      REQUIRE(error_line("camera 10 10 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "\n"
+                         "sphere closed\n") == 3);
+      REQUIRE(error_line("teapot\n") == 1);
+      REQUIRE(error_line("light 1 2 x 1 1 1\n") == 1);
+      REQUIRE(error_line("camera 10 10 1 from 0 0 -5 to 0 0 0\n") == 1);
+      REQUIRE(error_line("sphere\n") == 0);
+    }
+    AND_THEN("fractional and out of range image sizes are rejected") {
+      REQUIRE(error_line("camera 100.5 10 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "sphere\n") == 1);
+      REQUIRE(error_line("camera 10 1e2 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "sphere\n") == 1);
+      REQUIRE(error_line("camera 2147483648 10 1 from 0 0 -5 to 0 0 0 up "
+                         "0 1 0\n"
+                         "sphere\n") == 1);
+      REQUIRE(error_line("camera 0 10 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "sphere\n") == 1);
+    }
+    AND_THEN("materials and prototypes named twice are rejected") {
+      REQUIRE(error_line("material red color 1 0 0\n"
+                         "material blue color 0 0 1\n"
+                         "material red color 1 1 0\n") == 3);
+      REQUIRE(error_line("prototype a\n"
+                         "sphere\n"
+                         "end\n"
+                         "prototype a\n"
+                         "cube\n"
+                         "end\n") == 4);
+    }
+  }
+}
+
+SCENARIO("Parsing prototypes and their instances") {
+  GIVEN("a prototype of two spheres drawn by three instances") {
+    const auto scene = SceneUtil::parse(
+        "camera 4 4 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+        "material red color 1 0 0\n"
+        "prototype pair\n"
+        "  sphere translate -1 0 0\n"
+        "  sphere translate 1 0 0\n"
+        "end\n"
+        "plane\n"
+        "instance pair\n"
+        "instance pair material red translate 0 5 0\n"
+        "instance pair scale 2 2 2\n");
+
+    THEN("the prototype shapes are stored once and not drawn by themselves")
+    AND_THEN("instances get their material and transformation")
+    AND_THEN("the hierarchy over the instances is built") {
+      REQUIRE(scene.has_value());
+      const auto& world = scene->world;
+      REQUIRE(world.size() == 1);
+      REQUIRE(world.prototypes().size() == 1);
+      REQUIRE(world.prototypes()[0].primitive_count() == 2);
+      REQUIRE(world.instances().size() == 3);
+      REQUIRE(world.instances()[1].transform == translation(0, 5, 0));
+      REQUIRE(world.object_material(2).color == Color(1, 0, 0));
+      REQUIRE(world.object_material(3) == Material{});
+      REQUIRE(world.instance_bvh() != nullptr);
+
+      const auto xs =
+          WorldUtil::hit(world, Ray{point(1, 5, -5), vector(0, 0, 1)});
+      REQUIRE(xs.has_value());
+      REQUIRE(xs->index() == 2);
+      REQUIRE(xs->primitive() == 1);
+    }
+  }
+  GIVEN("the same prototype built as a linear hierarchy on two threads") {
+    const auto scene = SceneUtil::parse(
+        "camera 4 4 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+        "prototype pair\n"
+        "  sphere translate -1 0 0\n"
+        "  sphere translate 1 0 0\n"
+        "end\n"
+        "instance pair translate 0 5 0\n",
+        {}, nullptr, BvhSettings{BvhBuilder::Lbvh, 2});
+
+    THEN("rays hit the same primitive") {
+      REQUIRE(scene.has_value());
+      REQUIRE(scene->world.instance_bvh() != nullptr);
+      const auto xs = WorldUtil::hit(scene->world,
+                                     Ray{point(1, 5, -5), vector(0, 0, 1)});
+      REQUIRE(xs.has_value());
+      REQUIRE(xs->primitive() == 1);
+    }
+  }
+  GIVEN("scenes with misplaced prototypes") {
+    constexpr auto error_line = [](std::string_view text) {
+      std::size_t line = 99;
+      const auto scene = SceneUtil::parse(text, {}, &line);
+      return scene ? std::size_t{99} : line;
+    };
+    THEN("unknown, nested, empty, unbounded and unclosed ones are rejected") {
+      REQUIRE(error_line("camera 4 4 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "instance missing\n") == 2);
+      REQUIRE(error_line("prototype a\n"
+                         "prototype b\n") == 2);
+      REQUIRE(error_line("prototype a\n"
+                         "end\n") == 2);
+      REQUIRE(error_line("prototype a\n"
+                         "plane\n"
+                         "end\n") == 3);
+      REQUIRE(error_line("end\n") == 1);
+      REQUIRE(error_line("camera 4 4 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+                         "prototype a\n"
+                         "sphere\n") == 3);
+    }
+  }
+}
+
+SCENARIO("Loading a scene that references a mesh") {
+  GIVEN("a scene file next to an OBJ file") {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto scene_path = directory / "scene_tests.scene";
+    const auto mesh_path = directory / "scene_tests.obj";
+    std::ofstream(mesh_path) << "v -1 0 0\nv 0 1 0\nv 1 0 0\nf 1 2 3\n";
+    std::ofstream(scene_path)
+        << "camera 10 10 1 from 0 0 -5 to 0 0 0 up 0 1 0\n"
+        << "mesh scene_tests.obj translate 0 0 1\n";
+
+    WHEN("scene <- load(scene_path)") {
+      const auto scene = SceneUtil::load(scene_path);
+      THEN("the mesh is loaded relative to the scene and packed") {
+        REQUIRE(scene.has_value());
+        const auto& mesh = std::get<TriangleMesh>(scene->world.objects()[0]);
+        REQUIRE(mesh.triangle_count() == 1);
+        REQUIRE_FALSE(mesh.packets.empty());
+        REQUIRE(mesh.transform == translation(0, 0, 1));
+      }
+    }
+    std::filesystem::remove(scene_path);
+    std::filesystem::remove(mesh_path);
+  }
+}
+
+SCENARIO("Rendering a scene in tiles on several threads") {
+  GIVEN("the sample scene") {
+    const auto scene = SceneUtil::parse(sample_scene);
+    REQUIRE(scene.has_value());
+
+    WHEN("it is rendered on one thread and on three threads")
+    AND_WHEN("with different tile sizes") {
+      const auto serial = RenderUtil::render(scene->camera, scene->world,
+                                             RenderSettings{1, 16, 1});
+      const auto parallel = RenderUtil::render(scene->camera, scene->world,
+                                               RenderSettings{3, 7, 1});
+      THEN("both images are identical") {
+        REQUIRE(serial.width() == 40);
+        REQUIRE(serial.height() == 20);
+        REQUIRE(serial.pixels() == parallel.pixels());
+        REQUIRE_FALSE(serial.pixel_at(20, 15) == ColorUtil::black());
+      }
+    }
+  }
+}
+
+SCENARIO("Counting the rays of a render") {
+  GIVEN("a mirror floor below a glass sphere") {
+    const auto scene = SceneUtil::parse(
+        "camera 24 16 1.0472 from 0 1.5 -5 to 0 1 0 up 0 1 0\n"
+        "light -10 10 -10 1 1 1\n"
+        "material mirror reflective 0.8\n"
+        "material glass reflective 0.1 transparency 0.9 "
+        "refractive-index 1.5\n"
+        "plane material mirror\n"
+        "sphere material glass translate 0 1 0\n");
+    REQUIRE(scene.has_value());
+
+    WHEN("it is rendered on one and on four threads, with 2 samples") {
+      RayCounters serial;
+      RayCounters parallel;
+      static_cast<void>(RenderUtil::render(
+          scene->camera, scene->world, RenderSettings{1, 16, 2}, &serial));
+      static_cast<void>(RenderUtil::render(
+          scene->camera, scene->world, RenderSettings{4, 5, 2}, &parallel));
+
+      THEN("every sample casts one primary ray")
+      AND_THEN("the counts do not depend on the threads")
+      AND_THEN("the mirror and the glass cast secondary rays") {
+        REQUIRE(serial.primary == 24 * 16 * 2);
+        REQUIRE(serial == parallel);
+        REQUIRE(serial.reflection > 0);
+        REQUIRE(serial.refraction > 0);
+      }
+    }
+    WHEN("secondary rays are limited to one bounce") {
+      RenderSettings one_bounce{1, 16, 1};
+      one_bounce.trace.max_depth = 1;
+      RayCounters counters;
+      RayCounters unlimited;
+      static_cast<void>(RenderUtil::render(scene->camera, scene->world,
+                                           one_bounce, &counters));
+      static_cast<void>(RenderUtil::render(
+          scene->camera, scene->world, RenderSettings{1, 16, 1}, &unlimited));
+
+      THEN("each primary ray casts at most a reflected and a refracted ray") {
+        REQUIRE(counters.secondary() <= 2 * counters.primary);
+        REQUIRE(counters.secondary() < unlimited.secondary());
+      }
+    }
+  }
+}
+
+SCENARIO("Tracing the rays of a tile one bounce at a time") {
+  GIVEN("a mirror floor below a glass sphere and a packed mesh, lit by two "
+        "lights") {
+    const auto scene = SceneUtil::parse(
+        "camera 24 16 1.0472 from 0 1.5 -5 to 0 1 0 up 0 1 0\n"
+        "light -10 10 -10 1 1 1\n"
+        "light 5 8 -6 0.3 0.3 0.5\n"
+        "material mirror reflective 0.8\n"
+        "material glass reflective 0.1 transparency 0.9 "
+        "refractive-index 1.5\n"
+        "plane material mirror\n"
+        "sphere material glass translate 0 1 0\n");
+    REQUIRE(scene.has_value());
+    auto world = scene->world;
+    Material mirror;
+    mirror.reflective = 0.5f;
+    TriangleMesh mesh;
+    mesh.vertices = {-1, 0, 0, 1, 0, 0, 1, 2, 0, -1, 2, 0};
+    mesh.indices = {0, 1, 2, 0, 2, 3};
+    mesh.packets = MeshUtil::pack(mesh);
+    mesh.material = world.add(mirror);
+    mesh.transform = translation(1.5f, 0, 1.f);
+    world.add(std::move(mesh));
+
+    WHEN("it is rendered depth first and in wavefronts, with adaptive "
+         "samples") {
+      RenderSettings depth_first{2, 7, 2, 4, 0.05f, 3};
+      RenderSettings wavefront = depth_first;
+      wavefront.scheduling = RayScheduling::Wavefront;
+      RayCounters depth_first_counters;
+      RayCounters wavefront_counters;
+      const auto expected = RenderUtil::render(
+          scene->camera, world, depth_first, &depth_first_counters);
+      const auto image = RenderUtil::render(scene->camera, world, wavefront,
+                                            &wavefront_counters);
+
+      THEN("both cast the same rays")
+      AND_THEN("the images only differ by rounding") {
+        REQUIRE(wavefront_counters == depth_first_counters);
+        for (int y = 0; y < image.height(); ++y) {
+          for (int x = 0; x < image.width(); ++x) {
+            const auto a = image.pixel_at(x, y);
+            const auto b = expected.pixel_at(x, y);
+            REQUIRE(a.red == Approx(b.red).margin(1e-5));
+            REQUIRE(a.green == Approx(b.green).margin(1e-5));
+            REQUIRE(a.blue == Approx(b.blue).margin(1e-5));
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("Refining only the pixels that differ from their neighbours") {
+  GIVEN("the sample scene")
+  AND_GIVEN("a flat canvas with one bright pixel") {
+    const auto scene = SceneUtil::parse(sample_scene);
+    REQUIRE(scene.has_value());
+    Canvas flat(4, 4);
+    flat.write_pixel(1, 1, Color(1, 1, 1));
+
+    WHEN("the scene is rendered with and without adaptive samples") {
+      const auto base = RenderUtil::render(scene->camera, scene->world,
+                                           RenderSettings{1, 16, 4});
+      const auto adaptive = RenderUtil::render(
+          scene->camera, scene->world, RenderSettings{2, 8, 4, 16, 0.1f});
+      THEN("only the bright pixel and its neighbours need refinement")
+      AND_THEN("flagged pixels get new samples and the others are kept") {
+        REQUIRE(RenderUtil::detail::needs_refinement(flat, 1, 1, 0.1f));
+        REQUIRE(RenderUtil::detail::needs_refinement(flat, 1, 2, 0.1f));
+        REQUIRE_FALSE(RenderUtil::detail::needs_refinement(flat, 3, 3, 0.1f));
+
+        int refined = 0;
+        for (int y = 0; y < base.height(); ++y) {
+          for (int x = 0; x < base.width(); ++x) {
+            const bool flagged =
+                RenderUtil::detail::needs_refinement(base, x, y, 0.1f);
+            if (flagged) ++refined;
+            if (!flagged)
+              REQUIRE(adaptive.pixel_at(x, y) == base.pixel_at(x, y));
+          }
+        }
+        REQUIRE(refined > 0);
+        REQUIRE(refined < base.width() * base.height() / 2);
+      }
+    }
+  }
+}
+
+SCENARIO("Rendering progressively in refinement passes") {
+  GIVEN("the sample scene") {
+    const auto scene = SceneUtil::parse(sample_scene);
+    REQUIRE(scene.has_value());
+
+    WHEN("it is rendered progressively without budget") {
+      std::vector<PassInfo> passes;
+      std::vector<Canvas> images;
+      const auto image = RenderUtil::render_progressive(
+          scene->camera, scene->world,
+          ProgressiveSettings{RenderSettings{2, 5, 1}, 8, {}},
+          [&](const Canvas& pass_image, const PassInfo& info) {
+            passes.push_back(info);
+            images.push_back(pass_image);
+          });
+      THEN("the steps halve from 8 down to 1")
+      AND_THEN("the first pass fills whole blocks")
+      AND_THEN("the last pass matches a plain render") {
+        REQUIRE(passes.size() == 4);
+        REQUIRE(passes[0].step == 8);
+        REQUIRE(passes[3].step == 1);
+        REQUIRE(passes[3].last);
+        REQUIRE(images[0].pixel_at(7, 15) == images[0].pixel_at(0, 8));
+        REQUIRE(images[0].pixel_at(39, 19) == images[0].pixel_at(32, 16));
+        REQUIRE(image.pixels() ==
+                RenderUtil::render(scene->camera, scene->world).pixels());
+      }
+    }
+
+    WHEN("the budget runs out during the refinement") {
+      int pass_count = 0;
+      Canvas last_pass(1, 1);
+      const auto image = RenderUtil::render_progressive(
+          scene->camera, scene->world,
+          ProgressiveSettings{RenderSettings{1, 4, 256}, 8,
+                              std::chrono::milliseconds(1)},
+          [&](const Canvas& pass_image, const PassInfo&) {
+            ++pass_count;
+            last_pass = pass_image;
+          });
+      THEN("the coarse pass is still delivered")
+      AND_THEN("the image of the last completed pass is returned") {
+        REQUIRE(pass_count >= 1);
+        REQUIRE(pass_count < 4);
+        REQUIRE(image.pixels() == last_pass.pixels());
+      }
+    }
+  }
+}
+
+SCENARIO("Accumulating samples after the image is complete") {
+  GIVEN("the sample scene") {
+    const auto scene = SceneUtil::parse(sample_scene);
+    REQUIRE(scene.has_value());
+
+    WHEN("it is rendered progressively up to 3 samples per pixel") {
+      std::vector<PassInfo> passes;
+      const auto image = RenderUtil::render_progressive(
+          scene->camera, scene->world,
+          ProgressiveSettings{RenderSettings{2, 8, 1}, 4, {}, 3},
+          [&](const Canvas&, const PassInfo& info) { passes.push_back(info); });
+      AccumulationBuffer buffer(40, 20);
+      for (int i = 0; i < 3; ++i)
+        RenderUtil::accumulate(scene->camera, scene->world, buffer);
+
+      THEN("two passes of one sample follow the refinement passes")
+      AND_THEN("the image matches accumulating the same samples directly") {
+        REQUIRE(passes.size() == 5);
+        REQUIRE(passes[2].step == 1);
+        REQUIRE_FALSE(passes[2].last);
+        REQUIRE(passes[4].samples == 3);
+        REQUIRE(passes[4].last);
+        REQUIRE(buffer.count(5, 5) == 3);
+        REQUIRE(image.pixels() == buffer.resolve().pixels());
+      }
+    }
+  }
+}
+
+SCENARIO("Streaming rows to an encoder while rendering") {
+  GIVEN("the sample scene") {
+    const auto scene = SceneUtil::parse(sample_scene);
+    REQUIRE(scene.has_value());
+
+    WHEN("it is streamed to a PPM writer on three threads")
+    AND_WHEN("with adaptive sampling") {
+      const RenderSettings plain{3, 7, 1};
+      const RenderSettings adaptive{3, 6, 1, 4};
+      std::ostringstream plain_ppm;
+      std::ostringstream adaptive_ppm;
+      PpmRowWriter plain_writer(plain_ppm, 40, 20);
+      PpmRowWriter adaptive_writer(adaptive_ppm, 40, 20);
+      const auto plain_image = RenderUtil::render_streamed(
+          scene->camera, scene->world, plain_writer, plain);
+      const auto adaptive_image = RenderUtil::render_streamed(
+          scene->camera, scene->world, adaptive_writer, adaptive);
+
+      THEN("the streamed files equal the export of the rendered images")
+      AND_THEN("the images equal plain renders") {
+        REQUIRE(plain_ppm.str() == CanvasUtil::to_ppm(plain_image));
+        REQUIRE(adaptive_ppm.str() == CanvasUtil::to_ppm(adaptive_image));
+        REQUIRE(plain_image.pixels() ==
+                RenderUtil::render(scene->camera, scene->world, plain)
+                    .pixels());
+        REQUIRE(adaptive_image.pixels() ==
+                RenderUtil::render(scene->camera, scene->world, adaptive)
+                    .pixels());
+      }
+    }
+    WHEN("rows are collected by a sink") {
+      struct RowOrder {
+        std::vector<int> rows;
+        void write_row(int y, const Color*) { rows.push_back(y); }
+      } sink;
+      RenderUtil::render_streamed(scene->camera, scene->world, sink,
+                                  RenderSettings{4, 3, 1});
+
+      THEN("every row arrives once, top to bottom") {
+        REQUIRE(sink.rows.size() == 20);
+        for (std::size_t y = 0; y < sink.rows.size(); ++y)
+          REQUIRE(sink.rows[y] == static_cast<int>(y));
+      }
+    }
+    WHEN("the sink fails on a row") {
+      struct FailingSink {
+        void write_row(int y, const Color*) {
+          if (y == 5) throw std::runtime_error("disk full");
+        }
+      } sink;
+
+      THEN("the error is rethrown to the caller") {
+        REQUIRE_THROWS_WITH(
+            RenderUtil::render_streamed(scene->camera, scene->world, sink,
+                                        RenderSettings{4, 3, 1}),
+            "disk full");
+      }
+    }
+  }
+  GIVEN("a row tracker waiting for rows that never come") {
+    RenderUtil::detail::RowTracker tracker(4, 4, 2);
+
+    WHEN("it is cancelled") {
+      std::optional<int> ready{0};
+      std::thread consumer([&] { ready = tracker.wait_for_rows(0); });
+      tracker.cancel();
+      consumer.join();
+
+      THEN("the consumer is released without rows") {
+        REQUIRE_FALSE(ready.has_value());
+      }
+    }
+  }
+  GIVEN("tiles rendered on four threads, one of which fails") {
+    const auto render_tile = [](int x0, int y0, int, int) {
+      if (x0 == 8 && y0 == 8) throw std::runtime_error("out of memory");
+    };
+
+    THEN("the error is rethrown to the caller once the workers are done") {
+      REQUIRE_THROWS_WITH(RenderUtil::detail::for_each_tile(
+                              64, 64, RenderSettings{4, 4, 1}, render_tile,
+                              [] { return false; }),
+                          "out of memory");
+    }
+  }
+}
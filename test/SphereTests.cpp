@@ -5,6 +5,7 @@
 #include "../src/MatrixTransformations.hpp"
 #include "../src/Shape.hpp"
 #include "../src/Tuple.hpp"
+#include "../src/World.hpp"
 
 using namespace TupleUtil;
 using namespace MathUtil;
@@ -157,9 +158,15 @@ SCENARIO("The default material") {
 SCENARIO("A sphere has a default material") {
   GIVEN("s <- Sphere()") {
     constexpr Sphere s;
-    WHEN("m <- s.material") {
-      constexpr auto m = s.material;
-      THEN("m = material()") { STATIC_REQUIRE(m == Material()); }
+    WHEN("m <- the material of s in a world") {
+      constexpr auto is_default = [s = s] {
+        const World w;
+        return w.material(s.material) == Material();
+      }();
+      THEN("m = material()") {
+        STATIC_REQUIRE(s.material == 0);
+        STATIC_REQUIRE(is_default);
+      }
     }
   }
 }
@@ -174,12 +181,13 @@ SCENARIO("A sphere may be assigned a material") {
       ret.ambient = 1;
       return ret;
     }();
-    WHEN("s.material <- m") {
-      constexpr Sphere s2 = [s = s, &m]() mutable {
-        s.material = m;
-        return s;
+    WHEN("s.material <- the index of m in a world") {
+      constexpr auto assigned = [s = s, &m]() mutable {
+        World w;
+        s.material = w.add(m);
+        return s.material != 0 && w.material(s.material) == m;
       }();
-      THEN("s.material = m") { STATIC_REQUIRE(s2.material == m); }
+      THEN("the material of s = m") { STATIC_REQUIRE(assigned); }
     }
   }
 }
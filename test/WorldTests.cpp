@@ -0,0 +1,753 @@
+#include <array>
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <numbers>
+#include <vector>
+
+#include "../src/Instance.hpp"
+#include "../src/MatrixTransformations.hpp"
+#include "../src/Ray.hpp"
+#include "../src/Shape.hpp"
+#include "../src/Tuple.hpp"
+#include "../src/World.hpp"
+
+using namespace TupleUtil;
+using namespace MatrixUtil;
+using namespace WorldUtil;
+
+namespace {
+
+constexpr World default_world() {
+  World w;
+  w.add(PointLight(point(-10, 10, -10), Color(1, 1, 1)));
+
+  Material m1;
+  m1.color = Color(0.8f, 1.0f, 0.6f);
+  m1.diffuse = 0.7f;
+  m1.specular = 0.2f;
+  Sphere s1;
+  s1.material = w.add(m1);
+  w.add(s1);
+
+  Sphere s2;
+  s2.transform = scaling(0.5f, 0.5f, 0.5f);
+  w.add(s2);
+  return w;
+}
+
+// Adds the shapes of another world to w with their materials, changed by
+// edit first
+template <typename Edit = void (*)(Material&)>
+constexpr void add_shapes(World& w, const World& from,
+                          Edit edit = [](Material&) {}) {
+  for (std::size_t i = 0; i < from.size(); ++i) {
+    auto material = from.object_material(i);
+    edit(material);
+    auto shape = from.objects()[i];
+    std::visit([id = w.add(material)](auto& s) { s.material = id; }, shape);
+    w.add(shape);
+  }
+}
+
+// default_world() with a prototype of a sphere and a cube drawn by two
+// instances of a material with ambient 1 at x = 10 and x = 20
+constexpr World instanced_world() {
+  auto w = default_world();
+  const std::vector<Shape> shapes{Sphere{translation(0, 0, -2)},
+                                  Cube{translation(0, 0, 2)}};
+  const auto prototype = w.add(Prototype(shapes));
+  Material m;
+  m.ambient = 1;
+  const auto material = w.add(m);
+  w.add(Instance{prototype, translation(10, 0, 0), material});
+  w.add(Instance{prototype, translation(20, 0, 0), material});
+  return w;
+}
+
+}  // namespace
+
+SCENARIO("A world caches the inverse of every shape transformation") {
+  GIVEN("w <- default_world()") {
+    constexpr auto inverses_are_cached = [] {
+      const auto w = default_world();
+      return w.size() == 2 && w.lights().size() == 1 &&
+             w.inverse_transform(0) == identity<4>() &&
+             w.inverse_transform(1) == scaling(2, 2, 2);
+    }();
+    THEN("w.inverse_transform(1) = inverse(scaling(0.5, 0.5, 0.5))") {
+      STATIC_REQUIRE(inverses_are_cached);
+    }
+  }
+}
+
+SCENARIO("A world stores every material once") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("m <- a material with ambient 1") {
+    constexpr auto table = [] {
+      auto w = default_world();
+      Material m;
+      m.ambient = 1;
+      const auto first = w.add(m);
+      const auto second = w.add(m);
+      const auto default_id = w.add(Material{});
+      return std::array{static_cast<std::size_t>(first),
+                        static_cast<std::size_t>(second),
+                        static_cast<std::size_t>(default_id),
+                        w.materials().size()};
+    }();
+    constexpr auto shape_materials = [] {
+      const auto w = default_world();
+      return w.object_material(0).color == Color(0.8f, 1.0f, 0.6f) &&
+             w.object_material(1) == Material{};
+    }();
+    THEN("the default material comes first")
+    AND_THEN("adding m twice stores it once")
+    AND_THEN("shapes find their material through its index") {
+      STATIC_REQUIRE(table[0] == 2);
+      STATIC_REQUIRE(table[1] == 2);
+      STATIC_REQUIRE(table[2] == 0);
+      STATIC_REQUIRE(table[3] == 3);
+      STATIC_REQUIRE(shape_materials);
+    }
+  }
+}
+
+SCENARIO("A world keeps what intersection tests read apart from the shapes") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("a closed cylinder truncated at 1 and 2 added to w") {
+    constexpr auto hot_data = [] {
+      auto w = default_world();
+      w.add(Cylinder{translation(0, 1, 0), 0, 1, 2, true});
+      const auto& truncation = w.truncation(2);
+      return w.type(0) == ShapeType::Sphere &&
+             w.type(2) == ShapeType::Cylinder &&
+             truncation.object_type == ShapeType::Cylinder &&
+             truncation.minimum == 1 && truncation.maximum == 2 &&
+             truncation.closed;
+    }();
+    constexpr auto count = [] {
+      auto w = default_world();
+      w.add(Cylinder{translation(0, 1, 0), 0, 1, 2, true});
+      const Ray r{point(0, 2.5f, -5), vector(0, 0, 1)};
+      std::vector<Intersection> xs;
+      WorldUtil::visit_intersectable(w, 2, [&](const auto& shape) {
+        RayUtil::local_intersect(
+            RayUtil::transform(r, w.inverse_transform(2)), shape, xs);
+      });
+      return xs.size();
+    }();
+    THEN("w holds the type and truncation of every shape")
+    AND_THEN("the cylinder is intersected through its truncation alone") {
+      STATIC_REQUIRE(hot_data);
+      STATIC_REQUIRE(count == 2);
+    }
+  }
+}
+
+SCENARIO("A world packs the spheres it can test without their matrix") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("nine spheres translated along x added to w")
+  AND_GIVEN("a rotated sphere added to w") {
+    constexpr auto layout = [] {
+      auto w = default_world();
+      for (int i = 0; i < 9; ++i)
+        w.add(Sphere{translation(static_cast<float>(3 * i + 3), 0, 0)});
+      w.add(Sphere{rotation_y(0.5f)});
+      return std::array{w.sphere_packets().size(),
+                        w.sphere_packets()[1].count,
+                        w.sphere_packets()[1].index[2],
+                        w.transformed_shapes().size(),
+                        w.transformed_shapes()[0]};
+    }();
+    constexpr auto xs = [] {
+      auto w = default_world();
+      for (int i = 0; i < 9; ++i)
+        w.add(Sphere{translation(static_cast<float>(3 * i + 3), 0, 0)});
+      w.add(Sphere{rotation_y(0.5f)});
+      return hit(w, Ray{point(24, 0, -5), vector(0, 0, 1)});
+    }();
+    THEN("the eleven translated or scaled spheres fill two packets")
+    AND_THEN("only the rotated sphere goes through its matrix")
+    AND_THEN("a hit on a packed sphere refers to its place in w") {
+      STATIC_REQUIRE(layout[0] == 2);
+      STATIC_REQUIRE(layout[1] == 3);
+      STATIC_REQUIRE(layout[2] == 10);
+      STATIC_REQUIRE(layout[3] == 1);
+      STATIC_REQUIRE(layout[4] == 11);
+      STATIC_REQUIRE(xs == Intersection(4, ShapeType::Sphere, 9));
+    }
+  }
+}
+
+SCENARIO("A world draws instances of a prototype stored once") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("a prototype of a sphere and a cube added to w")
+  AND_GIVEN("two instances of it at x = 10 and x = 20 with material m") {
+    constexpr auto stale = [] {
+      auto w = instanced_world();
+      return w.instance_bvh() == nullptr &&
+             hit(w, Ray{point(20, 0, -8), vector(0, 0, 1)}) ==
+                 Intersection(5, ShapeType::Sphere, 3, 0);
+    }();
+    constexpr auto xs = [] {
+      auto w = instanced_world();
+      w.build_instance_bvh();
+      return hit(w, Ray{point(10, 0, 10), vector(0, 0, -1)});
+    }();
+    constexpr auto comps_are_instanced = [] {
+      auto w = instanced_world();
+      w.build_instance_bvh();
+      const Ray r{point(10, 0, 10), vector(0, 0, -1)};
+      const auto comps = prepare_computations(*hit(w, r), r, w);
+      return comps.normal_vector == vector(0, 0, 1) && comps.primitive == 1 &&
+             w.object_material(comps.object).ambient == 1;
+    }();
+    constexpr auto moved = [] {
+      auto w = instanced_world();
+      w.build_instance_bvh();
+      w.set_transform(1, translation(30, 0, 0));
+      const auto stale_after_move = w.instance_bvh() == nullptr;
+      w.build_instance_bvh();
+      return stale_after_move && w.prototypes().size() == 1 &&
+             !hit(w, Ray{point(20, 0, -10), vector(0, 0, 1)}) &&
+             hit(w, Ray{point(30, 0, -10), vector(0, 0, 1)})->index() == 3;
+    }();
+    THEN("hits on an instance refer to size() plus its place in instances()")
+    AND_THEN("they carry the primitive of the prototype that was hit")
+    AND_THEN("the normal and material come from the instance")
+    AND_THEN("instances are found without their hierarchy until it is built")
+    AND_THEN("moving an instance only rebuilds the hierarchy over instances") {
+      STATIC_REQUIRE(xs == Intersection(7, ShapeType::Cube, 2, 1));
+      STATIC_REQUIRE(comps_are_instanced);
+      STATIC_REQUIRE(stale);
+      STATIC_REQUIRE(moved);
+    }
+  }
+}
+
+SCENARIO("Moving instances refits the hierarchy over them") {
+  GIVEN("w <- a world with two instances and their hierarchy built")
+  AND_GIVEN("the second instance moved up by 1") {
+    constexpr auto refitted = [] {
+      auto w = instanced_world();
+      w.build_instance_bvh();
+      w.set_transform(1, translation(20, 1, 0));
+      const auto rebuilt = w.update_instance_bvh();
+      return !rebuilt && w.instance_bvh() != nullptr &&
+             w.instance_bvh()->nodes[0].bounds.max[1] == 2 &&
+             hit(w, Ray{point(20, 1, -8), vector(0, 0, 1)}) ==
+                 Intersection(5, ShapeType::Sphere, 3, 0);
+    }();
+    constexpr auto added = [] {
+      auto w = instanced_world();
+      w.build_instance_bvh();
+      w.add(Instance{0, translation(40, 0, 0)});
+      return w.update_instance_bvh() &&
+             w.instance_bvh()->items.size() == 3 &&
+             !w.update_instance_bvh();
+    }();
+    THEN("updating the hierarchy refits it in place")
+    AND_THEN("rays find the instance where it moved")
+    AND_THEN("adding an instance builds the hierarchy again") {
+      STATIC_REQUIRE(refitted);
+      STATIC_REQUIRE(added);
+    }
+  }
+}
+
+SCENARIO("The hit of a ray in a world is its nearest intersection") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("r <- ray(point(0, 0, -5), vector(0, 0, 1))") {
+    constexpr auto xs = [] {
+      const auto w = default_world();
+      return hit(w, Ray{point(0, 0, -5), vector(0, 0, 1)});
+    }();
+    constexpr auto inner = [] {
+      const auto w = default_world();
+      return hit(w, Ray{point(0, 0, 0), vector(0, 0, 1)});
+    }();
+    THEN("hit(w, r).t = 4 on the first shape")
+    AND_THEN("a ray starting inside the spheres hits the inner one first") {
+      STATIC_REQUIRE(xs == Intersection(4, ShapeType::Sphere, 0));
+      STATIC_REQUIRE(inner == Intersection(0.5f, ShapeType::Sphere, 1));
+    }
+  }
+}
+
+SCENARIO("Precomputing the state of an intersection") {
+  GIVEN("r <- ray(point(0, 0, -5), vector(0, 0, 1))")
+  AND_GIVEN("i <- intersection(4, shape)") {
+    constexpr auto comps = [] {
+      World w;
+      w.add(Sphere{});
+      return prepare_computations(Intersection(4, ShapeType::Sphere, 0),
+                                  Ray{point(0, 0, -5), vector(0, 0, 1)}, w);
+    }();
+    THEN("comps.point = point(0, 0, -1)")
+    AND_THEN("comps.eyev = vector(0, 0, -1)")
+    AND_THEN("comps.normalv = vector(0, 0, -1)")
+    AND_THEN("comps.inside = false") {
+      STATIC_REQUIRE(comps.t == 4);
+      STATIC_REQUIRE(comps.object == 0);
+      STATIC_REQUIRE(comps.point == point(0, 0, -1));
+      STATIC_REQUIRE(comps.eye_vector == vector(0, 0, -1));
+      STATIC_REQUIRE(comps.normal_vector == vector(0, 0, -1));
+      STATIC_REQUIRE_FALSE(comps.inside);
+    }
+  }
+}
+
+SCENARIO("The hit, when an intersection occurs on the inside") {
+  GIVEN("r <- ray(point(0, 0, 0), vector(0, 0, 1))")
+  AND_GIVEN("i <- intersection(1, shape)") {
+    constexpr auto comps = [] {
+      World w;
+      w.add(Sphere{});
+      return prepare_computations(Intersection(1, ShapeType::Sphere, 0),
+                                  Ray{point(0, 0, 0), vector(0, 0, 1)}, w);
+    }();
+    THEN("comps.point = point(0, 0, 1)")
+    AND_THEN("comps.eyev = vector(0, 0, -1)")
+    AND_THEN("comps.inside = true")
+    AND_THEN("comps.normalv = vector(0, 0, -1)") {
+      STATIC_REQUIRE(comps.point == point(0, 0, 1));
+      STATIC_REQUIRE(comps.eye_vector == vector(0, 0, -1));
+      STATIC_REQUIRE(comps.inside);
+      STATIC_REQUIRE(comps.normal_vector == vector(0, 0, -1));
+    }
+  }
+}
+
+SCENARIO("The hit should offset the point") {
+  GIVEN("shape <- sphere() with transform translation(0, 0, 1)")
+  AND_GIVEN("i <- intersection(5, shape)") {
+    constexpr auto comps = [] {
+      World w;
+      w.add(Sphere{translation(0, 0, 1)});
+      return prepare_computations(Intersection(5, ShapeType::Sphere, 0),
+                                  Ray{point(0, 0, -5), vector(0, 0, 1)}, w);
+    }();
+    THEN("comps.over_point.z < -EPSILON/2")
+    AND_THEN("comps.point.z > comps.over_point.z") {
+      STATIC_REQUIRE(comps.over_point.z < -MathUtil::default_epsilon / 2);
+      STATIC_REQUIRE(comps.point.z > comps.over_point.z);
+    }
+  }
+}
+
+SCENARIO("Shading an intersection") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("r <- ray(point(0, 0, -5), vector(0, 0, 1))")
+  AND_GIVEN("i <- intersection(4, first shape of w)") {
+    // The specular term underflows std::pow, which GCC does not fold in
+    // constant expressions
+    const auto c = [] {
+      const auto w = default_world();
+      const Ray r{point(0, 0, -5), vector(0, 0, 1)};
+      return shade_hit(
+          w, prepare_computations(Intersection(4, ShapeType::Sphere, 0), r,
+                                  w));
+    }();
+    THEN("shade_hit(w, comps) = color(0.38066, 0.47583, 0.2855)") {
+      REQUIRE(c == Color(0.38066f, 0.47583f, 0.2855f));
+    }
+  }
+}
+
+SCENARIO("Shading an intersection from the inside") {
+  GIVEN("w <- default_world() with light point(0, 0.25, 0)")
+  AND_GIVEN("r <- ray(point(0, 0, 0), vector(0, 0, 1))")
+  AND_GIVEN("i <- intersection(0.5, second shape of w)") {
+    constexpr auto c = [] {
+      World w;
+      w.add(PointLight(point(0, 0.25f, 0), Color(1, 1, 1)));
+      const auto defaults = default_world();
+      add_shapes(w, defaults);
+      const Ray r{point(0, 0, 0), vector(0, 0, 1)};
+      return shade_hit(
+          w, prepare_computations(Intersection(0.5f, ShapeType::Sphere, 1), r,
+                                  w));
+    }();
+    THEN("shade_hit(w, comps) = color(0.90498, 0.90498, 0.90498)") {
+      STATIC_REQUIRE(c == Color(0.90498f, 0.90498f, 0.90498f));
+    }
+  }
+}
+
+SCENARIO("shade_hit() is given an intersection in shadow") {
+  GIVEN("w <- world() with light point(0, 0, -10)")
+  AND_GIVEN("s1 <- sphere() and s2 <- sphere() at translation(0, 0, 10)")
+  AND_GIVEN("i <- intersection(4, s2)") {
+    constexpr auto c = [] {
+      World w;
+      w.add(PointLight(point(0, 0, -10), Color(1, 1, 1)));
+      w.add(Sphere{});
+      w.add(Sphere{translation(0, 0, 10)});
+      const Ray r{point(0, 0, 5), vector(0, 0, 1)};
+      return shade_hit(
+          w, prepare_computations(Intersection(4, ShapeType::Sphere, 1), r,
+                                  w));
+    }();
+    THEN("shade_hit(w, comps) = color(0.1, 0.1, 0.1)") {
+      STATIC_REQUIRE(c == Color(0.1f, 0.1f, 0.1f));
+    }
+  }
+}
+
+SCENARIO("Testing which points are in shadow") {
+  GIVEN("w <- default_world()") {
+    constexpr auto shadowed = [](float x, float y, float z) {
+      const auto w = default_world();
+      return is_shadowed(w, point(x, y, z), w.lights()[0]);
+    };
+    THEN("nothing is collinear with point and light")
+    AND_THEN("the shadow is cast when an object is between point and light")
+    AND_THEN("there is no shadow when an object is behind the light")
+    AND_THEN("there is no shadow when an object is behind the point") {
+      STATIC_REQUIRE_FALSE(shadowed(0, 10, 0));
+      STATIC_REQUIRE(shadowed(10, -10, 10));
+      STATIC_REQUIRE_FALSE(shadowed(-20, 20, -20));
+      STATIC_REQUIRE_FALSE(shadowed(-2, 2, -2));
+    }
+  }
+}
+
+SCENARIO("The color when a ray misses or hits") {
+  GIVEN("w <- default_world()") {
+    constexpr auto miss = [] {
+      return color_at(default_world(), Ray{point(0, 0, -5), vector(0, 1, 0)});
+    }();
+    const auto hit_color =
+        color_at(default_world(), Ray{point(0, 0, -5), vector(0, 0, 1)});
+    THEN("a ray that misses is black")
+    AND_THEN("a ray that hits is shaded") {
+      STATIC_REQUIRE(miss == Color(0, 0, 0));
+      REQUIRE(hit_color == Color(0.38066f, 0.47583f, 0.2855f));
+    }
+  }
+}
+
+SCENARIO("The color with an intersection behind the ray") {
+  GIVEN("w <- default_world() whose shapes have ambient 1")
+  AND_GIVEN("r <- ray(point(0, 0, 0.75), vector(0, 0, -1))") {
+    constexpr auto c = [] {
+      World w;
+      const auto defaults = default_world();
+      add_shapes(w, defaults, [](Material& m) { m.ambient = 1; });
+      w.add(PointLight(point(-10, 10, -10), Color(1, 1, 1)));
+      return color_at(w, Ray{point(0, 0, 0.75f), vector(0, 0, -1)});
+    }();
+    THEN("color_at(w, r) = inner.material.color") {
+      STATIC_REQUIRE(c == Color(1, 1, 1));
+    }
+  }
+}
+
+namespace {
+
+constexpr float half_sqrt2 = std::numbers::sqrt2_v<float> / 2;
+
+// The default world with a plane below the spheres
+constexpr World world_with_floor(const Material& floor_material) {
+  auto w = default_world();
+  w.add(Plane{translation(0, -1, 0), w.add(floor_material)});
+  return w;
+}
+
+constexpr Ray ray_to_floor() {
+  return Ray{point(0, 0, -3), vector(0, -half_sqrt2, half_sqrt2)};
+}
+
+constexpr Material reflective_material(float reflective) {
+  Material material;
+  material.reflective = reflective;
+  return material;
+}
+
+constexpr Material glass_material() {
+  Material material;
+  material.transparency = 1;
+  material.refractive_index = 1.5f;
+  return material;
+}
+
+// A point light between two parallel mirrors
+constexpr World facing_mirrors(float reflective) {
+  World w;
+  w.add(PointLight(point(0, 0, 0), Color(1, 1, 1)));
+  const auto mirror = w.add(reflective_material(reflective));
+  w.add(Plane{translation(0, -1, 0), mirror});
+  w.add(Plane{translation(0, 1, 0), mirror});
+  return w;
+}
+
+}  // namespace
+
+SCENARIO("Precomputing the reflection vector and the refractive indices") {
+  GIVEN("shape <- plane() and a glass sphere")
+  AND_GIVEN("r <- ray(point(0, 1, -1), vector(0, -√2/2, √2/2))") {
+    constexpr auto comps = [] {
+      World w;
+      w.add(Plane{});
+      return prepare_computations(
+          Intersection(std::numbers::sqrt2_v<float>, ShapeType::Plane, 0),
+          Ray{point(0, 1, -1), vector(0, -half_sqrt2, half_sqrt2)}, w);
+    }();
+    constexpr auto entering = [] {
+      World w;
+      w.add(Sphere{scaling(2, 2, 2), w.add(glass_material())});
+      return prepare_computations(Intersection(2, ShapeType::Sphere, 0),
+                                  Ray{point(0, 0, -4), vector(0, 0, 1)}, w);
+    }();
+    constexpr auto leaving = [] {
+      World w;
+      w.add(Sphere{scaling(2, 2, 2), w.add(glass_material())});
+      return prepare_computations(Intersection(6, ShapeType::Sphere, 0),
+                                  Ray{point(0, 0, -4), vector(0, 0, 1)}, w);
+    }();
+    THEN("comps.reflectv = vector(0, √2/2, √2/2)")
+    AND_THEN("a ray entering the glass goes from n1 = 1 to n2 = 1.5")
+    AND_THEN("a ray leaving it goes from n1 = 1.5 to n2 = 1")
+    AND_THEN("the under point is below the surface") {
+      STATIC_REQUIRE(comps.reflect_vector ==
+                     vector(0, half_sqrt2, half_sqrt2));
+      STATIC_REQUIRE(entering.n1 == 1.f);
+      STATIC_REQUIRE(entering.n2 == 1.5f);
+      STATIC_REQUIRE(leaving.n1 == 1.5f);
+      STATIC_REQUIRE(leaving.n2 == 1.f);
+      STATIC_REQUIRE(entering.under_point.z > entering.point.z);
+      STATIC_REQUIRE(entering.over_point.z < entering.point.z);
+    }
+  }
+}
+
+SCENARIO("Finding n1 and n2 at various intersections") {
+  GIVEN("A <- glass_sphere() with scaling(2, 2, 2) and refractive index 1.5")
+  AND_GIVEN("B <- glass_sphere() with translation(0, 0, -0.25) and index 2")
+  AND_GIVEN("C <- glass_sphere() with translation(0, 0, 0.25) and index 2.5")
+  AND_GIVEN("r <- ray(point(0, 0, -4), vector(0, 0, 1))") {
+    constexpr auto indices = [](float t, std::size_t object) {
+      World w;
+      const auto glass = [&](float refractive_index) {
+        auto material = glass_material();
+        material.refractive_index = refractive_index;
+        return w.add(material);
+      };
+      w.add(Sphere{scaling(2, 2, 2), glass(1.5f)});
+      w.add(Sphere{translation(0, 0, -0.25f), glass(2)});
+      w.add(Sphere{translation(0, 0, 0.25f), glass(2.5f)});
+      const auto comps = prepare_computations(
+          Intersection(t, ShapeType::Sphere, object),
+          Ray{point(0, 0, -4), vector(0, 0, 1)}, w);
+      return std::array{comps.n1, comps.n2};
+    };
+    constexpr auto in_glass_instance = [](bool hierarchy) {
+      World w;
+      const std::vector<Shape> shapes{Sphere{}};
+      const auto prototype = w.add(Prototype(shapes));
+      w.add(Instance{prototype, scaling(2, 2, 2), w.add(glass_material())});
+      if (hierarchy) w.build_instance_bvh();
+      auto liquid = glass_material();
+      liquid.refractive_index = 1.25f;
+      w.add(Sphere{identity<4>(), w.add(liquid)});
+      const auto comps = prepare_computations(
+          Intersection(3, ShapeType::Sphere, 0),
+          Ray{point(0, 0, -4), vector(0, 0, 1)}, w);
+      return std::array{comps.n1, comps.n2};
+    };
+    THEN("the indices at xs = 2:A, 2.75:B, 3.25:C, 4.75:B, 5.25:C, 6:A are "
+         "1/1.5, 1.5/2, 2/2.5, 2.5/2.5, 2.5/1.5 and 1.5/1")
+    AND_THEN("objects enclosing the hit are found among instances too") {
+      STATIC_REQUIRE(indices(2, 0) == std::array{1.f, 1.5f});
+      STATIC_REQUIRE(indices(2.75f, 1) == std::array{1.5f, 2.f});
+      STATIC_REQUIRE(indices(3.25f, 2) == std::array{2.f, 2.5f});
+      STATIC_REQUIRE(indices(4.75f, 1) == std::array{2.5f, 2.5f});
+      STATIC_REQUIRE(indices(5.25f, 2) == std::array{2.5f, 1.5f});
+      STATIC_REQUIRE(indices(6, 0) == std::array{1.5f, 1.f});
+      STATIC_REQUIRE(in_glass_instance(false) == std::array{1.5f, 1.25f});
+      STATIC_REQUIRE(in_glass_instance(true) == std::array{1.5f, 1.25f});
+    }
+  }
+}
+
+SCENARIO("The reflected color for a nonreflective material") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("r <- ray(point(0, 0, 0), vector(0, 0, 1))")
+  AND_GIVEN("shape <- the second object in w with ambient 1") {
+    constexpr auto c = [] {
+      World w;
+      const auto defaults = default_world();
+      add_shapes(w, defaults, [](Material& m) { m.ambient = 1; });
+      const Ray r{point(0, 0, 0), vector(0, 0, 1)};
+      return reflected_color(
+          w, prepare_computations(Intersection(1, ShapeType::Sphere, 1), r,
+                                  w));
+    }();
+    THEN("reflected_color(w, comps) = color(0, 0, 0)") {
+      STATIC_REQUIRE(c == Color(0, 0, 0));
+    }
+  }
+}
+
+SCENARIO("The reflected color for a reflective material") {
+  GIVEN("shape <- plane() with reflective 0.5 and translation(0, -1, 0)")
+  AND_GIVEN("r <- ray(point(0, 0, -3), vector(0, -√2/2, √2/2))") {
+    const auto w = world_with_floor(reflective_material(0.5f));
+    const auto comps = prepare_computations(
+        Intersection(std::numbers::sqrt2_v<float>, ShapeType::Plane, 2),
+        ray_to_floor(), w);
+    const auto reflected = reflected_color(w, comps);
+    const auto shaded = shade_hit(w, comps);
+    THEN("reflected_color(w, comps) = color(0.19032, 0.2379, 0.14274)")
+    AND_THEN("shade_hit(w, comps) = color(0.87677, 0.92436, 0.82918)") {
+      REQUIRE(reflected == Color(0.19032f, 0.2379f, 0.14274f));
+      REQUIRE(shaded == Color(0.87677f, 0.92436f, 0.82918f));
+    }
+  }
+}
+
+SCENARIO("Secondary rays stop at the maximum depth") {
+  GIVEN("two facing mirrors and a light between them")
+  AND_GIVEN("r <- ray(point(0, 0, 0), vector(0, 1, 0))") {
+    constexpr auto counters = [](int max_depth) {
+      RayCounters result;
+      static_cast<void>(color_at(facing_mirrors(1),
+                                 Ray{point(0, 0, 0), vector(0, 1, 0)},
+                                 TraceLimits{max_depth, 0.001f}, {},
+                                 &result));
+      return result;
+    };
+    constexpr auto at_limit = [] {
+      const auto w = world_with_floor(reflective_material(0.5f));
+      const auto comps = prepare_computations(
+          Intersection(std::numbers::sqrt2_v<float>, ShapeType::Plane, 2),
+          ray_to_floor(), w);
+      return reflected_color(w, comps, TraceLimits{}, RayPath{5, 1.f});
+    }();
+    THEN("color_at(w, r) terminates after max_depth reflections")
+    AND_THEN("every hit casts one shadow ray per light")
+    AND_THEN("a ray at the maximum depth reflects black") {
+      STATIC_REQUIRE(counters(5) == RayCounters{1, 5, 0, 6});
+      STATIC_REQUIRE(counters(0) == RayCounters{1, 0, 0, 1});
+      STATIC_REQUIRE(at_limit == Color(0, 0, 0));
+    }
+  }
+}
+
+SCENARIO("Secondary rays stop below the minimum contribution") {
+  GIVEN("two facing mirrors with reflective 0.5")
+  AND_GIVEN("limits with a minimum contribution of 0.1") {
+    constexpr auto counters = [] {
+      RayCounters result;
+      static_cast<void>(color_at(facing_mirrors(0.5f),
+                                 Ray{point(0, 0, 0), vector(0, 1, 0)},
+                                 TraceLimits{20, 0.1f}, {}, &result));
+      return result;
+    }();
+    THEN("rays with weights 0.5, 0.25 and 0.125 are cast")
+    AND_THEN("the ray with weight 0.0625 is not") {
+      STATIC_REQUIRE(counters.reflection == 3);
+      STATIC_REQUIRE(counters.secondary() == 3);
+    }
+  }
+}
+
+SCENARIO("The refracted color of opaque and totally reflecting surfaces") {
+  GIVEN("w <- default_world()")
+  AND_GIVEN("r <- ray(point(0, 0, -5), vector(0, 0, 1))") {
+    constexpr auto opaque = [] {
+      const auto w = default_world();
+      return refracted_color(
+          w, prepare_computations(Intersection(4, ShapeType::Sphere, 0),
+                                  Ray{point(0, 0, -5), vector(0, 0, 1)}, w));
+    }();
+    constexpr auto glass_world = [] {
+      World w;
+      w.add(PointLight(point(-10, 10, -10), Color(1, 1, 1)));
+      w.add(Sphere{identity<4>(), w.add(glass_material())});
+      return w;
+    };
+    constexpr auto at_limit = [&] {
+      const auto w = glass_world();
+      return refracted_color(
+          w,
+          prepare_computations(Intersection(4, ShapeType::Sphere, 0),
+                               Ray{point(0, 0, -5), vector(0, 0, 1)}, w),
+          TraceLimits{}, RayPath{5, 1.f});
+    }();
+    constexpr auto total_internal_reflection = [&] {
+      const auto w = glass_world();
+      RayCounters counters;
+      const auto c = refracted_color(
+          w,
+          prepare_computations(Intersection(half_sqrt2, ShapeType::Sphere, 0),
+                               Ray{point(0, 0, half_sqrt2), vector(0, 1, 0)},
+                               w),
+          TraceLimits{}, RayPath{}, &counters);
+      return c == Color(0, 0, 0) && counters == RayCounters{};
+    }();
+    THEN("an opaque surface refracts black")
+    AND_THEN("a ray at the maximum depth refracts black")
+    AND_THEN("no ray is cast under total internal reflection") {
+      STATIC_REQUIRE(opaque == Color(0, 0, 0));
+      STATIC_REQUIRE(at_limit == Color(0, 0, 0));
+      STATIC_REQUIRE(total_internal_reflection);
+    }
+  }
+}
+
+SCENARIO("shade_hit() with a transparent material") {
+  GIVEN("floor <- plane() with transparency 0.5 and refractive index 1.5")
+  AND_GIVEN("ball <- a red sphere with ambient 0.5 below the floor")
+  AND_GIVEN("r <- ray(point(0, 0, -3), vector(0, -√2/2, √2/2))") {
+    const auto floor_world = [](float reflective) {
+      Material floor;
+      floor.transparency = 0.5f;
+      floor.refractive_index = 1.5f;
+      floor.reflective = reflective;
+      auto w = world_with_floor(floor);
+      Material ball;
+      ball.color = Color(1, 0, 0);
+      ball.ambient = 0.5f;
+      w.add(Sphere{translation(0, -3.5f, -0.5f), w.add(ball)});
+      return w;
+    };
+    const auto shade = [](const World& w) {
+      return shade_hit(
+          w, prepare_computations(
+                 Intersection(std::numbers::sqrt2_v<float>, ShapeType::Plane,
+                              2),
+                 ray_to_floor(), w));
+    };
+    const auto transparent = shade(floor_world(0));
+    const auto reflective = shade(floor_world(0.5f));
+    THEN("shade_hit(w, comps) = color(0.93642, 0.68642, 0.68642)")
+    AND_THEN("a reflective floor blends both rays with the Schlick "
+             "approximation: color(0.93391, 0.69643, 0.69243)") {
+      REQUIRE(transparent == Color(0.93642f, 0.68642f, 0.68642f));
+      REQUIRE(reflective == Color(0.93391f, 0.69643f, 0.69243f));
+    }
+  }
+}
+
+SCENARIO("The Schlick approximation") {
+  GIVEN("shape <- glass_sphere()") {
+    constexpr auto reflectance = [](float t, Ray r) {
+      World w;
+      w.add(Sphere{identity<4>(), w.add(glass_material())});
+      return schlick(
+          prepare_computations(Intersection(t, ShapeType::Sphere, 0), r, w));
+    };
+    THEN("under total internal reflection it is 1")
+    AND_THEN("with a perpendicular viewing angle it is 0.04")
+    AND_THEN("with a small angle and n2 > n1 it is 0.48873") {
+      STATIC_REQUIRE(reflectance(half_sqrt2, Ray{point(0, 0, half_sqrt2),
+                                                 vector(0, 1, 0)}) == 1.f);
+      STATIC_REQUIRE(MathUtil::approx_equal(
+          reflectance(1, Ray{point(0, 0, 0), vector(0, 1, 0)}), 0.04f));
+      STATIC_REQUIRE(MathUtil::approx_equal(
+          reflectance(1.8589f, Ray{point(0, 0.99f, -2), vector(0, 0, 1)}),
+          0.48873f));
+    }
+  }
+}